@@ -41,9 +41,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/semphr.h"
 #include "esp_timer.h"
 #include "esp_system.h"
 #include "esp_wifi.h"
@@ -63,8 +65,23 @@
 #include "driver/uart.h"
 #include "hid_dev.h"
 #include "config.h"
+#include "config_store.h"
+#include "task_config.h"
+#include "indicator_led.h"
+#include "bond_cache.h"
+#include "kv_cache.h"
+#include "kv_bulk.h"
+#include "joystick_filter.h"
+#include "hid_stats.h"
+#include "hid_trace.h"
+#include "hid_bench.h"
+#include "hid_prof.h"
+#include "boot_prof.h"
+#include "uart_parser.h"
+#include "uart_capture.h"
 #include "esp_ota_ops.h"
 #include "esp_flash.h"
+#include "esp_heap_caps.h"
 
 /**
  * Brief:
@@ -164,16 +181,27 @@ int indicator_led = -1;
 static void hidd_event_callback(esp_hidd_cb_event_t event, esp_hidd_cb_param_t *param);
 
 #define MOUSE_SPEED 30
-#define MAX_CMDLEN  100
 
 #define EXT_UART_TAG "EXT_UART"
 #define CONSOLE_UART_TAG "CONSOLE_UART"
 
 static config_data_t config;
 
-#define CMDSTATE_IDLE 0
-#define CMDSTATE_GET_RAW 1
-#define CMDSTATE_GET_ASCII 2
+//stacks & TCBs of the permanent tasks (created in app_main)
+static StackType_t external_stack[TASK_STACK_EXTERNAL];
+static StaticTask_t external_tcb;
+#if CONFIG_MODULE_MINIBT
+static StackType_t console_stack[TASK_STACK_CONSOLE];
+static StaticTask_t console_tcb;
+#endif
+
+#if CONFIG_MODULE_CAPTURE
+static esp_err_t uart_replay_start(uint16_t speed);
+#endif
+
+//raw frame sizes of the parser must match the report lengths
+_Static_assert(UART_PARSER_JOY_LEN == HID_JOYSTICK_IN_RPT_LEN + 2, "joystick frame size mismatch");
+_Static_assert(UART_PARSER_JOY_HIRES_LEN == HID_JOYSTICK_HIRES_IN_RPT_LEN + 2, "wide joystick frame size mismatch");
 
 //a list of active HID connections.
 //conn_id array stores the connection ID, if unused it is -1
@@ -186,17 +214,6 @@ esp_bd_addr_t active_connections[CONFIG_BT_ACL_CONNECTIONS] = {0};
 ///@note This works only for the UART interface (uart_parse_command).
 int16_t hid_conn_id = -1;
 
-struct cmdBuf {
-	//current state of the parser, CMD_STATE*
-    int state;
-    //if a fixed length command is issued, we store expected length here
-    int expectedBytes;
-    int bufferLength;
-    //if != 0, the result of a command will be sent to the debug console AND the external UART (-> FLipMouse/FABI GUI on PC)
-    int sendToUART;
-    uint8_t buf[MAX_CMDLEN];
-};
-
 static uint8_t manufacturer[19]= {'A', 's', 'T', 'e', 'R', 'I', 'C', 'S', ' ', 'F', 'o', 'u', 'n', 'd', 'a', 't', 'i', 'o', 'n'};
 
 
@@ -218,6 +235,11 @@ static uint8_t hidd_service_uuid128[] = {
  * when the pairing mode is changed. */
 #define SYSTEM_CURRENTLY_ADVERTISING (1<<1)
 
+/** @brief Event bit, set if the configuration is loaded from NVS
+ *
+ * Loading runs in config_load_task, in parallel to the BT controller bring-up. */
+#define SYSTEM_CONFIG_LOADED (1<<2)
+
 /** @brief Event group for system status */
 EventGroupHandle_t eventgroup_system;
 
@@ -273,6 +295,39 @@ uint8_t uppercase(uint8_t c)
     return(c);
 }
 
+#if CONFIG_MODULE_USEJOYSTICK
+/** @brief Send a joystick report, which passed the joystick filter, to all connected hosts */
+static void joystick_send_filtered(uint8_t *report, uint8_t wide)
+{
+  for(uint8_t i = 0; i<CONFIG_BT_ACL_CONNECTIONS; i++)
+  {
+    if(active_hid_conn_ids[i] == -1) continue;
+    if(wide) esp_hidd_send_joy_hires_report(active_hid_conn_ids[i],report);
+    else esp_hidd_send_joy_report(active_hid_conn_ids[i],report);
+  }
+}
+#endif
+
+/** @brief Parse a BT address (12 hex digits, bytes may be separated by ' ' or ':')
+ * @return Index after the address, 0 if the address is invalid */
+int get_bdaddr(const char * input, int index, uint8_t * addr)
+{
+    while (input[index]==' ') index++;   // skip leading spaces
+    for (uint8_t i = 0; i < 6; i++) {
+        uint8_t byte = 0;
+        if (i > 0 && (input[index]==' ' || input[index]==':')) index++;
+        for (uint8_t n = 0; n < 2; n++) {
+            char c = input[index++];
+            if (c >= '0' && c <= '9') byte = (byte << 4) | (c - '0');
+            else if (c >= 'a' && c <= 'f') byte = (byte << 4) | (c + 10 - 'a');
+            else if (c >= 'A' && c <= 'F') byte = (byte << 4) | (c + 10 - 'A');
+            else return 0;
+        }
+        addr[i] = byte;
+    }
+    return index;
+}
+
 int get_int(const char * input, int index, int * value)
 {
     int sign=1, result=0, valid=0;
@@ -284,7 +339,9 @@ int get_int(const char * input, int index, int * value)
     }
     while ((input[index]>='0') && (input[index]<='9'))
     {
-        result= result*10+input[index]-'0';
+        //saturate instead of overflowing on too many digits
+        if (result <= (INT_MAX - 9) / 10) result= result*10+input[index]-'0';
+        else result = INT_MAX;
         valid=1;
         index++;
     }
@@ -301,6 +358,7 @@ int get_int(const char * input, int index, int * value)
 /** Periodic sending of empty HID reports if no updates are sent via API */
 static void periodicHIDCallback(void* arg)
 {
+	HID_PROF_SCOPE(HID_PROF_PERIODIC);
 	if((esp_timer_get_time()-timestampLastSent) > HID_IDLE_UPDATE_RATE)
 	{
 		//send empty report (but with last known button state)
@@ -327,6 +385,24 @@ bool isConnected()
 	return false;
 }
 
+//congested connections, bit per connection ID (for the indicator LED)
+static uint32_t congested_conns = 0;
+
+/**
+ * Show the connection state on the indicator LED.
+ * Called on state changes only, the LEDC peripheral does the blinking.
+ */
+static void led_show_state(void)
+{
+	if(congested_conns != 0) indicator_led_set(INDICATOR_LED_CONGESTED);
+	else if(isConnected()) indicator_led_set(INDICATOR_LED_CONNECTED);
+#if CONFIG_MODULE_BT_PAIRING
+	//pairing is disabled by default, show if it is enabled via $PM1
+	else if(xEventGroupGetBits(eventgroup_system) & SYSTEM_PAIRING_ENABLED) indicator_led_set(INDICATOR_LED_PAIRING);
+#endif
+	else indicator_led_set(INDICATOR_LED_ADVERTISING);
+}
+
 void printConnectedDevicesTable()
 {
 	for(uint8_t i = 0; i<CONFIG_BT_ACL_CONNECTIONS; i++)
@@ -341,19 +417,8 @@ void printConnectedDevicesTable()
 
 void update_config()
 {
-    nvs_handle my_handle;
-    esp_err_t err = nvs_open("config_c", NVS_READWRITE, &my_handle);
-    if(err != ESP_OK) ESP_LOGE("MAIN","error opening NVS");
-    err = nvs_set_str(my_handle, "btname", config.bt_device_name);
-    if(err != ESP_OK) ESP_LOGE("MAIN","error saving NVS - bt name");
-    err = nvs_set_u8(my_handle, "locale", config.locale);
-    if(err != ESP_OK) ESP_LOGE("MAIN","error saving NVS - locale");
-    err = nvs_set_u8(my_handle, "joyactive", config.joystick_active);
-    if(err != ESP_OK) ESP_LOGE("MAIN","error saving NVS - joystick state");
-    printf("Committing updates in NVS ... ");
-    err = nvs_commit(my_handle);
-    printf((err != ESP_OK) ? "Failed!\n" : "Done\n");
-    nvs_close(my_handle);
+    //one blob write & commit, skipped if nothing changed
+    if(config_store_save(&config) != ESP_OK) ESP_LOGE("MAIN","error saving config to NVS");
 }
 
 
@@ -365,6 +430,7 @@ static void hidd_event_callback(esp_hidd_cb_event_t event, esp_hidd_cb_param_t *
             //esp_bd_addr_t rand_addr = {0x04,0x11,0x11,0x11,0x11,0x05};
             esp_ble_gap_set_device_name(config.bt_device_name);
             esp_ble_gap_config_adv_data(&hidd_adv_data);
+            boot_prof_mark(BOOT_PROF_ADV_DATA);
         }
         break;
     }
@@ -375,6 +441,7 @@ static void hidd_event_callback(esp_hidd_cb_event_t event, esp_hidd_cb_param_t *
         break;
     case ESP_HIDD_EVENT_BLE_CONNECT: {
         ESP_LOGI(HID_DEMO_TAG, "ESP_HIDD_EVENT_BLE_CONNECT");
+        boot_prof_mark(BOOT_PROF_CONNECT);
         
         for(uint8_t i = 0; i<CONFIG_BT_ACL_CONNECTIONS;i++)
         {
@@ -386,6 +453,10 @@ static void hidd_event_callback(esp_hidd_cb_event_t event, esp_hidd_cb_param_t *
 				break;
 			}
 		}
+		#if CONFIG_MODULE_USEJOYSTICK
+		//new host: send the next joystick report, even if unchanged
+		joystick_filter_reset();
+		#endif
 		
 		//because some devices do connect with a quite high connection
 		//interval, we might have a congested channel...
@@ -402,6 +473,7 @@ static void hidd_event_callback(esp_hidd_cb_event_t event, esp_hidd_cb_param_t *
         //to allow more connections, we simply restart the adv process.
         esp_ble_gap_start_advertising(&hidd_adv_params);
         //xEventGroupClearBits(eventgroup_system,SYSTEM_CURRENTLY_ADVERTISING);
+        led_show_state();
         break;
     }
     case ESP_HIDD_EVENT_BLE_DISCONNECT: {
@@ -412,6 +484,9 @@ static void hidd_event_callback(esp_hidd_cb_event_t event, esp_hidd_cb_param_t *
 			{
 				//clear element
 				ESP_LOGI(HID_DEMO_TAG, "Removed connection: %d @ %d",active_hid_conn_ids[i],i);
+				//selected host ($SW) is gone, send to all again
+				if(hid_conn_id == active_hid_conn_ids[i]) hid_conn_id = -1;
+				congested_conns &= ~(1UL << (active_hid_conn_ids[i] & 31));
 				memset(active_connections[i],0,sizeof(esp_bd_addr_t));
 				active_hid_conn_ids[i] = -1;
 				break;
@@ -421,6 +496,7 @@ static void hidd_event_callback(esp_hidd_cb_event_t event, esp_hidd_cb_param_t *
         ESP_LOGI(HID_DEMO_TAG, "ESP_HIDD_EVENT_BLE_DISCONNECT");
         esp_ble_gap_start_advertising(&hidd_adv_params);
         xEventGroupSetBits(eventgroup_system,SYSTEM_CURRENTLY_ADVERTISING);
+        led_show_state();
         break;
     }
     /**
@@ -436,6 +512,9 @@ static void hidd_event_callback(esp_hidd_cb_event_t event, esp_hidd_cb_param_t *
     */
     
     case ESP_HIDD_EVENT_BLE_CONGEST: {
+		if(param->congest.congested) congested_conns |= 1UL << (param->congest.conn_id & 31);
+		else congested_conns &= ~(1UL << (param->congest.conn_id & 31));
+		led_show_state();
 		if(param->congest.congested)
 		{
 			ESP_LOGI(HID_DEMO_TAG, "Congest: %d, conn: %d",param->congest.congested,param->congest.conn_id);
@@ -453,15 +532,41 @@ static void hidd_event_callback(esp_hidd_cb_event_t event, esp_hidd_cb_param_t *
 
 static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
 {
+    #if CONFIG_MODULE_TRACE
+    static uint16_t scan_results = 0;
+    if(event != ESP_GAP_BLE_SCAN_RESULT_EVT) HID_TRACE(HID_TRACE_GAP, event, 0);
+    else if(++scan_results >= HID_TRACE_SCAN_SAMPLE)
+    {
+        HID_TRACE(HID_TRACE_GAP, event, scan_results);
+        scan_results = 0;
+    }
+    #endif
     switch (event) {
     case ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT:
         esp_ble_gap_start_advertising(&hidd_adv_params);
         xEventGroupSetBits(eventgroup_system,SYSTEM_CURRENTLY_ADVERTISING);
         break;
+    case ESP_GAP_BLE_ADV_START_COMPLETE_EVT:
+        if(param->adv_start_cmpl.status == ESP_BT_STATUS_SUCCESS && boot_prof_get(BOOT_PROF_ADV_START) == 0)
+        {
+            boot_prof_mark(BOOT_PROF_ADV_START);
+            ESP_LOGI(HID_DEMO_TAG,"advertising %lu ms after boot",(unsigned long)boot_prof_get(BOOT_PROF_ADV_START)/1000);
+        }
+        break;
     case ESP_GAP_BLE_SCAN_PARAM_SET_COMPLETE_EVT:
 		if(esp_ble_gap_start_scanning(3600) != ESP_OK) ESP_LOGW(HID_DEMO_TAG,"Cannot start scan");
 		else ESP_LOGI(HID_DEMO_TAG,"Start scan");
 		break;
+    case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
+        ESP_LOGI(HID_DEMO_TAG, "conn params updated, status %d, interval: %d, latency: %d, timeout: %d",
+            param->update_conn_params.status, param->update_conn_params.conn_int,
+            param->update_conn_params.latency, param->update_conn_params.timeout);
+        if(param->update_conn_params.status == ESP_BT_STATUS_SUCCESS) {
+            hidd_set_conn_interval(param->update_conn_params.bda, param->update_conn_params.conn_int);
+            hid_stats_conn_params(param->update_conn_params.bda, param->update_conn_params.conn_int,
+                param->update_conn_params.latency, param->update_conn_params.timeout);
+        }
+        break;
     case ESP_GAP_BLE_SEC_REQ_EVT:
         for(int i = 0; i < ESP_BD_ADDR_LEN; i++) {
             ESP_LOGD(HID_DEMO_TAG, "%x:",param->ble_security.ble_req.bd_addr[i]);
@@ -481,6 +586,8 @@ static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param
             ESP_LOGW(HID_DEMO_TAG, "fail reason = 0x%x",param->ble_security.auth_cmpl.fail_reason);
         } else {
             xEventGroupClearBits(eventgroup_system,SYSTEM_CURRENTLY_ADVERTISING);
+            //new bond or re-pairing, update the RAM copy of the bond list
+            bond_cache_sync();
         }
 #if CONFIG_MODULE_BT_PAIRING
         //add connected device to whitelist (necessary if whitelist connections only).
@@ -512,17 +619,8 @@ static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param
 				//esp_log_buffer_char(HID_DEMO_TAG, adv_name, adv_name_len);
 				//ESP_LOGI(HID_DEMO_TAG, "\n");
 				if (adv_name != NULL) {
-					//store name to BT addr...
-					esp_log_buffer_hex(HID_DEMO_TAG, scan_result->scan_rst.bda, 6);
-					esp_log_buffer_char(HID_DEMO_TAG, adv_name, adv_name_len);
-					adv_name[adv_name_len] = '\0';
-					char key[13];
-					sprintf(key,"%02X%02X%02X%02X%02X%02X",scan_result->scan_rst.bda[0],scan_result->scan_rst.bda[1], \
-						scan_result->scan_rst.bda[2],scan_result->scan_rst.bda[3],scan_result->scan_rst.bda[4],scan_result->scan_rst.bda[5]);
-					if(nvs_set_str(nvs_bt_name_h,key,(char*)adv_name) == ESP_OK)
-					{
-						ESP_LOGI(HID_DEMO_TAG,"Saved %s to %s",adv_name, key);
-					} else ESP_LOGW(HID_DEMO_TAG,"Error saving %s for %s",adv_name,key);
+					//RAM cache, written to NVS (deferred) only for bonded peers & changed names
+					bond_cache_set_name(scan_result->scan_rst.bda, adv_name, adv_name_len);
 				}
 				break;
 			case ESP_GAP_SEARCH_INQ_CMPL_EVT:
@@ -534,6 +632,12 @@ static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param
 		}
         break;
         
+    case ESP_GAP_BLE_REMOVE_BOND_DEV_COMPLETE_EVT:
+        if(param->remove_bond_dev_cmpl.status == ESP_BT_STATUS_SUCCESS) {
+            bond_cache_remove(param->remove_bond_dev_cmpl.bd_addr);
+        }
+        break;
+
     case ESP_GAP_BLE_SCAN_START_COMPLETE_EVT:
         //scan start complete event to indicate scan start successfully or failed
         if (param->scan_start_cmpl.status != ESP_BT_STATUS_SUCCESS) {
@@ -548,6 +652,68 @@ static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param
     }
 }
 
+/** @brief Reply to $SV / $CM: "NVS:OK xx/yy - used/free" or "NVS:<error>"
+ * @note The usage is the one of the last commit, pending values are not included */
+static void kv_reply(struct cmdBuf *cmdBuffer, esp_err_t ret, const char *key, const char *value)
+{
+	const char *nl = "\r\n";
+	
+	if(ret != ESP_OK)
+	{
+		//send back error message
+		ESP_LOGI(EXT_UART_TAG,"error setting string: %s",esp_err_to_name(ret));
+		if(cmdBuffer->sendToUART != 0) 
+		{
+			uart_write_bytes(ext_uart_num, "NVS:",strlen("NVS:"));
+			uart_write_bytes(ext_uart_num, esp_err_to_name(ret), strlen(esp_err_to_name(ret)));
+			uart_write_bytes(ext_uart_num,nl,strlen(nl)); //newline
+		}
+	} else {
+		//send back OK & used/free entries
+		nvs_stats_t nvs_stats;
+		kv_cache_get_stats(&nvs_stats);
+		if(key != NULL) ESP_LOGI(EXT_UART_TAG,"set - %s:%s - used:%d,free:%d",key,value,nvs_stats.used_entries, nvs_stats.free_entries);
+		else ESP_LOGI(EXT_UART_TAG,"committed - used:%d,free:%d",nvs_stats.used_entries, nvs_stats.free_entries);
+		if(cmdBuffer->sendToUART != 0) 
+		{
+			uart_write_bytes(ext_uart_num, "NVS:OK ", strlen("NVS:OK "));
+			char stats[64];
+			sprintf(stats,"%d/%d - used/free",nvs_stats.used_entries, nvs_stats.free_entries);
+			uart_write_bytes(ext_uart_num,stats,strnlen(stats,64));
+			uart_write_bytes(ext_uart_num,nl,strlen(nl)); //newline
+		}
+	}
+}
+
+/** @brief Payload length of a $BD header ("<offset> <len> <crc32>"), -1 if it cannot be parsed */
+static int bulk_chunk_len(const char *header)
+{
+	unsigned int chunklen;
+	
+	if(sscanf(header,"%*s %u",&chunklen) != 1 || chunklen > INT_MAX) return -1;
+	return chunklen;
+}
+
+/** @brief Reply to a $BD chunk: "BD:OK <received>", "BD:DONE <size>" or "BD:<error> <received>" */
+static void bulk_chunk_reply(struct cmdBuf *cmdBuffer)
+{
+	uint32_t received;
+	uint8_t stored;
+	char reply[64];
+	int len;
+	esp_err_t ret = kv_bulk_chunk_end(&received, &stored);
+	
+	if(ret != ESP_OK)
+	{
+		ESP_LOGI(EXT_UART_TAG,"BD: %s, continue at %lu",esp_err_to_name(ret),(unsigned long)received);
+		len = snprintf(reply,sizeof(reply),"BD:%s %lu\r\n",esp_err_to_name(ret),(unsigned long)received);
+	} else if(stored) {
+		len = snprintf(reply,sizeof(reply),"BD:DONE %lu\r\n",(unsigned long)received);
+	} else {
+		len = snprintf(reply,sizeof(reply),"BD:OK %lu\r\n",(unsigned long)received);
+	}
+	if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num, reply, len);
+}
 
 void processCommand(struct cmdBuf *cmdBuffer)
 {
@@ -560,19 +726,33 @@ void processCommand(struct cmdBuf *cmdBuffer)
   // $GC get connected devices
   // $NAME set name of bluetooth device
   // $JPx (0,1) en- / disable the joystick interface (for iOS compatibility) [available if compiled with Joystick support]
+  // $JF <deadzone> <hysteresis> <rate> set joystick filter (in report steps; max. report rate in Hz, 0 = unlimited); $JF only prints the current values [available if compiled with Joystick support]
   // $APx (0-4) Set the appearance value for advertising (0x03C0 - 0x03C4; default is mouse). See https://specificationrefs.bluetooth.com/assigned-values/Appearance%20Values.pdf page 8
   // $GV <key>  get the value of the given key from NVS. Note: no spaces in <key>! max. key length: 15
-  // $SV <key> <value> set the value of the given key & store to NVS. Note: no spaces in <key>!
+  // $SV <key> <value> set the value of the given key & store to NVS (after 500ms without $SV or on $CM). Note: no spaces in <key>!
   // $CV clear all key/value pairs set with $SV
+  // $TB begin a $SV transaction: values are stored on $CM only (e.g. restoring all settings)
+  // $CM store pending $SV values to NVS now (one commit) & end a transaction
+  // $BW <key> <size> <crc32 hex> start (or resume) a binary blob write of up to 8192 bytes, returns "BW:OK <offset to continue>"
+  // $BD <offset> <len> <crc32 hex> followed by <len> (max. 1024) raw bytes: one chunk of the blob, returns "BD:OK <received>", "BD:DONE <size>" or "BD:<error> <received>"
+  // $BR <key> [<offset> <len>] read a blob as binary (see tools/kv_bulk.py)
+  // $BA abort a blob write
   // $UG start flash update by searching for factory partition and rebooting there. Warning: not possible to boot back without flashing!
   // $LGx (0,1,2): enable / disable logging system of ESP32.0 is level error, 1 is level info, 2 is level debug
+  // $ST [R] print latency statistics per report ID (UART frame to BLE notification), optional: reset afterwards (incl. $SC counters)
+  // $SC print per host counters (reports sent/rejected, congestion, reconnects, connection parameters)
+  // $SY print task runtime & stack high water mark, free / minimum free heap and largest free block
+  // $BENCH <rate> <seconds> <mix> send empty reports to the selected host(s) (see $SW) & print throughput / latency; mix: k,m,c,j (keyboard, mouse, consumer, joystick). "$BENCH 0" stops.
+  // $BT print the boot phase timestamps (us since boot, us since the previous phase)
+  // $PF [R] print CPU cycles (count,min,avg,max) of the hot path functions, optional: reset afterwards [available if compiled with profiling support]
+  // $TR [C] dump the binary event trace (see tools/trace_decode.py) or clear it [available if compiled with trace support]
+  // $CP [S|P|R <speed>] dump the UART capture, start (S) / stop (P) capturing or replay it (R; speed 0: max., 1: original, n: n times faster) [available if compiled with capture support]
 
   if(cmdBuffer->bufferLength < 2) return;
   //easier this way than typecast in each str* function
   const char *input = (const char *) cmdBuffer->buf;
   int len = cmdBuffer->bufferLength;
   const char *nl = "\r\n";
-  esp_ble_bond_dev_t * btdevlist;
   int counter;
   esp_err_t ret;
   
@@ -580,6 +760,7 @@ void processCommand(struct cmdBuf *cmdBuffer)
   /**++++ (de-)activate joystick ++++*/
   if(strncmp(input,"JP",2) == 0)
   {
+    if(input[2] != '0' && input[2] != '1') return;
     uint8_t joystate = input[2] - '0';
     if(joystate) config.joystick_active = 1;
     else config.joystick_active = 0;
@@ -590,12 +771,229 @@ void processCommand(struct cmdBuf *cmdBuffer)
       uart_write_bytes(ext_uart_num, "JS:",strlen("JS:"));
       if(joystate) uart_write_bytes(ext_uart_num, "1",1);
       else uart_write_bytes(ext_uart_num, "0",1);
-      uart_write_bytes(ext_uart_num,nl,sizeof(nl)); //newline
+      uart_write_bytes(ext_uart_num,nl,strlen(nl)); //newline
+    }
+    return;
+  }
+  
+  /**++++ joystick filter parameters ++++*/
+  if(strncmp(input,"JF",2) == 0)
+  {
+    uint16_t jf[3];
+    int value, index = 2;
+    joystick_filter_get_params(&jf[0],&jf[1],&jf[2]);
+    for(uint8_t i = 0; i<3; i++)
+    {
+      index = get_int(input,index,&value);
+      if(index == 0) break;
+      if(value < 0 || value > UINT16_MAX)
+      {
+        ESP_LOGW(EXT_UART_TAG,"JF: value out of range: %d",value);
+        return;
+      }
+      jf[i] = value;
+    }
+    joystick_filter_set_params(jf[0],jf[1],jf[2]);
+    if(cmdBuffer->sendToUART != 0)
+    {
+      char resp[32];
+      int resplen = snprintf(resp,sizeof(resp),"JF:%u,%u,%u\r\n",jf[0],jf[1],jf[2]);
+      uart_write_bytes(ext_uart_num,resp,resplen);
     }
     return;
   }
   #endif
     
+  /**++++ latency statistics ++++*/
+  if(strncmp(input,"ST",2) == 0)
+  {
+    char line[128];
+    for(uint8_t id = 0; id < HID_STATS_RPT_NUM; id++)
+    {
+      int linelen = hid_stats_format_latency(id,line,sizeof(line));
+      if(linelen == 0) continue;
+      ESP_LOGI(EXT_UART_TAG,"%.*s",linelen-2,line);
+      if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num,line,linelen);
+    }
+    if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num, "END\r\n", 5);
+    //"$ST R": reset after printing
+    if(strchr(&input[2],'R') != NULL) hid_stats_reset();
+    return;
+  }
+  
+  /**++++ connection statistics ++++*/
+  if(strncmp(input,"SC",2) == 0)
+  {
+    char line[96];
+    for(uint8_t i = 0; i < HID_STATS_CONN_NUM; i++)
+    {
+      int linelen = hid_stats_format_conn(i,line,sizeof(line));
+      if(linelen == 0) continue;
+      ESP_LOGI(EXT_UART_TAG,"%.*s",linelen-2,line);
+      if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num,line,linelen);
+    }
+    if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num, "END\r\n", 5);
+    return;
+  }
+  
+  /**++++ synthetic load ++++*/
+  if(strncmp(input,"BENCH",5) == 0)
+  {
+    hid_bench_cfg_t bench = {0};
+    int rate = 0, seconds = 0, index;
+    if((index = get_int(input,5,&rate)) == 0 || rate == 0)
+    {
+      hid_bench_stop();
+      return;
+    }
+    if((index = get_int(input,index,&seconds)) == 0 || rate < 0 || seconds <= 0)
+    {
+      ESP_LOGW(EXT_UART_TAG,"BENCH: usage: $BENCH <rate> <seconds> <mix>");
+      return;
+    }
+    bench.rate = rate > HID_BENCH_MAX_RATE ? HID_BENCH_MAX_RATE : rate;
+    bench.duration_ms = seconds * 1000;
+    for(; input[index] != 0; index++)
+    {
+      if(input[index] == 'k') bench.mix |= HID_BENCH_KEYBOARD;
+      if(input[index] == 'm') bench.mix |= HID_BENCH_MOUSE;
+      if(input[index] == 'c') bench.mix |= HID_BENCH_CONSUMER;
+      if(input[index] == 'j') bench.mix |= HID_BENCH_JOYSTICK;
+    }
+    if(bench.mix == 0) bench.mix = HID_BENCH_MOUSE;
+    //same host selection as for HID reports
+    for(uint8_t i = 0; i<CONFIG_BT_ACL_CONNECTIONS; i++)
+    {
+      if(hid_conn_id != -1) { bench.conn_id[bench.conn_cnt++] = hid_conn_id; break; }
+      if(active_hid_conn_ids[i] != -1) bench.conn_id[bench.conn_cnt++] = active_hid_conn_ids[i];
+    }
+    ret = hid_bench_start(&bench, ext_uart_num);
+    if(ret != ESP_OK)
+    {
+      ESP_LOGW(EXT_UART_TAG,"BENCH: cannot start: %s",esp_err_to_name(ret));
+      if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num, "BENCH:error\r\n", 13);
+    }
+    return;
+  }
+  
+  /**++++ system statistics ++++*/
+  if(strncmp(input,"SY",2) == 0)
+  {
+    char line[80];
+    int linelen;
+    #if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    UBaseType_t taskcnt = uxTaskGetNumberOfTasks();
+    uint32_t totalruntime = 0;
+    TaskStatus_t *tasks = (TaskStatus_t *) malloc(sizeof(TaskStatus_t) * taskcnt);
+    if(tasks != NULL)
+    {
+      taskcnt = uxTaskGetSystemState(tasks, taskcnt, &totalruntime);
+      //percentage is relative to the runtime of one core
+      totalruntime /= 100;
+      for(UBaseType_t i = 0; i < taskcnt; i++)
+      {
+        //name, CPU time (% & timer ticks; 0 if run time stats are disabled), stack high water mark (bytes), priority
+        linelen = snprintf(line, sizeof(line), "SY:%s,%lu,%lu,%lu,%u\r\n", tasks[i].pcTaskName,
+          totalruntime ? (unsigned long)(tasks[i].ulRunTimeCounter / totalruntime) : 0,
+          (unsigned long)tasks[i].ulRunTimeCounter, (unsigned long)tasks[i].usStackHighWaterMark,
+          (unsigned)tasks[i].uxCurrentPriority);
+        ESP_LOGI(EXT_UART_TAG,"%.*s",linelen-2,line);
+        if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num,line,linelen);
+      }
+      free(tasks);
+    } else ESP_LOGE(EXT_UART_TAG,"SY: cannot allocate task list");
+    #endif
+    linelen = snprintf(line, sizeof(line), "SY:heap,%u,%u,%u\r\n",
+      (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT), (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+      (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    ESP_LOGI(EXT_UART_TAG,"%.*s",linelen-2,line);
+    if(cmdBuffer->sendToUART != 0)
+    {
+      uart_write_bytes(ext_uart_num,line,linelen);
+      uart_write_bytes(ext_uart_num, "END\r\n", 5);
+    }
+    return;
+  }
+  
+  /**++++ boot phase timestamps ++++*/
+  if(strncmp(input,"BT",2) == 0)
+  {
+    char line[64];
+    for(uint8_t i = 0; i < BOOT_PROF_NUM; i++)
+    {
+      int linelen = boot_prof_format(i,line,sizeof(line));
+      if(linelen == 0) continue;
+      ESP_LOGI(EXT_UART_TAG,"%.*s",linelen-2,line);
+      if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num,line,linelen);
+    }
+    if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num, "END\r\n", 5);
+    return;
+  }
+  
+  #if CONFIG_MODULE_PROFILING
+  /**++++ cycle profiling ++++*/
+  if(strncmp(input,"PF",2) == 0)
+  {
+    char line[64];
+    for(uint8_t i = 0; i < HID_PROF_NUM; i++)
+    {
+      int linelen = hid_prof_format(i,line,sizeof(line));
+      if(linelen == 0) continue;
+      ESP_LOGI(EXT_UART_TAG,"%.*s",linelen-2,line);
+      if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num,line,linelen);
+    }
+    if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num, "END\r\n", 5);
+    if(strchr(&input[2],'R') != NULL) hid_prof_reset();
+    return;
+  }
+  #endif
+  
+  #if CONFIG_MODULE_TRACE
+  /**++++ event trace ++++*/
+  if(strncmp(input,"TR",2) == 0)
+  {
+    //"$TR C": clear only
+    if(strchr(&input[2],'C') != NULL) hid_trace_clear();
+    else if(cmdBuffer->sendToUART != 0) hid_trace_dump(ext_uart_num);
+    return;
+  }
+  #endif
+  
+  #if CONFIG_MODULE_CAPTURE
+  /**++++ UART capture & replay ++++*/
+  if(strncmp(input,"CP",2) == 0)
+  {
+    int speed = 1;
+    int index = (input[2] == ' ') ? 3 : 2;
+    ret = ESP_OK;
+    switch(input[index])
+    {
+      case 'S': ret = uart_capture_start(); break;
+      case 'P': uart_capture_stop(); break;
+      case 'R':
+        //default: original timing
+        get_int(input,index+1,&speed);
+        if(speed < 0 || speed > UINT16_MAX)
+        {
+          ESP_LOGW(EXT_UART_TAG,"CP: invalid speed %d",speed);
+          return;
+        }
+        ret = uart_replay_start(speed);
+        break;
+      default:
+        if(cmdBuffer->sendToUART != 0) uart_capture_dump(ext_uart_num);
+        return;
+    }
+    if(ret != ESP_OK) ESP_LOGW(EXT_UART_TAG,"CP: not possible: %s",esp_err_to_name(ret));
+    if(cmdBuffer->sendToUART != 0)
+    {
+      if(ret == ESP_OK) uart_write_bytes(ext_uart_num, "CP:OK\r\n", strlen("CP:OK\r\n"));
+      else uart_write_bytes(ext_uart_num, "CP:FAIL\r\n", strlen("CP:FAIL\r\n"));
+    }
+    return;
+  }
+  #endif
+  
   /**++++ set BLE appearance ++++*/
   if(strncmp(input,"AP", 2) == 0)
   {
@@ -603,20 +1001,20 @@ void processCommand(struct cmdBuf *cmdBuffer)
     if(appv <= 4)
     {
       ESP_LOGI(EXT_UART_TAG,"setting appearance to NVS, will show on next reboot");
-      nvs_set_u8(nvs_storage_h,"BLEAPPEAR",appv);
-			nvs_commit(nvs_storage_h);
+      config.appearance = appv;
+      update_config();
       if(cmdBuffer->sendToUART != 0) 
       {
         uart_write_bytes(ext_uart_num, "AP:",strlen("AP:"));
         uart_write_bytes(ext_uart_num, &input[2],1);
-        uart_write_bytes(ext_uart_num,nl,sizeof(nl)); //newline
+        uart_write_bytes(ext_uart_num,nl,strlen(nl)); //newline
       }
     } else {
       ESP_LOGE(EXT_UART_TAG,"Cannot set appearance, value not correct. Use AP0 - AP4");
       if(cmdBuffer->sendToUART != 0) 
       {
         uart_write_bytes(ext_uart_num, "AP:invalid number, AP0-AP4",strlen("AP:invalid number, AP0-AP4"));
-        uart_write_bytes(ext_uart_num,nl,sizeof(nl)); //newline
+        uart_write_bytes(ext_uart_num,nl,strlen(nl)); //newline
       }
     }
     return;
@@ -629,7 +1027,7 @@ void processCommand(struct cmdBuf *cmdBuffer)
 		if(cmdBuffer->sendToUART != 0) 
 		{
 			uart_write_bytes(ext_uart_num, "LOG:0",strlen("LOG:0"));
-			uart_write_bytes(ext_uart_num,nl,sizeof(nl)); //newline
+			uart_write_bytes(ext_uart_num,nl,strlen(nl)); //newline
 		}
 		return;
 	}
@@ -639,7 +1037,7 @@ void processCommand(struct cmdBuf *cmdBuffer)
 		if(cmdBuffer->sendToUART != 0) 
 		{
 			uart_write_bytes(ext_uart_num, "LOG:1",strlen("LOG:1"));
-			uart_write_bytes(ext_uart_num,nl,sizeof(nl)); //newline
+			uart_write_bytes(ext_uart_num,nl,strlen(nl)); //newline
 		}
 		return;
 	}
@@ -649,7 +1047,7 @@ void processCommand(struct cmdBuf *cmdBuffer)
 		if(cmdBuffer->sendToUART != 0) 
 		{
 			uart_write_bytes(ext_uart_num, "LOG:2",strlen("LOG:2"));
-			uart_write_bytes(ext_uart_num,nl,sizeof(nl)); //newline
+			uart_write_bytes(ext_uart_num,nl,strlen(nl)); //newline
 		}
 		return;
 	}
@@ -660,14 +1058,12 @@ void processCommand(struct cmdBuf *cmdBuffer)
 		//no error checks here, because all errors
 		//are related to the NVS part, which cannot be fixed via
 		//the UART console
-		nvs_erase_all(nvs_storage_h);
-		//commit NVS storage
-		ret = nvs_commit(nvs_storage_h);
+		kv_cache_clear();
 		ESP_LOGI(EXT_UART_TAG,"cleared all NVS key/value pairs");
 		if(cmdBuffer->sendToUART != 0) 
 		{
 			uart_write_bytes(ext_uart_num, "NVS:OK",strlen("NVS:OK"));
-			uart_write_bytes(ext_uart_num,nl,sizeof(nl)); //newline
+			uart_write_bytes(ext_uart_num,nl,strlen(nl)); //newline
 		}
 		return;
 	}
@@ -679,18 +1075,9 @@ void processCommand(struct cmdBuf *cmdBuffer)
 		//get key
 		char *key = strsep(&work, " ");
 		
-		//get data size from NVS, check if key is set
-		size_t sizeData;
-		char* nvspayload = NULL;
-		ret = nvs_get_str(nvs_storage_h, key,NULL,&sizeData);
-		
-		//if we have a data length, load string
-		if(ret == ESP_OK)
-		{
-			//load str data
-			nvspayload = malloc(sizeData);
-			ret = nvs_get_str(nvs_storage_h, key, nvspayload, &sizeData);
-		}
+		//RAM cache, NVS is read on a miss only
+		char nvspayload[KV_CACHE_VALUE_LEN];
+		ret = kv_cache_get(key, nvspayload, sizeof(nvspayload));
 		
 		//OK or error?
 		if(ret != ESP_OK)
@@ -701,17 +1088,17 @@ void processCommand(struct cmdBuf *cmdBuffer)
 			{
 				uart_write_bytes(ext_uart_num, "NVS:",strlen("NVS:"));
 				uart_write_bytes(ext_uart_num, esp_err_to_name(ret), strlen(esp_err_to_name(ret)));
-				uart_write_bytes(ext_uart_num,nl,sizeof(nl)); //newline
+				uart_write_bytes(ext_uart_num,nl,strlen(nl)); //newline
 			}
 		} else {
 			ESP_LOGI(EXT_UART_TAG,"loaded - %s:%s",key,nvspayload);
-			uart_write_bytes(ext_uart_num, "NVS:",strlen("NVS:"));
-			uart_write_bytes(ext_uart_num, nvspayload, strlen(nvspayload));
-			uart_write_bytes(ext_uart_num,nl,sizeof(nl)); //newline
+			if(cmdBuffer->sendToUART != 0) 
+			{
+				uart_write_bytes(ext_uart_num, "NVS:",strlen("NVS:"));
+				uart_write_bytes(ext_uart_num, nvspayload, strlen(nvspayload));
+				uart_write_bytes(ext_uart_num,nl,strlen(nl)); //newline
+			}
 		}
-		
-		//done with the payload
-		if(nvspayload) free(nvspayload);
 		return;
 	}
 	
@@ -725,50 +1112,118 @@ void processCommand(struct cmdBuf *cmdBuffer)
 		//get payload
 		char* nvspayload = work;
 		
+		if(key == NULL || key[0] == 0 || strlen(key) >= NVS_KEY_NAME_MAX_SIZE)
+		{
+			ESP_LOGI(EXT_UART_TAG,"error setting string: invalid key");
+			if(cmdBuffer->sendToUART != 0) 
+			{
+				uart_write_bytes(ext_uart_num, "NVS:ESP_ERR_NVS_INVALID_NAME",strlen("NVS:ESP_ERR_NVS_INVALID_NAME"));
+				uart_write_bytes(ext_uart_num,nl,strlen(nl)); //newline
+			}
+			return;
+		}
+		
 		if(work == NULL)
 		{
 			ESP_LOGI(EXT_UART_TAG,"error setting string: no value provided");
 			if(cmdBuffer->sendToUART != 0) 
 			{
 				uart_write_bytes(ext_uart_num, "NVS:ESP_ERR_NVS_NO_VALUE",strlen("NVS:ESP_ERR_NVS_NO_VALUE"));
-				uart_write_bytes(ext_uart_num,nl,sizeof(nl)); //newline
+				uart_write_bytes(ext_uart_num,nl,strlen(nl)); //newline
 			}
 			return;
 		}
 		
-		//try to set string data to nvs
-		ret = nvs_set_str(nvs_storage_h, key,nvspayload);
+		//set in RAM, written to NVS when idle / on $CM
+		ret = kv_cache_set(key, nvspayload);
+		kv_reply(cmdBuffer, ret, key, nvspayload);
+		return;
+	}
+	
+	//TB: begin a key/value transaction, no NVS writes until $CM
+	if(strcmp(input,"TB") == 0)
+	{
+		kv_cache_begin();
+		ESP_LOGI(EXT_UART_TAG,"key/value transaction started");
+		if(cmdBuffer->sendToUART != 0) 
+		{
+			uart_write_bytes(ext_uart_num, "NVS:OK",strlen("NVS:OK"));
+			uart_write_bytes(ext_uart_num,nl,strlen(nl)); //newline
+		}
+		return;
+	}
+	
+	//CM: write pending key/value pairs now
+	if(strcmp(input,"CM") == 0)
+	{
+		ret = kv_cache_commit();
+		kv_reply(cmdBuffer, ret, NULL, NULL);
+		return;
+	}
+	
+	/**++++ chunked binary key/value transfer ++++*/
+	//BW: start or resume a blob write
+	if(strncmp(input,"BW ", 3) == 0)
+	{
+		char key[NVS_KEY_NAME_MAX_SIZE];
+		unsigned long size, crc;
+		uint32_t offset = 0;
+		char reply[48];
+		int replylen;
 		
-		if(ret == ESP_OK)
+		if(sscanf(input+3,"%15s %lu %lx",key,&size,&crc) != 3) ret = ESP_ERR_INVALID_ARG;
+		else ret = kv_bulk_begin(key, size, crc, &offset);
+		if(ret != ESP_OK) ESP_LOGI(EXT_UART_TAG,"BW: %s",esp_err_to_name(ret));
+		if(cmdBuffer->sendToUART != 0)
 		{
-			//commit NVS storage
-			ret = nvs_commit(nvs_storage_h);
+			if(ret == ESP_OK) replylen = snprintf(reply,sizeof(reply),"BW:OK %lu\r\n",(unsigned long)offset);
+			else replylen = snprintf(reply,sizeof(reply),"BW:%s\r\n",esp_err_to_name(ret));
+			uart_write_bytes(ext_uart_num, reply, replylen);
 		}
+		return;
+	}
+	
+	//BD: chunk header, the payload follows as binary (see bulk_binary_data)
+	if(strncmp(input,"BD ", 3) == 0)
+	{
+		unsigned long offset, crc;
+		int chunklen = bulk_chunk_len(input+3);
 		
-		if(ret != ESP_OK)
+		if(chunklen < 0)
 		{
-			//send back error message
-			ESP_LOGI(EXT_UART_TAG,"error setting string: %s",esp_err_to_name(ret));
-			if(cmdBuffer->sendToUART != 0) 
-			{
-				uart_write_bytes(ext_uart_num, "NVS:",strlen("NVS:"));
-				uart_write_bytes(ext_uart_num, esp_err_to_name(ret), strlen(esp_err_to_name(ret)));
-				uart_write_bytes(ext_uart_num,nl,sizeof(nl)); //newline
-			}
-		} else {
-			//send back OK & used/free entries
-			nvs_stats_t nvs_stats;
-			nvs_get_stats(NULL, &nvs_stats);
-			ESP_LOGI(EXT_UART_TAG,"set - %s:%s - used:%d,free:%d",key,nvspayload,nvs_stats.used_entries, nvs_stats.free_entries);
-			if(cmdBuffer->sendToUART != 0) 
-			{
-				uart_write_bytes(ext_uart_num, "NVS:OK ", strlen("NVS:OK "));
-				char stats[64];
-				sprintf(stats,"%d/%d - used/free",nvs_stats.used_entries, nvs_stats.free_entries);
-				uart_write_bytes(ext_uart_num,stats,strnlen(stats,64));
-				uart_write_bytes(ext_uart_num,nl,sizeof(nl)); //newline
-			}
+			//cannot know how many bytes follow, they are parsed as usual
+			ESP_LOGW(EXT_UART_TAG,"BD: invalid chunk header");
+			if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num, "BD:ESP_ERR_INVALID_ARG\r\n", strlen("BD:ESP_ERR_INVALID_ARG\r\n"));
+			return;
+		}
+		//the payload is consumed in any case, errors are replied after it
+		if(sscanf(input+3,"%lu %*u %lx",&offset,&crc) == 2) kv_bulk_chunk_start(offset, chunklen, crc);
+		else {
+			ESP_LOGW(EXT_UART_TAG,"BD: invalid chunk header, dropping %d bytes",chunklen);
+			kv_bulk_chunk_invalid();
 		}
+		if(chunklen == 0) bulk_chunk_reply(cmdBuffer);
+		else uart_parser_expect_binary(cmdBuffer, chunklen);
+		return;
+	}
+	
+	//BR: read a blob
+	if(strncmp(input,"BR ", 3) == 0)
+	{
+		char key[NVS_KEY_NAME_MAX_SIZE];
+		unsigned long offset = 0, readlen = 0;
+		
+		if(sscanf(input+3,"%15s %lu %lu",key,&offset,&readlen) < 1) key[0] = 0;
+		if(cmdBuffer->sendToUART != 0) kv_bulk_read(key, offset, readlen, ext_uart_num);
+		return;
+	}
+	
+	//BA: abort a blob write
+	if(strcmp(input,"BA") == 0)
+	{
+		kv_bulk_abort();
+		ESP_LOGI(EXT_UART_TAG,"BA: blob write aborted");
+		if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num, "BA:OK\r\n", strlen("BA:OK\r\n"));
 		return;
 	}
 
@@ -793,7 +1248,7 @@ void processCommand(struct cmdBuf *cmdBuffer)
 					sprintf(hexnum,"%02X ",active_connections[i][t]);
 					if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num, hexnum, 3);
 				}
-				if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num,nl,sizeof(nl)); //newline
+				if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num,nl,strlen(nl)); //newline
 			}
 		}
 		ESP_LOGI(EXT_UART_TAG,"---------------------------------------");
@@ -802,33 +1257,25 @@ void processCommand(struct cmdBuf *cmdBuffer)
     //switch between BT devices which are connected... 
     if(input[0] == 'S' && input[1] == 'W')
     {
-		if(len >= 15)
+		esp_bd_addr_t newaddr;
+		if(get_bdaddr(input,2,newaddr) != 0)
 		{
-			esp_bd_addr_t newaddr;
-			for(uint8_t i = 0; i<6; i++) {
-				if(input[i*2+3] >= '0' && input[i*2+3] <= '9') newaddr[i] = (input[i*2+3] - '0')<<4;
-				if(input[i*2+3] >= 'a' && input[i*2+3] <= 'f') newaddr[i] = (input[i*2+3] + 10 - 'a')<<4;
-				if(input[i*2+3] >= 'A' && input[i*2+3] <= 'F') newaddr[i] = (input[i*2+3] + 10 - 'A')<<4;
-				
-				if(input[i*2+1+3] >= '0' && input[i*2+1+3] <= '9') newaddr[i] |= input[i*2+1+3] - '0';
-				if(input[i*2+1+3] >= 'a' && input[i*2+1+3] <= 'f') newaddr[i] |= input[i*2+1+3] + 10 - 'a';
-				if(input[i*2+1+3] >= 'A' && input[i*2+1+3] <= 'F') newaddr[i] |= input[i*2+1+3] + 10 - 'A';
-			}
 			esp_log_buffer_hex(HID_DEMO_TAG, newaddr, 6);
 			
 			for(uint8_t i = 0; i<CONFIG_BT_ACL_CONNECTIONS; i++)
 			{
 				//check if this addr is in the array
-				if(memcmp(active_connections[i],newaddr,sizeof(esp_bd_addr_t)) == 0)
+				if(active_hid_conn_ids[i] != -1 && memcmp(active_connections[i],newaddr,sizeof(esp_bd_addr_t)) == 0)
 				{
-					ESP_LOGI(EXT_UART_TAG, "New hid_conn_id: %d",i);
-					hid_conn_id = i;
+					//hid_conn_id is used as connection ID for sending, not the index
+					ESP_LOGI(EXT_UART_TAG, "New hid_conn_id: %d @ %d",active_hid_conn_ids[i],i);
+					hid_conn_id = active_hid_conn_ids[i];
 					return;
 				}
 			}
 			ESP_LOGW(EXT_UART_TAG,"Cannot find BT MAC in connections");
 		} else {
-			ESP_LOGW(EXT_UART_TAG,"Command to short (need full BT MAC addr): %d",len);
+			ESP_LOGW(EXT_UART_TAG,"Invalid BT MAC addr (need 12 hex digits), len: %d",len);
 		}
 		return;
 	}
@@ -839,8 +1286,8 @@ void processCommand(struct cmdBuf *cmdBuffer)
     {
 		if(cmdBuffer->sendToUART != 0)
 		{
-			uart_write_bytes(ext_uart_num, MODULE_ID, sizeof(MODULE_ID));
-			uart_write_bytes(ext_uart_num, nl, sizeof(nl));
+			uart_write_bytes(ext_uart_num, MODULE_ID, strlen(MODULE_ID));
+			uart_write_bytes(ext_uart_num, nl, strlen(nl));
 		}
 		ESP_LOGI(EXT_UART_TAG,"ID: %s",MODULE_ID);
         return;
@@ -851,6 +1298,7 @@ void processCommand(struct cmdBuf *cmdBuffer)
 #if CONFIG_MODULE_BT_PAIRING
         ESP_LOGI(EXT_UART_TAG,"$PM0 - disabling pairing");
         xEventGroupClearBits(eventgroup_system,SYSTEM_PAIRING_ENABLED);
+        led_show_state();
         if(hidd_adv_params.adv_filter_policy == ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY)
         {
             //restart advertising with whitelisted connection only (no connection is possible if not
@@ -869,6 +1317,7 @@ void processCommand(struct cmdBuf *cmdBuffer)
 #if CONFIG_MODULE_BT_PAIRING
         ESP_LOGI(EXT_UART_TAG,"$PM1 - enabling pairing");
         xEventGroupSetBits(eventgroup_system,SYSTEM_PAIRING_ENABLED);
+        led_show_state();
         if(hidd_adv_params.adv_filter_policy == ADV_FILTER_ALLOW_SCAN_ANY_CON_WLST)
         {
             //restart advertising with open connection
@@ -881,52 +1330,39 @@ void processCommand(struct cmdBuf *cmdBuffer)
         return;
     }
 
-    //get all BT pairings
+    //get all BT pairings (answered from the RAM copy, no heap / NVS access)
     if(strcmp(input,"GP") == 0)
     {
-        counter = esp_ble_get_bond_device_num();
+        bond_cache_entry_t bond;
         char hexnum[5];
 
+        counter = bond_cache_count();
         if(counter > 0)
         {
-            btdevlist = (esp_ble_bond_dev_t *) malloc(sizeof(esp_ble_bond_dev_t)*counter);
-            if(btdevlist != NULL)
+            ESP_LOGI(EXT_UART_TAG,"bonded devices (starting with index 0):");
+            ESP_LOGI(EXT_UART_TAG,"---------------------------------------");
+            for(uint8_t i = 0; bond_cache_get(i,&bond) == ESP_OK; i++)
             {
-                if(esp_ble_get_bond_device_list(&counter,btdevlist) == ESP_OK)
+                //print on monitor & external uart
+                if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num, "PAIRING:",strlen("PAIRING:"));
+                esp_log_buffer_hex(EXT_UART_TAG, bond.addr, sizeof(esp_bd_addr_t));
+                for (int t=0; t<sizeof(esp_bd_addr_t); t++) {
+                    sprintf(hexnum,"%02X ",bond.addr[t]);
+                    if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num, hexnum, 3);
+                }
+                //print out name
+                if(bond.name[0] != '\0')
                 {
-                    ESP_LOGI(EXT_UART_TAG,"bonded devices (starting with index 0):");
-                    ESP_LOGI(EXT_UART_TAG,"---------------------------------------");
-                    for(uint8_t i = 0; i<counter; i++)
-                    {
-                        //print on monitor & external uart
-                        if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num, "PAIRING:",strlen("PAIRING:"));
-                        esp_log_buffer_hex(EXT_UART_TAG, btdevlist[i].bd_addr, sizeof(esp_bd_addr_t));
-                        for (int t=0; t<sizeof(esp_bd_addr_t); t++) {
-                            sprintf(hexnum,"%02X ",btdevlist[i].bd_addr[t]);
-                            if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num, hexnum, 3);
-                        }
-                        //print out name
-                        char btname[64];
-                        size_t name_len = 0;
-                        char key[13];
-                        sprintf(key,"%02X%02X%02X%02X%02X%02X",btdevlist[i].bd_addr[0],btdevlist[i].bd_addr[1], \
-							btdevlist[i].bd_addr[2],btdevlist[i].bd_addr[3],btdevlist[i].bd_addr[4],btdevlist[i].bd_addr[5]);
-                        
-                        if(nvs_get_str(nvs_bt_name_h,key,btname,&name_len) == ESP_OK)
-                        {
-							sprintf(hexnum," - ");
-							if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num, hexnum, 3);
-							if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num, btname, name_len);
-							ESP_LOGI(EXT_UART_TAG,"%s",btname);
-						} else ESP_LOGW(EXT_UART_TAG,"cannot find name for addr.");
-                        
-                        if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num,nl,sizeof(nl)); //newline
-                    }
-                    ESP_LOGI(EXT_UART_TAG,"---------------------------------------");
-                } else ESP_LOGW(EXT_UART_TAG,"error getting device list");
-            } else ESP_LOGE(EXT_UART_TAG,"error allocating memory for device list");
+                    if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num, " - ", 3);
+                    if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num, bond.name, strlen(bond.name));
+                    ESP_LOGI(EXT_UART_TAG,"%s",bond.name);
+                } else ESP_LOGW(EXT_UART_TAG,"cannot find name for addr.");
+
+                if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num,nl,strlen(nl)); //newline
+            }
+            ESP_LOGI(EXT_UART_TAG,"---------------------------------------");
         } else {
-			ESP_LOGI(EXT_UART_TAG,"error getting bonded devices count or no devices bonded");
+			ESP_LOGI(EXT_UART_TAG,"no devices bonded");
 			if(cmdBuffer->sendToUART != 0) uart_write_bytes(ext_uart_num, "END\r\n", 5);
 		}
         return;
@@ -936,53 +1372,47 @@ void processCommand(struct cmdBuf *cmdBuffer)
     //DP: delete one pairing
     if(input[0] == 'D' && input[1] == 'P')
     {
+        bond_cache_entry_t bond;
         int index_to_remove;
         if (!(get_int(input,2,&index_to_remove))) {
             ESP_LOGI(EXT_UART_TAG,"DP: no integer, deleting all bonded devices");
             index_to_remove = -1;
         }
 
-        counter = esp_ble_get_bond_device_num();
+        counter = bond_cache_count();
         if(counter == 0)
         {
             ESP_LOGI(EXT_UART_TAG,"error deleting device, no paired devices");
             return;
         }
 
-        if(index_to_remove >= counter)
+        if(index_to_remove >= counter || index_to_remove < -1)
         {
             ESP_LOGW(EXT_UART_TAG,"error deleting device, number out of range");
             return;
         }
-        if(counter >= 0)
+        //collect the addresses first, the removal events shrink the cached list
+        esp_bd_addr_t remove_addr[BOND_CACHE_MAX];
+        int remove_cnt = 0;
+        for(int i = 0; i<counter; i++)
         {
-            btdevlist = (esp_ble_bond_dev_t *) malloc(sizeof(esp_ble_bond_dev_t)*counter);
-            if(btdevlist != NULL)
-            {
-                if(esp_ble_get_bond_device_list(&counter,btdevlist) == ESP_OK)
-                {
-					//deleting only one pairing (-> -1 == delete all)
-					if(index_to_remove >= 0)
-					{
-	                    esp_ble_remove_bond_device(btdevlist[index_to_remove].bd_addr);
-	                    esp_ble_gap_update_whitelist(false,btdevlist[index_to_remove].bd_addr,BLE_WL_ADDR_TYPE_PUBLIC);
-	                    esp_ble_gap_update_whitelist(false,btdevlist[index_to_remove].bd_addr,BLE_WL_ADDR_TYPE_RANDOM);
-					} else {
-						for(int i = 0; i<counter; i++)
-						{
-							esp_ble_remove_bond_device(btdevlist[i].bd_addr);
-		                    esp_ble_gap_update_whitelist(false,btdevlist[i].bd_addr,BLE_WL_ADDR_TYPE_PUBLIC);
-		                    esp_ble_gap_update_whitelist(false,btdevlist[i].bd_addr,BLE_WL_ADDR_TYPE_RANDOM); 
-						}
-					}
-                } else ESP_LOGI(EXT_UART_TAG,"error getting device list");
-                free (btdevlist);
-                //wait 20 ticks for everything to settle (write commits to NVS)
-                vTaskDelay(20);
-                //then restart to avoid re-bonding of the device(s).
-                esp_restart();
-            } else ESP_LOGW(EXT_UART_TAG,"error allocating memory for device list");
-        } else ESP_LOGW(EXT_UART_TAG,"error getting bonded devices count");
+            //deleting only one pairing (-> -1 == delete all)
+            if(index_to_remove >= 0 && i != index_to_remove) continue;
+            if(bond_cache_get(i,&bond) != ESP_OK) break;
+            memcpy(remove_addr[remove_cnt++],bond.addr,sizeof(esp_bd_addr_t));
+        }
+        for(int i = 0; i<remove_cnt; i++)
+        {
+            esp_ble_remove_bond_device(remove_addr[i]);
+            esp_ble_gap_update_whitelist(false,remove_addr[i],BLE_WL_ADDR_TYPE_PUBLIC);
+            esp_ble_gap_update_whitelist(false,remove_addr[i],BLE_WL_ADDR_TYPE_RANDOM);
+        }
+        //pending $SV values would be lost by the restart
+        kv_cache_commit();
+        //wait 20 ticks for everything to settle (write commits to NVS)
+        vTaskDelay(20);
+        //then restart to avoid re-bonding of the device(s).
+        esp_restart();
         return;
     }
 
@@ -1011,129 +1441,194 @@ void processCommand(struct cmdBuf *cmdBuffer)
             esp_partition_iterator_release(pi);
             if (esp_ota_set_boot_partition(factory) == ESP_OK) {
                 uart_write_bytes(ext_uart_num, "OTA:start", strlen("OTA:start"));
-                uart_write_bytes(ext_uart_num, nl, sizeof(nl));
+                uart_write_bytes(ext_uart_num, nl, strlen(nl));
                 ESP_LOGI(EXT_UART_TAG, "Addon board in upgrade mode");
-                //LED off
-                #if CONFIG_MODULE_NANO
-                gpio_set_level(indicator_led, 1);
-                #endif
-                #if CONFIG_MODULE_MINIBT
-                gpio_set_level(indicator_led, 0);
-                #endif
+                indicator_led_set(INDICATOR_LED_UPDATE);
+                kv_cache_commit();
                 esp_restart();
             }else {
                 ESP_LOGI(EXT_UART_TAG, "Booting factory partition not possible");
                 uart_write_bytes(ext_uart_num, "OTA:not possible", strlen("OTA:not possible"));
-                uart_write_bytes(ext_uart_num, nl, sizeof(nl));
+                uart_write_bytes(ext_uart_num, nl, strlen(nl));
             }
         } else {
 			ESP_LOGI(EXT_UART_TAG, "Factory partition not found");
 			uart_write_bytes(ext_uart_num, "OTA:not possible", strlen("OTA:not possible"));
-			uart_write_bytes(ext_uart_num, nl, sizeof(nl));
+			uart_write_bytes(ext_uart_num, nl, strlen(nl));
 		}
         return;
     }
     ESP_LOGW(EXT_UART_TAG,"No command executed with: %s ; len= %d\n",input,len);
 }
 
-void uart_parse_command (uint8_t character, struct cmdBuf * cmdBuffer)
+/** @brief Parser handler: 0xFD received, remember the time for latency statistics */
+static void uart_frame_start(struct cmdBuf *cmdBuffer)
 {
-    switch (cmdBuffer->state) {
+    cmdBuffer->timestamp=esp_timer_get_time();
+    HID_TRACE(HID_TRACE_FRAME_START, 0, 0);
+}
 
-    case CMDSTATE_IDLE:
-        if (character==0xfd) {
-            cmdBuffer->bufferLength=0;
-            cmdBuffer->expectedBytes=8;   // 8 bytes for raw report size
-            cmdBuffer->state=CMDSTATE_GET_RAW;
-        }
-        else if (character == '$') {
-            cmdBuffer->bufferLength=0;   // we will read an ASCII-command until CR or LF
-            cmdBuffer->state=CMDSTATE_GET_ASCII;
+/** @brief Parser handler: send the report(s) of a complete raw frame */
+static void uart_raw_frame(struct cmdBuf *cmdBuffer)
+{
+    //reports sent from here on are accounted to this frame (latency statistics)
+    hid_stats_frame_begin(cmdBuffer->timestamp);
+    if(!isConnected()) {
+        ESP_LOGI(EXT_UART_TAG,"not connected, cannot send report");
+    } else if (cmdBuffer->buf[1] == 0x00) {   // keyboard report
+        //if hid_conn_id is set (!= -1) we send to one device only. Send to all otherwise
+        if(hid_conn_id == -1)
+        {
+            for(uint8_t i = 0; i<CONFIG_BT_ACL_CONNECTIONS; i++)
+            {
+                if(active_hid_conn_ids[i] != -1) esp_hidd_send_keyboard_value(active_hid_conn_ids[i],cmdBuffer->buf[0],&cmdBuffer->buf[2],6);
+            }
+        } else {
+            esp_hidd_send_keyboard_value(hid_conn_id,cmdBuffer->buf[0],&cmdBuffer->buf[2],6);
         }
-        break;
-
-    case CMDSTATE_GET_RAW:
-        cmdBuffer->buf[cmdBuffer->bufferLength]=character;
-        if ((cmdBuffer->bufferLength == 1) && (character==0x01)) { // we have a joystick report: increase by 5 bytes
-            cmdBuffer->expectedBytes += 5;
-            //ESP_LOGI(EXT_UART_TAG,"expecting 5 more bytes for joystick");
+        //update timestamp
+        timestampLastSent = esp_timer_get_time();
+    } else if (cmdBuffer->buf[1] == 0x01) {  // joystick report
+        ESP_LOGD(EXT_UART_TAG,"joystick: axis: 0x%X:0x%X:0x%X:0x%X, hat: %d",cmdBuffer->buf[2],cmdBuffer->buf[3],cmdBuffer->buf[4],cmdBuffer->buf[5],cmdBuffer->buf[8]);
+        ESP_LOGD(EXT_UART_TAG,"joystick: buttons: 0x%X:0x%X:0x%X:0x%X",cmdBuffer->buf[9],cmdBuffer->buf[10],cmdBuffer->buf[11],cmdBuffer->buf[12]);
+        //send joystick report (filtered & rate limited, see joystick_send_filtered)
+        #if CONFIG_MODULE_USEJOYSTICK
+        joystick_filter_submit(&cmdBuffer->buf[2],0);
+        #else
+        ESP_LOGE(EXT_UART_TAG,"built without joystick support, cannot fix that!");
+        #endif
+    } else if (cmdBuffer->buf[1] == 0x04) {  // wide joystick report (16bit axes & triggers)
+        #if CONFIG_MODULE_USEJOYSTICK
+        joystick_filter_submit(&cmdBuffer->buf[2],1);
+        #else
+        ESP_LOGE(EXT_UART_TAG,"built without joystick support, cannot fix that!");
+        #endif
+    } else if (cmdBuffer->buf[1] == 0x02) {  // extended consumer report
+        //byte 0: 0 sets the usage state (0 releases), 1 taps the usage (press & release)
+        uint16_t usage = cmdBuffer->buf[2] | (cmdBuffer->buf[3] << 8);
+        if(hid_conn_id == -1)
+        {
+            for(uint8_t i = 0; i<CONFIG_BT_ACL_CONNECTIONS; i++)
+            {
+                if(active_hid_conn_ids[i] == -1) continue;
+                if(cmdBuffer->buf[0] == 0x01) esp_hidd_send_consumer_tap(active_hid_conn_ids[i],usage);
+                else esp_hidd_send_consumer_usage(active_hid_conn_ids[i],usage);
+            }
+        } else {
+            if(cmdBuffer->buf[0] == 0x01) esp_hidd_send_consumer_tap(hid_conn_id,usage);
+            else esp_hidd_send_consumer_usage(hid_conn_id,usage);
         }
-
-        cmdBuffer->bufferLength++;
-        cmdBuffer->expectedBytes--;
-        if (!cmdBuffer->expectedBytes) {
-            if(!isConnected()) {
-                ESP_LOGI(EXT_UART_TAG,"not connected, cannot send report");
-            } else {
-                if (cmdBuffer->buf[1] == 0x00) {   // keyboard report
-            //if hid_conn_id is set (!= -1) we send to one device only. Send to all otherwise
-            if(hid_conn_id == -1)
+        //update timestamp
+        timestampLastSent = esp_timer_get_time();
+    } else if (cmdBuffer->buf[1] == 0x03) {  // mouse report
+        if(hid_conn_id == -1)
+        {
+            for(uint8_t i = 0; i<CONFIG_BT_ACL_CONNECTIONS; i++)
             {
-              for(uint8_t i = 0; i<CONFIG_BT_ACL_CONNECTIONS; i++)
-              {
-                if(active_hid_conn_ids[i] != -1) esp_hidd_send_keyboard_value(active_hid_conn_ids[i],cmdBuffer->buf[0],&cmdBuffer->buf[2],6);
-              }
-            } else {
-              esp_hidd_send_keyboard_value(hid_conn_id,cmdBuffer->buf[0],&cmdBuffer->buf[2],6);
+                if(active_hid_conn_ids[i] != -1) esp_hidd_send_mouse_value(active_hid_conn_ids[i],cmdBuffer->buf[2],cmdBuffer->buf[3],cmdBuffer->buf[4],cmdBuffer->buf[5]);
             }
-                    
-              //update timestamp
-              timestampLastSent = esp_timer_get_time();
-          } else if (cmdBuffer->buf[1] == 0x01) {  // joystick report
-              ESP_LOGI(EXT_UART_TAG,"joystick: axis: 0x%X:0x%X:0x%X:0x%X, hat: %d",cmdBuffer->buf[2],cmdBuffer->buf[3],cmdBuffer->buf[4],cmdBuffer->buf[5],cmdBuffer->buf[8]);
-              ESP_LOGI(EXT_UART_TAG,"joystick: buttons: 0x%X:0x%X:0x%X:0x%X",cmdBuffer->buf[9],cmdBuffer->buf[10],cmdBuffer->buf[11],cmdBuffer->buf[12]);
-              //@todo should be HID_JOYSTICK_IN_RPT_LEN, but not available here.
-              uint8_t joy[11];
-              memcpy(joy,&cmdBuffer->buf[2],11);
-              //send joystick report
-              #if CONFIG_MODULE_USEJOYSTICK
-              for(uint8_t i = 0; i<CONFIG_BT_ACL_CONNECTIONS; i++)
-              {
-                if(active_hid_conn_ids[i] != -1) esp_hidd_send_joy_report(active_hid_conn_ids[i],joy);
-              }
-              #else
-              ESP_LOGE(EXT_UART_TAG,"built without joystick support, cannot fix that!");
-              #endif
-          } else if (cmdBuffer->buf[1] == 0x03) {  // mouse report
-					if(hid_conn_id == -1)
-					{
-						for(uint8_t i = 0; i<CONFIG_BT_ACL_CONNECTIONS; i++)
-						{
-							if(active_hid_conn_ids[i] != -1) esp_hidd_send_mouse_value(active_hid_conn_ids[i],cmdBuffer->buf[2],cmdBuffer->buf[3],cmdBuffer->buf[4],cmdBuffer->buf[5]);
-						}
-					} else {
-						esp_hidd_send_mouse_value(hid_conn_id,cmdBuffer->buf[2],cmdBuffer->buf[3],cmdBuffer->buf[4],cmdBuffer->buf[5]);
-					}
-                    //update timestamp
-                    timestampLastSent = esp_timer_get_time();
-                    //and save mouse button state
-                    mouseButtons = cmdBuffer->buf[2];
-                    //ESP_LOGI(EXT_UART_TAG,"m: %d/%d",cmdBuffer->buf[3],cmdBuffer->buf[4]);
-                }
-                else ESP_LOGW(EXT_UART_TAG,"Unknown RAW HID packet");
+        } else {
+            esp_hidd_send_mouse_value(hid_conn_id,cmdBuffer->buf[2],cmdBuffer->buf[3],cmdBuffer->buf[4],cmdBuffer->buf[5]);
+        }
+        //update timestamp
+        timestampLastSent = esp_timer_get_time();
+        //and save mouse button state
+        mouseButtons = cmdBuffer->buf[2];
+    } else if (cmdBuffer->buf[1] == 0x05) {  // mouse report, high-resolution wheel & pan
+        //wheel & pan are given in 1/HID_MOUSE_WHEEL_MULTIPLIER detents
+        if(hid_conn_id == -1)
+        {
+            for(uint8_t i = 0; i<CONFIG_BT_ACL_CONNECTIONS; i++)
+            {
+                if(active_hid_conn_ids[i] != -1) esp_hidd_send_mouse_hires_value(active_hid_conn_ids[i],cmdBuffer->buf[2],cmdBuffer->buf[3],cmdBuffer->buf[4],(int8_t)cmdBuffer->buf[5],(int8_t)cmdBuffer->buf[6]);
             }
-            cmdBuffer->state=CMDSTATE_IDLE;
+        } else {
+            esp_hidd_send_mouse_hires_value(hid_conn_id,cmdBuffer->buf[2],cmdBuffer->buf[3],cmdBuffer->buf[4],(int8_t)cmdBuffer->buf[5],(int8_t)cmdBuffer->buf[6]);
         }
-        break;
+        //update timestamp
+        timestampLastSent = esp_timer_get_time();
+        //and save mouse button state
+        mouseButtons = cmdBuffer->buf[2];
+    } else {
+        ESP_LOGW(EXT_UART_TAG,"Unknown RAW HID packet");
+    }
+    hid_stats_frame_end();
+    HID_TRACE(HID_TRACE_FRAME_DONE, cmdBuffer->buf[1], 0);
+}
 
-    case CMDSTATE_GET_ASCII:
-        // collect a command string until CR or LF are received
-        if ((character==0x0d) || (character==0x0a))  {
-            cmdBuffer->buf[cmdBuffer->bufferLength]=0;
-            ESP_LOGI(EXT_UART_TAG,"sending command to parser: %s",cmdBuffer->buf);
+/** @brief Parser handler: process a complete ASCII command */
+static void uart_ascii_cmd(struct cmdBuf *cmdBuffer)
+{
+    ESP_LOGI(EXT_UART_TAG,"sending command to parser: %s",cmdBuffer->buf);
+    processCommand(cmdBuffer);
+    HID_TRACE(HID_TRACE_CMD, 0, cmdBuffer->buf[0] | (cmdBuffer->buf[1] << 8));
+}
 
-            processCommand(cmdBuffer);
-            cmdBuffer->state=CMDSTATE_IDLE;
-        } else {
-            if (cmdBuffer->bufferLength < MAX_CMDLEN-1)
-                cmdBuffer->buf[cmdBuffer->bufferLength++]=character;
-        }
-        break;
-    default:
-        cmdBuffer->state=CMDSTATE_IDLE;
+/** @brief Parser handler: payload of a $BD chunk */
+static void uart_binary_data(struct cmdBuf *cmdBuffer)
+{
+    kv_bulk_chunk_data(cmdBuffer->buf, cmdBuffer->bufferLength);
+    if(cmdBuffer->expectedBytes == 0) bulk_chunk_reply(cmdBuffer);
+}
+
+static const uart_parser_handler_t uart_handler = {
+    .frame_start = uart_frame_start,
+    .raw_frame = uart_raw_frame,
+    .ascii_cmd = uart_ascii_cmd,
+    .binary_data = uart_binary_data,
+};
+
+/** @brief Serializes the frame & command handlers, they are called by the external UART task,
+ * the console task (command mode) and the replay task. Created in app_main. */
+static SemaphoreHandle_t uart_handler_lock = NULL;
+static StaticSemaphore_t uart_handler_lock_buf;
+
+void uart_parse_command (uint8_t character, struct cmdBuf * cmdBuffer)
+{
+    HID_PROF_SCOPE(HID_PROF_PARSE);
+    xSemaphoreTake(uart_handler_lock, portMAX_DELAY);
+    uart_parser_feed(character, cmdBuffer, &uart_handler);
+    xSemaphoreGive(uart_handler_lock);
+}
+
+#if CONFIG_MODULE_CAPTURE
+/** parser state of the replayed stream, separate from the UART parsers */
+static struct cmdBuf replayBuffer;
+
+/** @brief Parser handler for replays: ASCII commands are not executed
+ * (a capture may contain $DP, $UG,... or the $CP command itself),
+ * the payload of a $BD chunk is skipped as well */
+static void uart_replay_cmd(struct cmdBuf *cmdBuffer)
+{
+    ESP_LOGI(EXT_UART_TAG,"replay: skipping command %s",cmdBuffer->buf);
+    if(strncmp((char *)cmdBuffer->buf,"BD ",3) == 0)
+    {
+        int chunklen = bulk_chunk_len((char *)cmdBuffer->buf+3);
+        if(chunklen > 0) uart_parser_expect_binary(cmdBuffer, chunklen);
     }
 }
 
+static const uart_parser_handler_t uart_replay_handler = {
+    .frame_start = uart_frame_start,
+    .raw_frame = uart_raw_frame,
+    .ascii_cmd = uart_replay_cmd,
+};
+
+static void uart_replay_feed(uint8_t data)
+{
+    HID_PROF_SCOPE(HID_PROF_PARSE);
+    xSemaphoreTake(uart_handler_lock, portMAX_DELAY);
+    uart_parser_feed(data, &replayBuffer, &uart_replay_handler);
+    xSemaphoreGive(uart_handler_lock);
+}
+
+static esp_err_t uart_replay_start(uint16_t speed)
+{
+    uart_parser_init(&replayBuffer, 0);
+    return uart_capture_replay(speed, uart_replay_feed, ext_uart_num);
+}
+#endif
+
 
 void uart_external_task(void *pvParameters)
 {
@@ -1207,38 +1702,29 @@ void uart_external_task(void *pvParameters)
     uart_driver_install(ext_uart_num, UART_FIFO_LEN * 2, UART_FIFO_LEN * 2, 0, NULL, 0);
 
     ESP_LOGI(EXT_UART_TAG,"external UART processing task started");
-    cmdBuffer.state=CMDSTATE_IDLE;
-    cmdBuffer.sendToUART = 1;
+    uart_parser_init(&cmdBuffer, 1);
 
     while(1)
     {
         // read & process a single byte
-        uart_read_bytes(ext_uart_num, (uint8_t*) &character, 1, portMAX_DELAY);
+        if(cmdBuffer.state == CMDSTATE_GET_BINARY)
+        {
+            //don't wait forever for the rest of a $BD chunk, report it as incomplete
+            if(uart_read_bytes(ext_uart_num, (uint8_t*) &character, 1, pdMS_TO_TICKS(KV_BULK_TIMEOUT_MS)) <= 0)
+            {
+                ESP_LOGW(EXT_UART_TAG,"timeout receiving binary data");
+                xSemaphoreTake(uart_handler_lock, portMAX_DELAY);
+                uart_parser_init(&cmdBuffer, 1);
+                bulk_chunk_reply(&cmdBuffer);
+                xSemaphoreGive(uart_handler_lock);
+                continue;
+            }
+        } else uart_read_bytes(ext_uart_num, (uint8_t*) &character, 1, portMAX_DELAY);
+        UART_CAPTURE(character);
         uart_parse_command(character, &cmdBuffer);
     }
 }
 
-void blink_task(void *pvParameter)
-{
-    // Initialize GPIO pins
-    //gpio_pad_select_gpio(indicator_led);
-    gpio_set_direction(indicator_led, GPIO_MODE_OUTPUT);
-    int blinkTime;
-
-    while(1) {
-		
-        if (isConnected()) blinkTime=1000;
-        else blinkTime=250;
-
-        /* Blink off (output low) */
-        gpio_set_level(indicator_led, 0);
-        vTaskDelay(blinkTime / portTICK_PERIOD_MS);
-        /* Blink on (output high) */
-        gpio_set_level(indicator_led, 1);
-        vTaskDelay(blinkTime / portTICK_PERIOD_MS);
-    }
-}
-
 //#if CONFIG_MODULE_NANO
 
 int uart_vprintf_valid = 0;
@@ -1259,10 +1745,9 @@ void uart_console_task(void *pvParameters)
 		//use input as HID test OR as input to processCommand (test commands)
 		uint8_t hid_or_command = 0;
     struct cmdBuf commands;
-    commands.sendToUART = 0;
-    commands.state=CMDSTATE_IDLE;
+    uart_parser_init(&commands, 0);
     #if CONFIG_MODULE_USEJOYSTICK
-		uint8_t joy[11] = {0};
+		uint8_t joy[HID_JOYSTICK_IN_RPT_LEN] = {0};
     #endif
 
     //Install UART driver, and get the queue.
@@ -1274,6 +1759,7 @@ void uart_console_task(void *pvParameters)
     {
         // read single byte
         uart_read_bytes(CONSOLE_UART_NUM, (uint8_t*) &character, 1, portMAX_DELAY);
+        HID_TRACE(HID_TRACE_TASK_WAKE, HID_TRACE_TASK_CONSOLE, 0);
         #if CONFIG_MODULE_NANO
           //if communcating with the RP2040, we need "dual-use" on UART0:
           // * debugging via esp-idf logger
@@ -1301,11 +1787,7 @@ void uart_console_task(void *pvParameters)
 			case 'm':
 				for(uint8_t i = 0; i<CONFIG_BT_ACL_CONNECTIONS; i++)
 				{
-					if(active_hid_conn_ids[i] != -1)
-					{
-						esp_hidd_send_consumer_value(active_hid_conn_ids[i],HID_CONSUMER_MUTE,true);
-						esp_hidd_send_consumer_value(active_hid_conn_ids[i],HID_CONSUMER_MUTE,false);
-					}
+					if(active_hid_conn_ids[i] != -1) esp_hidd_send_consumer_tap(active_hid_conn_ids[i],HID_CONSUMER_MUTE);
 				}
 				ESP_LOGI(CONSOLE_UART_TAG,"consumer: mute");
 				break;
@@ -1357,22 +1839,14 @@ void uart_console_task(void *pvParameters)
 			case 'p':
 				for(uint8_t i = 0; i<CONFIG_BT_ACL_CONNECTIONS; i++)
 				{
-					if(active_hid_conn_ids[i] != -1)
-					{
-						esp_hidd_send_consumer_value(active_hid_conn_ids[i],HID_CONSUMER_VOLUME_UP,true);
-						esp_hidd_send_consumer_value(active_hid_conn_ids[i],HID_CONSUMER_VOLUME_UP,false);
-					}
+					if(active_hid_conn_ids[i] != -1) esp_hidd_send_consumer_tap(active_hid_conn_ids[i],HID_CONSUMER_VOLUME_UP);
 				}
 				ESP_LOGI(CONSOLE_UART_TAG,"consumer: volume plus");
 				break;
 			case 'o':
 				for(uint8_t i = 0; i<CONFIG_BT_ACL_CONNECTIONS; i++)
 				{
-					if(active_hid_conn_ids[i] != -1)
-					{
-						esp_hidd_send_consumer_value(active_hid_conn_ids[i],HID_CONSUMER_VOLUME_DOWN,true);
-						esp_hidd_send_consumer_value(active_hid_conn_ids[i],HID_CONSUMER_VOLUME_DOWN,false);
-					}
+					if(active_hid_conn_ids[i] != -1) esp_hidd_send_consumer_tap(active_hid_conn_ids[i],HID_CONSUMER_VOLUME_DOWN);
 				}
 				ESP_LOGI(CONSOLE_UART_TAG,"consumer: volume minus");
 				break;
@@ -1446,9 +1920,57 @@ void uart_console_task(void *pvParameters)
     }
 }
 
+/** @brief Open the NVS handles & load the configuration
+ *
+ * Independent of the BT stack, runs in config_load_task while app_main brings up
+ * the controller & Bluedroid. Sets SYSTEM_CONFIG_LOADED when done. */
+static void config_load(void)
+{
+    esp_err_t ret;
+
+    //open NVS handle for storing BT device names
+    ESP_LOGI("MAIN","opening NVS handle for BT names");
+    ret = nvs_open("btnames", NVS_READWRITE, &nvs_bt_name_h);
+    if(ret != ESP_OK) ESP_LOGE("MAIN","error opening NVS for bt names");
+    
+    //open NVS handle for key/value storage via UART
+    ESP_LOGI("MAIN","opening NVS handle for key/value storage");
+    ret = nvs_open("kvstorage", NVS_READWRITE, &nvs_storage_h);
+    if(ret != ESP_OK) ESP_LOGE("MAIN","error opening NVS for key/value storage");
+    else {
+      kv_cache_init(nvs_storage_h);
+      kv_bulk_init(nvs_storage_h);
+    }
+    
+    // Read config (one blob, legacy keys are migrated on first boot)
+    ESP_LOGI("MAIN","loading configuration from NVS");
+    ret = config_store_load(&config);
+    if(ret != ESP_OK) ESP_LOGI("MAIN","no valid config in NVS (%s), using defaults",esp_err_to_name(ret));
+    ESP_LOGI("MAIN","bt device name is: %s",config.bt_device_name);
+    ESP_LOGI("MAIN","locale code is : %d",config.locale);
+    #if CONFIG_MODULE_USEJOYSTICK
+    ESP_LOGI("MAIN","Joystick: %d",config.joystick_active);
+    #else
+    config.joystick_active = 0;
+    #endif
+    ESP_LOGI("MAIN","Setting appearance to 0x03C%d",config.appearance);
+    hidd_adv_data.appearance = 0x03C0 + config.appearance;
+    ///@todo How to handle the locale here? We have the memory for full lookups on the ESP32, but how to communicate this with the Teensy?
+
+    boot_prof_mark(BOOT_PROF_CONFIG);
+    xEventGroupSetBits(eventgroup_system,SYSTEM_CONFIG_LOADED);
+}
+
+void config_load_task(void *param)
+{
+    config_load();
+    vTaskDelete(NULL);
+}
+
 void app_main(void)
 {
     esp_err_t ret;
+    boot_prof_mark(BOOT_PROF_APP_MAIN);
     
     //set external UART number according to setup
     //and setup anything pin related.
@@ -1474,6 +1996,13 @@ void app_main(void)
       indicator_led = CONFIG_MODULE_LED_PIN;
     #endif
 
+    //the LED is blinked by LEDC, the pattern changes on events (see led_show_state)
+    #if CONFIG_MODULE_NANO
+    indicator_led_init(indicator_led, 1);
+    #else
+    indicator_led_init(indicator_led, 0);
+    #endif
+
     // Initialize FreeRTOS elements
     eventgroup_system = xEventGroupCreate();
     if(eventgroup_system == NULL) ESP_LOGE(HID_DEMO_TAG, "Cannot initialize event group");
@@ -1496,6 +2025,16 @@ void app_main(void)
         ret = nvs_flash_init();
     }
     ESP_ERROR_CHECK( ret );
+    boot_prof_mark(BOOT_PROF_NVS_INIT);
+
+    //load the configuration on the input core, while the BT controller & Bluedroid
+    //are brought up (the BT tasks run on core 0)
+    if(xTaskCreatePinnedToCore(&config_load_task, "config", 4096, NULL, uxTaskPriorityGet(NULL),
+        NULL, TASK_CORE_INPUT) != pdPASS)
+    {
+        ESP_LOGE("MAIN","cannot start config task, loading config sequentially");
+        config_load();
+    }
 
     ESP_ERROR_CHECK(esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT));
 
@@ -1505,12 +2044,14 @@ void app_main(void)
         ESP_LOGE(HID_DEMO_TAG, "%s initialize controller failed\n", __func__);
         return;
     }
+    boot_prof_mark(BOOT_PROF_CTRL_INIT);
 
     ret = esp_bt_controller_enable(ESP_BT_MODE_BLE);
     if (ret) {
         ESP_LOGE(HID_DEMO_TAG, "%s enable controller failed\n", __func__);
         return;
     }
+    boot_prof_mark(BOOT_PROF_CTRL_ENABLE);
 
     ret = esp_bluedroid_init();
     if (ret) {
@@ -1523,62 +2064,16 @@ void app_main(void)
         ESP_LOGE(HID_DEMO_TAG, "%s init bluedroid failed\n", __func__);
         return;
     }
+    boot_prof_mark(BOOT_PROF_BLUEDROID);
 
     if((ret = esp_hidd_profile_init()) != ESP_OK) {
         ESP_LOGE(HID_DEMO_TAG, "%s init bluedroid failed\n", __func__);
     }
     
-    //open NVS handle for storing BT device names
-    ESP_LOGI("MAIN","opening NVS handle for BT names");
-    ret = nvs_open("btnames", NVS_READWRITE, &nvs_bt_name_h);
-    if(ret != ESP_OK) ESP_LOGE("MAIN","error opening NVS for bt names");
-    
-    //open NVS handle for key/value storage via UART
-    ESP_LOGI("MAIN","opening NVS handle for key/value storage");
-    ret = nvs_open("kvstorage", NVS_READWRITE, &nvs_storage_h);
-    if(ret != ESP_OK) ESP_LOGE("MAIN","error opening NVS for key/value storage");
-    
-    //read the appearance value for advertising
-    uint8_t advapp;
-    ret = nvs_get_u8(nvs_storage_h,"BLEAPPEAR",&advapp);
-    if(ret == ESP_OK)
-    {
-      ESP_LOGI("MAIN","Setting appearance to 0x03C%d",advapp);
-      hidd_adv_data.appearance = 0x03C0 + advapp;
-    }
-    
-    // Read config
-    nvs_handle my_handle;
-    ESP_LOGI("MAIN","loading configuration from NVS");
-    ret = nvs_open("config_c", NVS_READWRITE, &my_handle);
-    if(ret != ESP_OK) ESP_LOGE("MAIN","error opening NVS");
-    size_t available_size = MAX_BT_DEVICENAME_LENGTH;
-    strcpy(config.bt_device_name, GATTS_TAG);
-    nvs_get_str (my_handle, "btname", config.bt_device_name, &available_size);
-    if(ret != ESP_OK)
-    {
-        ESP_LOGI("MAIN","error reading NVS - bt name, setting to default");
-        strcpy(config.bt_device_name, GATTS_TAG);
-    } else ESP_LOGI("MAIN","bt device name is: %s",config.bt_device_name);
-
-    //get from NVS if the joystick should be registered
-    #if CONFIG_MODULE_USEJOYSTICK
-    config.joystick_active = 0;
-    nvs_get_u8(my_handle, "joyactive", &config.joystick_active);
-    ESP_LOGI("MAIN","Joystick: %d",config.joystick_active);
-    #endif
-    
-    //get locale
-    ret = nvs_get_u8(my_handle, "locale", &config.locale);
-    //if(ret != ESP_OK || config.locale >= LAYOUT_MAX)
-    ///@todo implement keyboard layouts.
-    if(ret != ESP_OK)
-    {
-        ESP_LOGI("MAIN","error reading NVS - locale, setting to US_INTERNATIONAL");
-        //config.locale = LAYOUT_US_INTERNATIONAL;
-    } else ESP_LOGI("MAIN","locale code is : %d",config.locale);
-    nvs_close(my_handle);
-    ///@todo How to handle the locale here? We have the memory for full lookups on the ESP32, but how to communicate this with the Teensy?
+    //the GATT apps need the device name, appearance & joystick setting
+    xEventGroupWaitBits(eventgroup_system,SYSTEM_CONFIG_LOADED,pdFALSE,pdTRUE,portMAX_DELAY);
+    //bonds are loaded by Bluedroid, names are in "btnames" (opened by config_load)
+    bond_cache_init(nvs_bt_name_h);
     
     ///clear the HID connection IDs&MACs
     for(uint8_t i = 0; i<CONFIG_BT_ACL_CONNECTIONS;i++)
@@ -1589,6 +2084,10 @@ void app_main(void)
     ///register the callback function to the gap module
     esp_ble_gap_register_callback(gap_event_handler);
     esp_hidd_register_callbacks(hidd_event_callback,config.joystick_active);
+    boot_prof_mark(BOOT_PROF_HIDD_REGISTER);
+    #if CONFIG_MODULE_USEJOYSTICK
+    if(joystick_filter_init(joystick_send_filtered) != ESP_OK) ESP_LOGE("MAIN","error initializing joystick filter");
+    #endif
 
     /* set the security iocap & auth_req & key size & init key response key parameters to the stack*/
     esp_ble_auth_req_t auth_req = ESP_LE_AUTH_BOND;     //bonding with peer device after authentication
@@ -1609,12 +2108,14 @@ void app_main(void)
     //start active scan
     //if(esp_ble_gap_set_scan_params(&scan_params) != ESP_OK) ESP_LOGE("MAIN","Cannot set scan params");
     //a console for HID debugging (sending simple mouse/kbd commands) is not available on Arduino RP2040 Connect.
+    //statically allocated & pinned, see task_config.h for the priority plan
+    uart_handler_lock = xSemaphoreCreateMutexStatic(&uart_handler_lock_buf);
     #if CONFIG_MODULE_MINIBT
-      xTaskCreate(&uart_console_task,  "console", 4096, NULL, configMAX_PRIORITIES, NULL);
+      xTaskCreateStaticPinnedToCore(&uart_console_task, "console", TASK_STACK_CONSOLE, NULL,
+        TASK_PRIO_CONSOLE, console_stack, &console_tcb, TASK_CORE_INPUT);
     #endif
-    xTaskCreate(&uart_external_task, "external", 4096, NULL, configMAX_PRIORITIES, NULL);
-    ///@todo maybe reduce stack size for blink task? 4k words for blinky :-)?
-    xTaskCreate(&blink_task, "blink", 4096, NULL, configMAX_PRIORITIES, NULL);
+    xTaskCreateStaticPinnedToCore(&uart_external_task, "external", TASK_STACK_EXTERNAL, NULL,
+      TASK_PRIO_EXTERNAL, external_stack, &external_tcb, TASK_CORE_INPUT);
     
     //start periodic timer to send HID reports
     const esp_timer_create_args_t periodic_timer_args = {
@@ -0,0 +1,290 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ *
+ * RAM copy of the bonded peers & their names for $GP / $DP: queries need neither
+ * heap allocations nor NVS reads, the copy is updated on bond events.
+ * Names from advertising data are written back to NVS only for bonded peers and
+ * only if they changed, batched by a low priority writer task.
+ */
+
+#include "bond_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_gap_ble_api.h"
+#include "esp_log.h"
+#include "task_config.h"
+
+#define BOND_CACHE_TAG "BOND"
+
+/** @brief Name of a peer which is not bonded (yet) */
+typedef struct {
+    esp_bd_addr_t addr;
+    char name[BOND_CACHE_NAME_LEN];
+    uint8_t used;
+} bond_cache_seen_t;
+
+static bond_cache_entry_t bonds[BOND_CACHE_MAX];
+static uint8_t bond_count = 0;
+static bond_cache_seen_t seen[BOND_CACHE_SEEN_MAX];
+static uint8_t seen_next = 0;
+static nvs_handle_t names_nvs;
+static SemaphoreHandle_t bond_lock = NULL;
+static StaticSemaphore_t bond_lock_buf;
+static TaskHandle_t writer_task = NULL;
+static StackType_t writer_stack[TASK_STACK_NAMES];
+static StaticTask_t writer_tcb;
+
+static void bond_cache_key(const esp_bd_addr_t addr, char key[13])
+{
+    sprintf(key, "%02X%02X%02X%02X%02X%02X", addr[0], addr[1], addr[2],
+            addr[3], addr[4], addr[5]);
+}
+
+static void bond_cache_load_name(bond_cache_entry_t *e)
+{
+    char key[13];
+    size_t len = sizeof(e->name);
+
+    bond_cache_key(e->addr, key);
+    if (nvs_get_str(names_nvs, key, e->name, &len) != ESP_OK) e->name[0] = '\0';
+}
+
+static int bond_cache_find(const esp_bd_addr_t addr)
+{
+    for (uint8_t i = 0; i < bond_count; i++) {
+        if (memcmp(bonds[i].addr, addr, sizeof(esp_bd_addr_t)) == 0) return i;
+    }
+    return -1;
+}
+
+static bond_cache_seen_t *bond_cache_find_seen(const esp_bd_addr_t addr)
+{
+    for (uint8_t i = 0; i < BOND_CACHE_SEEN_MAX; i++) {
+        if (seen[i].used && memcmp(seen[i].addr, addr, sizeof(esp_bd_addr_t)) == 0) return &seen[i];
+    }
+    return NULL;
+}
+
+/** @brief Names written by the current batch (writer task only) */
+static bond_cache_entry_t flushed[BOND_CACHE_MAX];
+
+/** @brief Writes the dirty names after BOND_CACHE_FLUSH_DELAY_MS, one commit per batch
+ * @note Names are marked clean only after a successful commit & if they did not change
+ * meanwhile, failed ones are written again with the next batch */
+static void bond_cache_writer_task(void *param)
+{
+    uint8_t written;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        //collect further changes (scan results arrive in bursts)
+        vTaskDelay(pdMS_TO_TICKS(BOND_CACHE_FLUSH_DELAY_MS));
+        ulTaskNotifyTake(pdTRUE, 0);
+
+        written = 0;
+        for (uint8_t i = 0; i < BOND_CACHE_MAX; i++) {
+            bond_cache_entry_t *e = &flushed[written];
+
+            //copy under the lock, NVS access without
+            xSemaphoreTake(bond_lock, portMAX_DELAY);
+            if (i >= bond_count) {
+                xSemaphoreGive(bond_lock);
+                break;
+            }
+            memcpy(e, &bonds[i], sizeof(*e));
+            xSemaphoreGive(bond_lock);
+            if (!e->dirty) continue;
+
+            char key[13];
+            bond_cache_key(e->addr, key);
+            if (nvs_set_str(names_nvs, key, e->name) == ESP_OK) {
+                written++;
+            } else {
+                ESP_LOGW(BOND_CACHE_TAG, "error saving %s for %s", e->name, key);
+            }
+        }
+        if (written == 0) continue;
+        if (nvs_commit(names_nvs) != ESP_OK) {
+            ESP_LOGW(BOND_CACHE_TAG, "error committing names");
+            continue;
+        }
+        //the list may have been synced meanwhile: entries are found by address
+        xSemaphoreTake(bond_lock, portMAX_DELAY);
+        for (uint8_t i = 0; i < written; i++) {
+            int idx = bond_cache_find(flushed[i].addr);
+            if (idx >= 0 && strcmp(bonds[idx].name, flushed[i].name) == 0) bonds[idx].dirty = 0;
+        }
+        xSemaphoreGive(bond_lock);
+        ESP_LOGI(BOND_CACHE_TAG, "saved %u name(s)", written);
+    }
+}
+
+static void bond_cache_schedule_write(void)
+{
+    if (writer_task != NULL) xTaskNotifyGive(writer_task);
+}
+
+void bond_cache_init(nvs_handle_t names_h)
+{
+    names_nvs = names_h;
+    if (bond_lock == NULL) bond_lock = xSemaphoreCreateMutexStatic(&bond_lock_buf);
+    if (writer_task == NULL) {
+        writer_task = xTaskCreateStaticPinnedToCore(&bond_cache_writer_task, "names", TASK_STACK_NAMES,
+            NULL, TASK_PRIO_NAMES, writer_stack, &writer_tcb, TASK_CORE_INPUT);
+    }
+    bond_cache_sync();
+}
+
+void bond_cache_sync(void)
+{
+    bond_cache_entry_t *old;
+    esp_ble_bond_dev_t *list;
+    int count;
+    uint8_t old_count;
+    uint8_t dirty = 0;
+
+    if (bond_lock == NULL) return;
+    count = esp_ble_get_bond_device_num();
+    if (count < 0) count = 0;
+    if (count > BOND_CACHE_MAX) count = BOND_CACHE_MAX;
+    //only on bond events, the queries don't allocate
+    list = count ? malloc(sizeof(esp_ble_bond_dev_t) * count) : NULL;
+    old = malloc(sizeof(bonds));
+    if ((count && list == NULL) || old == NULL) {
+        ESP_LOGE(BOND_CACHE_TAG, "no memory to update the bond list");
+        free(list);
+        free(old);
+        return;
+    }
+    if (count && esp_ble_get_bond_device_list(&count, list) != ESP_OK) {
+        ESP_LOGE(BOND_CACHE_TAG, "cannot get the bond list");
+        count = 0;
+    }
+
+    xSemaphoreTake(bond_lock, portMAX_DELAY);
+    memcpy(old, bonds, sizeof(bonds));
+    old_count = bond_count;
+    for (uint8_t i = 0; i < count; i++) {
+        bond_cache_entry_t *e = &bonds[i];
+        memcpy(e->addr, list[i].bd_addr, sizeof(esp_bd_addr_t));
+        e->name[0] = '\0';
+        e->dirty = 0;
+        //keep the name of known peers, NVS only for new ones
+        uint8_t j;
+        for (j = 0; j < old_count; j++) {
+            if (memcmp(old[j].addr, e->addr, sizeof(esp_bd_addr_t)) == 0) {
+                memcpy(e->name, old[j].name, sizeof(e->name));
+                e->dirty = old[j].dirty;
+                break;
+            }
+        }
+        if (j == old_count) {
+            bond_cache_load_name(e);
+            //name seen before bonding: store it now if it is new
+            bond_cache_seen_t *s = bond_cache_find_seen(e->addr);
+            if (s != NULL) {
+                if (strcmp(s->name, e->name) != 0) {
+                    memcpy(e->name, s->name, sizeof(e->name));
+                    e->dirty = 1;
+                }
+                s->used = 0;
+            }
+        }
+        dirty |= e->dirty;
+    }
+    bond_count = count;
+    xSemaphoreGive(bond_lock);
+
+    free(list);
+    free(old);
+    if (dirty) bond_cache_schedule_write();
+    ESP_LOGI(BOND_CACHE_TAG, "%u bonded device(s)", bond_count);
+}
+
+void bond_cache_remove(const esp_bd_addr_t addr)
+{
+    int i;
+
+    if (bond_lock == NULL) return;
+    xSemaphoreTake(bond_lock, portMAX_DELAY);
+    if ((i = bond_cache_find(addr)) >= 0) {
+        //keep the order of the stack's list
+        memmove(&bonds[i], &bonds[i + 1], sizeof(bond_cache_entry_t) * (bond_count - i - 1));
+        bond_count--;
+    }
+    xSemaphoreGive(bond_lock);
+}
+
+void bond_cache_set_name(const esp_bd_addr_t addr, const uint8_t *name, uint8_t len)
+{
+    char buf[BOND_CACHE_NAME_LEN];
+    uint8_t changed = 0;
+    int i;
+
+    if (bond_lock == NULL || name == NULL) return;
+    if (len >= sizeof(buf)) len = sizeof(buf) - 1;
+    memcpy(buf, name, len);
+    buf[len] = '\0';
+
+    xSemaphoreTake(bond_lock, portMAX_DELAY);
+    if ((i = bond_cache_find(addr)) >= 0) {
+        if (strcmp(bonds[i].name, buf) != 0) {
+            memcpy(bonds[i].name, buf, sizeof(buf));
+            bonds[i].dirty = 1;
+            changed = 1;
+        }
+    } else {
+        bond_cache_seen_t *s = bond_cache_find_seen(addr);
+        if (s == NULL) {
+            //bounded, replace the oldest entry
+            s = &seen[seen_next];
+            seen_next = (seen_next + 1) % BOND_CACHE_SEEN_MAX;
+            memcpy(s->addr, addr, sizeof(esp_bd_addr_t));
+            s->used = 1;
+        }
+        memcpy(s->name, buf, sizeof(buf));
+    }
+    xSemaphoreGive(bond_lock);
+
+    if (changed) bond_cache_schedule_write();
+}
+
+uint8_t bond_cache_count(void)
+{
+    return bond_count;
+}
+
+esp_err_t bond_cache_get(uint8_t index, bond_cache_entry_t *entry)
+{
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+
+    if (bond_lock == NULL) return ret;
+    xSemaphoreTake(bond_lock, portMAX_DELAY);
+    if (index < bond_count) {
+        memcpy(entry, &bonds[index], sizeof(bond_cache_entry_t));
+        ret = ESP_OK;
+    }
+    xSemaphoreGive(bond_lock);
+    return ret;
+}
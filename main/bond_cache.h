@@ -0,0 +1,81 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ */
+
+#ifndef _BOND_CACHE_H_
+#define _BOND_CACHE_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_bt_defs.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+
+/** @brief Maximum number of cached bonds (same as the Bluedroid bond storage) */
+#ifdef CONFIG_BT_SMP_MAX_BONDS
+  #define BOND_CACHE_MAX        CONFIG_BT_SMP_MAX_BONDS
+#else
+  #define BOND_CACHE_MAX        15
+#endif
+
+/** @brief Maximum length of a peer name (incl. '\0'), names from advertising data are shorter */
+#define BOND_CACHE_NAME_LEN     32
+
+/** @brief Names of not (yet) bonded peers kept in RAM, stored to NVS when the peer bonds */
+#define BOND_CACHE_SEEN_MAX     8
+
+/** @brief Delay for collecting name changes before writing them to NVS (one commit) */
+#define BOND_CACHE_FLUSH_DELAY_MS   2000
+
+/** @brief One bonded peer */
+typedef struct {
+    esp_bd_addr_t addr;
+    char name[BOND_CACHE_NAME_LEN];    /// peer name, "" if unknown
+    uint8_t dirty;                     /// name not written to NVS yet
+} bond_cache_entry_t;
+
+/** @brief Load the bond list from the stack & the peer names from NVS, start the name writer task
+ * @note Call after esp_bluedroid_enable (bonds are loaded by the stack)
+ * @param names_h NVS handle of the address -> name storage (key: address as 12 hex digits) */
+void bond_cache_init(nvs_handle_t names_h);
+
+/** @brief Re-read the bond list from the stack (after authentication, the list changed)
+ * @note Names of known peers are kept, only new peers are looked up in NVS */
+void bond_cache_sync(void);
+
+/** @brief Remove a peer (bond removal complete) */
+void bond_cache_remove(const esp_bd_addr_t addr);
+
+/** @brief Update the cached name of a peer (e.g. from advertising data)
+ *
+ * Bonded peers: a changed name is written to NVS by the writer task after
+ * BOND_CACHE_FLUSH_DELAY_MS, unchanged names cost a compare only.
+ * Other peers: the name is kept in RAM until the peer bonds.
+ * @param name Name, not necessarily terminated
+ * @param len Length of name */
+void bond_cache_set_name(const esp_bd_addr_t addr, const uint8_t *name, uint8_t len);
+
+/** @brief Number of bonded peers */
+uint8_t bond_cache_count(void);
+
+/** @brief Get one bonded peer, in the order of the stack's bond list
+ * @return ESP_OK or ESP_ERR_NOT_FOUND if index >= bond_cache_count() */
+esp_err_t bond_cache_get(uint8_t index, bond_cache_entry_t *entry);
+
+#endif
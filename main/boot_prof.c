@@ -0,0 +1,71 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ *
+ * Timestamps of the boot phases, from power-on to the first connection.
+ */
+
+#include "boot_prof.h"
+
+#include <stdio.h>
+#include "esp_timer.h"
+
+static const char *const phase_names[BOOT_PROF_NUM] = {
+    [BOOT_PROF_APP_MAIN] = "app_main",
+    [BOOT_PROF_NVS_INIT] = "nvs_init",
+    [BOOT_PROF_CTRL_INIT] = "ctrl_init",
+    [BOOT_PROF_CTRL_ENABLE] = "ctrl_enable",
+    [BOOT_PROF_BLUEDROID] = "bluedroid",
+    [BOOT_PROF_CONFIG] = "config",
+    [BOOT_PROF_HIDD_REGISTER] = "hidd_register",
+    [BOOT_PROF_ADV_DATA] = "adv_data",
+    [BOOT_PROF_ADV_START] = "adv_start",
+    [BOOT_PROF_HID_SERVICE] = "hid_service",
+    [BOOT_PROF_CONNECT] = "connect",
+};
+
+//written once per phase (aligned 32bit stores), read by $BT
+static volatile uint32_t marks[BOOT_PROF_NUM];
+
+void boot_prof_mark(boot_prof_phase_t phase)
+{
+    if (phase >= BOOT_PROF_NUM || marks[phase] != 0) return;
+    //esp_timer starts counting before app_main, 0 is never a valid mark
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    marks[phase] = now != 0 ? now : 1;
+}
+
+uint32_t boot_prof_get(boot_prof_phase_t phase)
+{
+    return phase < BOOT_PROF_NUM ? marks[phase] : 0;
+}
+
+int boot_prof_format(boot_prof_phase_t phase, char *buf, size_t len)
+{
+    uint32_t prev = 0;
+    int pos;
+
+    if (phase >= BOOT_PROF_NUM || marks[phase] == 0) return 0;
+    //delta to the latest phase which finished before this one (phases may overlap)
+    for (uint8_t i = 0; i < BOOT_PROF_NUM; i++) {
+        if (marks[i] != 0 && marks[i] < marks[phase] && marks[i] > prev) prev = marks[i];
+    }
+    pos = snprintf(buf, len, "BT:%s,%lu,%lu\r\n", phase_names[phase],
+                   (unsigned long)marks[phase], (unsigned long)(marks[phase] - prev));
+    return pos < (int)len ? pos : (int)len - 1;
+}
@@ -0,0 +1,55 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ */
+
+#ifndef _BOOT_PROF_H_
+#define _BOOT_PROF_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** @brief Boot phases, in the order they are expected to finish */
+typedef enum {
+    BOOT_PROF_APP_MAIN = 0,     /// app_main entered
+    BOOT_PROF_NVS_INIT,         /// nvs_flash_init done
+    BOOT_PROF_CTRL_INIT,        /// esp_bt_controller_init done
+    BOOT_PROF_CTRL_ENABLE,      /// esp_bt_controller_enable done
+    BOOT_PROF_BLUEDROID,        /// esp_bluedroid_init & enable done
+    BOOT_PROF_CONFIG,           /// NVS handles opened & config loaded (runs in parallel to the BT bring-up)
+    BOOT_PROF_HIDD_REGISTER,    /// HID & battery GATT apps registered
+    BOOT_PROF_ADV_DATA,         /// advertising data configured (HID app registered)
+    BOOT_PROF_ADV_START,        /// advertising started (device visible)
+    BOOT_PROF_HID_SERVICE,      /// HID service attribute table created & started
+    BOOT_PROF_CONNECT,          /// first host connected
+    BOOT_PROF_NUM,
+} boot_prof_phase_t;
+
+/** @brief Record the time since boot for a phase, only the first call per phase counts */
+void boot_prof_mark(boot_prof_phase_t phase);
+
+/** @brief Get the recorded time of a phase
+ * @return Time since boot in us, 0 if the phase was not reached (yet) */
+uint32_t boot_prof_get(boot_prof_phase_t phase);
+
+/** @brief Format one phase as one line
+ * Format: "BT:<name>,<us since boot>,<us since previous phase>\r\n"
+ * @return Length of the line, 0 if the phase was not reached (yet) */
+int boot_prof_format(boot_prof_phase_t phase, char *buf, size_t len);
+
+#endif
@@ -24,10 +24,17 @@
 // serial port of monitor and for debugging (not in KConfig, won't be changed normally)
 #define CONSOLE_UART_NUM 	 UART_NUM_0
 
+// default advertising appearance: 0x03C0 + CONFIG_DEFAULT_APPEARANCE (HID mouse)
+#define CONFIG_DEFAULT_APPEARANCE 2
+
+/** @brief Persistent configuration, stored as one blob by config_store.c
+ * @note New fields must be appended at the end (older blobs are extended with defaults)
+ * and CONFIG_STORE_VERSION must be increased. */
 typedef struct config_data {
     char bt_device_name[MAX_BT_DEVICENAME_LENGTH];
     uint8_t locale;
     uint8_t joystick_active;
+    uint8_t appearance;     /// advertising appearance 0x03C0 + appearance ($AP)
 } config_data_t;
 
 
@@ -0,0 +1,188 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ *
+ * Persistent configuration (config_data_t) as one versioned, CRC protected NVS blob.
+ */
+
+#include "config_store.h"
+
+#include <string.h>
+#include <stddef.h>
+#include "nvs.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+
+#define CONFIG_STORE_TAG "CONFIG"
+#define CONFIG_STORE_NAMESPACE "config_c"
+#define CONFIG_STORE_KEY "cfg"
+
+/** @brief Stored blob: header & configuration */
+typedef struct {
+    uint16_t version;   /// CONFIG_STORE_VERSION when written
+    uint16_t length;    /// sizeof(config_data_t) when written
+    uint32_t crc;       /// CRC32 of the configuration (length bytes)
+    config_data_t data;
+} config_blob_t;
+
+static nvs_handle_t config_h;
+static uint8_t config_h_open = 0;
+//CRC of the stored configuration, used to skip writes without changes
+static uint32_t stored_crc;
+static uint8_t stored_valid = 0;
+
+static esp_err_t config_store_open(void)
+{
+    esp_err_t ret;
+    if (config_h_open) return ESP_OK;
+    ret = nvs_open(CONFIG_STORE_NAMESPACE, NVS_READWRITE, &config_h);
+    if (ret == ESP_OK) config_h_open = 1;
+    else ESP_LOGE(CONFIG_STORE_TAG, "cannot open NVS: %s", esp_err_to_name(ret));
+    return ret;
+}
+
+static uint32_t config_store_crc(const config_data_t *cfg, uint16_t length)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)cfg, length);
+}
+
+void config_store_defaults(config_data_t *cfg)
+{
+    memset(cfg, 0, sizeof(config_data_t));
+    strcpy(cfg->bt_device_name, GATTS_TAG);
+    cfg->appearance = CONFIG_DEFAULT_APPEARANCE;
+}
+
+/** @brief Replace invalid values by their defaults */
+static void config_store_sanitize(config_data_t *cfg)
+{
+    cfg->bt_device_name[MAX_BT_DEVICENAME_LENGTH - 1] = '\0';
+    if (cfg->bt_device_name[0] == '\0') strcpy(cfg->bt_device_name, GATTS_TAG);
+    if (cfg->joystick_active > 1) cfg->joystick_active = 0;
+    if (cfg->appearance > 4) cfg->appearance = CONFIG_DEFAULT_APPEARANCE;
+}
+
+/** @brief Read the pre-blob keys into cfg
+ * @return ESP_OK if at least one legacy key was found */
+static esp_err_t config_store_migrate(config_data_t *cfg)
+{
+    size_t len = sizeof(cfg->bt_device_name);
+    nvs_handle_t kv_h;
+    uint8_t found = 0;
+
+    if (nvs_get_str(config_h, "btname", cfg->bt_device_name, &len) == ESP_OK) found = 1;
+    else strcpy(cfg->bt_device_name, GATTS_TAG);
+    if (nvs_get_u8(config_h, "locale", &cfg->locale) == ESP_OK) found = 1;
+    if (nvs_get_u8(config_h, "joyactive", &cfg->joystick_active) == ESP_OK) found = 1;
+    //the appearance was stored with the $SV key/value pairs
+    if (nvs_open("kvstorage", NVS_READONLY, &kv_h) == ESP_OK) {
+        if (nvs_get_u8(kv_h, "BLEAPPEAR", &cfg->appearance) == ESP_OK) found = 1;
+        nvs_close(kv_h);
+    }
+    return found ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+/** @brief Erase the pre-blob keys, call after the migrated config was saved */
+static void config_store_migrate_erase(void)
+{
+    nvs_handle_t kv_h;
+
+    nvs_erase_key(config_h, "btname");
+    nvs_erase_key(config_h, "locale");
+    nvs_erase_key(config_h, "joyactive");
+    nvs_commit(config_h);
+    if (nvs_open("kvstorage", NVS_READWRITE, &kv_h) == ESP_OK) {
+        if (nvs_erase_key(kv_h, "BLEAPPEAR") == ESP_OK) nvs_commit(kv_h);
+        nvs_close(kv_h);
+    }
+}
+
+esp_err_t config_store_load(config_data_t *cfg)
+{
+    config_blob_t blob;
+    size_t len = sizeof(blob);
+    esp_err_t ret;
+
+    config_store_defaults(cfg);
+    if ((ret = config_store_open()) != ESP_OK) return ret;
+
+    //a blob of a newer firmware (after a downgrade) is larger: ESP_ERR_NVS_INVALID_LENGTH, defaults are used
+    ret = nvs_get_blob(config_h, CONFIG_STORE_KEY, &blob, &len);
+    if (ret == ESP_OK && (len < offsetof(config_blob_t, data) || blob.length > sizeof(config_data_t) ||
+                          len != offsetof(config_blob_t, data) + blob.length)) {
+        ret = ESP_ERR_INVALID_SIZE;
+    }
+    if (ret == ESP_OK && blob.crc != config_store_crc(&blob.data, blob.length)) {
+        ret = ESP_ERR_INVALID_CRC;
+    }
+
+    if (ret == ESP_OK) {
+        //older versions are a prefix of config_data_t, the remaining fields keep their defaults
+        memcpy(cfg, &blob.data, blob.length);
+        config_store_sanitize(cfg);
+        if (blob.version == CONFIG_STORE_VERSION && blob.length == sizeof(config_data_t)) {
+            stored_crc = blob.crc;
+            stored_valid = 1;
+            return ESP_OK;
+        }
+        ESP_LOGI(CONFIG_STORE_TAG, "upgrading config from version %u", blob.version);
+        config_store_save(cfg);
+        return ESP_OK;
+    }
+
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        if (config_store_migrate(cfg) == ESP_OK) {
+            ESP_LOGI(CONFIG_STORE_TAG, "migrated legacy config keys");
+            config_store_sanitize(cfg);
+            //the legacy keys are kept until the blob is stored, migrated again on the next boot otherwise
+            if (config_store_save(cfg) == ESP_OK) config_store_migrate_erase();
+            return ESP_OK;
+        }
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    ESP_LOGE(CONFIG_STORE_TAG, "stored config invalid (%s), using defaults", esp_err_to_name(ret));
+    config_store_defaults(cfg);
+    return ret == ESP_ERR_INVALID_CRC ? ret : ESP_ERR_INVALID_SIZE;
+}
+
+esp_err_t config_store_save(const config_data_t *cfg)
+{
+    config_blob_t blob;
+    esp_err_t ret;
+
+    //zero padding & unused name bytes, the CRC covers the whole struct
+    memset(&blob, 0, sizeof(blob));
+    memcpy(&blob.data, cfg, sizeof(config_data_t));
+    blob.data.bt_device_name[MAX_BT_DEVICENAME_LENGTH - 1] = '\0';
+    memset(&blob.data.bt_device_name[strlen(blob.data.bt_device_name)], 0,
+           MAX_BT_DEVICENAME_LENGTH - strlen(blob.data.bt_device_name));
+    blob.version = CONFIG_STORE_VERSION;
+    blob.length = sizeof(config_data_t);
+    blob.crc = config_store_crc(&blob.data, blob.length);
+    if (stored_valid && blob.crc == stored_crc) return ESP_OK;
+
+    if ((ret = config_store_open()) != ESP_OK) return ret;
+    ret = nvs_set_blob(config_h, CONFIG_STORE_KEY, &blob, offsetof(config_blob_t, data) + blob.length);
+    if (ret == ESP_OK) ret = nvs_commit(config_h);
+    if (ret == ESP_OK) {
+        stored_crc = blob.crc;
+        stored_valid = 1;
+    } else ESP_LOGE(CONFIG_STORE_TAG, "error saving config: %s", esp_err_to_name(ret));
+    return ret;
+}
@@ -0,0 +1,51 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ */
+
+#ifndef _CONFIG_STORE_H_
+#define _CONFIG_STORE_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include "config.h"
+
+/** @brief Version of the stored config_data_t layout, increase when appending fields */
+#define CONFIG_STORE_VERSION 1
+
+/** @brief Load the configuration (one NVS read)
+ *
+ * Reads the versioned, CRC protected blob from the "config_c" namespace.
+ * Older blob versions are extended with defaults. If there is no blob, the legacy
+ * keys (btname, locale, joyactive & BLEAPPEAR from "kvstorage") are migrated into
+ * a new blob and erased once the blob is stored. Invalid or missing values are set to the defaults.
+ * @param cfg Configuration to fill, always valid afterwards
+ * @return ESP_OK if loaded or migrated, ESP_ERR_NOT_FOUND if defaults are used,
+ *         ESP_ERR_INVALID_CRC if the blob was corrupted (defaults are used), other NVS errors */
+esp_err_t config_store_load(config_data_t *cfg);
+
+/** @brief Store the configuration (one NVS write & commit)
+ * @note Skipped if the configuration did not change since the last load/save
+ * @return ESP_OK or the NVS error */
+esp_err_t config_store_save(const config_data_t *cfg);
+
+/** @brief Set the configuration to the defaults (not stored) */
+void config_store_defaults(config_data_t *cfg);
+
+#endif
@@ -15,25 +15,20 @@
 #include "esp_hidd_prf_api.h"
 #include "hidd_le_prf_int.h"
 #include "hid_dev.h"
+#include "hid_trace.h"
+#include "hid_prof.h"
 #include <stdlib.h>
 #include <string.h>
 #include "esp_log.h"
+#include "esp_timer.h"
 
-// HID keyboard input report length
-///@note Set to 7, because padding byte is removed
-#define HID_KEYBOARD_IN_RPT_LEN     7
+// Release delay for consumer taps, if the connection interval is not known (7.5ms)
+#define HID_CC_TAP_DEFAULT_INTERVAL 6
 
-// HID LED output report length
-//#define HID_LED_OUT_RPT_LEN         1
-
-// HID mouse input report length
-#define HID_MOUSE_IN_RPT_LEN        5
-
-// HID joystick input report length
-#define HID_JOYSTICK_IN_RPT_LEN     11
-
-// HID consumer control input report length
-#define HID_CC_IN_RPT_LEN           2
+// one-shot timers for releasing consumer taps, one per connection slot
+static esp_timer_handle_t cc_tap_timer[HIDD_LE_MAX_CONN];
+// conn_id of the pending tap, the slot may be used by another connection when the timer fires
+static uint16_t cc_tap_conn_id[HIDD_LE_MAX_CONN];
 
 esp_err_t esp_hidd_register_callbacks(esp_hidd_event_cb_t callbacks, uint8_t enablegamepad)
 {
@@ -109,19 +104,93 @@ uint16_t esp_hidd_get_version(void)
 
 void esp_hidd_send_consumer_value(uint16_t conn_id, uint8_t key_cmd, bool key_pressed)
 {
-    uint8_t buffer[HID_CC_IN_RPT_LEN] = {0, 0};
+    HID_PROF_SCOPE(HID_PROF_BUILD_CONSUMER);
+    uint8_t buffer[HID_CC_IN_RPT_LEN] = {0};
     if (key_pressed) {
         ESP_LOGD(HID_LE_PRF_TAG, "hid_consumer_build_report");
         hid_consumer_build_report(buffer, key_cmd);
     }
-    ESP_LOGD(HID_LE_PRF_TAG, "buffer[0] = %x, buffer[1] = %x", buffer[0], buffer[1]);
+    ESP_LOGD(HID_LE_PRF_TAG, "buffer[0] = %x", buffer[0]);
     hid_dev_send_report(hidd_le_env.gatt_if, conn_id,
                         HID_RPT_ID_CC_IN, HID_REPORT_TYPE_INPUT, HID_CC_IN_RPT_LEN, buffer);
     return;
 }
 
+void esp_hidd_send_consumer_usage(uint16_t conn_id, uint16_t usage)
+{
+    HID_PROF_SCOPE(HID_PROF_BUILD_CONSUMER);
+    uint8_t buffer[HID_CC_EXT_IN_RPT_LEN];
+
+    //outside of the logical range of the report map, hosts drop or misread it
+    if (usage > HID_CONSUMER_USAGE_MAX) {
+        ESP_LOGW(HID_LE_PRF_TAG, "%s(), usage 0x%X out of range", __func__, usage);
+        return;
+    }
+    buffer[0] = usage & 0xFF;
+    buffer[1] = (usage >> 8) & 0xFF;
+    hid_dev_send_report(hidd_le_env.gatt_if, conn_id,
+                        HID_RPT_ID_CC_EXT_IN, HID_REPORT_TYPE_INPUT, HID_CC_EXT_IN_RPT_LEN, buffer);
+    return;
+}
+
+static void esp_hidd_consumer_tap_release(void *arg)
+{
+    hidd_clcb_t *p_clcb = &hidd_le_env.hidd_clcb[(uintptr_t)arg];
+
+    HID_TRACE(HID_TRACE_TASK_WAKE, HID_TRACE_TASK_TIMER, 0);
+    if (p_clcb->in_use && p_clcb->conn_id == cc_tap_conn_id[(uintptr_t)arg]) {
+        esp_hidd_send_consumer_usage(p_clcb->conn_id, 0);
+    }
+}
+
+void hidd_consumer_tap_cancel(uint8_t slot)
+{
+    if (slot < HIDD_LE_MAX_CONN && cc_tap_timer[slot] != NULL) esp_timer_stop(cc_tap_timer[slot]);
+}
+
+void esp_hidd_send_consumer_tap(uint16_t conn_id, uint16_t usage)
+{
+    hidd_clcb_t *p_clcb = hidd_clcb_find(conn_id);
+    uintptr_t slot;
+    uint16_t interval;
+
+    if (p_clcb == NULL) {
+        ESP_LOGW(HID_LE_PRF_TAG, "%s(), unknown conn_id %d", __func__, conn_id);
+        return;
+    }
+    if (usage > HID_CONSUMER_USAGE_MAX) {
+        ESP_LOGW(HID_LE_PRF_TAG, "%s(), usage 0x%X out of range", __func__, usage);
+        return;
+    }
+    slot = p_clcb - hidd_le_env.hidd_clcb;
+
+    if (cc_tap_timer[slot] == NULL) {
+        const esp_timer_create_args_t tap_timer_args = {
+            .callback = &esp_hidd_consumer_tap_release,
+            .arg = (void *)slot,
+            .name = "CCtap"
+        };
+        if (esp_timer_create(&tap_timer_args, &cc_tap_timer[slot]) != ESP_OK) {
+            ESP_LOGE(HID_LE_PRF_TAG, "%s(), cannot create tap timer", __func__);
+            return;
+        }
+    } else {
+        //a pending release is replaced: the new usage in the array releases the old one
+        esp_timer_stop(cc_tap_timer[slot]);
+    }
+
+    esp_hidd_send_consumer_usage(conn_id, usage);
+    cc_tap_conn_id[slot] = conn_id;
+
+    //release one connection interval later (1.25ms units), so press & release are
+    //delivered in two consecutive connection events.
+    interval = p_clcb->conn_interval ? p_clcb->conn_interval : HID_CC_TAP_DEFAULT_INTERVAL;
+    esp_timer_start_once(cc_tap_timer[slot], (uint64_t)interval * 1250);
+}
+
 void esp_hidd_send_keyboard_value(uint16_t conn_id, key_mask_t special_key_mask, uint8_t *keyboard_cmd, uint8_t num_key)
 {
+    HID_PROF_SCOPE(HID_PROF_BUILD_KEYBOARD);
     //if (num_key > HID_KEYBOARD_IN_RPT_LEN - 2) {
     ///@note Here without padding byte as well.
     if (num_key > HID_KEYBOARD_IN_RPT_LEN - 1) {
@@ -146,18 +215,71 @@ void esp_hidd_send_keyboard_value(uint16_t conn_id, key_mask_t special_key_mask,
     return;
 }
 
+static inline int8_t clamp_int8(int32_t value)
+{
+    if (value > INT8_MAX) return INT8_MAX;
+    if (value < -INT8_MAX) return -INT8_MAX;
+    return value;
+}
+
+/** @brief Maximum number of reports for one scroll value, a larger amount is sent with the next report */
+#define MOUSE_SCROLL_REPORTS_MAX    8
+
+/** @brief Convert a scroll value (1/HID_MOUSE_WHEEL_MULTIPLIER detents) to the resolution used by the host
+ * @param value Scroll value
+ * @param hires 1 if the host enabled the resolution multiplier for this axis
+ * @param rem Amount which was not sent yet: fractions of a detent (low resolution)
+ * and what exceeds one report */
+static int8_t mouse_scroll_value(int16_t value, uint8_t hires, int16_t *rem)
+{
+    int32_t unit = hires ? 1 : HID_MOUSE_WHEEL_MULTIPLIER;
+    if (rem == NULL) return clamp_int8(value / unit);
+    int32_t sum = *rem + value;
+    int8_t out = clamp_int8(sum / unit);
+    sum -= out * unit;
+    *rem = sum > INT16_MAX ? INT16_MAX : (sum < INT16_MIN ? INT16_MIN : sum);
+    return out;
+}
+
+/** @brief 1 if the remainder of mouse_scroll_value is at least one report unit */
+static uint8_t mouse_scroll_pending(int16_t rem, uint8_t hires)
+{
+    int32_t unit = hires ? 1 : HID_MOUSE_WHEEL_MULTIPLIER;
+    return rem >= unit || rem <= -unit;
+}
+
 void esp_hidd_send_mouse_value(uint16_t conn_id, uint8_t mouse_button, int8_t mickeys_x, int8_t mickeys_y, int8_t wheel)
 {
+    //full detents: scale up if the host uses the high-resolution wheel
+    //(more than 127 units are split, see esp_hidd_send_mouse_hires_value)
+    esp_hidd_send_mouse_hires_value(conn_id, mouse_button, mickeys_x, mickeys_y,
+                                    wheel * HID_MOUSE_WHEEL_MULTIPLIER, 0);
+}
+
+void esp_hidd_send_mouse_hires_value(uint16_t conn_id, uint8_t mouse_button, int8_t mickeys_x, int8_t mickeys_y, int16_t wheel, int16_t pan)
+{
+    HID_PROF_SCOPE(HID_PROF_BUILD_MOUSE);
     uint8_t buffer[HID_MOUSE_IN_RPT_LEN];
-    
+    hidd_clcb_t *p_clcb = hidd_clcb_find(conn_id);
+    uint8_t res_multiplier = p_clcb ? p_clcb->res_multiplier : 0;
+
     buffer[0] = mouse_button;   // Buttons
     buffer[1] = mickeys_x;           // X
     buffer[2] = mickeys_y;           // Y
-    buffer[3] = wheel;           // Wheel
-    buffer[4] = 0;           // AC Pan
+    for (uint8_t i = 0; i < MOUSE_SCROLL_REPORTS_MAX; i++) {
+        buffer[3] = mouse_scroll_value(wheel, res_multiplier & HIDD_LE_RES_MULT_WHEEL,
+                                       p_clcb ? &p_clcb->wheel_rem : NULL);           // Wheel
+        buffer[4] = mouse_scroll_value(pan, res_multiplier & HIDD_LE_RES_MULT_PAN,
+                                       p_clcb ? &p_clcb->pan_rem : NULL);           // AC Pan
 
-    hid_dev_send_report(hidd_le_env.gatt_if, conn_id,
-                        HID_RPT_ID_MOUSE_IN, HID_REPORT_TYPE_INPUT, HID_MOUSE_IN_RPT_LEN, buffer);
+        hid_dev_send_report(hidd_le_env.gatt_if, conn_id,
+                            HID_RPT_ID_MOUSE_IN, HID_REPORT_TYPE_INPUT, HID_MOUSE_IN_RPT_LEN, buffer);
+        //more than one report can hold: send the rest without movement
+        if (p_clcb == NULL || (!mouse_scroll_pending(p_clcb->wheel_rem, res_multiplier & HIDD_LE_RES_MULT_WHEEL) &&
+                               !mouse_scroll_pending(p_clcb->pan_rem, res_multiplier & HIDD_LE_RES_MULT_PAN))) break;
+        buffer[1] = buffer[2] = 0;
+        wheel = pan = 0;
+    }
     return;
 }
 
@@ -204,8 +326,67 @@ void esp_hidd_send_joy_value(uint16_t conn_id, int8_t x, int8_t y, int8_t z, int
  */
 void esp_hidd_send_joy_report(uint16_t conn_id, uint8_t *report)
 {
+  HID_PROF_SCOPE(HID_PROF_BUILD_JOYSTICK);
+#if CONFIG_MODULE_JOYSTICK_HIRES
+  //scale 8bit axes to 16bit (-127..127 -> -32766..32766), triggers stay released
+  uint8_t data[HID_JOYSTICK_HIRES_IN_RPT_LEN] = {0};
+  for(uint8_t i = 0; i < 6; i++) {
+    //-128 would overflow int16_t, it is clamped to the logical minimum
+    int8_t value = (int8_t)report[i] < -127 ? -127 : (int8_t)report[i];
+    int16_t axis = value * 258;
+    data[i*2] = axis & 0xFF;
+    data[i*2+1] = (axis >> 8) & 0xFF;
+  }
+  //hat & buttons
+  memcpy(&data[16], &report[6], 5);
+  hid_dev_send_report(hidd_le_env.gatt_if, conn_id,
+    HID_RPT_ID_JOY_IN, HID_REPORT_TYPE_INPUT, HID_JOYSTICK_HIRES_IN_RPT_LEN, data);
+#else
   hid_dev_send_report(hidd_le_env.gatt_if, conn_id,
     HID_RPT_ID_JOY_IN, HID_REPORT_TYPE_INPUT, HID_JOYSTICK_IN_RPT_LEN, report);
+#endif
+}
+
+void esp_hidd_send_joy_hires_value(uint16_t conn_id, int16_t x, int16_t y, int16_t z, int16_t rz, int16_t rx, int16_t ry,
+                                   uint16_t lt, uint16_t rt, uint8_t hat, uint32_t buttons)
+{
+  int16_t axes[8] = {x, y, z, rz, rx, ry, (int16_t)lt, (int16_t)rt};
+  uint8_t data[HID_JOYSTICK_HIRES_IN_RPT_LEN];
+
+  //axis & triggers, little endian
+  for(uint8_t i = 0; i < 8; i++) {
+    data[i*2] = axes[i] & 0xFF;
+    data[i*2+1] = (axes[i] >> 8) & 0xFF;
+  }
+
+  //add hat & buttons
+  data[16] = hat;
+  data[17] = (uint8_t)(buttons & 0xFF);
+  data[18] = (uint8_t)((buttons>>8) & 0xFF);
+  data[19] = (uint8_t)((buttons>>16) & 0xFF);
+  data[20] = (uint8_t)((buttons>>24) & 0xFF);
+
+  esp_hidd_send_joy_hires_report(conn_id, data);
+}
+
+void esp_hidd_send_joy_hires_report(uint16_t conn_id, uint8_t *report)
+{
+  HID_PROF_SCOPE(HID_PROF_BUILD_JOYSTICK);
+#if CONFIG_MODULE_JOYSTICK_HIRES
+  hid_dev_send_report(hidd_le_env.gatt_if, conn_id,
+    HID_RPT_ID_JOY_IN, HID_REPORT_TYPE_INPUT, HID_JOYSTICK_HIRES_IN_RPT_LEN, report);
+#else
+  //scale 16bit axes down to 8bit (-32767..32767 -> -127..127), triggers are not available
+  uint8_t data[HID_JOYSTICK_IN_RPT_LEN];
+  for(uint8_t i = 0; i < 6; i++) {
+    int16_t axis = report[i*2] | (report[i*2+1] << 8);
+    data[i] = (int8_t)(axis / 258);
+  }
+  //hat & buttons
+  memcpy(&data[6], &report[16], 5);
+  hid_dev_send_report(hidd_le_env.gatt_if, conn_id,
+    HID_RPT_ID_JOY_IN, HID_REPORT_TYPE_INPUT, HID_JOYSTICK_IN_RPT_LEN, data);
+#endif
 }
 
 #endif
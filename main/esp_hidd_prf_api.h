@@ -61,6 +61,28 @@ typedef enum {
 #define RIGHT_GUI_KEY_MASK           (1 << 7)
 
 typedef uint8_t key_mask_t;
+
+/// HID keyboard input report length
+///@note Set to 7, because padding byte is removed
+#define HID_KEYBOARD_IN_RPT_LEN         7
+
+/// HID mouse input report length (buttons, X, Y, wheel, pan)
+#define HID_MOUSE_IN_RPT_LEN            5
+
+/// HID consumer control input report length (channel, volume & one button, see HID_CC_RPT_SET_*)
+#define HID_CC_IN_RPT_LEN               1
+
+/// HID extended consumer control input report length (one 16bit usage)
+#define HID_CC_EXT_IN_RPT_LEN           2
+
+/// Wheel/pan steps per detent, if the host enabled the resolution multiplier (physical max. in the report map)
+#define HID_MOUSE_WHEEL_MULTIPLIER      8
+
+/// HID joystick input report length (6 axes, hat, 32 buttons), used by the 8bit UART joystick frame
+#define HID_JOYSTICK_IN_RPT_LEN         11
+
+/// HID high-resolution joystick input report length (6 16bit axes, 2 16bit triggers, hat, 32 buttons)
+#define HID_JOYSTICK_HIRES_IN_RPT_LEN   21
 /**
  * @brief HIDD callback parameters union 
  */
@@ -175,6 +197,29 @@ uint16_t esp_hidd_get_version(void);
  */
 void esp_hidd_send_consumer_value(uint16_t conn_id, uint8_t key_cmd, bool key_pressed);
 
+/**
+ *
+ * @brief           Send an extended consumer control report (16bit usage code).
+ *
+ * @param           conn_id HID over GATT connection ID to be used.
+ * @param           usage Consumer usage code (e.g. HID_CONSUMER_AC_HOME), 0 releases the key.
+ *                  Codes above HID_CONSUMER_USAGE_MAX are not sent.
+ *
+ */
+void esp_hidd_send_consumer_usage(uint16_t conn_id, uint16_t usage);
+
+/**
+ *
+ * @brief           Tap a consumer key: press now, release on the next connection event.
+ *
+ * @param           conn_id HID over GATT connection ID to be used.
+ * @param           usage Consumer usage code (e.g. HID_CONSUMER_MUTE), up to HID_CONSUMER_USAGE_MAX
+ * @note            The release is sent from a timer, one connection interval after the press.
+ *                  A new tap before the release replaces the pending one.
+ *
+ */
+void esp_hidd_send_consumer_tap(uint16_t conn_id, uint16_t usage);
+
 /**
  *
  * @brief           Send a keyboard report.
@@ -199,6 +244,22 @@ void esp_hidd_send_keyboard_value(uint16_t conn_id, key_mask_t special_key_mask,
  */
 void esp_hidd_send_mouse_value(uint16_t conn_id, uint8_t mouse_button, int8_t mickeys_x, int8_t mickeys_y, int8_t wheel);
 
+/**
+ *
+ * @brief           Send a Mouse report with high-resolution wheel & horizontal pan.
+ *
+ * @param           conn_id HID over GATT connection ID to be used.
+ * @param           mouse_button  Mouse button values, 1 is pressed, 0 is released. bit 0: left, bit 1: right, bit 2: middle button
+ * @param           mickeys_x  relative X axis movement
+ * @param           mickeys_y  relative Y axis movement
+ * @param           wheel  relative wheel movement, in 1/HID_MOUSE_WHEEL_MULTIPLIER detents
+ * @param           pan  relative horizontal scroll (AC Pan), in 1/HID_MOUSE_WHEEL_MULTIPLIER detents
+ * @note            If the host did not enable the resolution multiplier, the fractions
+ *                  are accumulated and sent as full detents. Scrolling more than one
+ *                  report can hold (127) is split into up to 8 reports.
+ */
+void esp_hidd_send_mouse_hires_value(uint16_t conn_id, uint8_t mouse_button, int8_t mickeys_x, int8_t mickeys_y, int16_t wheel, int16_t pan);
+
 
 #if CONFIG_MODULE_USEJOYSTICK
 /**
@@ -222,6 +283,30 @@ void esp_hidd_send_joy_value(uint16_t conn_id, int8_t x, int8_t y, int8_t z, int
  */
 void esp_hidd_send_joy_report(uint16_t conn_id, uint8_t *report);
 
+/**
+ *
+ * @brief           Send a high-resolution Joystick report, set individual axis
+ *
+ * @param           conn_id HID over GATT connection ID to be used.
+ * @param           x,y,z,rz,rx,ry  Individual gamepad axis (-32767 to 32767)
+ * @param           lt,rt Left & right analog trigger (0 to 32767)
+ * @param           hat Hat switch status. Send 0 for rest/middleposition; 1-8 to for a direction.
+ * @param           buttons Button bitmap, button 0 is bit 0 and so on.
+ * @note            If built without CONFIG_MODULE_JOYSTICK_HIRES, axes are scaled to 8bit and triggers are dropped.
+ */
+void esp_hidd_send_joy_hires_value(uint16_t conn_id, int16_t x, int16_t y, int16_t z, int16_t rz, int16_t rx, int16_t ry,
+                                   uint16_t lt, uint16_t rt, uint8_t hat, uint32_t buttons);
+
+/**
+ *
+ * @brief           Send a high-resolution Joystick report, use a byte array
+ *
+ * @param           conn_id HID over GATT connection ID to be used.
+ * @param           report  Pointer to a 21 Byte sized array (6 axes & 2 triggers little endian, hat, buttons)
+ * @note            If built without CONFIG_MODULE_JOYSTICK_HIRES, axes are scaled to 8bit and triggers are dropped.
+ */
+void esp_hidd_send_joy_hires_report(uint16_t conn_id, uint8_t *report);
+
 #endif
 
 #ifdef __cplusplus
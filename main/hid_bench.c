@@ -0,0 +1,187 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ *
+ * Synthetic report load ($BENCH) for comparing hosts, connection
+ * parameters and firmware versions.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "task_config.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "driver/uart.h"
+#include "esp_hidd_prf_api.h"
+#include "hid_stats.h"
+#include "hid_bench.h"
+
+#define HID_BENCH_TAG "HID_BENCH"
+
+static struct {
+    hid_bench_cfg_t cfg;
+    int uart_num;
+    TaskHandle_t task;
+    esp_timer_handle_t timer;
+    volatile uint8_t running;
+    /** bench_task exists (set by hid_bench_start, cleared by the task as the last access to bench) */
+    volatile uint8_t task_alive;
+    /** time of the last timer tick, latency is measured from here */
+    volatile int64_t tick_time;
+    uint32_t ticks;
+    uint32_t skipped;
+    hid_stats_latency_t latency;
+    hid_stats_conn_t start[CONFIG_BT_ACL_CONNECTIONS];
+} bench;
+
+static void bench_timer_cb(void *arg)
+{
+    bench.tick_time = esp_timer_get_time();
+    xTaskNotifyGive(bench.task);
+}
+
+/** send one empty report of the given type */
+static void bench_send(uint16_t conn_id, uint8_t type)
+{
+    uint8_t keys[6] = {0};
+
+    switch (type) {
+        case HID_BENCH_KEYBOARD: esp_hidd_send_keyboard_value(conn_id, 0, keys, 6); break;
+        case HID_BENCH_MOUSE: esp_hidd_send_mouse_value(conn_id, 0, 0, 0, 0); break;
+        case HID_BENCH_CONSUMER: esp_hidd_send_consumer_usage(conn_id, 0); break;
+        #if CONFIG_MODULE_USEJOYSTICK
+        case HID_BENCH_JOYSTICK: {
+            uint8_t joy[HID_JOYSTICK_IN_RPT_LEN] = {0};
+            esp_hidd_send_joy_report(conn_id, joy);
+            break;
+        }
+        #endif
+        default: break;
+    }
+}
+
+static void bench_print(int64_t duration_us)
+{
+    char line[96];
+    int len;
+    hid_stats_conn_t now;
+
+    for (uint8_t i = 0; i < bench.cfg.conn_cnt; i++) {
+        if (hid_stats_get_conn(bench.cfg.conn_id[i], &now) != ESP_OK) {
+            len = snprintf(line, sizeof(line), "BENCH:%u,disconnected\r\n", bench.cfg.conn_id[i]);
+        } else {
+            uint32_t accepted = (now.submitted - bench.start[i].submitted) - (now.rejected - bench.start[i].rejected);
+            //conn_id, accepted, rejected, notifications/s, congestions, congested ms
+            len = snprintf(line, sizeof(line), "BENCH:%u,%lu,%lu,%lu,%lu,%lu\r\n", bench.cfg.conn_id[i],
+                           (unsigned long)accepted, (unsigned long)(now.rejected - bench.start[i].rejected),
+                           (unsigned long)(duration_us ? (uint64_t)accepted * 1000000 / duration_us : 0),
+                           (unsigned long)(now.congest_cnt - bench.start[i].congest_cnt),
+                           (unsigned long)((now.congest_us - bench.start[i].congest_us) / 1000));
+        }
+        ESP_LOGI(HID_BENCH_TAG, "%.*s", len - 2, line);
+        uart_write_bytes(bench.uart_num, line, len);
+    }
+    //ticks, skipped ticks, latency percentiles & max (us)
+    len = snprintf(line, sizeof(line), "BENCH:lat,%lu,%lu,%lu,%lu,%lu,%lu\r\n",
+                   (unsigned long)bench.ticks, (unsigned long)bench.skipped,
+                   (unsigned long)hid_stats_latency_percentile(&bench.latency, 50),
+                   (unsigned long)hid_stats_latency_percentile(&bench.latency, 90),
+                   (unsigned long)hid_stats_latency_percentile(&bench.latency, 99),
+                   (unsigned long)bench.latency.max_us);
+    ESP_LOGI(HID_BENCH_TAG, "%.*s", len - 2, line);
+    uart_write_bytes(bench.uart_num, line, len);
+    uart_write_bytes(bench.uart_num, "END\r\n", 5);
+}
+
+static void bench_task(void *arg)
+{
+    int64_t start = esp_timer_get_time();
+    int64_t end = start + (int64_t)bench.cfg.duration_ms * 1000;
+    uint8_t type = 1;
+
+    bench.task = xTaskGetCurrentTaskHandle();
+    esp_timer_start_periodic(bench.timer, 1000000 / bench.cfg.rate);
+    while (bench.running && esp_timer_get_time() < end) {
+        uint32_t pending = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+        if (pending == 0) continue;
+        int64_t tick = bench.tick_time;
+        //more than one tick pending: we are too slow for this rate
+        bench.skipped += pending - 1;
+        bench.ticks++;
+
+        //next report type of the mix
+        do {
+            type = (type << 1) & 0x0F;
+            if (type == 0) type = 1;
+        } while (!(bench.cfg.mix & type));
+
+        for (uint8_t i = 0; i < bench.cfg.conn_cnt; i++) bench_send(bench.cfg.conn_id[i], type);
+        hid_stats_latency_add(&bench.latency, esp_timer_get_time() - tick);
+    }
+    esp_timer_stop(bench.timer);
+    bench_print(esp_timer_get_time() - start);
+
+    esp_timer_delete(bench.timer);
+    bench.running = 0;
+    bench.task = NULL;
+    bench.task_alive = 0;
+    vTaskDelete(NULL);
+}
+
+esp_err_t hid_bench_start(const hid_bench_cfg_t *cfg, int uart_num)
+{
+    const esp_timer_create_args_t timer_args = {
+        .callback = &bench_timer_cb,
+        .name = "bench"
+    };
+
+    if (bench.running) return ESP_ERR_INVALID_STATE;
+    if (cfg->rate == 0 || cfg->rate > HID_BENCH_MAX_RATE || cfg->duration_ms == 0 ||
+        (cfg->mix & 0x0F) == 0 || cfg->conn_cnt == 0 || cfg->conn_cnt > CONFIG_BT_ACL_CONNECTIONS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    //stopped but still printing: wait for the task (it wakes up at least every 100ms),
+    //it still uses the timer & the task handle
+    for (uint8_t i = 0; bench.task_alive && i < 50; i++) vTaskDelay(pdMS_TO_TICKS(10));
+    if (bench.task_alive) return ESP_ERR_INVALID_STATE;
+
+    memset(&bench, 0, sizeof(bench));
+    bench.cfg = *cfg;
+    bench.uart_num = uart_num;
+    for (uint8_t i = 0; i < cfg->conn_cnt; i++) hid_stats_get_conn(cfg->conn_id[i], &bench.start[i]);
+    if (esp_timer_create(&timer_args, &bench.timer) != ESP_OK) return ESP_ERR_NO_MEM;
+    bench.running = 1;
+    bench.task_alive = 1;
+    //below the UART task, so commands (e.g. stopping) are still processed
+    if (xTaskCreatePinnedToCore(&bench_task, "bench", TASK_STACK_BENCH, NULL, TASK_PRIO_BENCH, &bench.task, TASK_CORE_INPUT) != pdPASS) {
+        esp_timer_delete(bench.timer);
+        bench.running = 0;
+        bench.task_alive = 0;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(HID_BENCH_TAG, "started: %u reports/s, %lums, mix 0x%X, %u host(s)", cfg->rate,
+             (unsigned long)cfg->duration_ms, cfg->mix, cfg->conn_cnt);
+    return ESP_OK;
+}
+
+void hid_bench_stop(void)
+{
+    bench.running = 0;
+}
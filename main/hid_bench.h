@@ -0,0 +1,58 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ */
+
+#ifndef _HID_BENCH_H_
+#define _HID_BENCH_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+/// Report types for the benchmark mix
+#define HID_BENCH_KEYBOARD  (1<<0)
+#define HID_BENCH_MOUSE     (1<<1)
+#define HID_BENCH_CONSUMER  (1<<2)
+#define HID_BENCH_JOYSTICK  (1<<3)
+
+/// Maximum report rate of the benchmark
+#define HID_BENCH_MAX_RATE  1000
+
+/** @brief Benchmark configuration */
+typedef struct {
+    uint16_t rate;          /// reports per second (per host), 1 - HID_BENCH_MAX_RATE
+    uint32_t duration_ms;   /// duration of the benchmark
+    uint8_t mix;            /// HID_BENCH_* bitmask, the selected report types are sent in turn
+    uint8_t conn_cnt;       /// number of valid entries in conn_id
+    uint16_t conn_id[CONFIG_BT_ACL_CONNECTIONS];  /// hosts receiving the reports
+} hid_bench_cfg_t;
+
+/** @brief Start a benchmark
+ *
+ * Empty reports (no keys, no movement, released consumer usage, centered joystick)
+ * are sent at the given rate, so the host is not disturbed. The result is written
+ * to the given UART when the benchmark is finished.
+ * A stopped benchmark which is still finishing is waited for (up to 500ms).
+ * @return ESP_ERR_INVALID_STATE if a benchmark is running, ESP_ERR_INVALID_ARG for invalid parameters */
+esp_err_t hid_bench_start(const hid_bench_cfg_t *cfg, int uart_num);
+
+/** @brief Stop a running benchmark, the result is printed as usual */
+void hid_bench_stop(void);
+
+#endif
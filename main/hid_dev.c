@@ -13,6 +13,9 @@
 // limitations under the License.
 
 #include "hid_dev.h"
+#include "hid_stats.h"
+#include "hid_trace.h"
+#include "hid_prof.h"
 #include <stdint.h>
 #include <string.h>
 #include <stdbool.h>
@@ -22,12 +25,12 @@
 static hid_report_map_t *hid_dev_rpt_tbl;
 static uint8_t hid_dev_rpt_tbl_Len;
 
-static hid_report_map_t *hid_dev_rpt_by_id(uint8_t id, uint8_t type)
+static hid_report_map_t *hid_dev_rpt_by_id(uint8_t id, uint8_t type, uint8_t mode)
 {
     hid_report_map_t *rpt = hid_dev_rpt_tbl;
 
     for (uint8_t i = hid_dev_rpt_tbl_Len; i > 0; i--, rpt++) {
-        if (rpt->id == id && rpt->type == type && rpt->mode == hidProtocolMode) {
+        if (rpt->id == id && rpt->type == type && rpt->mode == mode) {
             return rpt;
         }
     }
@@ -35,6 +38,32 @@ static hid_report_map_t *hid_dev_rpt_by_id(uint8_t id, uint8_t type)
     return NULL;
 }
 
+/* Translate a report protocol input report into its boot protocol format.
+ * Returns the length of the boot report or 0 if this report has no boot representation
+ * (consumer control, joystick,...) and must not be sent to a boot mode host. */
+static uint8_t hid_dev_boot_translate(uint8_t id, uint8_t length, const uint8_t *data, uint8_t *boot)
+{
+    switch (id) {
+        case HID_RPT_ID_KEY_IN:
+            // report mode: modifier, 6 keycodes (no reserved byte)
+            // boot mode: modifier, reserved, 6 keycodes
+            if (length < 1) return 0;
+            memset(boot, 0, HIDD_LE_BOOT_KB_IN_RPT_LEN);
+            boot[0] = data[0];
+            memcpy(&boot[2], &data[1], (length - 1) > 6 ? 6 : (length - 1));
+            return HIDD_LE_BOOT_KB_IN_RPT_LEN;
+
+        case HID_RPT_ID_MOUSE_IN:
+            // report mode: buttons, X, Y, wheel,...; boot mode: buttons, X, Y
+            if (length < HIDD_LE_BOOT_MOUSE_IN_RPT_LEN) return 0;
+            memcpy(boot, data, HIDD_LE_BOOT_MOUSE_IN_RPT_LEN);
+            return HIDD_LE_BOOT_MOUSE_IN_RPT_LEN;
+
+        default:
+            return 0;
+    }
+}
+
 void hid_dev_register_reports(uint8_t num_reports, hid_report_map_t *p_report)
 {
     hid_dev_rpt_tbl = p_report;
@@ -45,13 +74,31 @@ void hid_dev_register_reports(uint8_t num_reports, hid_report_map_t *p_report)
 void hid_dev_send_report(esp_gatt_if_t gatts_if, uint16_t conn_id,
                                     uint8_t id, uint8_t type, uint8_t length, uint8_t *data)
 {
+    HID_PROF_SCOPE(HID_PROF_SEND_REPORT);
     hid_report_map_t *p_rpt;
+    uint8_t mode = HID_PROTOCOL_MODE_REPORT;
+    uint8_t boot[HIDD_LE_BOOT_REPORT_MAX_LEN];
+
+    // fast path: no lookup necessary as long as every host uses report protocol
+    if (hidd_le_env.boot_mode_cnt != 0) {
+        mode = hidd_get_proto_mode(conn_id);
+    }
+
+    if (mode == HID_PROTOCOL_MODE_BOOT) {
+        if (type != HID_REPORT_TYPE_INPUT || (length = hid_dev_boot_translate(id, length, data, boot)) == 0) {
+            ESP_LOGD(HID_LE_PRF_TAG, "%s(), report %d not available in boot mode", __func__, id);
+            return;
+        }
+        data = boot;
+    }
 
     // get att handle for report
-    if ((p_rpt = hid_dev_rpt_by_id(id, type)) != NULL) {
+    if ((p_rpt = hid_dev_rpt_by_id(id, type, mode)) != NULL) {
         // if notifications are enabled
         ESP_LOGD(HID_LE_PRF_TAG, "%s(), send the report, handle = %d", __func__, p_rpt->handle);
-        esp_ble_gatts_send_indicate(gatts_if, conn_id, p_rpt->handle, length, data, false);
+        esp_err_t ret = esp_ble_gatts_send_indicate(gatts_if, conn_id, p_rpt->handle, length, data, false);
+        hid_stats_report_sent(conn_id, id, ret);
+        HID_TRACE(HID_TRACE_REPORT, id, conn_id | (ret != ESP_OK ? 0x8000 : 0));
     }
     
     return;
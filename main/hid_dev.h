@@ -183,6 +183,24 @@ typedef uint8_t mouse_cmd_t;
 #define HID_CONSUMER_VOLUME_DOWN    234 // Volume Decrement
 typedef uint8_t consumer_cmd_t;
 
+// HID Consumer Usage IDs above 0xFF, only available via the extended consumer report
+#define HID_CONSUMER_BRIGHTNESS_UP      0x006F // Display Brightness Increment
+#define HID_CONSUMER_BRIGHTNESS_DOWN    0x0070 // Display Brightness Decrement
+#define HID_CONSUMER_AL_EMAIL           0x018A // AL Email Reader
+#define HID_CONSUMER_AL_CALCULATOR      0x0192 // AL Calculator
+#define HID_CONSUMER_AL_FILE_BROWSER    0x0194 // AL Local Machine Browser
+#define HID_CONSUMER_AL_WWW_BROWSER     0x0196 // AL Internet Browser
+#define HID_CONSUMER_AC_SEARCH          0x0221 // AC Search
+#define HID_CONSUMER_AC_HOME            0x0223 // AC Home
+#define HID_CONSUMER_AC_BACK            0x0224 // AC Back
+#define HID_CONSUMER_AC_FORWARD         0x0225 // AC Forward
+#define HID_CONSUMER_AC_STOP            0x0226 // AC Stop
+#define HID_CONSUMER_AC_REFRESH         0x0227 // AC Refresh
+#define HID_CONSUMER_AC_BOOKMARKS       0x022A // AC Bookmarks
+// Highest usage declared in the extended consumer report descriptor
+#define HID_CONSUMER_USAGE_MAX          0x03FF
+typedef uint16_t consumer_usage_t;
+
 #define HID_CC_RPT_MUTE                 1
 #define HID_CC_RPT_POWER                2
 #define HID_CC_RPT_LAST                 3
@@ -198,30 +216,26 @@ typedef uint8_t consumer_cmd_t;
 
 #define HID_CC_RPT_CHANNEL_UP           0x01
 #define HID_CC_RPT_CHANNEL_DOWN         0x03
-#define HID_CC_RPT_VOLUME_UP            0x40
-#define HID_CC_RPT_VOLUME_DOWN          0x80
+#define HID_CC_RPT_VOLUME_UP            0x04
+#define HID_CC_RPT_VOLUME_DOWN          0x08
 
 // HID Consumer Control report bitmasks
-#define HID_CC_RPT_NUMERIC_BITS         0xF0
-#define HID_CC_RPT_CHANNEL_BITS         0xCF
-#define HID_CC_RPT_VOLUME_BITS          0x3F
-#define HID_CC_RPT_BUTTON_BITS          0xF0
-#define HID_CC_RPT_SELECTION_BITS       0xCF
+// bits 0-1: channel (-1/+1), bit 2: volume up, bit 3: volume down, bits 4-7: button (array)
+///@note The numeric key pad & selection fields of the original example are not in the report map
+#define HID_CC_RPT_CHANNEL_BITS         0xFC
+#define HID_CC_RPT_VOLUME_BITS          0xF3
+#define HID_CC_RPT_BUTTON_BITS          0x0F
 
 
-// Macros for the HID Consumer Control 2-byte report
-#define HID_CC_RPT_SET_NUMERIC(s, x)    (s)[0] &= HID_CC_RPT_NUMERIC_BITS;   \
-                                        (s)[0] = (x)
+// Macros for the HID Consumer Control 1-byte report
 #define HID_CC_RPT_SET_CHANNEL(s, x)    (s)[0] &= HID_CC_RPT_CHANNEL_BITS;   \
-                                        (s)[0] |= ((x) & 0x03) << 4
+                                        (s)[0] |= ((x) & 0x03)
 #define HID_CC_RPT_SET_VOLUME_UP(s)     (s)[0] &= HID_CC_RPT_VOLUME_BITS;    \
-                                        (s)[0] |= 0x40
+                                        (s)[0] |= HID_CC_RPT_VOLUME_UP
 #define HID_CC_RPT_SET_VOLUME_DOWN(s)   (s)[0] &= HID_CC_RPT_VOLUME_BITS;    \
-                                        (s)[0] |= 0x80
-#define HID_CC_RPT_SET_BUTTON(s, x)     (s)[1] &= HID_CC_RPT_BUTTON_BITS;    \
-                                        (s)[1] |= (x)
-#define HID_CC_RPT_SET_SELECTION(s, x)  (s)[1] &= HID_CC_RPT_SELECTION_BITS; \
-                                        (s)[1] |= ((x) & 0x03) << 4
+                                        (s)[0] |= HID_CC_RPT_VOLUME_DOWN
+#define HID_CC_RPT_SET_BUTTON(s, x)     (s)[0] &= HID_CC_RPT_BUTTON_BITS;    \
+                                        (s)[0] |= ((x) & 0x0F) << 4
 
 
 // HID report mapping table
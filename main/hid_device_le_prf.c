@@ -13,7 +13,12 @@
 // limitations under the License.
 
 #include "hidd_le_prf_int.h"
+#include "hid_stats.h"
+#include "hid_trace.h"
+#include "hid_rpt_check.h"
+#include "boot_prof.h"
 #include <string.h>
+#include <stdlib.h>
 #include "esp_log.h"
 
 /// characteristic presentation information
@@ -36,8 +41,11 @@ static uint8_t gamepadenabled = 0;
 // HID report mapping table
 static hid_report_map_t hid_rpt_map[HID_NUM_REPORTS];
 
-// HID Report Map characteristic value - including Mouse, Consumer Control, Keyboard & Joystick (if enabled)
-static const uint8_t hidReportMap[] = {
+// HID Report Map fragments, one top level collection each.
+// hidd_compose_report_map() concatenates the enabled fragments to the report map characteristic value.
+
+// Keyboard (report ID 1)
+static const uint8_t hidReportMapKeyboard[] = {
     0x05, 0x01,  // Usage Pg (Generic Desktop)
     0x09, 0x06,  // Usage (Keyboard)
     0xA1, 0x01,  // Collection: (Application)
@@ -89,7 +97,10 @@ static const uint8_t hidReportMap[] = {
     0x81, 0x00,  //   Input: (Data, Array)
     //
     0xC0,        // End Collection
-    //
+};
+
+// Consumer control, channel/volume & 4bit media keys (report ID 2)
+static const uint8_t hidReportMapConsumer[] = {
     0x05, 0x0C,   // Usage Pg (Consumer Devices)
     0x09, 0x01,   // Usage (Consumer Control)
     0xA1, 0x01,   // Collection (Application)
@@ -154,8 +165,26 @@ static const uint8_t hidReportMap[] = {
     * 
     * */
     0xC0,            // End Collection
-    
-    
+};
+
+// Consumer control, 16bit usage (report ID 5)
+static const uint8_t hidReportMapConsumer16[] = {
+    0x05, 0x0C,   // Usage Pg (Consumer Devices)
+    0x09, 0x01,   // Usage (Consumer Control)
+    0xA1, 0x01,   // Collection (Application)
+    0x85, 0x05,   // Report Id (5)
+    0x15, 0x00,   //   Logical Min (0)
+    0x26, 0xFF, 0x03, // Logical Max (1023)
+    0x19, 0x00,   //   Usage Min (0)
+    0x2A, 0xFF, 0x03, // Usage Max (1023)
+    0x75, 0x10,   //   Report Size (16)
+    0x95, 0x01,   //   Report Count (1)
+    0x81, 0x00,   //   Input (Data, Ary, Abs)
+    0xC0,         // End Collection
+};
+
+// Mouse with wheel & pan resolution multiplier (input report ID 3, feature report ID 6)
+static const uint8_t hidReportMapMouse[] = {
     0x05, 0x01,  // Usage Page (Generic Desktop)
     0x09, 0x02,  // Usage (Mouse)
     0xA1, 0x01,  // Collection (Application)
@@ -176,20 +205,86 @@ static const uint8_t hidReportMap[] = {
     0x05, 0x01,  //     Usage Page (Generic Desktop)
     0x09, 0x30,  //     Usage (X)
     0x09, 0x31,  //     Usage (Y)
-    0x09, 0x38,  //     Usage (Wheel)
     0x15, 0x81,  //     Logical Minimum (-127)
     0x25, 0x7F,  //     Logical Maximum (127)
     0x75, 0x08,  //     Report Size (8)
-    0x95, 0x03,  //     Report Count (3)
+    0x95, 0x02,  //     Report Count (2)
     0x81, 0x06,  //     Input (Data, Variable, Relative) - X & Y coordinate
+    0xA1, 0x02,  //     Collection (Logical)
+    0x85, 0x06,  //       Report Id (6)
+    0x09, 0x48,  //       Usage (Resolution Multiplier) - wheel, feature bits 0-1
+    0x15, 0x00,  //       Logical Minimum (0)
+    0x25, 0x01,  //       Logical Maximum (1)
+    0x35, 0x01,  //       Physical Minimum (1)
+    0x45, 0x08,  //       Physical Maximum (8)
+    0x75, 0x02,  //       Report Size (2)
+    0x95, 0x01,  //       Report Count (1)
+    0xB1, 0x02,  //       Feature (Data, Variable, Absolute)
+    0x85, 0x03,  //       Report Id (3)
+    0x09, 0x38,  //       Usage (Wheel)
+    0x35, 0x00,  //       Physical Minimum (0)
+    0x45, 0x00,  //       Physical Maximum (0)
+    0x15, 0x81,  //       Logical Minimum (-127)
+    0x25, 0x7F,  //       Logical Maximum (127)
+    0x75, 0x08,  //       Report Size (8)
+    0x81, 0x06,  //       Input (Data, Variable, Relative) - wheel
+    0xC0,        //     End Collection
+    0xA1, 0x02,  //     Collection (Logical)
+    0x85, 0x06,  //       Report Id (6)
+    0x09, 0x48,  //       Usage (Resolution Multiplier) - pan, feature bits 2-3
+    0x15, 0x00,  //       Logical Minimum (0)
+    0x25, 0x01,  //       Logical Maximum (1)
+    0x35, 0x01,  //       Physical Minimum (1)
+    0x45, 0x08,  //       Physical Maximum (8)
+    0x75, 0x02,  //       Report Size (2)
+    0xB1, 0x02,  //       Feature (Data, Variable, Absolute)
+    0x75, 0x04,  //       Report Size (4)
+    0xB1, 0x01,  //       Feature (Constant) - padding
+    0x85, 0x03,  //       Report Id (3)
+    0x05, 0x0C,  //       Usage Page (Consumer Devices)
+    0x0A, 0x38, 0x02, //  Usage (AC Pan)
+    0x35, 0x00,  //       Physical Minimum (0)
+    0x45, 0x00,  //       Physical Maximum (0)
+    0x15, 0x81,  //       Logical Minimum (-127)
+    0x25, 0x7F,  //       Logical Maximum (127)
+    0x75, 0x08,  //       Report Size (8)
+    0x81, 0x06,  //       Input (Data, Variable, Relative) - horizontal scroll
+    0xC0,        //     End Collection
     0xC0,        //   End Collection
     0xC0,        // End Collection
+};
 
-    #if CONFIG_MODULE_USEJOYSTICK
+#if CONFIG_MODULE_USEJOYSTICK
+// Gamepad (report ID 4), 8 or 16bit axes
+static const uint8_t hidReportMapJoystick[] = {
     0x05, 0x01,  // Usage Page (Generic Desktop)
     0x09, 0x05,  // Usage (Gamepad)
     0xA1, 0x01,  // Collection (Application)
     0x85, 0x04,  // Report Id (4)
+    #if CONFIG_MODULE_JOYSTICK_HIRES
+    /* 16 bit X, Y, Z, Rz, Rx, Ry (min -32767, max 32767 ) */
+      0x05, 0x01,  // Usage Page (Generic Desktop)
+      0x09, 0x30,  // Usage (desktop X)
+      0x09, 0x31,  // Usage (desktop Y)
+      0x09, 0x32,  // Usage (desktop Z)
+      0x09, 0x35,  // Usage (desktop RZ)
+      0x09, 0x33,  // Usage (desktop RX)
+      0x09, 0x34,  // Usage (desktop RY)
+      0x16, 0x01, 0x80, // Logical Minimum (-32767)
+      0x26, 0xFF, 0x7F, // Logical Maximum (32767)
+      0x95, 0x06,  // Report Count (6)
+      0x75, 0x10,  // Report Size (16)
+      0x81, 0x02,  // Input: (Data, Variable, Absolute)
+    /* 16 bit analog triggers (min 0, max 32767) */
+      0x05, 0x02,  // Usage Page (Simulation Controls)
+      0x09, 0xC5,  // Usage (Brake) - left trigger
+      0x09, 0xC4,  // Usage (Accelerator) - right trigger
+      0x15, 0x00,  // Logical Minimum (0)
+      0x26, 0xFF, 0x7F, // Logical Maximum (32767)
+      0x95, 0x02,  // Report Count (2)
+      0x75, 0x10,  // Report Size (16)
+      0x81, 0x02,  // Input: (Data, Variable, Absolute)
+    #else
     /* 8 bit X, Y, Z, Rz, Rx, Ry (min -127, max 127 ) */ 
     /* implemented like Gamepad from tinyUSB */
       0x05, 0x01,  // Usage Page (Generic Desktop)
@@ -204,6 +299,7 @@ static const uint8_t hidReportMap[] = {
       0x95, 0x06,  // Report Count (6)
       0x75, 0x08,  // Report Size (8)
       0x81, 0x02,  // Input: (Data, Variable, Absolute)
+    #endif
     /* 8 bit DPad/Hat Button Map  */
       0x05, 0x01,  // Usage Page (Generic Desktop)
       0x09, 0x39,  // Usage (hat switch)
@@ -226,104 +322,6 @@ static const uint8_t hidReportMap[] = {
       0x75, 0x01,  // Report Size (1)
       0x81, 0x02,  // Input: (Data, Variable, Absolute)
     0xC0,            // End Collection
-    #endif
-
-};
-// HID Report Map characteristic value - including Mouse, Consumer Control, Keyboard (joystick disabled on runtime)
-#if CONFIG_MODULE_USEJOYSTICK
-static const uint8_t hidReportMapNoJoy[] = {
-    0x05, 0x01,  // Usage Pg (Generic Desktop)
-    0x09, 0x06,  // Usage (Keyboard)
-    0xA1, 0x01,  // Collection: (Application)
-    0x85, 0x01,  // Report Id (1)
-    //
-    0x05, 0x07,  //   Usage Pg (Key Codes)
-    0x19, 0xE0,  //   Usage Min (224)
-    0x29, 0xE7,  //   Usage Max (231)
-    0x15, 0x00,  //   Log Min (0)
-    0x25, 0x01,  //   Log Max (1)
-    //
-    //   Modifier byte
-    0x75, 0x01,  //   Report Size (1)
-    0x95, 0x08,  //   Report Count (8)
-    0x81, 0x02,  //   Input: (Data, Variable, Absolute)
-    //
-    //   Key arrays (6 bytes)
-    0x95, 0x06,  //   Report Count (6)
-    0x75, 0x08,  //   Report Size (8)
-    0x15, 0x00,  //   Log Min (0)
-    0x25, 0x65,  //   Log Max (101)
-    0x05, 0x07,  //   Usage Pg (Key Codes)
-    0x19, 0x00,  //   Usage Min (0)
-    0x29, 0x65,  //   Usage Max (101)
-    0x81, 0x00,  //   Input: (Data, Array)
-    //
-    0xC0,        // End Collection
-    //
-    0x05, 0x0C,   // Usage Pg (Consumer Devices)
-    0x09, 0x01,   // Usage (Consumer Control)
-    0xA1, 0x01,   // Collection (Application)
-    0x85, 0x02,   // Report Id (2)
-    0x05, 0x0C,   //   Usage Pg (Consumer Devices)
-    0x09, 0x86,   //   Usage (Channel)
-    0x15, 0xFF,   //   Logical Min (-1)
-    0x25, 0x01,   //   Logical Max (1)
-    0x75, 0x02,   //   Report Size (2)
-    0x95, 0x01,   //   Report Count (1)
-    0x81, 0x46,   //   Input (Data, Var, Rel, Null)
-    0x09, 0xE9,   //   Usage (Volume Up)
-    0x09, 0xEA,   //   Usage (Volume Down)
-    0x15, 0x00,   //   Logical Min (0)
-    0x75, 0x01,   //   Report Size (1)
-    0x95, 0x02,   //   Report Count (2)
-    0x81, 0x02,   //   Input (Data, Var, Abs)
-    0x09, 0xE2,   //   Usage (Mute)
-    0x09, 0x30,   //   Usage (Power)
-    0x09, 0x83,   //   Usage (Recall Last)
-    0x09, 0x81,   //   Usage (Assign Selection)
-    0x09, 0xB0,   //   Usage (Play)
-    0x09, 0xB1,   //   Usage (Pause)
-    0x09, 0xB2,   //   Usage (Record)
-    0x09, 0xB3,   //   Usage (Fast Forward)
-    0x09, 0xB4,   //   Usage (Rewind)
-    0x09, 0xB5,   //   Usage (Scan Next)
-    0x09, 0xB6,   //   Usage (Scan Prev)
-    0x09, 0xB7,   //   Usage (Stop)
-    0x15, 0x01,   //   Logical Min (1)
-    0x25, 0x0C,   //   Logical Max (12)
-    0x75, 0x04,   //   Report Size (4)
-    0x95, 0x01,   //   Report Count (1)
-    0x81, 0x00,   //   Input (Data, Ary, Abs)
-    0xC0,            // End Collection
-    
-    0x05, 0x01,  // Usage Page (Generic Desktop)
-    0x09, 0x02,  // Usage (Mouse)
-    0xA1, 0x01,  // Collection (Application)
-    0x85, 0x03,  // Report Id (3)
-    0x09, 0x01,  //   Usage (Pointer)
-    0xA1, 0x00,  //   Collection (Physical)
-    0x05, 0x09,  //     Usage Page (Buttons)
-    0x19, 0x01,  //     Usage Minimum (01) - Button 1
-    0x29, 0x03,  //     Usage Maximum (03) - Button 3
-    0x15, 0x00,  //     Logical Minimum (0)
-    0x25, 0x01,  //     Logical Maximum (1)
-    0x75, 0x01,  //     Report Size (1)
-    0x95, 0x03,  //     Report Count (3)
-    0x81, 0x02,  //     Input (Data, Variable, Absolute) - Button states
-    0x75, 0x05,  //     Report Size (5)
-    0x95, 0x01,  //     Report Count (1)
-    0x81, 0x01,  //     Input (Constant) - Padding or Reserved bits
-    0x05, 0x01,  //     Usage Page (Generic Desktop)
-    0x09, 0x30,  //     Usage (X)
-    0x09, 0x31,  //     Usage (Y)
-    0x09, 0x38,  //     Usage (Wheel)
-    0x15, 0x81,  //     Logical Minimum (-127)
-    0x25, 0x7F,  //     Logical Maximum (127)
-    0x75, 0x08,  //     Report Size (8)
-    0x95, 0x03,  //     Report Count (3)
-    0x81, 0x06,  //     Input (Data, Variable, Relative) - X & Y coordinate
-    0xC0,        //   End Collection
-    0xC0,        // End Collection
 };
 #endif
 
@@ -354,9 +352,20 @@ struct gatts_profile_inst {
 
 hidd_le_env_t hidd_le_env;
 
-// HID report map length
-///@note This line is just used to trigger a warning if the 255B limit is reached
-uint8_t hidReportMapLen = sizeof(hidReportMap);
+// Length of all report map fragments together, the report map characteristic must hold it
+#if CONFIG_MODULE_USEJOYSTICK
+  #define HIDD_REPORT_MAP_JOY_LEN   sizeof(hidReportMapJoystick)
+#else
+  #define HIDD_REPORT_MAP_JOY_LEN   0
+#endif
+#define HIDD_REPORT_MAP_FULL_LEN  (sizeof(hidReportMapKeyboard) + sizeof(hidReportMapConsumer) + \
+                                   sizeof(hidReportMapConsumer16) + sizeof(hidReportMapMouse) + HIDD_REPORT_MAP_JOY_LEN)
+_Static_assert(HIDD_REPORT_MAP_FULL_LEN <= HIDD_LE_REPORT_MAP_MAX_LEN, "HID report map exceeds HIDD_LE_REPORT_MAP_MAX_LEN");
+
+// HID report map characteristic value & length, composed by hidd_compose_report_map()
+///@note The stack reads the value asynchronously when creating the attribute table, so it stays allocated
+static uint8_t hidReportMap[HIDD_REPORT_MAP_FULL_LEN];
+uint16_t hidReportMapLen = 0;
 uint8_t hidProtocolMode = HID_PROTOCOL_MODE_REPORT;
 
 // HID report mapping table
@@ -392,14 +401,21 @@ static uint8_t hidReportRefKeyIn[HID_REPORT_REF_LEN] =
 static uint8_t hidReportRefLedOut[HID_REPORT_REF_LEN] =
              { HID_RPT_ID_LED_OUT, HID_REPORT_TYPE_OUTPUT };
 
-// HID Report Reference characteristic descriptor, Feature
+// HID Report Reference characteristic descriptor, Feature (mouse resolution multiplier)
 static uint8_t hidReportRefFeature[HID_REPORT_REF_LEN] =
              { HID_RPT_ID_FEATURE, HID_REPORT_TYPE_FEATURE };
 
+// Mouse feature report value of the attribute table, reads are answered per connection (res_multiplier)
+static uint8_t hidMouseFeature[HIDD_LE_MOUSE_FEATURE_RPT_LEN] = { 0 };
+
 // HID Report Reference characteristic descriptor, consumer control input
 static uint8_t hidReportRefCCIn[HID_REPORT_REF_LEN] =
              { HID_RPT_ID_CC_IN, HID_REPORT_TYPE_INPUT };
 
+// HID Report Reference characteristic descriptor, extended consumer control input
+static uint8_t hidReportRefCCExtIn[HID_REPORT_REF_LEN] =
+             { HID_RPT_ID_CC_EXT_IN, HID_REPORT_TYPE_INPUT };
+
 
 /*
  *  Heart Rate PROFILE ATTRIBUTES
@@ -469,425 +485,151 @@ static const esp_gatts_attr_db_t bas_att_db[BAS_IDX_NB] =
 };
 
 
-/// Full Hid device Database Description - Used to add attributes into the database - with Joystick report
-static esp_gatts_attr_db_t hidd_le_gatt_db[HIDD_LE_IDX_NB] =
-{
-            // HID Service Declaration
-    [HIDD_LE_IDX_SVC]                       = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&primary_service_uuid,
-                                                             ESP_GATT_PERM_READ_ENCRYPTED, sizeof(uint16_t), sizeof(hid_le_svc),
-                                                            (uint8_t *)&hid_le_svc}},
-
-    // HID Service Declaration
-    [HIDD_LE_IDX_INCL_SVC]               = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&include_service_uuid,
-                                                            ESP_GATT_PERM_READ,
-                                                            sizeof(esp_gatts_incl_svc_desc_t), sizeof(esp_gatts_incl_svc_desc_t),
-                                                            (uint8_t *)&incl_svc}},
-
-    // HID Information Characteristic Declaration
-    [HIDD_LE_IDX_HID_INFO_CHAR]     = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                            ESP_GATT_PERM_READ,
-                                                            CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                            (uint8_t *)&char_prop_read}},
-    // HID Information Characteristic Value
-    [HIDD_LE_IDX_HID_INFO_VAL]       = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_info_char_uuid,
-                                                            ESP_GATT_PERM_READ,
-                                                            sizeof(hids_hid_info_t), sizeof(hidInfo),
-                                                            (uint8_t *)&hidInfo}},
-
-    // HID Control Point Characteristic Declaration
-    [HIDD_LE_IDX_HID_CTNL_PT_CHAR]  = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                              ESP_GATT_PERM_READ,
-                                                              CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                              (uint8_t *)&char_prop_write_nr}},
-    // HID Control Point Characteristic Value
-    [HIDD_LE_IDX_HID_CTNL_PT_VAL]    = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_control_point_uuid,
-                                                             ESP_GATT_PERM_WRITE,
-                                                             sizeof(uint8_t), 0,
-                                                             NULL}},
-
-    // Report Map Characteristic Declaration
-    [HIDD_LE_IDX_REPORT_MAP_CHAR]   = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                              ESP_GATT_PERM_READ,
-                                                              CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                              (uint8_t *)&char_prop_read}},
-    // Report Map Characteristic Value
-    [HIDD_LE_IDX_REPORT_MAP_VAL]     = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_map_uuid,
-                                                              ESP_GATT_PERM_READ,
-                                                              HIDD_LE_REPORT_MAP_MAX_LEN, sizeof(hidReportMap),
-                                                              (uint8_t *)&hidReportMap}},
-
-    // Report Map Characteristic - External Report Reference Descriptor
-    [HIDD_LE_IDX_REPORT_MAP_EXT_REP_REF]  = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_repot_map_ext_desc_uuid,
-                                                                        ESP_GATT_PERM_READ,
-                                                                        sizeof(uint16_t), sizeof(uint16_t),
-                                                                        (uint8_t *)&hidExtReportRefDesc}},
-
-    // Protocol Mode Characteristic Declaration
-    [HIDD_LE_IDX_PROTO_MODE_CHAR]            = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                                        ESP_GATT_PERM_READ,
-                                                                        CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                                        (uint8_t *)&char_prop_read_write}},
-    // Protocol Mode Characteristic Value
-    [HIDD_LE_IDX_PROTO_MODE_VAL]               = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_proto_mode_uuid,
-                                                                        (ESP_GATT_PERM_READ|ESP_GATT_PERM_WRITE),
-                                                                        sizeof(uint8_t), sizeof(hidProtocolMode),
-                                                                        (uint8_t *)&hidProtocolMode}},
-                                                                        
-    // Report Characteristic Declaration
-    [HIDD_LE_IDX_REPORT_KEY_IN_CHAR]         = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                                         ESP_GATT_PERM_READ,
-                                                                         CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                                         (uint8_t *)&char_prop_read_notify}},
-    // Report Characteristic Value
-    [HIDD_LE_IDX_REPORT_KEY_IN_VAL]            = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_uuid,
-                                                                       ESP_GATT_PERM_READ,
-                                                                       HIDD_LE_REPORT_MAX_LEN, 0,
-                                                                       NULL}},
-    // Report KEY INPUT Characteristic - Client Characteristic Configuration Descriptor
-    [HIDD_LE_IDX_REPORT_KEY_IN_CCC]              = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_client_config_uuid,
-                                                                      (ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE),
-                                                                      sizeof(uint16_t), 0,
-                                                                      NULL}},
-     // Report Characteristic - Report Reference Descriptor
-    [HIDD_LE_IDX_REPORT_KEY_IN_REP_REF]       = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_ref_descr_uuid,
-                                                                       ESP_GATT_PERM_READ,
-                                                                       sizeof(hidReportRefKeyIn), sizeof(hidReportRefKeyIn),
-                                                                       hidReportRefKeyIn}},
-                                                                       
-    [HIDD_LE_IDX_REPORT_MOUSE_IN_CHAR]       = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                                         ESP_GATT_PERM_READ,
-                                                                         CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                                         (uint8_t *)&char_prop_read_notify}},
-
-    [HIDD_LE_IDX_REPORT_MOUSE_IN_VAL]        = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_uuid,
-                                                                       ESP_GATT_PERM_READ,
-                                                                       HIDD_LE_REPORT_MAX_LEN, 0,
-                                                                       NULL}},
-
-    [HIDD_LE_IDX_REPORT_MOUSE_IN_CCC]        = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_client_config_uuid,
-                                                                      (ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE),
-                                                                      sizeof(uint16_t), 0,
-                                                                      NULL}},
-
-    [HIDD_LE_IDX_REPORT_MOUSE_REP_REF]       = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_ref_descr_uuid,
-                                                                       ESP_GATT_PERM_READ,
-                                                                       sizeof(hidReportRefMouseIn), sizeof(hidReportRefMouseIn),
-                                                                       hidReportRefMouseIn}},
+/** @brief One characteristic of the HID service, expanded to the attribute table at init
+ *
+ * Each entry produces (at consecutive indices, starting with idx):
+ * characteristic declaration, value, client characteristic configuration (if ccc_perm != 0)
+ * and one descriptor (if desc_uuid != NULL, report reference or external report reference). */
+typedef struct {
+    uint8_t idx;                /// HIDD_LE_IDX_* of the characteristic declaration
+    const uint8_t *prop;        /// characteristic properties
+    const uint16_t *uuid;       /// value UUID
+    uint16_t perm;              /// value permissions
+    uint16_t max_len;           /// maximum value length
+    uint16_t len;               /// initial value length
+    uint8_t *value;             /// initial value (may be NULL)
+    uint16_t ccc_perm;          /// permissions of the CCC descriptor, 0 for none
+    const uint16_t *desc_uuid;  /// descriptor UUID, NULL for none
+    uint8_t desc_len;
+    uint8_t *desc_value;
+} hidd_char_spec_t;
+
+#define HIDD_REPORT_IN(index, ref, ccc) \
+    { index, &char_prop_read_notify, &hid_report_uuid, ESP_GATT_PERM_READ, HIDD_LE_REPORT_MAX_LEN, 0, NULL, \
+      ccc, &hid_report_ref_descr_uuid, HID_REPORT_REF_LEN, ref }
+
+/// HID service characteristics (in HIDD_LE_IDX_* order), the report map value is set by hidd_build_gatt_db
+static const hidd_char_spec_t hidd_le_char_spec[] = {
+    { HIDD_LE_IDX_HID_INFO_CHAR, &char_prop_read, &hid_info_char_uuid, ESP_GATT_PERM_READ,
+      sizeof(hids_hid_info_t), sizeof(hidInfo), (uint8_t *)&hidInfo, 0, NULL, 0, NULL },
+    { HIDD_LE_IDX_HID_CTNL_PT_CHAR, &char_prop_write_nr, &hid_control_point_uuid, ESP_GATT_PERM_WRITE,
+      sizeof(uint8_t), 0, NULL, 0, NULL, 0, NULL },
+    { HIDD_LE_IDX_REPORT_MAP_CHAR, &char_prop_read, &hid_report_map_uuid, ESP_GATT_PERM_READ,
+      HIDD_LE_REPORT_MAP_MAX_LEN, 0, NULL,
+      0, &hid_repot_map_ext_desc_uuid, sizeof(uint16_t), (uint8_t *)&hidExtReportRefDesc },
+    { HIDD_LE_IDX_PROTO_MODE_CHAR, &char_prop_read_write, &hid_proto_mode_uuid, ESP_GATT_PERM_READ|ESP_GATT_PERM_WRITE,
+      sizeof(uint8_t), sizeof(hidProtocolMode), (uint8_t *)&hidProtocolMode, 0, NULL, 0, NULL },
+    HIDD_REPORT_IN(HIDD_LE_IDX_REPORT_KEY_IN_CHAR, hidReportRefKeyIn, ESP_GATT_PERM_READ|ESP_GATT_PERM_WRITE),
+    HIDD_REPORT_IN(HIDD_LE_IDX_REPORT_MOUSE_IN_CHAR, hidReportRefMouseIn, ESP_GATT_PERM_READ|ESP_GATT_PERM_WRITE),
 #if CONFIG_MODULE_USEJOYSTICK
-                                                                       
-    [HIDD_LE_IDX_REPORT_JOY_IN_CHAR]       = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                                         ESP_GATT_PERM_READ,
-                                                                         CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                                         (uint8_t *)&char_prop_read_notify}},
-
-    [HIDD_LE_IDX_REPORT_JOY_IN_VAL]        = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_uuid,
-                                                                       ESP_GATT_PERM_READ,
-                                                                       HIDD_LE_REPORT_MAX_LEN, 0,
-                                                                       NULL}},
-
-    [HIDD_LE_IDX_REPORT_JOY_IN_CCC]        = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_client_config_uuid,
-                                                                      (ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE),
-                                                                      sizeof(uint16_t), 0,
-                                                                      NULL}},
-
-    [HIDD_LE_IDX_REPORT_JOY_REP_REF]       = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_ref_descr_uuid,
-                                                                       ESP_GATT_PERM_READ,
-                                                                       sizeof(hidReportRefJoyIn), sizeof(hidReportRefJoyIn),
-                                                                       hidReportRefJoyIn}},
-#endif                                                                       
-    // Report Characteristic Declaration
-    [HIDD_LE_IDX_REPORT_CC_IN_CHAR]         = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                                         ESP_GATT_PERM_READ,
-                                                                         CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                                         (uint8_t *)&char_prop_read_notify}},
-    // Report Characteristic Value
-    [HIDD_LE_IDX_REPORT_CC_IN_VAL]            = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_uuid,
-                                                                       ESP_GATT_PERM_READ,
-                                                                       HIDD_LE_REPORT_MAX_LEN, 0,
-                                                                       NULL}},
-    // Report KEY INPUT Characteristic - Client Characteristic Configuration Descriptor
-    [HIDD_LE_IDX_REPORT_CC_IN_CCC]              = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_client_config_uuid,
-                                                                      (ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE_ENCRYPTED),
-                                                                      sizeof(uint16_t), 0,
-                                                                      NULL}},
-     // Report Characteristic - Report Reference Descriptor
-    [HIDD_LE_IDX_REPORT_CC_IN_REP_REF]       = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_ref_descr_uuid,
-                                                                       ESP_GATT_PERM_READ,
-                                                                       sizeof(hidReportRefCCIn), sizeof(hidReportRefCCIn),
-                                                                       hidReportRefCCIn}},
-
-    // Boot Keyboard Input Report Characteristic Declaration
-    [HIDD_LE_IDX_BOOT_KB_IN_REPORT_CHAR] = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                                        ESP_GATT_PERM_READ,
-                                                                        CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                                        (uint8_t *)&char_prop_read_notify}},
-    // Boot Keyboard Input Report Characteristic Value
-    [HIDD_LE_IDX_BOOT_KB_IN_REPORT_VAL]   = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_kb_input_uuid,
-                                                                        ESP_GATT_PERM_READ,
-                                                                        HIDD_LE_BOOT_REPORT_MAX_LEN, 0,
-                                                                        NULL}},
-    // Boot Keyboard Input Report Characteristic - Client Characteristic Configuration Descriptor
-    [HIDD_LE_IDX_BOOT_KB_IN_REPORT_NTF_CFG]  = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_client_config_uuid,
-                                                                              (ESP_GATT_PERM_READ|ESP_GATT_PERM_WRITE),
-                                                                              sizeof(uint16_t), 0,
-                                                                              NULL}},
-
-    // Boot Keyboard Output Report Characteristic Declaration
-    [HIDD_LE_IDX_BOOT_KB_OUT_REPORT_CHAR]    = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                                              ESP_GATT_PERM_READ,
-                                                                              CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                                              (uint8_t *)&char_prop_read_write_write_nr}},
-    // Boot Keyboard Output Report Characteristic Value
-    [HIDD_LE_IDX_BOOT_KB_OUT_REPORT_VAL]      = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_kb_output_uuid,
-                                                                              (ESP_GATT_PERM_READ|ESP_GATT_PERM_WRITE),
-                                                                              HIDD_LE_BOOT_REPORT_MAX_LEN, 0,
-                                                                              NULL}},
-
-    // Boot Mouse Input Report Characteristic Declaration
-    [HIDD_LE_IDX_BOOT_MOUSE_IN_REPORT_CHAR] = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                                              ESP_GATT_PERM_READ,
-                                                                              CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                                              (uint8_t *)&char_prop_read_notify}},
-    // Boot Mouse Input Report Characteristic Value
-    [HIDD_LE_IDX_BOOT_MOUSE_IN_REPORT_VAL]   = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_mouse_input_uuid,
-                                                                              ESP_GATT_PERM_READ,
-                                                                              HIDD_LE_BOOT_REPORT_MAX_LEN, 0,
-                                                                              NULL}},
-    // Boot Mouse Input Report Characteristic - Client Characteristic Configuration Descriptor
-    [HIDD_LE_IDX_BOOT_MOUSE_IN_REPORT_NTF_CFG]    = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_client_config_uuid,
-                                                                                      (ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE),
-                                                                                      sizeof(uint16_t), 0,
-                                                                                      NULL}},
-
-    // Report Characteristic Declaration
-    [HIDD_LE_IDX_REPORT_CHAR]                    = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                                         ESP_GATT_PERM_READ,
-                                                                         CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                                         (uint8_t *)&char_prop_read_write}},
-    // Report Characteristic Value
-    [HIDD_LE_IDX_REPORT_VAL]                      = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_uuid,
-                                                                       ESP_GATT_PERM_READ,
-                                                                       HIDD_LE_REPORT_MAX_LEN, 0,
-                                                                       NULL}},
-    // Report Characteristic - Report Reference Descriptor
-    [HIDD_LE_IDX_REPORT_REP_REF]               = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_ref_descr_uuid,
-                                                                       ESP_GATT_PERM_READ,
-                                                                       sizeof(hidReportRefFeature), sizeof(hidReportRefFeature),
-                                                                       hidReportRefFeature}},
+    HIDD_REPORT_IN(HIDD_LE_IDX_REPORT_JOY_IN_CHAR, hidReportRefJoyIn, ESP_GATT_PERM_READ|ESP_GATT_PERM_WRITE),
+#endif
+    HIDD_REPORT_IN(HIDD_LE_IDX_REPORT_CC_IN_CHAR, hidReportRefCCIn, ESP_GATT_PERM_READ|ESP_GATT_PERM_WRITE_ENCRYPTED),
+    HIDD_REPORT_IN(HIDD_LE_IDX_REPORT_CC_EXT_IN_CHAR, hidReportRefCCExtIn, ESP_GATT_PERM_READ|ESP_GATT_PERM_WRITE_ENCRYPTED),
+    { HIDD_LE_IDX_BOOT_KB_IN_REPORT_CHAR, &char_prop_read_notify, &hid_kb_input_uuid, ESP_GATT_PERM_READ,
+      HIDD_LE_BOOT_REPORT_MAX_LEN, 0, NULL, ESP_GATT_PERM_READ|ESP_GATT_PERM_WRITE, NULL, 0, NULL },
+    { HIDD_LE_IDX_BOOT_KB_OUT_REPORT_CHAR, &char_prop_read_write_write_nr, &hid_kb_output_uuid, ESP_GATT_PERM_READ|ESP_GATT_PERM_WRITE,
+      HIDD_LE_BOOT_REPORT_MAX_LEN, 0, NULL, 0, NULL, 0, NULL },
+    { HIDD_LE_IDX_BOOT_MOUSE_IN_REPORT_CHAR, &char_prop_read_notify, &hid_mouse_input_uuid, ESP_GATT_PERM_READ,
+      HIDD_LE_BOOT_REPORT_MAX_LEN, 0, NULL, ESP_GATT_PERM_READ|ESP_GATT_PERM_WRITE, NULL, 0, NULL },
+    // mouse feature report (resolution multiplier)
+    { HIDD_LE_IDX_REPORT_CHAR, &char_prop_read_write, &hid_report_uuid, ESP_GATT_PERM_READ|ESP_GATT_PERM_WRITE_ENCRYPTED,
+      HIDD_LE_MOUSE_FEATURE_RPT_LEN, HIDD_LE_MOUSE_FEATURE_RPT_LEN, hidMouseFeature,
+      0, &hid_report_ref_descr_uuid, HID_REPORT_REF_LEN, hidReportRefFeature },
 };
-/// Full Hid device Database Description - Used to add attributes into the database - without Joystick report
-#if CONFIG_MODULE_USEJOYSTICK
-static esp_gatts_attr_db_t hidd_le_gatt_db_no_joy[HIDD_LE_IDX_NB] =
+
+static void hidd_set_attr(esp_gatts_attr_db_t *attr, const uint16_t *uuid, uint16_t perm,
+                          uint16_t max_len, uint16_t len, uint8_t *value)
 {
-            // HID Service Declaration
-    [HIDD_LE_IDX_SVC]                       = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&primary_service_uuid,
-                                                             ESP_GATT_PERM_READ_ENCRYPTED, sizeof(uint16_t), sizeof(hid_le_svc),
-                                                            (uint8_t *)&hid_le_svc}},
-
-    // HID Service Declaration
-    [HIDD_LE_IDX_INCL_SVC]               = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&include_service_uuid,
-                                                            ESP_GATT_PERM_READ,
-                                                            sizeof(esp_gatts_incl_svc_desc_t), sizeof(esp_gatts_incl_svc_desc_t),
-                                                            (uint8_t *)&incl_svc}},
-
-    // HID Information Characteristic Declaration
-    [HIDD_LE_IDX_HID_INFO_CHAR]     = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                            ESP_GATT_PERM_READ,
-                                                            CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                            (uint8_t *)&char_prop_read}},
-    // HID Information Characteristic Value
-    [HIDD_LE_IDX_HID_INFO_VAL]       = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_info_char_uuid,
-                                                            ESP_GATT_PERM_READ,
-                                                            sizeof(hids_hid_info_t), sizeof(hidInfo),
-                                                            (uint8_t *)&hidInfo}},
-
-    // HID Control Point Characteristic Declaration
-    [HIDD_LE_IDX_HID_CTNL_PT_CHAR]  = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                              ESP_GATT_PERM_READ,
-                                                              CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                              (uint8_t *)&char_prop_write_nr}},
-    // HID Control Point Characteristic Value
-    [HIDD_LE_IDX_HID_CTNL_PT_VAL]    = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_control_point_uuid,
-                                                             ESP_GATT_PERM_WRITE,
-                                                             sizeof(uint8_t), 0,
-                                                             NULL}},
-
-    // Report Map Characteristic Declaration
-    [HIDD_LE_IDX_REPORT_MAP_CHAR]   = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                              ESP_GATT_PERM_READ,
-                                                              CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                              (uint8_t *)&char_prop_read}},
-    // Report Map Characteristic Value
-    [HIDD_LE_IDX_REPORT_MAP_VAL]     = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_map_uuid,
-                                                              ESP_GATT_PERM_READ,
-                                                              HIDD_LE_REPORT_MAP_MAX_LEN, sizeof(hidReportMapNoJoy),
-                                                              (uint8_t *)&hidReportMapNoJoy}},
-
-    // Report Map Characteristic - External Report Reference Descriptor
-    [HIDD_LE_IDX_REPORT_MAP_EXT_REP_REF]  = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_repot_map_ext_desc_uuid,
-                                                                        ESP_GATT_PERM_READ,
-                                                                        sizeof(uint16_t), sizeof(uint16_t),
-                                                                        (uint8_t *)&hidExtReportRefDesc}},
-
-    // Protocol Mode Characteristic Declaration
-    [HIDD_LE_IDX_PROTO_MODE_CHAR]            = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                                        ESP_GATT_PERM_READ,
-                                                                        CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                                        (uint8_t *)&char_prop_read_write}},
-    // Protocol Mode Characteristic Value
-    [HIDD_LE_IDX_PROTO_MODE_VAL]               = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_proto_mode_uuid,
-                                                                        (ESP_GATT_PERM_READ|ESP_GATT_PERM_WRITE),
-                                                                        sizeof(uint8_t), sizeof(hidProtocolMode),
-                                                                        (uint8_t *)&hidProtocolMode}},
-                                                                        
-    // Report Characteristic Declaration
-    [HIDD_LE_IDX_REPORT_KEY_IN_CHAR]         = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                                         ESP_GATT_PERM_READ,
-                                                                         CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                                         (uint8_t *)&char_prop_read_notify}},
-    // Report Characteristic Value
-    [HIDD_LE_IDX_REPORT_KEY_IN_VAL]            = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_uuid,
-                                                                       ESP_GATT_PERM_READ,
-                                                                       HIDD_LE_REPORT_MAX_LEN, 0,
-                                                                       NULL}},
-    // Report KEY INPUT Characteristic - Client Characteristic Configuration Descriptor
-    [HIDD_LE_IDX_REPORT_KEY_IN_CCC]              = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_client_config_uuid,
-                                                                      (ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE),
-                                                                      sizeof(uint16_t), 0,
-                                                                      NULL}},
-     // Report Characteristic - Report Reference Descriptor
-    [HIDD_LE_IDX_REPORT_KEY_IN_REP_REF]       = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_ref_descr_uuid,
-                                                                       ESP_GATT_PERM_READ,
-                                                                       sizeof(hidReportRefKeyIn), sizeof(hidReportRefKeyIn),
-                                                                       hidReportRefKeyIn}},
-                                                                       
-    [HIDD_LE_IDX_REPORT_MOUSE_IN_CHAR]       = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                                         ESP_GATT_PERM_READ,
-                                                                         CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                                         (uint8_t *)&char_prop_read_notify}},
-
-    [HIDD_LE_IDX_REPORT_MOUSE_IN_VAL]        = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_uuid,
-                                                                       ESP_GATT_PERM_READ,
-                                                                       HIDD_LE_REPORT_MAX_LEN, 0,
-                                                                       NULL}},
-
-    [HIDD_LE_IDX_REPORT_MOUSE_IN_CCC]        = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_client_config_uuid,
-                                                                      (ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE),
-                                                                      sizeof(uint16_t), 0,
-                                                                      NULL}},
-
-    [HIDD_LE_IDX_REPORT_MOUSE_REP_REF]       = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_ref_descr_uuid,
-                                                                       ESP_GATT_PERM_READ,
-                                                                       sizeof(hidReportRefMouseIn), sizeof(hidReportRefMouseIn),
-                                                                       hidReportRefMouseIn}},
-                                                                       
-    [HIDD_LE_IDX_REPORT_JOY_IN_CHAR]       = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                                         ESP_GATT_PERM_READ,
-                                                                         CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                                         (uint8_t *)&char_prop_read_notify}},
-
-    [HIDD_LE_IDX_REPORT_JOY_IN_VAL]        = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_uuid,
-                                                                       ESP_GATT_PERM_READ,
-                                                                       HIDD_LE_REPORT_MAX_LEN, 0,
-                                                                       NULL}},
-
-    [HIDD_LE_IDX_REPORT_JOY_IN_CCC]        = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_client_config_uuid,
-                                                                      (ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE),
-                                                                      sizeof(uint16_t), 0,
-                                                                      NULL}},
-
-    [HIDD_LE_IDX_REPORT_JOY_REP_REF]       = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_ref_descr_uuid,
-                                                                       ESP_GATT_PERM_READ,
-                                                                       sizeof(hidReportRefJoyIn), sizeof(hidReportRefJoyIn),
-                                                                       hidReportRefJoyIn}},
-                                                                                                                                             
-    // Report Characteristic Declaration
-    [HIDD_LE_IDX_REPORT_CC_IN_CHAR]         = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                                         ESP_GATT_PERM_READ,
-                                                                         CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                                         (uint8_t *)&char_prop_read_notify}},
-    // Report Characteristic Value
-    [HIDD_LE_IDX_REPORT_CC_IN_VAL]            = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_uuid,
-                                                                       ESP_GATT_PERM_READ,
-                                                                       HIDD_LE_REPORT_MAX_LEN, 0,
-                                                                       NULL}},
-    // Report KEY INPUT Characteristic - Client Characteristic Configuration Descriptor
-    [HIDD_LE_IDX_REPORT_CC_IN_CCC]              = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_client_config_uuid,
-                                                                      (ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE_ENCRYPTED),
-                                                                      sizeof(uint16_t), 0,
-                                                                      NULL}},
-     // Report Characteristic - Report Reference Descriptor
-    [HIDD_LE_IDX_REPORT_CC_IN_REP_REF]       = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_ref_descr_uuid,
-                                                                       ESP_GATT_PERM_READ,
-                                                                       sizeof(hidReportRefCCIn), sizeof(hidReportRefCCIn),
-                                                                       hidReportRefCCIn}},
-
-    // Boot Keyboard Input Report Characteristic Declaration
-    [HIDD_LE_IDX_BOOT_KB_IN_REPORT_CHAR] = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                                        ESP_GATT_PERM_READ,
-                                                                        CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                                        (uint8_t *)&char_prop_read_notify}},
-    // Boot Keyboard Input Report Characteristic Value
-    [HIDD_LE_IDX_BOOT_KB_IN_REPORT_VAL]   = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_kb_input_uuid,
-                                                                        ESP_GATT_PERM_READ,
-                                                                        HIDD_LE_BOOT_REPORT_MAX_LEN, 0,
-                                                                        NULL}},
-    // Boot Keyboard Input Report Characteristic - Client Characteristic Configuration Descriptor
-    [HIDD_LE_IDX_BOOT_KB_IN_REPORT_NTF_CFG]  = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_client_config_uuid,
-                                                                              (ESP_GATT_PERM_READ|ESP_GATT_PERM_WRITE),
-                                                                              sizeof(uint16_t), 0,
-                                                                              NULL}},
-
-    // Boot Keyboard Output Report Characteristic Declaration
-    [HIDD_LE_IDX_BOOT_KB_OUT_REPORT_CHAR]    = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                                              ESP_GATT_PERM_READ,
-                                                                              CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                                              (uint8_t *)&char_prop_read_write_write_nr}},
-    // Boot Keyboard Output Report Characteristic Value
-    [HIDD_LE_IDX_BOOT_KB_OUT_REPORT_VAL]      = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_kb_output_uuid,
-                                                                              (ESP_GATT_PERM_READ|ESP_GATT_PERM_WRITE),
-                                                                              HIDD_LE_BOOT_REPORT_MAX_LEN, 0,
-                                                                              NULL}},
-
-    // Boot Mouse Input Report Characteristic Declaration
-    [HIDD_LE_IDX_BOOT_MOUSE_IN_REPORT_CHAR] = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                                              ESP_GATT_PERM_READ,
-                                                                              CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                                              (uint8_t *)&char_prop_read_notify}},
-    // Boot Mouse Input Report Characteristic Value
-    [HIDD_LE_IDX_BOOT_MOUSE_IN_REPORT_VAL]   = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_mouse_input_uuid,
-                                                                              ESP_GATT_PERM_READ,
-                                                                              HIDD_LE_BOOT_REPORT_MAX_LEN, 0,
-                                                                              NULL}},
-    // Boot Mouse Input Report Characteristic - Client Characteristic Configuration Descriptor
-    [HIDD_LE_IDX_BOOT_MOUSE_IN_REPORT_NTF_CFG]    = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_client_config_uuid,
-                                                                                      (ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE),
-                                                                                      sizeof(uint16_t), 0,
-                                                                                      NULL}},
-
-    // Report Characteristic Declaration
-    [HIDD_LE_IDX_REPORT_CHAR]                    = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
-                                                                         ESP_GATT_PERM_READ,
-                                                                         CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
-                                                                         (uint8_t *)&char_prop_read_write}},
-    // Report Characteristic Value
-    [HIDD_LE_IDX_REPORT_VAL]                      = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_uuid,
-                                                                       ESP_GATT_PERM_READ,
-                                                                       HIDD_LE_REPORT_MAX_LEN, 0,
-                                                                       NULL}},
-    // Report Characteristic - Report Reference Descriptor
-    [HIDD_LE_IDX_REPORT_REP_REF]               = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_ref_descr_uuid,
-                                                                       ESP_GATT_PERM_READ,
-                                                                       sizeof(hidReportRefFeature), sizeof(hidReportRefFeature),
-                                                                       hidReportRefFeature}},
-};
-#endif
+    attr->attr_control.auto_rsp = ESP_GATT_AUTO_RSP;
+    attr->att_desc.uuid_length = ESP_UUID_LEN_16;
+    attr->att_desc.uuid_p = (uint8_t *)uuid;
+    attr->att_desc.perm = perm;
+    attr->att_desc.max_length = max_len;
+    attr->att_desc.length = len;
+    attr->att_desc.value = value;
+}
+
+/** @brief Build the HID service attribute table from hidd_le_char_spec
+ * @param db Table with HIDD_LE_IDX_NB entries
+ * @param map Report map to use
+ * @param map_len Length of the report map
+ * @return ESP_OK or ESP_ERR_INVALID_STATE if the spec does not fit the HIDD_LE_IDX_* layout */
+static esp_err_t hidd_build_gatt_db(esp_gatts_attr_db_t *db, const uint8_t *map, uint16_t map_len)
+{
+    uint8_t next = HIDD_LE_IDX_HID_INFO_CHAR;
+
+    hidd_set_attr(&db[HIDD_LE_IDX_SVC], &primary_service_uuid, ESP_GATT_PERM_READ_ENCRYPTED,
+                  sizeof(uint16_t), sizeof(hid_le_svc), (uint8_t *)&hid_le_svc);
+    hidd_set_attr(&db[HIDD_LE_IDX_INCL_SVC], &include_service_uuid, ESP_GATT_PERM_READ,
+                  sizeof(esp_gatts_incl_svc_desc_t), sizeof(esp_gatts_incl_svc_desc_t), (uint8_t *)&incl_svc);
+
+    for (uint8_t i = 0; i < sizeof(hidd_le_char_spec) / sizeof(hidd_le_char_spec[0]); i++) {
+        const hidd_char_spec_t *c = &hidd_le_char_spec[i];
+        //characteristics must follow each other without gaps
+        if (c->idx != next) return ESP_ERR_INVALID_STATE;
+        hidd_set_attr(&db[next++], &character_declaration_uuid, ESP_GATT_PERM_READ,
+                      CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE, (uint8_t *)c->prop);
+        hidd_set_attr(&db[next++], c->uuid, c->perm, c->max_len, c->len, c->value);
+        if (c->ccc_perm != 0) {
+            hidd_set_attr(&db[next++], &character_client_config_uuid, c->ccc_perm, sizeof(uint16_t), 0, NULL);
+        }
+        if (c->desc_uuid != NULL) {
+            hidd_set_attr(&db[next++], c->desc_uuid, ESP_GATT_PERM_READ, c->desc_len, c->desc_len, c->desc_value);
+        }
+    }
+    if (next != HIDD_LE_IDX_NB) return ESP_ERR_INVALID_STATE;
+
+    db[HIDD_LE_IDX_REPORT_MAP_VAL].att_desc.length = map_len;
+    db[HIDD_LE_IDX_REPORT_MAP_VAL].att_desc.value = (uint8_t *)map;
+    //protocol mode & resolution multiplier are per connection, reads & writes are answered in esp_hidd_prf_cb_hdl
+    db[HIDD_LE_IDX_PROTO_MODE_VAL].attr_control.auto_rsp = ESP_GATT_RSP_BY_APP;
+    db[HIDD_LE_IDX_REPORT_VAL].attr_control.auto_rsp = ESP_GATT_RSP_BY_APP;
+    return ESP_OK;
+}
+
+/** @brief Create the HID service with the report map composed by hidd_register_cb
+ * @note The table is only needed for the call, the stack copies it */
+static void hidd_create_hid_service(esp_gatt_if_t gatts_if)
+{
+    esp_gatts_attr_db_t *db = calloc(HIDD_LE_IDX_NB, sizeof(esp_gatts_attr_db_t));
+
+    if (db == NULL) {
+        ESP_LOGE(HID_LE_PRF_TAG, "%s(), no memory for attribute table", __func__);
+        return;
+    }
+    if (hidd_build_gatt_db(db, hidReportMap, hidReportMapLen) == ESP_OK) {
+        esp_ble_gatts_create_attr_tab(db, gatts_if, HIDD_LE_IDX_NB, 0);
+    } else {
+        ESP_LOGE(HID_LE_PRF_TAG, "%s(), hidd_le_char_spec does not match HIDD_LE_IDX_*", __func__);
+    }
+    free(db);
+}
 
 static void hid_add_id_tbl(void);
 
+#if CONFIG_MODULE_TRACE
+/** @brief conn_id of a GATTS event for the trace, 0xFFFF if the event has none */
+static uint16_t gatts_trace_conn_id(esp_gatts_cb_event_t event, const esp_ble_gatts_cb_param_t *param)
+{
+    switch (event) {
+        case ESP_GATTS_READ_EVT: return param->read.conn_id;
+        case ESP_GATTS_WRITE_EVT: return param->write.conn_id;
+        case ESP_GATTS_EXEC_WRITE_EVT: return param->exec_write.conn_id;
+        case ESP_GATTS_MTU_EVT: return param->mtu.conn_id;
+        case ESP_GATTS_CONF_EVT: return param->conf.conn_id;
+        case ESP_GATTS_CONNECT_EVT: return param->connect.conn_id;
+        case ESP_GATTS_DISCONNECT_EVT: return param->disconnect.conn_id;
+        case ESP_GATTS_CONGEST_EVT: return param->congest.conn_id;
+        default: return 0xFFFF;
+    }
+}
+#endif
+
 void esp_hidd_prf_cb_hdl(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
 									esp_ble_gatts_cb_param_t *param)
 {
+    HID_TRACE(HID_TRACE_GATTS, event, gatts_trace_conn_id(event, param));
     switch(event) {
         case ESP_GATTS_REG_EVT: {
             esp_ble_gap_config_local_icon (ESP_BLE_APPEARANCE_GENERIC_HID);
@@ -911,6 +653,11 @@ void esp_hidd_prf_cb_hdl(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
             break;
         }
         case ESP_GATTS_CONF_EVT: {
+            //a notification could not be sent after all
+            if (param->conf.status != ESP_GATT_OK) {
+                ESP_LOGD(HID_LE_PRF_TAG, "notification to %d failed: %d", param->conf.conn_id, param->conf.status);
+                hid_stats_report_failed(param->conf.conn_id);
+            }
             break;
         }
         case ESP_GATTS_CREATE_EVT:
@@ -921,6 +668,9 @@ void esp_hidd_prf_cb_hdl(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
 			memcpy(cb_param.connect.remote_bda, param->connect.remote_bda, sizeof(esp_bd_addr_t));
             cb_param.connect.conn_id = param->connect.conn_id;
             hidd_clcb_alloc(param->connect.conn_id, param->connect.remote_bda);
+            hidd_set_conn_interval(param->connect.remote_bda, param->connect.conn_params.interval);
+            hid_stats_conn_open(param->connect.conn_id, param->connect.remote_bda, param->connect.conn_params.interval,
+                                param->connect.conn_params.latency, param->connect.conn_params.timeout);
             esp_ble_set_encryption(param->connect.remote_bda, ESP_BLE_SEC_ENCRYPT_NO_MITM);
             if(hidd_le_env.hidd_cb != NULL) {
                 (hidd_le_env.hidd_cb)(ESP_HIDD_EVENT_BLE_CONNECT, &cb_param);
@@ -933,12 +683,57 @@ void esp_hidd_prf_cb_hdl(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
 			 if(hidd_le_env.hidd_cb != NULL) {
                     (hidd_le_env.hidd_cb)(ESP_HIDD_EVENT_BLE_DISCONNECT, &cb_param);
              }
+            hid_stats_conn_close(param->disconnect.conn_id);
             hidd_clcb_dealloc(param->disconnect.conn_id);
             break;
         }
         case ESP_GATTS_CLOSE_EVT:
             break;
+        case ESP_GATTS_READ_EVT: {
+            esp_gatt_rsp_t rsp;
+            if (!param->read.need_rsp) break;
+            memset(&rsp, 0, sizeof(rsp));
+            rsp.attr_value.handle = param->read.handle;
+            if (param->read.handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_PROTO_MODE_VAL]) {
+                //protocol mode of the reading connection (each connection starts in report mode, HOGP 1.0, 4.8)
+                rsp.attr_value.len = HID_PROTOCOL_MODE_LEN;
+                rsp.attr_value.value[0] = hidd_get_proto_mode(param->read.conn_id);
+            } else if (param->read.handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_VAL]) {
+                //resolution multiplier of the reading connection (disabled until the host enables it)
+                hidd_clcb_t *p_clcb = hidd_clcb_find(param->read.conn_id);
+                rsp.attr_value.len = HIDD_LE_MOUSE_FEATURE_RPT_LEN;
+                rsp.attr_value.value[0] = p_clcb != NULL ? p_clcb->res_multiplier : 0;
+            } else {
+                break;
+            }
+            esp_ble_gatts_send_response(gatts_if, param->read.conn_id, param->read.trans_id, ESP_GATT_OK, &rsp);
+            break;
+        }
         case ESP_GATTS_WRITE_EVT: {
+            //host switches between boot & report protocol (e.g. BIOS/UEFI keyboards)
+            if (param->write.handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_PROTO_MODE_VAL]) {
+                esp_gatt_status_t status = ESP_GATT_INVALID_ATTR_LEN;
+                if (param->write.len == HID_PROTOCOL_MODE_LEN) {
+                    hidd_set_proto_mode(param->write.conn_id, param->write.value[0]);
+                    status = ESP_GATT_OK;
+                }
+                if (param->write.need_rsp) {
+                    esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id, status, NULL);
+                }
+                break;
+            }
+            //host enables / disables the high-resolution wheel & pan
+            if (param->write.handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_VAL]) {
+                esp_gatt_status_t status = ESP_GATT_INVALID_ATTR_LEN;
+                if (param->write.len == HIDD_LE_MOUSE_FEATURE_RPT_LEN) {
+                    hidd_set_res_multiplier(param->write.conn_id, param->write.value[0]);
+                    status = ESP_GATT_OK;
+                }
+                if (param->write.need_rsp) {
+                    esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id, status, NULL);
+                }
+                break;
+            }
             /**esp_hidd_cb_param_t cb_param = {0};
             if (param->write.handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_LED_OUT_VAL] &&
                 hidd_le_env.hidd_cb != NULL) {
@@ -959,15 +754,7 @@ void esp_hidd_prf_cb_hdl(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
                 incl_svc.end_hdl = incl_svc.start_hdl + BAS_IDX_NB -1;
                 ESP_LOGI(HID_LE_PRF_TAG, "%s(), start added the hid service to the stack database. incl_handle = %d",
                            __func__, incl_svc.start_hdl);
-                #if CONFIG_MODULE_USEJOYSTICK
-                  if(gamepadenabled) {
-                    esp_ble_gatts_create_attr_tab(hidd_le_gatt_db, gatts_if, HIDD_LE_IDX_NB, 0);
-                  } else {
-                    esp_ble_gatts_create_attr_tab(hidd_le_gatt_db_no_joy, gatts_if, HIDD_LE_IDX_NB, 0);
-                  }
-                #else
-                  esp_ble_gatts_create_attr_tab(hidd_le_gatt_db, gatts_if, HIDD_LE_IDX_NB, 0);
-                #endif
+                hidd_create_hid_service(gatts_if);
             }
             if (param->add_attr_tab.num_handle == HIDD_LE_IDX_NB &&
                 param->add_attr_tab.status == ESP_GATT_OK) {
@@ -976,6 +763,7 @@ void esp_hidd_prf_cb_hdl(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
                 ESP_LOGI(HID_LE_PRF_TAG, "hid svc handle = %x",hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_SVC]);
                 hid_add_id_tbl();
 		        esp_ble_gatts_start_service(hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_SVC]);
+                boot_prof_mark(BOOT_PROF_HID_SERVICE);
             } else {
                 esp_ble_gatts_start_service(param->add_attr_tab.handles[0]);
             }
@@ -987,6 +775,8 @@ void esp_hidd_prf_cb_hdl(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
 			ESP_LOGV(HID_LE_PRF_TAG, "Congest EVT, conn_id = %x",param->congest.conn_id);
 			cb_param.congest.congested = param->congest.congested;
 			cb_param.congest.conn_id = param->congest.conn_id;
+			hid_stats_conn_congest(param->congest.conn_id, param->congest.congested);
+			HID_TRACE(HID_TRACE_CONGEST, param->congest.congested, param->congest.conn_id);
             if(hidd_le_env.hidd_cb != NULL) {
                 (hidd_le_env.hidd_cb)(ESP_HIDD_EVENT_BLE_CONGEST, &cb_param);
             }
@@ -1014,11 +804,15 @@ void hidd_clcb_alloc (uint16_t conn_id, esp_bd_addr_t bda)
     uint8_t                   i_clcb = 0;
     hidd_clcb_t      *p_clcb = NULL;
 
-    for (i_clcb = 0, p_clcb= hidd_le_env.hidd_clcb; i_clcb < HID_MAX_APPS; i_clcb++, p_clcb++) {
+    for (i_clcb = 0, p_clcb= hidd_le_env.hidd_clcb; i_clcb < HIDD_LE_MAX_CONN; i_clcb++, p_clcb++) {
         if (!p_clcb->in_use) {
             p_clcb->in_use      = true;
             p_clcb->conn_id     = conn_id;
             p_clcb->connected   = true;
+            p_clcb->proto_mode  = HID_PROTOCOL_MODE_REPORT;
+            p_clcb->res_multiplier = 0;
+            p_clcb->wheel_rem   = 0;
+            p_clcb->pan_rem     = 0;
             memcpy (p_clcb->remote_bda, bda, ESP_BD_ADDR_LEN);
             break;
         }
@@ -1027,16 +821,100 @@ void hidd_clcb_alloc (uint16_t conn_id, esp_bd_addr_t bda)
 }
 
 bool hidd_clcb_dealloc (uint16_t conn_id)
+{
+    hidd_clcb_t      *p_clcb = hidd_clcb_find(conn_id);
+
+    if (p_clcb != NULL) {
+        if (p_clcb->proto_mode == HID_PROTOCOL_MODE_BOOT && hidd_le_env.boot_mode_cnt > 0) {
+            hidd_le_env.boot_mode_cnt--;
+        }
+        //the next connection may get the same slot & conn_id
+        hidd_consumer_tap_cancel(p_clcb - hidd_le_env.hidd_clcb);
+        memset(p_clcb, 0, sizeof(hidd_clcb_t));
+        return true;
+    }
+
+    return false;
+}
+
+hidd_clcb_t *hidd_clcb_find (uint16_t conn_id)
 {
     uint8_t              i_clcb = 0;
     hidd_clcb_t      *p_clcb = NULL;
 
-    for (i_clcb = 0, p_clcb= hidd_le_env.hidd_clcb; i_clcb < HID_MAX_APPS; i_clcb++, p_clcb++) {
-            memset(p_clcb, 0, sizeof(hidd_clcb_t));
-            return true;
+    for (i_clcb = 0, p_clcb= hidd_le_env.hidd_clcb; i_clcb < HIDD_LE_MAX_CONN; i_clcb++, p_clcb++) {
+        if (p_clcb->in_use && p_clcb->conn_id == conn_id) {
+            return p_clcb;
+        }
     }
 
-    return false;
+    return NULL;
+}
+
+void hidd_set_proto_mode(uint16_t conn_id, uint8_t mode)
+{
+    hidd_clcb_t *p_clcb = hidd_clcb_find(conn_id);
+
+    if (p_clcb == NULL) {
+        ESP_LOGW(HID_LE_PRF_TAG, "%s(), unknown conn_id %d", __func__, conn_id);
+        return;
+    }
+    if (mode != HID_PROTOCOL_MODE_BOOT && mode != HID_PROTOCOL_MODE_REPORT) {
+        ESP_LOGW(HID_LE_PRF_TAG, "%s(), invalid protocol mode %d", __func__, mode);
+        return;
+    }
+    if (p_clcb->proto_mode == mode) {
+        return;
+    }
+
+    //keep track of boot mode connections, hid_dev_send_report skips the lookup if there are none.
+    if (mode == HID_PROTOCOL_MODE_BOOT) {
+        hidd_le_env.boot_mode_cnt++;
+    } else if (hidd_le_env.boot_mode_cnt > 0) {
+        hidd_le_env.boot_mode_cnt--;
+    }
+    p_clcb->proto_mode = mode;
+    ESP_LOGI(HID_LE_PRF_TAG, "conn_id %d switched to %s protocol mode", conn_id,
+             mode == HID_PROTOCOL_MODE_BOOT ? "boot" : "report");
+}
+
+void hidd_set_res_multiplier(uint16_t conn_id, uint8_t value)
+{
+    hidd_clcb_t *p_clcb = hidd_clcb_find(conn_id);
+
+    if (p_clcb == NULL) {
+        ESP_LOGW(HID_LE_PRF_TAG, "%s(), unknown conn_id %d", __func__, conn_id);
+        return;
+    }
+    p_clcb->res_multiplier = value;
+    //drop fractions collected in low-resolution mode
+    p_clcb->wheel_rem = 0;
+    p_clcb->pan_rem = 0;
+    ESP_LOGI(HID_LE_PRF_TAG, "conn_id %d resolution multiplier: wheel %s, pan %s", conn_id,
+             (value & HIDD_LE_RES_MULT_WHEEL) ? "on" : "off", (value & HIDD_LE_RES_MULT_PAN) ? "on" : "off");
+}
+
+void hidd_set_conn_interval(esp_bd_addr_t bda, uint16_t interval)
+{
+    uint8_t              i_clcb = 0;
+    hidd_clcb_t      *p_clcb = NULL;
+
+    for (i_clcb = 0, p_clcb= hidd_le_env.hidd_clcb; i_clcb < HIDD_LE_MAX_CONN; i_clcb++, p_clcb++) {
+        if (p_clcb->in_use && memcmp(p_clcb->remote_bda, bda, ESP_BD_ADDR_LEN) == 0) {
+            p_clcb->conn_interval = interval;
+            return;
+        }
+    }
+}
+
+uint8_t hidd_get_proto_mode(uint16_t conn_id)
+{
+    hidd_clcb_t *p_clcb = hidd_clcb_find(conn_id);
+
+    if (p_clcb == NULL) {
+        return HID_PROTOCOL_MODE_REPORT;
+    }
+    return p_clcb->proto_mode;
 }
 
 static struct gatts_profile_inst heart_rate_profile_tab[PROFILE_NUM] = {
@@ -1076,10 +954,102 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
 }
 
 
+/// Reports declared by each report map fragment, with the lengths sent by esp_hidd_prf_api.c
+static const hid_rpt_check_t hidReportsKeyboard[] = {
+    { HID_RPT_ID_KEY_IN, HID_REPORT_TYPE_INPUT, HID_KEYBOARD_IN_RPT_LEN, "keyboard" },
+};
+static const hid_rpt_check_t hidReportsConsumer[] = {
+    { HID_RPT_ID_CC_IN, HID_REPORT_TYPE_INPUT, HID_CC_IN_RPT_LEN, "consumer" },
+};
+static const hid_rpt_check_t hidReportsConsumer16[] = {
+    { HID_RPT_ID_CC_EXT_IN, HID_REPORT_TYPE_INPUT, HID_CC_EXT_IN_RPT_LEN, "consumer16" },
+};
+static const hid_rpt_check_t hidReportsMouse[] = {
+    { HID_RPT_ID_MOUSE_IN, HID_REPORT_TYPE_INPUT, HID_MOUSE_IN_RPT_LEN, "mouse" },
+    { HID_RPT_ID_FEATURE, HID_REPORT_TYPE_FEATURE, HIDD_LE_MOUSE_FEATURE_RPT_LEN, "resolution multiplier" },
+};
+#if CONFIG_MODULE_USEJOYSTICK
+///@note 8bit reports are converted if the wide report is used
+static const hid_rpt_check_t hidReportsJoystick[] = {
+    #if CONFIG_MODULE_JOYSTICK_HIRES
+    { HID_RPT_ID_JOY_IN, HID_REPORT_TYPE_INPUT, HID_JOYSTICK_HIRES_IN_RPT_LEN, "joystick" },
+    #else
+    { HID_RPT_ID_JOY_IN, HID_REPORT_TYPE_INPUT, HID_JOYSTICK_IN_RPT_LEN, "joystick" },
+    #endif
+};
+#endif
+
+/** @brief One top level collection of the report map and the reports it declares */
+typedef struct {
+    const uint8_t *desc;
+    uint16_t len;
+    const hid_rpt_check_t *reports;
+    uint8_t report_cnt;
+    uint8_t gamepad;    /// only added if the gamepad is enabled on runtime
+} hidd_rpt_fragment_t;
+
+#define HIDD_RPT_FRAGMENT(desc, reports, gamepad) \
+    { desc, sizeof(desc), reports, sizeof(reports) / sizeof(reports[0]), gamepad }
+
+/// Report map fragments, in report map order
+static const hidd_rpt_fragment_t hidReportFragments[] = {
+    HIDD_RPT_FRAGMENT(hidReportMapKeyboard, hidReportsKeyboard, 0),
+    HIDD_RPT_FRAGMENT(hidReportMapConsumer, hidReportsConsumer, 0),
+    HIDD_RPT_FRAGMENT(hidReportMapConsumer16, hidReportsConsumer16, 0),
+    HIDD_RPT_FRAGMENT(hidReportMapMouse, hidReportsMouse, 0),
+#if CONFIG_MODULE_USEJOYSTICK
+    HIDD_RPT_FRAGMENT(hidReportMapJoystick, hidReportsJoystick, 1),
+#endif
+};
+
+static void hidd_report_mismatch(const hid_rpt_check_t *rpt, int bits)
+{
+    if (bits < 0) {
+        ESP_LOGE(HID_LE_PRF_TAG, "report map cannot be parsed");
+    } else {
+        ESP_LOGE(HID_LE_PRF_TAG, "%s report (ID %u): %u bytes sent, report map declares %d bits",
+                 rpt->name, rpt->id, rpt->len, bits);
+    }
+}
+
+/** @brief Concatenate the enabled fragments to hidReportMap and check the report lengths
+ *
+ * Reports of included fragments are checked against the composed map (catches duplicate IDs),
+ * excluded fragments on their own, so every runtime combination is covered.
+ * @return Number of reports whose declared length differs from the sent length */
+static int hidd_compose_report_map(void)
+{
+    uint16_t len = 0;
+    int errors = 0;
+
+    for (uint8_t i = 0; i < sizeof(hidReportFragments) / sizeof(hidReportFragments[0]); i++) {
+        const hidd_rpt_fragment_t *f = &hidReportFragments[i];
+        if (f->gamepad && !gamepadenabled) continue;
+        memcpy(&hidReportMap[len], f->desc, f->len);
+        len += f->len;
+    }
+    hidReportMapLen = len;
+
+    for (uint8_t i = 0; i < sizeof(hidReportFragments) / sizeof(hidReportFragments[0]); i++) {
+        const hidd_rpt_fragment_t *f = &hidReportFragments[i];
+        if (f->gamepad && !gamepadenabled) {
+            errors += hid_rpt_check_map(f->desc, f->len, f->reports, f->report_cnt, hidd_report_mismatch);
+        } else {
+            errors += hid_rpt_check_map(hidReportMap, hidReportMapLen, f->reports, f->report_cnt, hidd_report_mismatch);
+        }
+    }
+    return errors;
+}
+
 esp_err_t hidd_register_cb(uint8_t enablegamepad)
 {
 	esp_err_t status;
   if(enablegamepad) gamepadenabled = 1;
+  //mismatches are logged only, the host build (test/host) fails on them
+  if(hidd_compose_report_map() != 0)
+  {
+    ESP_LOGE(HID_LE_PRF_TAG, "report map does not match the sent reports, hosts may drop them");
+  }
 	status = esp_ble_gatts_register_callback(gatts_event_handler);
 	return status;
 }
@@ -1109,90 +1079,46 @@ void hidd_get_attr_value(uint16_t handle, uint16_t *length, uint8_t **value)
     return;
 }
 
+static void hid_add_rpt(uint8_t *index, const uint8_t *ref, uint16_t handle, uint16_t cccd, uint8_t mode)
+{
+    if (*index >= HID_NUM_REPORTS) {
+        ESP_LOGE(HID_LE_PRF_TAG, "%s(), more reports than HID_NUM_REPORTS", __func__);
+        return;
+    }
+    hid_rpt_map[*index].id = ref[0];
+    hid_rpt_map[*index].type = ref[1];
+    hid_rpt_map[*index].handle = handle;
+    hid_rpt_map[*index].cccdHandle = cccd;
+    hid_rpt_map[*index].mode = mode;
+    (*index)++;
+}
+
+/** @brief Fill the report ID map from hidd_le_char_spec
+ * @note IDs and types are taken from the report reference descriptors, boot reports
+ * use the ID & type of their report mode counterpart */
 static void hid_add_id_tbl(void)
 {
-      uint8_t index = 0;
-      // Key input report
-      hid_rpt_map[index].id = hidReportRefKeyIn[0];
-      hid_rpt_map[index].type = hidReportRefKeyIn[1];
-      hid_rpt_map[index].handle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_KEY_IN_VAL];
-      hid_rpt_map[index].cccdHandle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_KEY_IN_CCC];
-      hid_rpt_map[index].mode = HID_PROTOCOL_MODE_REPORT;
-      index++;
-      
-      // Consumer Control input report
-      hid_rpt_map[index].id = hidReportRefCCIn[0];
-      hid_rpt_map[index].type = hidReportRefCCIn[1];
-      hid_rpt_map[index].handle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_CC_IN_VAL];
-      hid_rpt_map[index].cccdHandle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_CC_IN_CCC];
-      hid_rpt_map[index].mode = HID_PROTOCOL_MODE_REPORT;
-      index++;
-      
-      // LED output report
-      /**
-      hid_rpt_map[index].id = hidReportRefLedOut[0];
-      hid_rpt_map[index].type = hidReportRefLedOut[1];
-      hid_rpt_map[index].handle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_LED_OUT_VAL];
-      hid_rpt_map[index].cccdHandle = 0;
-      hid_rpt_map[index].mode = HID_PROTOCOL_MODE_REPORT;
-      index++;
-      **/
-      
-      // Mouse input report
-      hid_rpt_map[index].id = hidReportRefMouseIn[0];
-      hid_rpt_map[index].type = hidReportRefMouseIn[1];
-      hid_rpt_map[index].handle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_MOUSE_IN_VAL];
-      hid_rpt_map[index].cccdHandle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_MOUSE_IN_VAL];
-      hid_rpt_map[index].mode = HID_PROTOCOL_MODE_REPORT;
-      index++;
-      
-            
-      // joystick report
-      #if CONFIG_MODULE_USEJOYSTICK
-      hid_rpt_map[index].id = hidReportRefJoyIn[0];
-      hid_rpt_map[index].type = hidReportRefJoyIn[1];
-      hid_rpt_map[index].handle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_JOY_IN_VAL];
-      hid_rpt_map[index].cccdHandle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_JOY_IN_VAL];
-      hid_rpt_map[index].mode = HID_PROTOCOL_MODE_REPORT;
-      index++;
-      #endif
-
-      // Boot keyboard input report
-      // Use same ID and type as key input report
-      hid_rpt_map[index].id = hidReportRefKeyIn[0];
-      hid_rpt_map[index].type = hidReportRefKeyIn[1];
-      hid_rpt_map[index].handle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_BOOT_KB_IN_REPORT_VAL];
-      hid_rpt_map[index].cccdHandle = 0;
-      hid_rpt_map[index].mode = HID_PROTOCOL_MODE_BOOT;
-      index++;
-
-      // Boot keyboard output report
-      // Use same ID and type as LED output report
-      hid_rpt_map[index].id = hidReportRefLedOut[0];
-      hid_rpt_map[index].type = hidReportRefLedOut[1];
-      hid_rpt_map[index].handle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_BOOT_KB_OUT_REPORT_VAL];
-      hid_rpt_map[index].cccdHandle = 0;
-      hid_rpt_map[index].mode = HID_PROTOCOL_MODE_BOOT;
-      index++;
-
-      // Boot mouse input report
-      // Use same ID and type as mouse input report
-      hid_rpt_map[index].id = hidReportRefMouseIn[0];
-      hid_rpt_map[index].type = hidReportRefMouseIn[1];
-      hid_rpt_map[index].handle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_BOOT_MOUSE_IN_REPORT_VAL];
-      hid_rpt_map[index].cccdHandle = 0;
-      hid_rpt_map[index].mode = HID_PROTOCOL_MODE_BOOT;
-      index++;
-
-      // Feature report
-      hid_rpt_map[index].id = hidReportRefFeature[0];
-      hid_rpt_map[index].type = hidReportRefFeature[1];
-      hid_rpt_map[index].handle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_VAL];
-      hid_rpt_map[index].cccdHandle = 0;
-      hid_rpt_map[index].mode = HID_PROTOCOL_MODE_REPORT;
-      index++;
-
-  // Setup report ID map
-  hid_dev_register_reports(HID_NUM_REPORTS, hid_rpt_map);
+    uint16_t *att_tbl = hidd_le_env.hidd_inst.att_tbl;
+    uint8_t index = 0;
+
+    for (uint8_t i = 0; i < sizeof(hidd_le_char_spec) / sizeof(hidd_le_char_spec[0]); i++) {
+        const hidd_char_spec_t *c = &hidd_le_char_spec[i];
+        // value follows the declaration, CCC (if any) follows the value
+        uint16_t handle = att_tbl[c->idx + 1];
+        uint16_t cccd = c->ccc_perm != 0 ? att_tbl[c->idx + 2] : 0;
+
+        if (c->desc_uuid == &hid_report_ref_descr_uuid) {
+            hid_add_rpt(&index, c->desc_value, handle, cccd, HID_PROTOCOL_MODE_REPORT);
+        } else if (c->uuid == &hid_kb_input_uuid) {
+            hid_add_rpt(&index, hidReportRefKeyIn, handle, 0, HID_PROTOCOL_MODE_BOOT);
+        } else if (c->uuid == &hid_kb_output_uuid) {
+            hid_add_rpt(&index, hidReportRefLedOut, handle, 0, HID_PROTOCOL_MODE_BOOT);
+        } else if (c->uuid == &hid_mouse_input_uuid) {
+            hid_add_rpt(&index, hidReportRefMouseIn, handle, 0, HID_PROTOCOL_MODE_BOOT);
+        }
+    }
+
+    // Setup report ID map
+    hid_dev_register_reports(index, hid_rpt_map);
 }
 
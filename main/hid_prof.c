@@ -0,0 +1,89 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ *
+ * Cycle counts (Xtensa CCOUNT) of hot path functions, see HID_PROF_SCOPE.
+ */
+
+#include "hid_prof.h"
+
+#if CONFIG_MODULE_PROFILING
+
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+} hid_prof_stat_t;
+
+static const char *const scope_names[HID_PROF_NUM] = {
+    [HID_PROF_PARSE] = "parse",
+    [HID_PROF_SEND_REPORT] = "send_report",
+    [HID_PROF_BUILD_KEYBOARD] = "keyboard",
+    [HID_PROF_BUILD_MOUSE] = "mouse",
+    [HID_PROF_BUILD_CONSUMER] = "consumer",
+    [HID_PROF_BUILD_JOYSTICK] = "joystick",
+    [HID_PROF_PERIODIC] = "periodic",
+};
+
+static hid_prof_stat_t stats[HID_PROF_NUM];
+static portMUX_TYPE prof_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void hid_prof_end(hid_prof_t *p)
+{
+    uint32_t cycles = esp_cpu_get_cycle_count() - p->start;
+    hid_prof_stat_t *s = &stats[p->scope];
+
+    //CCOUNT is per core, a measurement is invalid if the task was moved to the other core
+    if (p->core != xPortGetCoreID()) return;
+
+    portENTER_CRITICAL(&prof_lock);
+    if (s->count == 0 || cycles < s->min) s->min = cycles;
+    if (cycles > s->max) s->max = cycles;
+    s->sum += cycles;
+    s->count++;
+    portEXIT_CRITICAL(&prof_lock);
+}
+
+int hid_prof_format(uint8_t scope, char *buf, size_t len)
+{
+    hid_prof_stat_t s;
+    int pos;
+
+    if (scope >= HID_PROF_NUM) return 0;
+    portENTER_CRITICAL(&prof_lock);
+    s = stats[scope];
+    portEXIT_CRITICAL(&prof_lock);
+    if (s.count == 0) return 0;
+
+    pos = snprintf(buf, len, "PF:%s,%lu,%lu,%lu,%lu\r\n", scope_names[scope], (unsigned long)s.count,
+                   (unsigned long)s.min, (unsigned long)(s.sum / s.count), (unsigned long)s.max);
+    return pos < (int)len ? pos : (int)len - 1;
+}
+
+void hid_prof_reset(void)
+{
+    portENTER_CRITICAL(&prof_lock);
+    memset(stats, 0, sizeof(stats));
+    portEXIT_CRITICAL(&prof_lock);
+}
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ */
+
+#ifndef _HID_PROF_H_
+#define _HID_PROF_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+
+/** @brief Profiling scopes (one per instrumented function) */
+typedef enum {
+    HID_PROF_PARSE = 0,         /// uart_parse_command
+    HID_PROF_SEND_REPORT,       /// hid_dev_send_report
+    HID_PROF_BUILD_KEYBOARD,    /// esp_hidd_send_keyboard_value
+    HID_PROF_BUILD_MOUSE,       /// esp_hidd_send_mouse_(hires_)value
+    HID_PROF_BUILD_CONSUMER,    /// esp_hidd_send_consumer_value/usage
+    HID_PROF_BUILD_JOYSTICK,    /// esp_hidd_send_joy_(hires_)report
+    HID_PROF_PERIODIC,          /// periodicHIDCallback
+    HID_PROF_NUM,
+} hid_prof_scope_t;
+
+#if CONFIG_MODULE_PROFILING
+
+#include "esp_cpu.h"
+#include "freertos/FreeRTOS.h"
+
+/** @brief Running measurement, ended automatically when leaving the C scope */
+typedef struct {
+    uint32_t start;
+    uint8_t scope;
+    uint8_t core;
+} hid_prof_t;
+
+/** @brief End a measurement (called via the cleanup attribute of HID_PROF_SCOPE) */
+void hid_prof_end(hid_prof_t *p);
+
+/** @brief Format the statistics of one scope as one line
+ * Format: "PF:<name>,<count>,<min>,<avg>,<max>\r\n" (CPU cycles)
+ * @return Length of the line, 0 if there are no samples */
+int hid_prof_format(uint8_t scope, char *buf, size_t len);
+
+/** @brief Clear all profiling statistics */
+void hid_prof_reset(void);
+
+/** @brief Measure CPU cycles (CCOUNT) from here until the enclosing C scope is left (incl. early returns) */
+#define HID_PROF_SCOPE(s) \
+    hid_prof_t _hid_prof __attribute__((cleanup(hid_prof_end))) = \
+        { .start = esp_cpu_get_cycle_count(), .scope = (s), .core = xPortGetCoreID() }
+
+#else
+
+#define HID_PROF_SCOPE(s) do { } while (0)
+
+#endif
+
+#endif
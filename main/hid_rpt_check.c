@@ -0,0 +1,113 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ *
+ * Minimal HID report descriptor parser, used to check that the report maps
+ * declare exactly the report lengths the firmware sends. A mismatch leads
+ * to wasted bytes on air or reports the host parses wrongly.
+ * No ESP-IDF dependencies, so it can be compiled on its own.
+ */
+
+#include <stddef.h>
+#include "hid_rpt_check.h"
+
+/** item prefix: tag & type, size bits masked out */
+#define ITEM_INPUT          0x80
+#define ITEM_OUTPUT         0x90
+#define ITEM_FEATURE        0xB0
+#define ITEM_REPORT_SIZE    0x74
+#define ITEM_REPORT_ID      0x84
+#define ITEM_REPORT_COUNT   0x94
+#define ITEM_PUSH           0xA4
+#define ITEM_POP            0xB4
+#define ITEM_LONG           0xFE
+
+/** maximum Push depth */
+#define GLOBAL_STACK        4
+
+typedef struct {
+    uint32_t size;
+    uint32_t count;
+    uint8_t id;
+} rpt_globals_t;
+
+int hid_rpt_check_bits(const uint8_t *map, uint16_t len, uint8_t id, uint8_t type)
+{
+    rpt_globals_t stack[GLOBAL_STACK];
+    rpt_globals_t g = { 0, 0, 0 };
+    uint8_t depth = 0;
+    uint8_t main_item;
+    int bits = 0;
+
+    switch (type) {
+        case HID_RPT_CHECK_INPUT: main_item = ITEM_INPUT; break;
+        case HID_RPT_CHECK_OUTPUT: main_item = ITEM_OUTPUT; break;
+        case HID_RPT_CHECK_FEATURE: main_item = ITEM_FEATURE; break;
+        default: return -1;
+    }
+
+    for (uint16_t i = 0; i < len;) {
+        uint8_t prefix = map[i];
+        if (prefix == ITEM_LONG) {
+            //long item: bDataSize, bLongItemTag, data
+            if (i + 1 >= len) return -1;
+            i += 3 + map[i + 1];
+            continue;
+        }
+        uint8_t size = prefix & 0x03;
+        if (size == 3) size = 4;
+        if (i + 1 + size > len) return -1;
+        uint32_t data = 0;
+        for (uint8_t b = 0; b < size; b++) data |= (uint32_t)map[i + 1 + b] << (8 * b);
+        i += 1 + size;
+
+        switch (prefix & 0xFC) {
+            case ITEM_REPORT_SIZE: g.size = data; break;
+            case ITEM_REPORT_COUNT: g.count = data; break;
+            case ITEM_REPORT_ID: g.id = data; break;
+            case ITEM_PUSH:
+                if (depth >= GLOBAL_STACK) return -1;
+                stack[depth++] = g;
+                break;
+            case ITEM_POP:
+                if (depth == 0) return -1;
+                g = stack[--depth];
+                break;
+            default:
+                if ((prefix & 0xFC) == main_item && g.id == id) bits += g.size * g.count;
+                break;
+        }
+    }
+    return bits;
+}
+
+int hid_rpt_check_map(const uint8_t *map, uint16_t len, const hid_rpt_check_t *expected, uint8_t count,
+                      void (*mismatch)(const hid_rpt_check_t *rpt, int bits))
+{
+    int errors = 0;
+
+    for (uint8_t i = 0; i < count; i++) {
+        int bits = hid_rpt_check_bits(map, len, expected[i].id, expected[i].type);
+        //reports are padded to full bytes in the descriptor, so the bit count must match exactly
+        if (bits != expected[i].len * 8) {
+            errors++;
+            if (mismatch != NULL) mismatch(&expected[i], bits);
+        }
+    }
+    return errors;
+}
@@ -0,0 +1,60 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ */
+
+#ifndef _HID_RPT_CHECK_H_
+#define _HID_RPT_CHECK_H_
+
+#include <stdint.h>
+
+/** @brief Report types, same values as HID_REPORT_TYPE_* */
+#define HID_RPT_CHECK_INPUT     1
+#define HID_RPT_CHECK_OUTPUT    2
+#define HID_RPT_CHECK_FEATURE   3
+
+/** @brief Expected length of one report */
+typedef struct {
+    uint8_t id;      /// report ID
+    uint8_t type;    /// HID_RPT_CHECK_*
+    uint8_t len;     /// length in bytes (without report ID)
+    const char *name;
+} hid_rpt_check_t;
+
+/** @brief Get the size of a report as declared in a report map
+ *
+ * Sums up Report Size * Report Count of all main items of the given type
+ * with the given report ID (short items, Push/Pop are supported).
+ * @param map Report map
+ * @param len Length of the report map
+ * @param id Report ID
+ * @param type HID_RPT_CHECK_*
+ * @return Report size in bits, -1 if the report map cannot be parsed */
+int hid_rpt_check_bits(const uint8_t *map, uint16_t len, uint8_t id, uint8_t type);
+
+/** @brief Check the declared report sizes of a report map against the lengths used for sending
+ * @param map Report map
+ * @param len Length of the report map
+ * @param expected Reports sent by the firmware
+ * @param count Number of entries in expected
+ * @param mismatch Called for each mismatch (may be NULL), bits is -1 on parse errors
+ * @return Number of mismatches, 0 if everything matches */
+int hid_rpt_check_map(const uint8_t *map, uint16_t len, const hid_rpt_check_t *expected, uint8_t count,
+                      void (*mismatch)(const hid_rpt_check_t *rpt, int bits));
+
+#endif
@@ -0,0 +1,295 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ *
+ * Report statistics: latency from the first byte of a UART frame until
+ * esp_ble_gatts_send_indicate returns, as histogram per report ID.
+ * Per host counters for sent/rejected reports, congestion and connection parameters.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "hid_stats.h"
+
+static hid_stats_latency_t latency[HID_STATS_RPT_NUM];
+
+/** connection counters are updated from the BT task & the UART task */
+static hid_stats_conn_t conn[HID_STATS_CONN_NUM];
+static portMUX_TYPE conn_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/** frame currently processed; reports from other tasks (e.g. timers) are not accounted */
+static int64_t frame_start;
+static TaskHandle_t frame_task;
+
+void hid_stats_frame_begin(int64_t timestamp)
+{
+    frame_start = timestamp;
+    frame_task = xTaskGetCurrentTaskHandle();
+}
+
+void hid_stats_frame_end(void)
+{
+    frame_task = NULL;
+}
+
+static inline uint8_t latency_bucket(uint32_t us)
+{
+    uint32_t steps = us / HID_STATS_LAT_BUCKET0_US;
+    if (steps == 0) return 0;
+    uint8_t bucket = 32 - __builtin_clz(steps);
+    return bucket < HID_STATS_LAT_BUCKETS ? bucket : HID_STATS_LAT_BUCKETS - 1;
+}
+
+/** find a connected host; lock must be held */
+static hid_stats_conn_t *conn_by_id(uint16_t conn_id)
+{
+    for (uint8_t i = 0; i < HID_STATS_CONN_NUM; i++) {
+        if (conn[i].in_use && conn[i].connected && conn[i].conn_id == conn_id) return &conn[i];
+    }
+    return NULL;
+}
+
+/** find a host by address; lock must be held */
+static hid_stats_conn_t *conn_by_bda(const uint8_t *bda)
+{
+    for (uint8_t i = 0; i < HID_STATS_CONN_NUM; i++) {
+        if (conn[i].in_use && memcmp(conn[i].bda, bda, sizeof(conn[i].bda)) == 0) return &conn[i];
+    }
+    return NULL;
+}
+
+/** finish a congestion episode; lock must be held */
+static void conn_congest_end(hid_stats_conn_t *c, int64_t now)
+{
+    if (c->congest_start == 0) return;
+    c->congest_us += now - c->congest_start;
+    c->congest_start = 0;
+}
+
+void hid_stats_conn_open(uint16_t conn_id, const uint8_t *bda, uint16_t interval, uint16_t latency, uint16_t timeout)
+{
+    int64_t now = esp_timer_get_time();
+    hid_stats_conn_t *c;
+
+    portENTER_CRITICAL(&conn_lock);
+    c = conn_by_bda(bda);
+    if (c == NULL) {
+        //new host: take a free entry or replace the disconnected one seen least recently
+        for (uint8_t i = 0; i < HID_STATS_CONN_NUM; i++) {
+            if (!conn[i].in_use) { c = &conn[i]; break; }
+            if (conn[i].connected) continue;
+            if (c == NULL || conn[i].last_seen < c->last_seen) c = &conn[i];
+        }
+        if (c != NULL) {
+            memset(c, 0, sizeof(hid_stats_conn_t));
+            memcpy(c->bda, bda, sizeof(c->bda));
+            c->in_use = 1;
+        }
+    }
+    if (c != NULL) {
+        c->connected = 1;
+        c->conn_id = conn_id;
+        c->connects++;
+        c->congest_start = 0;
+        c->last_seen = now;
+        c->interval = interval;
+        c->latency = latency;
+        c->timeout = timeout;
+    }
+    portEXIT_CRITICAL(&conn_lock);
+}
+
+void hid_stats_conn_close(uint16_t conn_id)
+{
+    int64_t now = esp_timer_get_time();
+    hid_stats_conn_t *c;
+
+    portENTER_CRITICAL(&conn_lock);
+    if ((c = conn_by_id(conn_id)) != NULL) {
+        conn_congest_end(c, now);
+        c->connected = 0;
+        c->last_seen = now;
+    }
+    portEXIT_CRITICAL(&conn_lock);
+}
+
+void hid_stats_conn_congest(uint16_t conn_id, bool congested)
+{
+    int64_t now = esp_timer_get_time();
+    hid_stats_conn_t *c;
+
+    portENTER_CRITICAL(&conn_lock);
+    if ((c = conn_by_id(conn_id)) != NULL) {
+        if (congested && c->congest_start == 0) {
+            c->congest_start = now;
+            c->congest_cnt++;
+        } else if (!congested) {
+            conn_congest_end(c, now);
+        }
+    }
+    portEXIT_CRITICAL(&conn_lock);
+}
+
+void hid_stats_conn_params(const uint8_t *bda, uint16_t interval, uint16_t latency, uint16_t timeout)
+{
+    hid_stats_conn_t *c;
+
+    portENTER_CRITICAL(&conn_lock);
+    if ((c = conn_by_bda(bda)) != NULL) {
+        c->interval = interval;
+        c->latency = latency;
+        c->timeout = timeout;
+    }
+    portEXIT_CRITICAL(&conn_lock);
+}
+
+int hid_stats_format_conn(uint8_t index, char *buf, size_t len)
+{
+    hid_stats_conn_t c;
+    uint64_t congest_us;
+    int pos;
+
+    if (index >= HID_STATS_CONN_NUM) return 0;
+    portENTER_CRITICAL(&conn_lock);
+    c = conn[index];
+    portEXIT_CRITICAL(&conn_lock);
+    if (!c.in_use) return 0;
+
+    //include a running congestion episode
+    congest_us = c.congest_us;
+    if (c.congest_start != 0) congest_us += esp_timer_get_time() - c.congest_start;
+    pos = snprintf(buf, len, "SC:%02x%02x%02x%02x%02x%02x,%u,%lu,%lu,%lu,%lu,%u,%u,%u,%u\r\n",
+                   c.bda[0], c.bda[1], c.bda[2], c.bda[3], c.bda[4], c.bda[5], c.connected,
+                   (unsigned long)c.submitted, (unsigned long)c.rejected, (unsigned long)c.congest_cnt,
+                   (unsigned long)(congest_us / 1000), c.connects ? c.connects - 1 : 0,
+                   c.interval, c.latency, c.timeout);
+    return pos < (int)len ? pos : (int)len - 1;
+}
+
+esp_err_t hid_stats_get_conn(uint16_t conn_id, hid_stats_conn_t *out)
+{
+    hid_stats_conn_t *c;
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+
+    portENTER_CRITICAL(&conn_lock);
+    if ((c = conn_by_id(conn_id)) != NULL) {
+        *out = *c;
+        ret = ESP_OK;
+    }
+    portEXIT_CRITICAL(&conn_lock);
+    //include a running congestion episode
+    if (ret == ESP_OK && out->congest_start != 0) out->congest_us += esp_timer_get_time() - out->congest_start;
+    return ret;
+}
+
+void hid_stats_latency_add(hid_stats_latency_t *lat, uint32_t us)
+{
+    lat->count++;
+    lat->sum_us += us;
+    if (us > lat->max_us) lat->max_us = us;
+    lat->bucket[latency_bucket(us)]++;
+}
+
+uint32_t hid_stats_latency_percentile(const hid_stats_latency_t *lat, uint8_t percent)
+{
+    uint32_t target = ((uint64_t)lat->count * percent + 99) / 100;
+    uint32_t sum = 0;
+
+    if (lat->count == 0) return 0;
+    for (uint8_t i = 0; i < HID_STATS_LAT_BUCKETS - 1; i++) {
+        sum += lat->bucket[i];
+        if (sum >= target) {
+            uint32_t bound = HID_STATS_LAT_BUCKET0_US << i;
+            return bound < lat->max_us ? bound : lat->max_us;
+        }
+    }
+    return lat->max_us;
+}
+
+void hid_stats_report_sent(uint16_t conn_id, uint8_t id, esp_err_t result)
+{
+    hid_stats_conn_t *c;
+    uint32_t us;
+
+    portENTER_CRITICAL(&conn_lock);
+    if ((c = conn_by_id(conn_id)) != NULL) {
+        c->submitted++;
+        if (result != ESP_OK) c->rejected++;
+    }
+    portEXIT_CRITICAL(&conn_lock);
+
+    if (frame_task == NULL || frame_task != xTaskGetCurrentTaskHandle()) return;
+    if (id >= HID_STATS_RPT_NUM || result != ESP_OK) return;
+
+    us = esp_timer_get_time() - frame_start;
+    hid_stats_latency_add(&latency[id], us);
+}
+
+void hid_stats_report_failed(uint16_t conn_id)
+{
+    hid_stats_conn_t *c;
+
+    portENTER_CRITICAL(&conn_lock);
+    if ((c = conn_by_id(conn_id)) != NULL) c->rejected++;
+    portEXIT_CRITICAL(&conn_lock);
+}
+
+const hid_stats_latency_t *hid_stats_get_latency(uint8_t id)
+{
+    if (id >= HID_STATS_RPT_NUM) return NULL;
+    return &latency[id];
+}
+
+int hid_stats_format_latency(uint8_t id, char *buf, size_t len)
+{
+    const hid_stats_latency_t *lat = hid_stats_get_latency(id);
+    int pos;
+
+    if (lat == NULL || lat->count == 0) return 0;
+    pos = snprintf(buf, len, "ST:%u,%lu,%lu,%lu", id, (unsigned long)lat->count,
+                   (unsigned long)(lat->sum_us / lat->count), (unsigned long)lat->max_us);
+    for (uint8_t i = 0; i < HID_STATS_LAT_BUCKETS && pos < (int)len; i++) {
+        pos += snprintf(&buf[pos], len - pos, ",%lu", (unsigned long)lat->bucket[i]);
+    }
+    if (pos < (int)len) pos += snprintf(&buf[pos], len - pos, "\r\n");
+    return pos < (int)len ? pos : (int)len - 1;
+}
+
+void hid_stats_reset(void)
+{
+    int64_t now = esp_timer_get_time();
+
+    memset(latency, 0, sizeof(latency));
+    portENTER_CRITICAL(&conn_lock);
+    for (uint8_t i = 0; i < HID_STATS_CONN_NUM; i++) {
+        if (!conn[i].connected) {
+            memset(&conn[i], 0, sizeof(hid_stats_conn_t));
+            continue;
+        }
+        conn[i].connects = 1;
+        conn[i].submitted = 0;
+        conn[i].rejected = 0;
+        conn[i].congest_cnt = 0;
+        conn[i].congest_us = 0;
+        if (conn[i].congest_start != 0) conn[i].congest_start = now;
+    }
+    portEXIT_CRITICAL(&conn_lock);
+}
@@ -0,0 +1,128 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ */
+
+#ifndef _HID_STATS_H_
+#define _HID_STATS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/// Number of tracked report IDs (report ID is used as index)
+#define HID_STATS_RPT_NUM          8
+/// Number of latency histogram buckets. Bucket 0: <125us, bucket n: <(125us << n), last bucket: everything above
+#define HID_STATS_LAT_BUCKETS      12
+/// Upper bound of the first latency bucket in us
+#define HID_STATS_LAT_BUCKET0_US   125
+
+/// Number of hosts tracked by the connection statistics (connected & recently disconnected)
+#define HID_STATS_CONN_NUM         8
+
+/** @brief Counters of one host, kept across reconnects */
+typedef struct {
+    uint8_t bda[6];
+    uint8_t in_use;
+    uint8_t connected;
+    uint16_t conn_id;
+    uint16_t connects;       /// number of connections; reconnects = connects - 1
+    uint32_t submitted;      /// reports passed to esp_ble_gatts_send_indicate
+    uint32_t rejected;       /// reports not accepted by esp_ble_gatts_send_indicate or failed later (ESP_GATTS_CONF_EVT)
+    uint32_t congest_cnt;    /// congestion episodes
+    uint64_t congest_us;     /// total time spent congested (finished episodes)
+    int64_t congest_start;   /// start of current congestion episode, 0 if not congested
+    int64_t last_seen;       /// last connect/disconnect, oldest entry is replaced first
+    uint16_t interval;       /// granted connection interval (1.25ms units)
+    uint16_t latency;        /// granted slave latency
+    uint16_t timeout;        /// granted supervision timeout (10ms units)
+} hid_stats_conn_t;
+
+/** @brief Latency statistics for one report ID (UART frame start to BLE notification) */
+typedef struct {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint32_t bucket[HID_STATS_LAT_BUCKETS];
+} hid_stats_latency_t;
+
+/** @brief Start of a UART frame is being processed.
+ * @param timestamp esp_timer timestamp of the first byte of this frame
+ * @note Reports sent by the calling task until hid_stats_frame_end are accounted to this frame. */
+void hid_stats_frame_begin(int64_t timestamp);
+
+/** @brief Processing of the current UART frame is finished */
+void hid_stats_frame_end(void);
+
+/** @brief A report was passed to the BLE stack
+ * @param conn_id Connection ID
+ * @param id Report ID
+ * @param result Return value of esp_ble_gatts_send_indicate */
+void hid_stats_report_sent(uint16_t conn_id, uint8_t id, esp_err_t result);
+
+/** @brief A report accepted by esp_ble_gatts_send_indicate was not sent (ESP_GATTS_CONF_EVT with an error),
+ * it is counted as rejected */
+void hid_stats_report_failed(uint16_t conn_id);
+
+/** @brief Get the latency statistics of one report ID
+ * @return Statistics or NULL if id is out of range */
+const hid_stats_latency_t *hid_stats_get_latency(uint8_t id);
+
+/** @brief Format the latency statistics of one report ID as one line
+ * Format: "ST:<id>,<count>,<avg us>,<max us>,<bucket 0>,...,<bucket n>\r\n"
+ * @return Length of the line, 0 if there are no samples for this ID */
+int hid_stats_format_latency(uint8_t id, char *buf, size_t len);
+
+/** @brief A host connected
+ * @param conn_id Connection ID
+ * @param bda Address of the host
+ * @param interval,latency,timeout Initial connection parameters */
+void hid_stats_conn_open(uint16_t conn_id, const uint8_t *bda, uint16_t interval, uint16_t latency, uint16_t timeout);
+
+/** @brief A host disconnected */
+void hid_stats_conn_close(uint16_t conn_id);
+
+/** @brief Congestion state of a connection changed */
+void hid_stats_conn_congest(uint16_t conn_id, bool congested);
+
+/** @brief Connection parameters were granted (GAP connection parameter update) */
+void hid_stats_conn_params(const uint8_t *bda, uint16_t interval, uint16_t latency, uint16_t timeout);
+
+/** @brief Get a copy of the counters of a connected host
+ * @return ESP_OK or ESP_ERR_NOT_FOUND if conn_id is not connected */
+esp_err_t hid_stats_get_conn(uint16_t conn_id, hid_stats_conn_t *out);
+
+/** @brief Add one latency sample to a latency statistics structure */
+void hid_stats_latency_add(hid_stats_latency_t *lat, uint32_t us);
+
+/** @brief Get a latency percentile from the histogram
+ * @param percent Percentile, 1-100
+ * @return Upper bound of the histogram bucket containing the percentile in us (max. latency for the last bucket) */
+uint32_t hid_stats_latency_percentile(const hid_stats_latency_t *lat, uint8_t percent);
+
+/** @brief Format the counters of one tracked host as one line
+ * Format: "SC:<addr>,<connected>,<submitted>,<rejected>,<congestions>,<congested ms>,<reconnects>,<interval>,<latency>,<timeout>\r\n"
+ * @param index Index of the entry, 0 to HID_STATS_CONN_NUM-1
+ * @return Length of the line, 0 if this entry is not used */
+int hid_stats_format_conn(uint8_t index, char *buf, size_t len);
+
+/** @brief Clear all latency statistics & connection counters (connected hosts are kept) */
+void hid_stats_reset(void);
+
+#endif
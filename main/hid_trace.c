@@ -0,0 +1,95 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ *
+ * Binary event trace in RAM. Unlike logging, adding an entry costs only
+ * a few us and does not use the UART, so timing is not changed.
+ */
+
+#include "hid_trace.h"
+
+#if CONFIG_MODULE_TRACE
+
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "driver/uart.h"
+
+static hid_trace_entry_t trace_ring[CONFIG_MODULE_TRACE_ENTRIES];
+/** next entry to write */
+static uint16_t trace_head;
+/** number of valid entries */
+static uint16_t trace_count;
+/** recording is paused while dumping */
+static volatile uint8_t trace_paused;
+static portMUX_TYPE trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void hid_trace_add(uint8_t type, uint8_t a8, uint16_t a16)
+{
+    uint32_t now = (uint32_t)esp_timer_get_time();
+
+    if (trace_paused) return;
+    portENTER_CRITICAL(&trace_lock);
+    hid_trace_entry_t *e = &trace_ring[trace_head];
+    e->timestamp = now;
+    e->type = type;
+    e->a8 = a8;
+    e->a16 = a16;
+    if (++trace_head >= CONFIG_MODULE_TRACE_ENTRIES) trace_head = 0;
+    if (trace_count < CONFIG_MODULE_TRACE_ENTRIES) trace_count++;
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+void hid_trace_clear(void)
+{
+    portENTER_CRITICAL(&trace_lock);
+    trace_head = 0;
+    trace_count = 0;
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+void hid_trace_dump(int uart_num)
+{
+    char header[24];
+    uint16_t start, count;
+    int len;
+
+    trace_paused = 1;
+    portENTER_CRITICAL(&trace_lock);
+    count = trace_count;
+    start = (trace_head + CONFIG_MODULE_TRACE_ENTRIES - count) % CONFIG_MODULE_TRACE_ENTRIES;
+    portEXIT_CRITICAL(&trace_lock);
+
+    len = snprintf(header, sizeof(header), "TR:%u,%u\r\n", count, (unsigned)sizeof(hid_trace_entry_t));
+    uart_write_bytes(uart_num, header, len);
+    //ring is not modified while paused, write the (up to) two consecutive parts
+    if (start + count > CONFIG_MODULE_TRACE_ENTRIES) {
+        uart_write_bytes(uart_num, (const char *)&trace_ring[start],
+                         (CONFIG_MODULE_TRACE_ENTRIES - start) * sizeof(hid_trace_entry_t));
+        uart_write_bytes(uart_num, (const char *)&trace_ring[0],
+                         (start + count - CONFIG_MODULE_TRACE_ENTRIES) * sizeof(hid_trace_entry_t));
+    } else {
+        uart_write_bytes(uart_num, (const char *)&trace_ring[start], count * sizeof(hid_trace_entry_t));
+    }
+    uart_write_bytes(uart_num, "\r\nEND\r\n", 7);
+
+    hid_trace_clear();
+    trace_paused = 0;
+}
+
+#endif
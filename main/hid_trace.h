@@ -0,0 +1,78 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ */
+
+#ifndef _HID_TRACE_H_
+#define _HID_TRACE_H_
+
+#include <stdint.h>
+#include "sdkconfig.h"
+
+/** @brief Trace event types.
+ * @note Keep in sync with tools/trace_decode.py */
+typedef enum {
+    HID_TRACE_FRAME_START = 1,  /// 0xFD received; a16: -
+    HID_TRACE_FRAME_DONE,       /// raw frame processed; a8: frame type
+    HID_TRACE_CMD,              /// ASCII command processed; a16: first 2 characters
+    HID_TRACE_REPORT,           /// report passed to BLE stack; a8: report ID, a16: conn_id, bit 15 set if rejected
+    HID_TRACE_CONGEST,          /// congestion changed; a8: congested, a16: conn_id
+    HID_TRACE_GAP,              /// GAP event; a8: event, a16: scan results since the last traced one (sampled, see HID_TRACE_SCAN_SAMPLE)
+    HID_TRACE_GATTS,            /// GATTS event; a8: event, a16: conn_id (0xFFFF if the event has none)
+    HID_TRACE_TASK_WAKE,        /// task woke up from a blocking call; a8: HID_TRACE_TASK_*
+} hid_trace_evt_t;
+
+/// Only every n-th GAP scan result is traced, they arrive in bursts while scanning
+#define HID_TRACE_SCAN_SAMPLE   64
+
+/// Task identifiers for HID_TRACE_TASK_WAKE (the UART task is traced by HID_TRACE_FRAME_START & HID_TRACE_CMD)
+#define HID_TRACE_TASK_CONSOLE  1
+#define HID_TRACE_TASK_TIMER    2
+
+/** @brief One trace entry, 8 bytes, little endian when dumped */
+typedef struct __attribute__((packed)) {
+    uint32_t timestamp;  /// lower 32bit of esp_timer_get_time() (us)
+    uint8_t type;        /// hid_trace_evt_t
+    uint8_t a8;
+    uint16_t a16;
+} hid_trace_entry_t;
+
+#if CONFIG_MODULE_TRACE
+
+/** @brief Add an entry to the trace ring (oldest entry is overwritten) */
+void hid_trace_add(uint8_t type, uint8_t a8, uint16_t a16);
+
+/** @brief Dump the trace ring via the given UART and clear it afterwards
+ *
+ * Format: "TR:<number of entries>,<entry size>\r\n", entries as raw binary
+ * (oldest first), "\r\nEND\r\n". Recording is paused while dumping.
+ * Use tools/trace_decode.py to convert the dump to a readable timeline. */
+void hid_trace_dump(int uart_num);
+
+/** @brief Clear the trace ring */
+void hid_trace_clear(void);
+
+#define HID_TRACE(type, a8, a16) hid_trace_add((type), (a8), (a16))
+
+#else
+
+#define HID_TRACE(type, a8, a16) do { } while (0)
+
+#endif
+
+#endif
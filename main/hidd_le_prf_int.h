@@ -41,11 +41,14 @@
 
 #define HID_MAX_APPS                 1
 
-// Number of HID reports defined in the service
+/// Maximal number of simultaneous HID connections tracked by the profile
+#define HIDD_LE_MAX_CONN             CONFIG_BT_ACL_CONNECTIONS
+
+// Maximum number of HID reports in the report ID map (report & boot mode characteristics)
 #if CONFIG_MODULE_USEJOYSTICK
-  #define HID_NUM_REPORTS          10
+  #define HID_NUM_REPORTS          11
 #else
-  #define HID_NUM_REPORTS          9
+  #define HID_NUM_REPORTS          10
 #endif
 
 // HID Report IDs for the service
@@ -53,8 +56,9 @@
 #define HID_RPT_ID_CC_IN         2   // Consumer Control input report ID
 #define HID_RPT_ID_MOUSE_IN      3   // Mouse input report ID
 #define HID_RPT_ID_JOY_IN        4   // Joystick input report ID
+#define HID_RPT_ID_CC_EXT_IN     5   // Extended consumer control input report ID (16bit usage)
 #define HID_RPT_ID_LED_OUT       1  // LED output report ID
-#define HID_RPT_ID_FEATURE       0  // Feature report ID
+#define HID_RPT_ID_FEATURE       6  // Feature report ID (mouse resolution multiplier)
 
 #define HIDD_APP_ID			0x1812//ATT_SVC_HID
 
@@ -73,6 +77,16 @@
 
 /// Length of Boot Report Char. Value Maximal Length
 #define HIDD_LE_BOOT_REPORT_MAX_LEN           (8)
+/// Length of the boot keyboard input report (modifier, reserved, 6 keycodes)
+#define HIDD_LE_BOOT_KB_IN_RPT_LEN            (8)
+/// Length of the mouse feature report (resolution multiplier for wheel & pan)
+#define HIDD_LE_MOUSE_FEATURE_RPT_LEN         (1)
+/// Mouse feature report: wheel resolution multiplier (bits 0-1) & pan resolution multiplier (bits 2-3)
+#define HIDD_LE_RES_MULT_WHEEL                (0x03)
+#define HIDD_LE_RES_MULT_PAN                  (0x0C)
+
+/// Length of the boot mouse input report (buttons, X, Y)
+#define HIDD_LE_BOOT_MOUSE_IN_RPT_LEN         (3)
 
 /// Boot KB Input Report Notification Configuration Bit Mask
 #define HIDD_LE_BOOT_KB_IN_NTF_CFG_MASK       (0x40)
@@ -162,6 +176,12 @@ enum {
     HIDD_LE_IDX_REPORT_CC_IN_VAL,
     HIDD_LE_IDX_REPORT_CC_IN_CCC,
     HIDD_LE_IDX_REPORT_CC_IN_REP_REF,
+
+    //Report extended consumer control input (16bit usage)
+    HIDD_LE_IDX_REPORT_CC_EXT_IN_CHAR,
+    HIDD_LE_IDX_REPORT_CC_EXT_IN_VAL,
+    HIDD_LE_IDX_REPORT_CC_EXT_IN_CCC,
+    HIDD_LE_IDX_REPORT_CC_EXT_IN_REP_REF,
     
     // Boot Keyboard Input Report
     HIDD_LE_IDX_BOOT_KB_IN_REPORT_CHAR,
@@ -211,6 +231,11 @@ typedef struct {
     esp_bd_addr_t         remote_bda;
     uint32_t                  trans_id;
     uint8_t                    cur_srvc_id;
+    uint8_t                    proto_mode;     // Protocol mode of this connection (report or boot)
+    uint16_t                  conn_interval;  // Current connection interval (in 1.25ms units)
+    uint8_t                    res_multiplier; // Mouse feature report written by the host (HIDD_LE_RES_MULT_*)
+    int16_t                   wheel_rem;      // Wheel fraction not sent yet (without resolution multiplier)
+    int16_t                   pan_rem;        // Pan fraction not sent yet (without resolution multiplier)
 
 } hidd_clcb_t;
 
@@ -264,7 +289,8 @@ typedef struct
 
 /* service engine control block */
 typedef struct {
-    hidd_clcb_t                  hidd_clcb[HID_MAX_APPS];          /* connection link*/
+    hidd_clcb_t                  hidd_clcb[HIDD_LE_MAX_CONN];      /* connection link*/
+    uint8_t                      boot_mode_cnt;                    /* number of connections in boot protocol mode */
     esp_gatt_if_t                gatt_if;
     bool                         enabled;
     bool                         is_take;
@@ -282,6 +308,19 @@ void hidd_clcb_alloc (uint16_t conn_id, esp_bd_addr_t bda);
 
 bool hidd_clcb_dealloc (uint16_t conn_id);
 
+/** @brief Stop a pending consumer tap release of a connection slot (on disconnect) */
+void hidd_consumer_tap_cancel(uint8_t slot);
+
+hidd_clcb_t *hidd_clcb_find (uint16_t conn_id);
+
+void hidd_set_proto_mode(uint16_t conn_id, uint8_t mode);
+
+uint8_t hidd_get_proto_mode(uint16_t conn_id);
+
+void hidd_set_conn_interval(esp_bd_addr_t bda, uint16_t interval);
+
+void hidd_set_res_multiplier(uint16_t conn_id, uint8_t value);
+
 void hidd_le_create_service(esp_gatt_if_t gatts_if);
 
 void hidd_set_attr_value(uint16_t handle, uint16_t val_len, const uint8_t *value);
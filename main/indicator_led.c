@@ -0,0 +1,134 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ *
+ * Indicator LED, blinked by the LEDC peripheral: the pattern is only changed on
+ * events (connect, disconnect, congestion, pairing mode,...), there is no task.
+ */
+
+#include "indicator_led.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "driver/ledc.h"
+#include "esp_log.h"
+
+#define INDICATOR_LED_TAG "LED"
+
+#define LED_MODE        LEDC_LOW_SPEED_MODE
+#define LED_TIMER       LEDC_TIMER_0
+#define LED_CHANNEL     LEDC_CHANNEL_0
+#define LED_RES_BITS    12
+#define LED_DUTY_MAX    (1 << LED_RES_BITS)
+
+typedef struct {
+    uint16_t period_ms;     /// 0: steady (on_ms 0: off, otherwise on)
+    uint16_t on_ms;
+} led_pattern_t;
+
+static const led_pattern_t patterns[INDICATOR_LED_NUM] = {
+    [INDICATOR_LED_OFF] = { 0, 0 },
+    [INDICATOR_LED_ON] = { 0, 1 },
+    [INDICATOR_LED_ADVERTISING] = { 500, 250 },
+    [INDICATOR_LED_PAIRING] = { 200, 100 },
+    [INDICATOR_LED_CONNECTED] = { 2000, 1000 },
+    [INDICATOR_LED_CONGESTED] = { 500, 50 },
+    [INDICATOR_LED_UPDATE] = { 0, 1 },
+};
+
+static SemaphoreHandle_t led_lock = NULL;
+static StaticSemaphore_t led_lock_buf;
+static indicator_led_pattern_t current = INDICATOR_LED_NUM;
+
+/** @brief Set the LEDC timer to the pattern period */
+static esp_err_t led_set_period(uint16_t period_ms)
+{
+#if SOC_LEDC_SUPPORT_REF_TICK
+    //ledc_set_freq cannot go below 1Hz: set the divider directly.
+    //REF_TICK (1MHz) / (divider * 2^12), divider in Q10.8: periods of 5ms .. 4.1s
+    uint32_t div = (uint32_t)period_ms * 62500UL / 1000UL;
+    return ledc_timer_set(LED_MODE, LED_TIMER, div, LED_RES_BITS, LEDC_REF_TICK);
+#else
+    //no slow clock available, round to full Hz
+    uint32_t freq = (1000 + period_ms / 2) / period_ms;
+    return ledc_set_freq(LED_MODE, LED_TIMER, freq ? freq : 1);
+#endif
+}
+
+static esp_err_t led_apply(const led_pattern_t *p)
+{
+    esp_err_t ret = ESP_OK;
+    uint32_t duty;
+
+    if (p->period_ms == 0) {
+        duty = p->on_ms ? LED_DUTY_MAX : 0;
+    } else {
+        ret = led_set_period(p->period_ms);
+        duty = (uint32_t)p->on_ms * LED_DUTY_MAX / p->period_ms;
+    }
+    if (ret == ESP_OK) ret = ledc_set_duty(LED_MODE, LED_CHANNEL, duty);
+    if (ret == ESP_OK) ret = ledc_update_duty(LED_MODE, LED_CHANNEL);
+    return ret;
+}
+
+esp_err_t indicator_led_init(int gpio, uint8_t active_low)
+{
+    esp_err_t ret;
+    ledc_timer_config_t timer = {
+        .speed_mode = LED_MODE,
+        .duty_resolution = LED_RES_BITS,
+        .timer_num = LED_TIMER,
+        .freq_hz = 2,
+#if SOC_LEDC_SUPPORT_REF_TICK
+        .clk_cfg = LEDC_USE_REF_TICK,
+#else
+        .clk_cfg = LEDC_AUTO_CLK,
+#endif
+    };
+    ledc_channel_config_t channel = {
+        .gpio_num = gpio,
+        .speed_mode = LED_MODE,
+        .channel = LED_CHANNEL,
+        .intr_type = LEDC_INTR_DISABLE,
+        .timer_sel = LED_TIMER,
+        .duty = 0,
+        .hpoint = 0,
+        .flags.output_invert = active_low ? 1 : 0,
+    };
+
+    if (gpio < 0) return ESP_ERR_INVALID_ARG;
+    led_lock = xSemaphoreCreateMutexStatic(&led_lock_buf);
+    if ((ret = ledc_timer_config(&timer)) != ESP_OK || (ret = ledc_channel_config(&channel)) != ESP_OK) {
+        ESP_LOGE(INDICATOR_LED_TAG, "cannot configure LEDC: %s", esp_err_to_name(ret));
+        led_lock = NULL;
+        return ret;
+    }
+    indicator_led_set(INDICATOR_LED_ADVERTISING);
+    return ESP_OK;
+}
+
+void indicator_led_set(indicator_led_pattern_t pattern)
+{
+    if (led_lock == NULL || pattern >= INDICATOR_LED_NUM) return;
+    xSemaphoreTake(led_lock, portMAX_DELAY);
+    if (pattern != current) {
+        if (led_apply(&patterns[pattern]) == ESP_OK) current = pattern;
+        else ESP_LOGW(INDICATOR_LED_TAG, "cannot set pattern %d", pattern);
+    }
+    xSemaphoreGive(led_lock);
+}
@@ -0,0 +1,48 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ */
+
+#ifndef _INDICATOR_LED_H_
+#define _INDICATOR_LED_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+
+/** @brief LED patterns, generated by the LEDC peripheral without CPU wakeups */
+typedef enum {
+    INDICATOR_LED_OFF = 0,
+    INDICATOR_LED_ON,
+    INDICATOR_LED_ADVERTISING,  /// 250ms on, 250ms off: no host connected
+    INDICATOR_LED_PAIRING,      /// 100ms on, 100ms off: no host connected & pairing enabled ($PM1)
+    INDICATOR_LED_CONNECTED,    /// 1s on, 1s off: at least one host connected
+    INDICATOR_LED_CONGESTED,    /// 50ms on, 450ms off: a connection is congested
+    INDICATOR_LED_UPDATE,       /// steady on: restarting into the factory partition ($UG)
+    INDICATOR_LED_NUM,
+} indicator_led_pattern_t;
+
+/** @brief Attach the LED to a LEDC channel, starts with INDICATOR_LED_ADVERTISING
+ * @param gpio LED pin, no LED if < 0
+ * @param active_low LED is on at low level
+ * @return ESP_OK, ESP_ERR_INVALID_ARG without LED or a LEDC error */
+esp_err_t indicator_led_init(int gpio, uint8_t active_low);
+
+/** @brief Change the pattern (no effect if it is already shown or without LED) */
+void indicator_led_set(indicator_led_pattern_t pattern);
+
+#endif
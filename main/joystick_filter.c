@@ -0,0 +1,200 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ *
+ * Deadzone, hysteresis and rate limiting for joystick reports received via UART.
+ * Upstream analog sensors tend to change by one LSB on nearly every frame,
+ * which would cost one BLE notification per frame without this filter.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_hidd_prf_api.h"
+#include "joystick_filter.h"
+#include "hid_trace.h"
+
+#define JOY_FILTER_TAG "JOY_FILTER"
+
+#ifndef CONFIG_MODULE_JOYSTICK_DEADZONE
+#define CONFIG_MODULE_JOYSTICK_DEADZONE 0
+#endif
+#ifndef CONFIG_MODULE_JOYSTICK_HYSTERESIS
+#define CONFIG_MODULE_JOYSTICK_HYSTERESIS 1
+#endif
+#ifndef CONFIG_MODULE_JOYSTICK_MAX_RATE
+#define CONFIG_MODULE_JOYSTICK_MAX_RATE 100
+#endif
+
+/** 8bit report: 6 axes; 16bit report: 6 axes & 2 triggers */
+#define JOY_AXES_NARROW 6
+#define JOY_AXES_WIDE   8
+
+static struct {
+    joystick_filter_send_t send;
+    SemaphoreHandle_t lock;
+    esp_timer_handle_t timer;
+    uint16_t deadzone;
+    uint16_t hysteresis;
+    /** minimum time between two axis-only reports, 0 if not limited */
+    int64_t min_interval;
+    /** last report passed to send, invalid after reset */
+    uint8_t last[HID_JOYSTICK_HIRES_IN_RPT_LEN];
+    uint8_t last_wide;
+    uint8_t last_valid;
+    int64_t last_time;
+    /** report waiting for the rate limit timer */
+    uint8_t pending[HID_JOYSTICK_HIRES_IN_RPT_LEN];
+    uint8_t pending_wide;
+    uint8_t pending_valid;
+} joy;
+
+static inline uint8_t joy_len(uint8_t wide)
+{
+    return wide ? HID_JOYSTICK_HIRES_IN_RPT_LEN : HID_JOYSTICK_IN_RPT_LEN;
+}
+
+static inline int32_t joy_get_axis(const uint8_t *report, uint8_t wide, uint8_t axis)
+{
+    if (wide) return (int16_t)(report[axis*2] | (report[axis*2+1] << 8));
+    return (int8_t)report[axis];
+}
+
+static inline void joy_set_axis(uint8_t *report, uint8_t wide, uint8_t axis, int32_t value)
+{
+    if (wide) {
+        report[axis*2] = value & 0xFF;
+        report[axis*2+1] = (value >> 8) & 0xFF;
+    } else {
+        report[axis] = (uint8_t)(int8_t)value;
+    }
+}
+
+/** send & remember a report; lock must be held */
+static void joy_send(const uint8_t *report, uint8_t wide)
+{
+    memcpy(joy.last, report, joy_len(wide));
+    joy.last_wide = wide;
+    joy.last_valid = 1;
+    joy.last_time = esp_timer_get_time();
+    joy.pending_valid = 0;
+    if (joy.send) joy.send(joy.last, wide);
+}
+
+/** rate limit interval has passed, send latest pending report */
+static void joy_timer_cb(void *arg)
+{
+    HID_TRACE(HID_TRACE_TASK_WAKE, HID_TRACE_TASK_TIMER, 0);
+    xSemaphoreTake(joy.lock, portMAX_DELAY);
+    if (joy.pending_valid) joy_send(joy.pending, joy.pending_wide);
+    xSemaphoreGive(joy.lock);
+}
+
+esp_err_t joystick_filter_init(joystick_filter_send_t send)
+{
+    const esp_timer_create_args_t timer_args = {
+        .callback = &joy_timer_cb,
+        .name = "JOYrate"
+    };
+
+    memset(&joy, 0, sizeof(joy));
+    joy.send = send;
+    joy.lock = xSemaphoreCreateMutex();
+    if (joy.lock == NULL) return ESP_ERR_NO_MEM;
+    joystick_filter_set_params(CONFIG_MODULE_JOYSTICK_DEADZONE, CONFIG_MODULE_JOYSTICK_HYSTERESIS,
+                               CONFIG_MODULE_JOYSTICK_MAX_RATE);
+    return esp_timer_create(&timer_args, &joy.timer);
+}
+
+void joystick_filter_set_params(uint16_t deadzone, uint16_t hysteresis, uint16_t max_rate)
+{
+    joy.deadzone = deadzone;
+    joy.hysteresis = hysteresis;
+    joy.min_interval = max_rate ? (1000000 / max_rate) : 0;
+    ESP_LOGI(JOY_FILTER_TAG, "deadzone: %d, hysteresis: %d, max. rate: %dHz", deadzone, hysteresis, max_rate);
+}
+
+void joystick_filter_get_params(uint16_t *deadzone, uint16_t *hysteresis, uint16_t *max_rate)
+{
+    if (deadzone) *deadzone = joy.deadzone;
+    if (hysteresis) *hysteresis = joy.hysteresis;
+    if (max_rate) *max_rate = joy.min_interval ? (1000000 / joy.min_interval) : 0;
+}
+
+void joystick_filter_reset(void)
+{
+    if (joy.lock == NULL) return;
+    xSemaphoreTake(joy.lock, portMAX_DELAY);
+    joy.last_valid = 0;
+    xSemaphoreGive(joy.lock);
+}
+
+void joystick_filter_submit(const uint8_t *report, uint8_t wide)
+{
+    uint8_t filtered[HID_JOYSTICK_HIRES_IN_RPT_LEN];
+    uint8_t len = joy_len(wide);
+    uint8_t axes = wide ? JOY_AXES_WIDE : JOY_AXES_NARROW;
+    //hat & buttons follow the axes
+    uint8_t btn_offset = len - 5;
+    int64_t now;
+
+    if (joy.lock == NULL) return;
+    xSemaphoreTake(joy.lock, portMAX_DELAY);
+
+    memcpy(filtered, report, len);
+    //a change of the report format always invalidates the last report
+    uint8_t compare = joy.last_valid && joy.last_wide == wide;
+
+    for (uint8_t i = 0; i < axes; i++) {
+        int32_t value = joy_get_axis(report, wide, i);
+        if (abs(value) <= joy.deadzone) value = 0;
+        if (compare) {
+            int32_t last = joy_get_axis(joy.last, wide, i);
+            //hysteresis: keep the last sent value for small changes, but always allow returning to center
+            if (value != 0 && abs(value - last) <= joy.hysteresis) value = last;
+        }
+        joy_set_axis(filtered, wide, i, value);
+    }
+
+    if (compare && memcmp(filtered, joy.last, len) == 0) {
+        //nothing changed, a pending report (if any) is outdated
+        joy.pending_valid = 0;
+        xSemaphoreGive(joy.lock);
+        return;
+    }
+
+    now = esp_timer_get_time();
+    if (!compare || memcmp(&filtered[btn_offset], &joy.last[btn_offset], 5) != 0 ||
+        joy.min_interval == 0 || (now - joy.last_time) >= joy.min_interval) {
+        //button/hat changes or enough time passed: send immediately
+        esp_timer_stop(joy.timer);
+        joy_send(filtered, wide);
+    } else {
+        //rate limited: store the latest report, timer sends it at the end of the interval
+        memcpy(joy.pending, filtered, len);
+        joy.pending_wide = wide;
+        joy.pending_valid = 1;
+        if (!esp_timer_is_active(joy.timer)) {
+            esp_timer_start_once(joy.timer, joy.min_interval - (now - joy.last_time));
+        }
+    }
+    xSemaphoreGive(joy.lock);
+}
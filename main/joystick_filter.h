@@ -0,0 +1,59 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ */
+
+#ifndef _JOYSTICK_FILTER_H_
+#define _JOYSTICK_FILTER_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+
+/** @brief Callback for sending a filtered joystick report to the hosts
+ * @param report Joystick report, HID_JOYSTICK_IN_RPT_LEN or HID_JOYSTICK_HIRES_IN_RPT_LEN bytes
+ * @param wide 0 for an 8bit report, 1 for a 16bit report */
+typedef void (*joystick_filter_send_t)(uint8_t *report, uint8_t wide);
+
+/** @brief Initialize the joystick filter with the Kconfig defaults
+ * @param send Function which is called for each report that passes the filter */
+esp_err_t joystick_filter_init(joystick_filter_send_t send);
+
+/** @brief Set the filter parameters
+ * @param deadzone Axis values within +/- deadzone around center are sent as 0
+ * @param hysteresis Axis changes smaller or equal than this value are suppressed
+ * @param max_rate Maximum rate of axis-only updates in Hz, 0 disables rate limiting
+ * @note deadzone & hysteresis are given in steps of the received report (8bit or 16bit) */
+void joystick_filter_set_params(uint16_t deadzone, uint16_t hysteresis, uint16_t max_rate);
+
+/** @brief Get the current filter parameters (see joystick_filter_set_params) */
+void joystick_filter_get_params(uint16_t *deadzone, uint16_t *hysteresis, uint16_t *max_rate);
+
+/** @brief Submit a joystick report from the UART
+ *
+ * Unchanged reports are dropped. Button or hat changes are sent immediately,
+ * axis-only changes are limited to max_rate; the latest pending report is sent
+ * when the rate limit interval has passed (latest value wins).
+ * @param report Joystick report, HID_JOYSTICK_IN_RPT_LEN or HID_JOYSTICK_HIRES_IN_RPT_LEN bytes
+ * @param wide 0 for an 8bit report, 1 for a 16bit report */
+void joystick_filter_submit(const uint8_t *report, uint8_t wide);
+
+/** @brief Forget the last sent report, the next submitted report is sent in any case.
+ * @note Used on new connections, so a new host receives the current state. */
+void joystick_filter_reset(void);
+
+#endif
@@ -0,0 +1,198 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ *
+ * Chunked binary transfer of large key/value payloads ($BW, $BD, $BR): the
+ * chunks are collected in RAM, checked by CRC and stored as one NVS blob.
+ * Transfers can be resumed after a failed chunk, $BW returns the offset.
+ */
+
+#include "kv_bulk.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "driver/uart.h"
+#include "kv_cache.h"
+
+#define KV_BULK_TAG "BULK"
+
+static nvs_handle_t bulk_nvs;
+
+/** @brief Pending blob write */
+static struct {
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    uint8_t *data;          /// NULL if no transfer is pending
+    uint32_t size;
+    uint32_t crc;
+    uint32_t received;      /// continuous bytes from offset 0
+} blob;
+
+/** @brief Current chunk */
+static struct {
+    esp_err_t error;        /// returned by kv_bulk_chunk_end, the payload is dropped if != ESP_OK
+    uint32_t offset;
+    uint32_t len;
+    uint32_t pos;
+    uint32_t crc;           /// expected
+    uint32_t crc_calc;      /// running
+} chunk;
+
+void kv_bulk_init(nvs_handle_t h)
+{
+    bulk_nvs = h;
+    chunk.error = ESP_ERR_INVALID_STATE;
+}
+
+void kv_bulk_abort(void)
+{
+    free(blob.data);
+    blob.data = NULL;
+    chunk.error = ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t kv_bulk_begin(const char *key, uint32_t size, uint32_t crc, uint32_t *offset)
+{
+    if (key == NULL || key[0] == 0 || strlen(key) >= NVS_KEY_NAME_MAX_SIZE) return ESP_ERR_NVS_INVALID_NAME;
+    if (size == 0 || size > KV_BULK_MAX_SIZE) return ESP_ERR_INVALID_SIZE;
+
+    chunk.error = ESP_ERR_INVALID_STATE;
+    //same transfer: resume
+    if (blob.data != NULL && blob.size == size && blob.crc == crc && strcmp(blob.key, key) == 0) {
+        *offset = blob.received;
+        ESP_LOGI(KV_BULK_TAG, "resuming %s at %lu/%lu", key, (unsigned long)blob.received, (unsigned long)size);
+        return ESP_OK;
+    }
+
+    kv_bulk_abort();
+    blob.data = malloc(size);
+    if (blob.data == NULL) return ESP_ERR_NO_MEM;
+    strcpy(blob.key, key);
+    blob.size = size;
+    blob.crc = crc;
+    blob.received = 0;
+    *offset = 0;
+    ESP_LOGI(KV_BULK_TAG, "receiving %s, %lu bytes", key, (unsigned long)size);
+    return ESP_OK;
+}
+
+void kv_bulk_chunk_start(uint32_t offset, uint32_t len, uint32_t crc)
+{
+    chunk.offset = offset;
+    chunk.len = len;
+    chunk.pos = 0;
+    chunk.crc = crc;
+    chunk.crc_calc = 0;
+    //no gaps, a repeated chunk overwrites the same data
+    if (len > KV_BULK_CHUNK_MAX) chunk.error = ESP_ERR_INVALID_ARG;
+    else if (blob.data == NULL || offset > blob.received || offset + len > blob.size) chunk.error = ESP_ERR_INVALID_STATE;
+    else chunk.error = ESP_OK;
+}
+
+void kv_bulk_chunk_invalid(void)
+{
+    chunk.error = ESP_ERR_INVALID_ARG;
+}
+
+void kv_bulk_chunk_data(const uint8_t *data, uint16_t len)
+{
+    if (chunk.error != ESP_OK) return;
+    if (len > chunk.len - chunk.pos) len = chunk.len - chunk.pos;
+    memcpy(&blob.data[chunk.offset + chunk.pos], data, len);
+    chunk.crc_calc = esp_rom_crc32_le(chunk.crc_calc, data, len);
+    chunk.pos += len;
+}
+
+esp_err_t kv_bulk_chunk_end(uint32_t *received, uint8_t *stored)
+{
+    esp_err_t ret;
+
+    *stored = 0;
+    *received = blob.data != NULL ? blob.received : 0;
+    ret = chunk.error;
+    chunk.error = ESP_ERR_INVALID_STATE;
+    if (ret != ESP_OK) return ret;
+    if (chunk.pos != chunk.len) return ESP_ERR_INVALID_SIZE;
+    if (chunk.crc_calc != chunk.crc) return ESP_ERR_INVALID_CRC;
+
+    if (chunk.offset + chunk.len > blob.received) blob.received = chunk.offset + chunk.len;
+    *received = blob.received;
+    if (blob.received < blob.size) return ESP_OK;
+
+    //complete: check & store
+    if (esp_rom_crc32_le(0, blob.data, blob.size) != blob.crc) {
+        //start over, the chunks were fine but do not match
+        blob.received = 0;
+        *received = 0;
+        return ESP_ERR_INVALID_CRC;
+    }
+    //a $SV string of the same key is replaced
+    kv_cache_invalidate(blob.key);
+    nvs_erase_key(bulk_nvs, blob.key);
+    ret = nvs_set_blob(bulk_nvs, blob.key, blob.data, blob.size);
+    if (ret == ESP_OK) ret = nvs_commit(bulk_nvs);
+    if (ret == ESP_OK) {
+        ESP_LOGI(KV_BULK_TAG, "stored %s, %lu bytes", blob.key, (unsigned long)blob.size);
+        *stored = 1;
+        kv_bulk_abort();
+    } else {
+        //keep the data, $BW & the last chunk can be sent again
+        ESP_LOGW(KV_BULK_TAG, "error storing %s: %s", blob.key, esp_err_to_name(ret));
+        blob.received -= chunk.len;
+        *received = blob.received;
+    }
+    return ret;
+}
+
+esp_err_t kv_bulk_read(const char *key, uint32_t offset, uint32_t len, int uart_num)
+{
+    char header[48];
+    uint8_t *data = NULL;
+    size_t size = 0;
+    esp_err_t ret;
+    int hlen;
+
+    if (key == NULL || key[0] == 0 || strlen(key) >= NVS_KEY_NAME_MAX_SIZE) ret = ESP_ERR_NVS_INVALID_NAME;
+    else ret = nvs_get_blob(bulk_nvs, key, NULL, &size);
+    //whole blob is read, NVS has no partial blob access
+    if (ret == ESP_OK) {
+        data = malloc(size);
+        if (data == NULL) ret = ESP_ERR_NO_MEM;
+        else ret = nvs_get_blob(bulk_nvs, key, data, &size);
+    }
+    if (ret == ESP_OK && offset > size) ret = ESP_ERR_INVALID_SIZE;
+
+    if (ret != ESP_OK) {
+        ESP_LOGI(KV_BULK_TAG, "error reading %s: %s", key != NULL ? key : "", esp_err_to_name(ret));
+        hlen = snprintf(header, sizeof(header), "BR:%s\r\n", esp_err_to_name(ret));
+        uart_write_bytes(uart_num, header, hlen);
+        free(data);
+        return ret;
+    }
+
+    if (len == 0 || len > size - offset) len = size - offset;
+    hlen = snprintf(header, sizeof(header), "BR:%u,%lu,%lu,%08lX\r\n", (unsigned)size, (unsigned long)offset,
+                    (unsigned long)len, (unsigned long)esp_rom_crc32_le(0, &data[offset], len));
+    uart_write_bytes(uart_num, header, hlen);
+    uart_write_bytes(uart_num, (const char *)&data[offset], len);
+    uart_write_bytes(uart_num, "\r\nEND\r\n", 7);
+    free(data);
+    return ESP_OK;
+}
@@ -0,0 +1,82 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ */
+
+#ifndef _KV_BULK_H_
+#define _KV_BULK_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "nvs.h"
+
+/** @brief Maximum size of one blob (buffered in RAM until complete) */
+#define KV_BULK_MAX_SIZE        8192
+
+/** @brief Maximum payload of one $BD chunk */
+#define KV_BULK_CHUNK_MAX       1024
+
+/** @brief A chunk is dropped if no byte is received for this time */
+#define KV_BULK_TIMEOUT_MS      1000
+
+/** @brief Remember the NVS handle of the key/value namespace ("kvstorage")
+ * @note Not thread safe, all functions are called by the external UART task */
+void kv_bulk_init(nvs_handle_t h);
+
+/** @brief Start or resume writing a blob ($BW)
+ *
+ * If a transfer with the same key, size & CRC is pending, it is resumed,
+ * otherwise a pending transfer is dropped and a new one started.
+ * @param crc CRC32 of the whole blob (esp_rom_crc32_le(0,...), same as zlib.crc32)
+ * @param offset Returns the number of bytes received so far (continue there)
+ * @return ESP_OK, ESP_ERR_NVS_INVALID_NAME, ESP_ERR_INVALID_SIZE or ESP_ERR_NO_MEM */
+esp_err_t kv_bulk_begin(const char *key, uint32_t size, uint32_t crc, uint32_t *offset);
+
+/** @brief Announce a chunk ($BD), followed by len bytes of kv_bulk_chunk_data
+ *
+ * Chunks may be repeated (offset <= bytes received), but not skip data.
+ * Errors are reported by kv_bulk_chunk_end, after the payload was consumed. */
+void kv_bulk_chunk_start(uint32_t offset, uint32_t len, uint32_t crc);
+
+/** @brief Announce a chunk with an invalid header, its payload is dropped
+ * and kv_bulk_chunk_end returns ESP_ERR_INVALID_ARG */
+void kv_bulk_chunk_invalid(void);
+
+/** @brief Payload of the current chunk, may be split into several calls */
+void kv_bulk_chunk_data(const uint8_t *data, uint16_t len);
+
+/** @brief Check the chunk, store the blob (nvs_set_blob & commit) when complete
+ * @param received Returns the number of bytes received so far (continue there)
+ * @param stored Returns 1 if the blob is complete & stored, 0 otherwise
+ * @return ESP_OK, ESP_ERR_INVALID_ARG (invalid header or len > KV_BULK_CHUNK_MAX),
+ * ESP_ERR_INVALID_STATE (no transfer or chunk not continuous),
+ * ESP_ERR_INVALID_SIZE (incomplete chunk), ESP_ERR_INVALID_CRC (chunk or blob) or the NVS error */
+esp_err_t kv_bulk_chunk_end(uint32_t *received, uint8_t *stored);
+
+/** @brief Drop a pending transfer ($BA) */
+void kv_bulk_abort(void);
+
+/** @brief Send a blob (or a part of it) via the given UART ($BR)
+ *
+ * Format: "BR:<size>,<offset>,<len>,<crc of the part, hex>\r\n", the bytes as raw
+ * binary, "\r\nEND\r\n". On error: "BR:<error name>\r\n".
+ * @param len Number of bytes, 0: up to the end */
+esp_err_t kv_bulk_read(const char *key, uint32_t offset, uint32_t len, int uart_num);
+
+#endif
@@ -0,0 +1,286 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ *
+ * Write-back cache for the $SV / $GV key/value storage: $SV only updates RAM,
+ * dirty values are written with a single commit when the UART is idle, on $CM or
+ * when the cache runs out of clean entries. $GV is answered from RAM if possible.
+ */
+
+#include "kv_cache.h"
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "task_config.h"
+
+#define KV_CACHE_TAG "KV"
+
+typedef enum {
+    KV_EMPTY = 0,
+    KV_CLEAN,       /// same as in NVS
+    KV_DIRTY        /// changed, not written yet
+} kv_state_t;
+
+typedef struct {
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    char value[KV_CACHE_VALUE_LEN];
+    uint8_t state;
+    uint32_t used;  /// access counter value of the last use (LRU)
+} kv_entry_t;
+
+static kv_entry_t entries[KV_CACHE_ENTRIES];
+static uint32_t access_cnt = 0;
+static uint8_t transaction = 0;
+static TickType_t last_set;         /// tick of the last kv_cache_set / kv_cache_begin (transaction timeout)
+static esp_err_t deferred_error = ESP_OK;   /// error of a commit on idle, reported by the next kv_cache_set
+static nvs_handle_t kv_nvs;
+static nvs_stats_t kv_stats;
+static SemaphoreHandle_t kv_lock = NULL;
+static StaticSemaphore_t kv_lock_buf;
+static TaskHandle_t idle_task = NULL;
+static StackType_t idle_stack[TASK_STACK_KVSTORE];
+static StaticTask_t idle_tcb;
+
+static kv_entry_t *kv_find(const char *key)
+{
+    for (uint8_t i = 0; i < KV_CACHE_ENTRIES; i++) {
+        if (entries[i].state != KV_EMPTY && strcmp(entries[i].key, key) == 0) return &entries[i];
+    }
+    return NULL;
+}
+
+/** @brief Write the dirty entries, one commit. Call with kv_lock taken.
+ * @note Entries which could not be written or committed stay dirty and are written again next time */
+static esp_err_t kv_flush_locked(void)
+{
+    esp_err_t ret = ESP_OK;
+    uint32_t written = 0;   /// bit per entry
+    uint8_t count = 0;
+
+    _Static_assert(KV_CACHE_ENTRIES <= 32, "written is a bitmask");
+    for (uint8_t i = 0; i < KV_CACHE_ENTRIES; i++) {
+        if (entries[i].state != KV_DIRTY) continue;
+        esp_err_t r = nvs_set_str(kv_nvs, entries[i].key, entries[i].value);
+        if (r == ESP_OK) {
+            written |= 1UL << i;
+            count++;
+        } else {
+            ESP_LOGW(KV_CACHE_TAG, "error writing %s: %s", entries[i].key, esp_err_to_name(r));
+            ret = r;
+        }
+    }
+    if (written) {
+        esp_err_t r = nvs_commit(kv_nvs);
+        nvs_get_stats(NULL, &kv_stats);
+        if (r == ESP_OK) {
+            for (uint8_t i = 0; i < KV_CACHE_ENTRIES; i++) {
+                if (written & (1UL << i)) entries[i].state = KV_CLEAN;
+            }
+            ESP_LOGI(KV_CACHE_TAG, "committed %u value(s)", count);
+        } else {
+            ESP_LOGW(KV_CACHE_TAG, "commit failed: %s", esp_err_to_name(r));
+            ret = r;
+        }
+    }
+    return ret;
+}
+
+/** @brief Free entry or least recently used clean one, flushes if all are dirty. Call with kv_lock taken. */
+static kv_entry_t *kv_alloc_locked(esp_err_t *ret)
+{
+    kv_entry_t *lru = NULL;
+
+    *ret = ESP_OK;
+    for (uint8_t pass = 0; pass < 2; pass++) {
+        for (uint8_t i = 0; i < KV_CACHE_ENTRIES; i++) {
+            if (entries[i].state == KV_EMPTY) return &entries[i];
+            if (entries[i].state == KV_CLEAN && (lru == NULL || (int32_t)(entries[i].used - lru->used) < 0)) {
+                lru = &entries[i];
+            }
+        }
+        if (lru != NULL) {
+            lru->state = KV_EMPTY;
+            return lru;
+        }
+        //everything dirty (e.g. a large transaction): write early
+        ESP_LOGW(KV_CACHE_TAG, "cache full, writing dirty values");
+        *ret = kv_flush_locked();
+    }
+    return NULL;
+}
+
+/** @brief Commits after KV_CACHE_IDLE_MS without a new kv_cache_set,
+ * ends a transaction after KV_CACHE_TRANSACTION_MS without one */
+static void kv_idle_task(void *param)
+{
+    while (1) {
+        //during a transaction, wake up for its timeout
+        if (ulTaskNotifyTake(pdTRUE, transaction ? pdMS_TO_TICKS(KV_CACHE_TRANSACTION_MS) : portMAX_DELAY) != 0) {
+            //each further $SV restarts the idle time
+            while (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(KV_CACHE_IDLE_MS)) != 0);
+        }
+
+        xSemaphoreTake(kv_lock, portMAX_DELAY);
+        if (transaction && xTaskGetTickCount() - last_set >= pdMS_TO_TICKS(KV_CACHE_TRANSACTION_MS)) {
+            ESP_LOGW(KV_CACHE_TAG, "transaction timed out, committing");
+            transaction = 0;
+        }
+        if (!transaction) {
+            esp_err_t r = kv_flush_locked();
+            if (r != ESP_OK) deferred_error = r;
+        }
+        xSemaphoreGive(kv_lock);
+    }
+}
+
+void kv_cache_init(nvs_handle_t h)
+{
+    kv_nvs = h;
+    if (kv_lock == NULL) kv_lock = xSemaphoreCreateMutexStatic(&kv_lock_buf);
+    if (idle_task == NULL) {
+        idle_task = xTaskCreateStaticPinnedToCore(&kv_idle_task, "kvstore", TASK_STACK_KVSTORE,
+            NULL, TASK_PRIO_KVSTORE, idle_stack, &idle_tcb, TASK_CORE_INPUT);
+    }
+    nvs_get_stats(NULL, &kv_stats);
+}
+
+esp_err_t kv_cache_get(const char *key, char *value, size_t len)
+{
+    esp_err_t ret = ESP_OK;
+    kv_entry_t *e;
+
+    if (key == NULL || key[0] == 0 || strlen(key) >= NVS_KEY_NAME_MAX_SIZE) return ESP_ERR_NVS_INVALID_NAME;
+    if (kv_lock == NULL) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(kv_lock, portMAX_DELAY);
+    e = kv_find(key);
+    if (e == NULL) {
+        //miss: load into the cache
+        e = kv_alloc_locked(&ret);
+        if (e != NULL) {
+            size_t size = sizeof(e->value);
+            ret = nvs_get_str(kv_nvs, key, e->value, &size);
+            if (ret == ESP_OK) {
+                strcpy(e->key, key);
+                e->state = KV_CLEAN;
+            } else {
+                e->state = KV_EMPTY;
+                e = NULL;
+            }
+        }
+    }
+    if (e != NULL) {
+        e->used = ++access_cnt;
+        if (strlen(e->value) < len) {
+            strcpy(value, e->value);
+            ret = ESP_OK;
+        } else ret = ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    xSemaphoreGive(kv_lock);
+    return ret;
+}
+
+esp_err_t kv_cache_set(const char *key, const char *value)
+{
+    esp_err_t ret = ESP_OK;
+    kv_entry_t *e;
+
+    if (key == NULL || key[0] == 0 || strlen(key) >= NVS_KEY_NAME_MAX_SIZE) return ESP_ERR_NVS_INVALID_NAME;
+    if (strlen(value) >= KV_CACHE_VALUE_LEN) return ESP_ERR_NVS_INVALID_LENGTH;
+    if (kv_lock == NULL) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(kv_lock, portMAX_DELAY);
+    e = kv_find(key);
+    //all entries dirty & cannot be written (e.g. NVS full): refused
+    if (e == NULL) e = kv_alloc_locked(&ret);
+    if (e != NULL) {
+        //unchanged values are not written again
+        if (e->state == KV_EMPTY || strcmp(e->value, value) != 0) {
+            strcpy(e->key, key);
+            strcpy(e->value, value);
+            e->state = KV_DIRTY;
+        }
+        e->used = ++access_cnt;
+        //the value is kept, but a previous commit on idle failed
+        ret = deferred_error;
+    } else if (ret == ESP_OK) ret = ESP_ERR_NO_MEM;
+    deferred_error = ESP_OK;
+    last_set = xTaskGetTickCount();
+    xSemaphoreGive(kv_lock);
+
+    if (idle_task != NULL) xTaskNotifyGive(idle_task);
+    return ret;
+}
+
+void kv_cache_invalidate(const char *key)
+{
+    kv_entry_t *e;
+
+    if (kv_lock == NULL) return;
+    xSemaphoreTake(kv_lock, portMAX_DELAY);
+    if ((e = kv_find(key)) != NULL) e->state = KV_EMPTY;
+    xSemaphoreGive(kv_lock);
+}
+
+void kv_cache_begin(void)
+{
+    if (kv_lock == NULL) return;
+    xSemaphoreTake(kv_lock, portMAX_DELAY);
+    transaction = 1;
+    last_set = xTaskGetTickCount();
+    xSemaphoreGive(kv_lock);
+    //start the transaction timeout
+    if (idle_task != NULL) xTaskNotifyGive(idle_task);
+}
+
+esp_err_t kv_cache_commit(void)
+{
+    esp_err_t ret;
+
+    if (kv_lock == NULL) return ESP_ERR_INVALID_STATE;
+    xSemaphoreTake(kv_lock, portMAX_DELAY);
+    transaction = 0;
+    deferred_error = ESP_OK;
+    ret = kv_flush_locked();
+    xSemaphoreGive(kv_lock);
+    return ret;
+}
+
+esp_err_t kv_cache_clear(void)
+{
+    esp_err_t ret;
+
+    if (kv_lock == NULL) return ESP_ERR_INVALID_STATE;
+    xSemaphoreTake(kv_lock, portMAX_DELAY);
+    memset(entries, 0, sizeof(entries));
+    transaction = 0;
+    deferred_error = ESP_OK;
+    ret = nvs_erase_all(kv_nvs);
+    if (ret == ESP_OK) ret = nvs_commit(kv_nvs);
+    nvs_get_stats(NULL, &kv_stats);
+    xSemaphoreGive(kv_lock);
+    return ret;
+}
+
+void kv_cache_get_stats(nvs_stats_t *stats)
+{
+    memcpy(stats, &kv_stats, sizeof(nvs_stats_t));
+}
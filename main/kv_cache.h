@@ -0,0 +1,75 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ */
+
+#ifndef _KV_CACHE_H_
+#define _KV_CACHE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "nvs.h"
+#include "uart_parser.h"
+
+/** @brief Number of cached key/value pairs, clean entries are evicted (least recently used) */
+#define KV_CACHE_ENTRIES        32
+
+/** @brief Maximum value length (incl. '\0'), $SV values are limited by the command length */
+#define KV_CACHE_VALUE_LEN      MAX_CMDLEN
+
+/** @brief Dirty entries are committed after this time without $SV (unless a transaction is open) */
+#define KV_CACHE_IDLE_MS        500
+
+/** @brief A transaction without $SV for this time is committed & ended */
+#define KV_CACHE_TRANSACTION_MS 10000
+
+/** @brief Remember the NVS handle & start the commit-on-idle task
+ * @param h NVS handle of the key/value namespace ("kvstorage") */
+void kv_cache_init(nvs_handle_t h);
+
+/** @brief Get a value, read from NVS only on a cache miss
+ * @param value Destination buffer
+ * @param len Size of value
+ * @return ESP_OK, ESP_ERR_NVS_NOT_FOUND, ESP_ERR_NVS_INVALID_LENGTH (buffer too small) or another NVS error */
+esp_err_t kv_cache_get(const char *key, char *value, size_t len);
+
+/** @brief Set a value in RAM, written to NVS on idle, by kv_cache_commit or if the cache is full
+ *
+ * Values which cannot be written stay in the cache and are written again on the next commit.
+ * @return ESP_OK, ESP_ERR_NVS_INVALID_NAME, ESP_ERR_NVS_INVALID_LENGTH (value too long),
+ * the NVS error of the last commit on idle (the value is set anyway) or the NVS error
+ * if all entries are dirty & cannot be written (the value is not set) */
+esp_err_t kv_cache_set(const char *key, const char *value);
+
+/** @brief Drop a key from the cache, incl. a pending value (e.g. the key is written as blob) */
+void kv_cache_invalidate(const char *key);
+
+/** @brief Start a transaction: no commit-on-idle until kv_cache_commit or KV_CACHE_TRANSACTION_MS without kv_cache_set */
+void kv_cache_begin(void);
+
+/** @brief Write all dirty entries to NVS (one commit) & end a transaction */
+esp_err_t kv_cache_commit(void);
+
+/** @brief Erase all key/value pairs (RAM & NVS) */
+esp_err_t kv_cache_clear(void);
+
+/** @brief NVS usage, updated on each commit (no flash access) */
+void kv_cache_get_stats(nvs_stats_t *stats);
+
+#endif
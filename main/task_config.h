@@ -0,0 +1,71 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ */
+
+#ifndef _TASK_CONFIG_H_
+#define _TASK_CONFIG_H_
+
+#include "freertos/FreeRTOS.h"
+
+/* Task plan
+ *
+ * Core 0 (PRO_CPU) belongs to the BT stack: controller (prio. configMAX_PRIORITIES-2),
+ * esp_timer (-3, runs periodicHIDCallback, joystick filter & consumer tap timers),
+ * BTU (-5) and BTC (-6). The input pipeline runs on core 1 (APP_CPU), so UART bytes
+ * are parsed while the stack is busy; the reports are handed over to BTC by queue.
+ *
+ * On core 1 the external UART has the highest priority, tasks generating load
+ * (benchmark, replay) are below it, so commands (e.g. stopping them) are still handled.
+ * Note: configMAX_PRIORITIES itself is not a valid priority (clamped to configMAX_PRIORITIES-1).
+ *
+ * Stack sizes are in bytes and include a margin for rarely used paths (NVS, OTA,
+ * debug logging). Verify changes with the stack high water marks of $SY. */
+
+/** @brief Core for the input pipeline & helper tasks, away from the BT controller */
+#if portNUM_PROCESSORS > 1
+  #define TASK_CORE_INPUT           1
+#else
+  #define TASK_CORE_INPUT           0
+#endif
+
+/** @brief External UART: parser, commands & HID reports */
+#define TASK_PRIO_EXTERNAL          (configMAX_PRIORITIES - 4)
+#define TASK_STACK_EXTERNAL         4096
+
+/** @brief UART capture replay, feeds the parser instead of the external UART */
+#define TASK_PRIO_REPLAY            (TASK_PRIO_EXTERNAL - 1)
+#define TASK_STACK_REPLAY           3072
+
+/** @brief $BENCH report generator */
+#define TASK_PRIO_BENCH             (TASK_PRIO_EXTERNAL - 1)
+#define TASK_STACK_BENCH            3072
+
+/** @brief Debug console on UART0 (ESP32 miniBT only) */
+#define TASK_PRIO_CONSOLE           (TASK_PRIO_EXTERNAL - 2)
+#define TASK_STACK_CONSOLE          4096
+
+/** @brief Deferred NVS writes of peer names, only runs when nothing else is ready */
+#define TASK_PRIO_NAMES             (tskIDLE_PRIORITY + 1)
+#define TASK_STACK_NAMES            3072
+
+/** @brief Commit-on-idle of the $SV key/value cache */
+#define TASK_PRIO_KVSTORE           (tskIDLE_PRIORITY + 1)
+#define TASK_STACK_KVSTORE          3072
+
+#endif
@@ -0,0 +1,195 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ *
+ * Capture of the bytes received on the external UART (with arrival time)
+ * and replay of such a capture, used to reproduce problems reported by users.
+ */
+
+#include "uart_capture.h"
+
+#if CONFIG_MODULE_CAPTURE
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "task_config.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "driver/uart.h"
+#include "hid_stats.h"
+
+#define UART_CAPTURE_TAG "UART_CAPTURE"
+
+static uart_capture_entry_t capture_ring[CONFIG_MODULE_CAPTURE_ENTRIES];
+/** next entry to write */
+static uint16_t capture_head;
+/** number of valid entries */
+static uint16_t capture_count;
+static volatile uint8_t capture_active;
+static portMUX_TYPE capture_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static struct {
+    uart_capture_feed_t feed;
+    uint16_t speed;
+    int uart_num;
+    volatile uint8_t running;
+} replay;
+
+void uart_capture_add(uint8_t data)
+{
+    uint32_t now = (uint32_t)esp_timer_get_time();
+
+    if (!capture_active) return;
+    portENTER_CRITICAL(&capture_lock);
+    capture_ring[capture_head].timestamp = now;
+    capture_ring[capture_head].data = data;
+    if (++capture_head >= CONFIG_MODULE_CAPTURE_ENTRIES) capture_head = 0;
+    if (capture_count < CONFIG_MODULE_CAPTURE_ENTRIES) capture_count++;
+    portEXIT_CRITICAL(&capture_lock);
+}
+
+esp_err_t uart_capture_start(void)
+{
+    if (replay.running) return ESP_ERR_INVALID_STATE;
+    portENTER_CRITICAL(&capture_lock);
+    capture_head = 0;
+    capture_count = 0;
+    portEXIT_CRITICAL(&capture_lock);
+    capture_active = 1;
+    return ESP_OK;
+}
+
+void uart_capture_stop(void)
+{
+    capture_active = 0;
+}
+
+/** index of the oldest entry */
+static uint16_t capture_start_index(void)
+{
+    return (capture_head + CONFIG_MODULE_CAPTURE_ENTRIES - capture_count) % CONFIG_MODULE_CAPTURE_ENTRIES;
+}
+
+void uart_capture_dump(int uart_num)
+{
+    char header[24];
+    uint8_t active = capture_active;
+    uint16_t start, count;
+    int len;
+
+    capture_active = 0;
+    portENTER_CRITICAL(&capture_lock);
+    count = capture_count;
+    start = capture_start_index();
+    portEXIT_CRITICAL(&capture_lock);
+
+    len = snprintf(header, sizeof(header), "CP:%u,%u\r\n", count, (unsigned)sizeof(uart_capture_entry_t));
+    uart_write_bytes(uart_num, header, len);
+    //ring is not modified while paused, write the (up to) two consecutive parts
+    if (start + count > CONFIG_MODULE_CAPTURE_ENTRIES) {
+        uart_write_bytes(uart_num, (const char *)&capture_ring[start],
+                         (CONFIG_MODULE_CAPTURE_ENTRIES - start) * sizeof(uart_capture_entry_t));
+        uart_write_bytes(uart_num, (const char *)&capture_ring[0],
+                         (start + count - CONFIG_MODULE_CAPTURE_ENTRIES) * sizeof(uart_capture_entry_t));
+    } else {
+        uart_write_bytes(uart_num, (const char *)&capture_ring[start], count * sizeof(uart_capture_entry_t));
+    }
+    uart_write_bytes(uart_num, "\r\nEND\r\n", 7);
+    capture_active = active;
+}
+
+static void replay_print(uint16_t count, int64_t duration_us, uint32_t original_us, uint32_t max_lag_us,
+                         const hid_stats_latency_t *before)
+{
+    char line[80];
+    int len;
+
+    //bytes, replay duration, original duration, max. lag behind original timing (us)
+    len = snprintf(line, sizeof(line), "CP:replay,%u,%lu,%lu,%lu\r\n", count, (unsigned long)duration_us,
+                   (unsigned long)original_us, (unsigned long)max_lag_us);
+    ESP_LOGI(UART_CAPTURE_TAG, "%.*s", len - 2, line);
+    uart_write_bytes(replay.uart_num, line, len);
+    //resulting reports: report ID, count, avg. latency (us)
+    for (uint8_t id = 0; id < HID_STATS_RPT_NUM; id++) {
+        const hid_stats_latency_t *now = hid_stats_get_latency(id);
+        uint32_t n = now->count - before[id].count;
+        if (n == 0) continue;
+        len = snprintf(line, sizeof(line), "CP:rpt,%u,%lu,%lu\r\n", id, (unsigned long)n,
+                       (unsigned long)((now->sum_us - before[id].sum_us) / n));
+        ESP_LOGI(UART_CAPTURE_TAG, "%.*s", len - 2, line);
+        uart_write_bytes(replay.uart_num, line, len);
+    }
+    uart_write_bytes(replay.uart_num, "END\r\n", 5);
+}
+
+static void replay_task(void *arg)
+{
+    static hid_stats_latency_t before[HID_STATS_RPT_NUM];
+    uint16_t start = capture_start_index();
+    uint16_t count = capture_count;
+    uint32_t first = capture_ring[start].timestamp;
+    uint32_t offset = 0, max_lag = 0;
+    int64_t begin;
+
+    for (uint8_t id = 0; id < HID_STATS_RPT_NUM; id++) before[id] = *hid_stats_get_latency(id);
+
+    begin = esp_timer_get_time();
+    for (uint16_t i = 0; i < count; i++) {
+        const uart_capture_entry_t *e = &capture_ring[(start + i) % CONFIG_MODULE_CAPTURE_ENTRIES];
+        //timestamps are the lower 32bit of the us timer, the difference is wrap-safe
+        offset = e->timestamp - first;
+        if (replay.speed != UART_CAPTURE_SPEED_MAX) {
+            int64_t due = begin + offset / replay.speed;
+            int64_t wait = due - esp_timer_get_time();
+            //bytes of one frame arrive within one tick, only gaps between frames are reproduced
+            if (wait >= portTICK_PERIOD_MS * 1000) vTaskDelay(wait / 1000 / portTICK_PERIOD_MS);
+            int64_t lag = esp_timer_get_time() - due;
+            if (lag > (int64_t)max_lag) max_lag = lag;
+        } else if ((i & 0x3FF) == 0x3FF) {
+            //let the idle task run (task watchdog)
+            vTaskDelay(1);
+        }
+        replay.feed(e->data);
+    }
+    replay_print(count, esp_timer_get_time() - begin, offset, max_lag, before);
+
+    replay.running = 0;
+    vTaskDelete(NULL);
+}
+
+esp_err_t uart_capture_replay(uint16_t speed, uart_capture_feed_t feed, int uart_num)
+{
+    if (replay.running || capture_count == 0) return ESP_ERR_INVALID_STATE;
+    //capture ring must not change while replaying
+    capture_active = 0;
+    replay.feed = feed;
+    replay.speed = speed;
+    replay.uart_num = uart_num;
+    replay.running = 1;
+    //below the UART task, so commands are still processed
+    if (xTaskCreatePinnedToCore(&replay_task, "replay", TASK_STACK_REPLAY, NULL, TASK_PRIO_REPLAY, NULL, TASK_CORE_INPUT) != pdPASS) {
+        replay.running = 0;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(UART_CAPTURE_TAG, "replaying %u bytes, speed %u", capture_count, speed);
+    return ESP_OK;
+}
+
+#endif
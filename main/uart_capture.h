@@ -0,0 +1,79 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ */
+
+#ifndef _UART_CAPTURE_H_
+#define _UART_CAPTURE_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+/** @brief One captured byte, 5 bytes, little endian when dumped */
+typedef struct __attribute__((packed)) {
+    uint32_t timestamp;  /// lower 32bit of esp_timer_get_time() (us)
+    uint8_t data;
+} uart_capture_entry_t;
+
+/** @brief Replay speed: as fast as possible */
+#define UART_CAPTURE_SPEED_MAX  0
+
+/** @brief Function used to feed a byte of the capture into the parser */
+typedef void (*uart_capture_feed_t)(uint8_t data);
+
+#if CONFIG_MODULE_CAPTURE
+
+/** @brief Add a received byte to the capture ring (if capturing, oldest entry is overwritten) */
+void uart_capture_add(uint8_t data);
+
+/** @brief Clear the capture ring and start capturing
+ * @return ESP_ERR_INVALID_STATE while a replay is running */
+esp_err_t uart_capture_start(void);
+
+/** @brief Stop capturing, the captured data is kept */
+void uart_capture_stop(void);
+
+/** @brief Dump the capture ring via the given UART
+ *
+ * Format: "CP:<number of entries>,<entry size>\r\n", entries as raw binary
+ * (oldest first), "\r\nEND\r\n". Capturing is paused while dumping.
+ * Use tools/capture_replay.py to decode or replay the dump, test/host/replay_host
+ * replays it on the host build. */
+void uart_capture_dump(int uart_num);
+
+/** @brief Replay the capture ring in a separate task
+ *
+ * Capturing is stopped. Each byte is passed to feed, either with the original
+ * timing divided by speed or as fast as possible (UART_CAPTURE_SPEED_MAX).
+ * When finished, the number of bytes, the replay & original duration, the
+ * maximum lag behind the original timing and the resulting reports per report ID
+ * (count, avg. latency from frame start to BLE stack) are written to the given UART.
+ * @note Do not send raw frames via UART while replaying, the latency statistics are per frame.
+ * @return ESP_ERR_INVALID_STATE if a replay is running or nothing is captured */
+esp_err_t uart_capture_replay(uint16_t speed, uart_capture_feed_t feed, int uart_num);
+
+#define UART_CAPTURE(data) uart_capture_add(data)
+
+#else
+
+#define UART_CAPTURE(data) do { } while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ *
+ * Byte-wise state machine for the UART interface (raw HID frames & ASCII commands).
+ * Kept free of ESP-IDF & BLE dependencies, so it can be compiled on its own;
+ * dispatching the frames is done by the handlers in ble_hidd_demo_main.c.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "uart_parser.h"
+
+void uart_parser_init(struct cmdBuf *cmdBuffer, int sendToUART)
+{
+    cmdBuffer->state = CMDSTATE_IDLE;
+    cmdBuffer->expectedBytes = 0;
+    cmdBuffer->bufferLength = 0;
+    cmdBuffer->sendToUART = sendToUART;
+    cmdBuffer->timestamp = 0;
+}
+
+void uart_parser_feed(uint8_t character, struct cmdBuf *cmdBuffer, const uart_parser_handler_t *handler)
+{
+    switch (cmdBuffer->state) {
+
+    case CMDSTATE_IDLE:
+        if (character==0xfd) {
+            cmdBuffer->bufferLength=0;
+            cmdBuffer->expectedBytes=UART_PARSER_RAW_LEN;   // 8 bytes for raw report size
+            if(handler->frame_start != NULL) handler->frame_start(cmdBuffer);
+            cmdBuffer->state=CMDSTATE_GET_RAW;
+        }
+        else if (character == '$') {
+            cmdBuffer->bufferLength=0;   // we will read an ASCII-command until CR or LF
+            cmdBuffer->state=CMDSTATE_GET_ASCII;
+        }
+        break;
+
+    case CMDSTATE_GET_RAW:
+        cmdBuffer->buf[cmdBuffer->bufferLength]=character;
+        if ((cmdBuffer->bufferLength == 1) && (character==0x01)) { // we have a joystick report
+            cmdBuffer->expectedBytes += UART_PARSER_JOY_LEN - UART_PARSER_RAW_LEN;
+        }
+        if ((cmdBuffer->bufferLength == 1) && (character==0x04)) { // wide joystick report
+            cmdBuffer->expectedBytes += UART_PARSER_JOY_HIRES_LEN - UART_PARSER_RAW_LEN;
+        }
+
+        cmdBuffer->bufferLength++;
+        cmdBuffer->expectedBytes--;
+        if (!cmdBuffer->expectedBytes) {
+            handler->raw_frame(cmdBuffer);
+            cmdBuffer->state=CMDSTATE_IDLE;
+        }
+        break;
+
+    case CMDSTATE_GET_ASCII:
+        // collect a command string until CR or LF are received
+        if ((character==0x0d) || (character==0x0a))  {
+            cmdBuffer->buf[cmdBuffer->bufferLength]=0;
+            handler->ascii_cmd(cmdBuffer);
+            // the command may request a binary payload
+            if (cmdBuffer->state == CMDSTATE_GET_ASCII) cmdBuffer->state=CMDSTATE_IDLE;
+        } else {
+            if (cmdBuffer->bufferLength < MAX_CMDLEN-1)
+                cmdBuffer->buf[cmdBuffer->bufferLength++]=character;
+        }
+        break;
+
+    case CMDSTATE_GET_BINARY:
+        // pass the payload on in pieces of up to MAX_CMDLEN bytes
+        cmdBuffer->buf[cmdBuffer->bufferLength++]=character;
+        cmdBuffer->expectedBytes--;
+        if (!cmdBuffer->expectedBytes || cmdBuffer->bufferLength == MAX_CMDLEN) {
+            if(handler->binary_data != NULL) handler->binary_data(cmdBuffer);
+            cmdBuffer->bufferLength=0;
+            if (!cmdBuffer->expectedBytes) cmdBuffer->state=CMDSTATE_IDLE;
+        }
+        break;
+    default:
+        cmdBuffer->state=CMDSTATE_IDLE;
+    }
+}
+
+void uart_parser_expect_binary(struct cmdBuf *cmdBuffer, int len)
+{
+    if (len <= 0) return;
+    cmdBuffer->bufferLength = 0;
+    cmdBuffer->expectedBytes = len;
+    cmdBuffer->state = CMDSTATE_GET_BINARY;
+}
@@ -0,0 +1,94 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ */
+
+#ifndef _UART_PARSER_H_
+#define _UART_PARSER_H_
+
+#include <stdint.h>
+
+/** @brief Maximum length of a raw frame or an ASCII command (including the terminating 0) */
+#define MAX_CMDLEN  100
+
+/** @brief Parser states, see cmdBuf.state */
+#define CMDSTATE_IDLE 0
+#define CMDSTATE_GET_RAW 1
+#define CMDSTATE_GET_ASCII 2
+#define CMDSTATE_GET_BINARY 3
+
+/** @brief Raw frame sizes (bytes after 0xFD)
+ * @note The joystick sizes are the report lengths + 2 (report type & padding),
+ * they are checked against esp_hidd_prf_api.h in ble_hidd_demo_main.c */
+#define UART_PARSER_RAW_LEN         8
+#define UART_PARSER_JOY_LEN         (11 + 2)
+#define UART_PARSER_JOY_HIRES_LEN   (21 + 2)
+
+_Static_assert(UART_PARSER_JOY_HIRES_LEN <= MAX_CMDLEN, "raw frames must fit into cmdBuf.buf");
+
+struct cmdBuf {
+	//current state of the parser, CMD_STATE*
+    int state;
+    //if a fixed length command is issued, we store expected length here
+    int expectedBytes;
+    int bufferLength;
+    //if != 0, the result of a command will be sent to the debug console AND the external UART (-> FLipMouse/FABI GUI on PC)
+    int sendToUART;
+    //timestamp of the first byte of the current raw frame (for latency statistics)
+    int64_t timestamp;
+    uint8_t buf[MAX_CMDLEN];
+};
+
+/** @brief Handlers which are called by the parser
+ * @note The parser itself has no dependencies on ESP-IDF or the BLE stack,
+ * everything device specific is done in these handlers. */
+typedef struct {
+    /** Called when 0xFD is received (optional, may be NULL). Used to set cmdBuf.timestamp */
+    void (*frame_start)(struct cmdBuf *cmdBuffer);
+    /** Called for a complete raw frame, buf[0..bufferLength-1] is valid */
+    void (*raw_frame)(struct cmdBuf *cmdBuffer);
+    /** Called for a complete ASCII command (without '$'), buf is 0-terminated */
+    void (*ascii_cmd)(struct cmdBuf *cmdBuffer);
+    /** Called for binary data requested by uart_parser_expect_binary (optional, may be NULL).
+     * buf[0..bufferLength-1] is valid (up to MAX_CMDLEN bytes per call),
+     * expectedBytes is 0 on the last call of a block */
+    void (*binary_data)(struct cmdBuf *cmdBuffer);
+} uart_parser_handler_t;
+
+/** @brief Reset the parser state of a command buffer
+ * @param sendToUART Value for cmdBuf.sendToUART */
+void uart_parser_init(struct cmdBuf *cmdBuffer, int sendToUART);
+
+/** @brief Process one received byte
+ *
+ * Raw frames start with 0xFD and have a fixed length depending on the
+ * frame type (buf[1]), ASCII commands start with '$' and end with CR or LF.
+ * The handlers are called from within this function (in the calling task).
+ * @param character Received byte
+ * @param cmdBuffer Parser state & buffer, one per input stream
+ * @param handler Handlers for complete frames & commands */
+void uart_parser_feed(uint8_t character, struct cmdBuf *cmdBuffer, const uart_parser_handler_t *handler);
+
+/** @brief Receive a block of binary data after the current ASCII command
+ *
+ * Call from the ascii_cmd handler: the next len bytes are passed to the
+ * binary_data handler instead of being parsed (e.g. payload of $BD).
+ * @param len Number of bytes, 0 does nothing */
+void uart_parser_expect_binary(struct cmdBuf *cmdBuffer, int len);
+
+#endif
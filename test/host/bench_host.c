@@ -0,0 +1,97 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ *
+ * Microbenchmark of the host build: ns per raw frame / report on the build
+ * machine, to compare changes of the hot path (not the timing on the ESP32).
+ * Usage: bench_host [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "host_app.h"
+#include "esp_hidd_prf_api.h"
+
+static const uint8_t mouse_frame[] = { 0xfd, 0x00, 0x03, 0x00, 0x01, 0xff, 0x00, 0x00, 0x00 };
+
+static struct cmdBuf parser_buf;
+static volatile int parser_sink;
+
+static void sink_frame(struct cmdBuf *b) { parser_sink += b->bufferLength; }
+
+static const uart_parser_handler_t sink_handler = {
+    .raw_frame = sink_frame,
+    .ascii_cmd = sink_frame,
+};
+
+static void bench_parser(void)
+{
+    for (unsigned i = 0; i < sizeof(mouse_frame); i++) uart_parser_feed(mouse_frame[i], &parser_buf, &sink_handler);
+}
+
+static void bench_mouse_frame(void)
+{
+    host_app_feed(mouse_frame, sizeof(mouse_frame));
+    host_notify_clear();
+}
+
+#if CONFIG_MODULE_USEJOYSTICK
+static void bench_joystick_report(void)
+{
+    esp_hidd_send_joy_value(0, 1, 2, 3, 4, 5, 6, 0, 0x5a);
+    host_notify_clear();
+}
+#endif
+
+static void bench_command(void)
+{
+    host_app_cmd("GV benchkey");
+}
+
+static void run(const char *name, void (*fn)(void), long iterations)
+{
+    struct timespec start, end;
+    double ns;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++) fn();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    printf("%-20s %10.1f ns/op (%ld ops)\n", name, ns / iterations, iterations);
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+    if (iterations <= 0) iterations = 1;
+
+    host_app_init();
+    host_app_connect(0);
+    uart_parser_init(&parser_buf, 0);
+    host_app_cmd("SV benchkey value");
+
+    run("parser (mouse frame)", bench_parser, iterations);
+    run("raw mouse frame", bench_mouse_frame, iterations);
+#if CONFIG_MODULE_USEJOYSTICK
+    run("joystick report", bench_joystick_report, iterations);
+#endif
+    run("$GV (cached)", bench_command, iterations);
+    return 0;
+}
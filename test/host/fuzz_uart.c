@@ -0,0 +1,55 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ *
+ * Fuzz target of the UART interface: the input is fed byte by byte to the
+ * parser of the external UART (raw frames, $ commands incl. binary payloads)
+ * with one connected host. Built with libFuzzer (clang, -DHOST_FUZZ=ON) or
+ * with fuzz_main.c, which runs the seed corpus (ctest).
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "host_app.h"
+
+/** @brief Longer inputs add no coverage, but slow down the fuzzer */
+#define FUZZ_MAX_INPUT 4096
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static int initialized;
+
+    if (!initialized) {
+        host_log_level(ESP_LOG_NONE);
+        host_app_init();
+        host_app_connect(0);
+        initialized = 1;
+    }
+    if (size > FUZZ_MAX_INPUT) return 0;
+
+    //each input starts with an idle parser
+    uart_parser_init(host_app_uart(), 1);
+    host_app_feed(data, size);
+    //let pending timers run (tap release, joystick rate limit, benchmark)
+    host_time_advance(50000);
+
+    host_uart_clear();
+    host_notify_clear();
+    return 0;
+}
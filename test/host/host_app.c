@@ -0,0 +1,82 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ *
+ * The firmware main file, built for the host: the static functions & variables
+ * of ble_hidd_demo_main.c are reachable from the helpers below.
+ */
+
+#include "host_app.h"
+
+#include "../../main/ble_hidd_demo_main.c"
+
+static struct cmdBuf host_uart_buffer;
+
+void host_app_init(void)
+{
+    eventgroup_system = xEventGroupCreate();
+    xEventGroupSetBits(eventgroup_system,SYSTEM_PAIRING_ENABLED);
+    ESP_ERROR_CHECK(nvs_flash_init());
+    config_load();
+    bond_cache_init(nvs_bt_name_h);
+    for(uint8_t i = 0; i<CONFIG_BT_ACL_CONNECTIONS;i++) active_hid_conn_ids[i] = -1;
+
+    ESP_ERROR_CHECK(esp_hidd_profile_init());
+    esp_ble_gap_register_callback(gap_event_handler);
+    esp_hidd_register_callbacks(hidd_event_callback,config.joystick_active);
+    #if CONFIG_MODULE_USEJOYSTICK
+    ESP_ERROR_CHECK(joystick_filter_init(joystick_send_filtered));
+    #endif
+    //register the apps, create & start the services, advertise
+    host_bt_run();
+
+    uart_handler_lock = xSemaphoreCreateMutexStatic(&uart_handler_lock_buf);
+    uart_parser_init(&host_uart_buffer, 1);
+}
+
+void host_app_connect(uint16_t conn_id)
+{
+    esp_bd_addr_t bda = {0x11, 0x22, 0x33, 0x44, 0x55, conn_id};
+    //7.5ms
+    host_bt_connect(conn_id, bda, 6);
+}
+
+void host_app_disconnect(uint16_t conn_id)
+{
+    esp_bd_addr_t bda = {0x11, 0x22, 0x33, 0x44, 0x55, conn_id};
+    host_bt_disconnect(conn_id, bda);
+}
+
+void host_app_feed(const uint8_t *data, int len)
+{
+    for(int i = 0; i < len; i++) uart_parse_command(data[i], &host_uart_buffer);
+}
+
+const char *host_app_cmd(const char *cmd)
+{
+    host_uart_clear();
+    host_app_feed((const uint8_t *)"$", 1);
+    host_app_feed((const uint8_t *)cmd, strlen(cmd));
+    host_app_feed((const uint8_t *)"\n", 1);
+    return host_uart_output(NULL);
+}
+
+struct cmdBuf *host_app_uart(void)
+{
+    return &host_uart_buffer;
+}
@@ -0,0 +1,56 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ */
+
+#ifndef _HOST_APP_H_
+#define _HOST_APP_H_
+
+#include "host_stubs.h"
+#include "uart_parser.h"
+
+/** @brief Firmware (main/ble_hidd_demo_main.c) on the host
+ *
+ * host_app.c includes the firmware main file, these functions give the tests
+ * access to its static parts. */
+
+/** @brief Bring up the firmware like app_main, without the BT controller
+ *
+ * Loads the config from the (empty) stubbed NVS, registers the HID profile
+ * and delivers the stack events until the services are started and the
+ * device advertises. Call once per process. */
+void host_app_init(void);
+
+/** @brief Connect a host and deliver all resulting events
+ * @param conn_id Connection ID, bda is 11:22:33:44:55:<conn_id> */
+void host_app_connect(uint16_t conn_id);
+
+/** @brief Disconnect a host connected with host_app_connect */
+void host_app_disconnect(uint16_t conn_id);
+
+/** @brief Feed bytes to the parser of the external UART (like uart_external_task) */
+void host_app_feed(const uint8_t *data, int len);
+
+/** @brief Feed an ASCII command (without '$' and line end) and return the UART output
+ * @return All output written since the last call of host_uart_clear, the output is cleared before sending */
+const char *host_app_cmd(const char *cmd);
+
+/** @brief Parser state of the external UART */
+struct cmdBuf *host_app_uart(void);
+
+#endif
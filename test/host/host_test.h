@@ -0,0 +1,69 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ */
+
+#ifndef _HOST_TEST_H_
+#define _HOST_TEST_H_
+
+#include <stdio.h>
+#include <string.h>
+
+/** @brief Minimal test helpers of the host tests
+ *
+ * A failed check prints the location and continues, TEST_RESULT is the
+ * exit code of main (0: all checks passed). */
+
+static int test_failures;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        test_failures++; \
+    } \
+} while (0)
+
+#define CHECK_EQ(a, b) do { \
+    long long _a = (long long)(a), _b = (long long)(b); \
+    if (_a != _b) { \
+        printf("%s:%d: check failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+        test_failures++; \
+    } \
+} while (0)
+
+#define CHECK_STR(s, prefix) do { \
+    const char *_s = (s); \
+    if (strncmp(_s, (prefix), strlen(prefix)) != 0) { \
+        printf("%s:%d: check failed: \"%s\" starts with \"%s\"\n", __FILE__, __LINE__, _s, (prefix)); \
+        test_failures++; \
+    } \
+} while (0)
+
+#define CHECK_MEM(a, b, len) do { \
+    if (memcmp((a), (b), (len)) != 0) { \
+        printf("%s:%d: check failed: %s == %s (%d bytes)\n", __FILE__, __LINE__, #a, #b, (int)(len)); \
+        test_failures++; \
+    } \
+} while (0)
+
+/** @brief Run one test function, print its name */
+#define RUN(test) do { printf("-- %s\n", #test); test(); } while (0)
+
+#define TEST_RESULT (test_failures != 0)
+
+#endif
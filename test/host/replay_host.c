@@ -0,0 +1,177 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ *
+ * Replay of a UART capture ($CP dump, see uart_capture.h) on the host build:
+ * the bytes are fed to the external UART parser (raw frames & commands) with
+ * the simulated time advanced like "$CP R speed" on the device, the resulting
+ * notifications are printed with their time.
+ * Usage: replay_host <dump file> [speed]  (1: original timing, n: n times faster, 0: as fast as possible)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_app.h"
+#include "hidd_le_prf_int.h"
+#include "uart_capture.h"
+
+/** @brief Time after the last byte for pending releases & rate limited reports (us) */
+#define REPLAY_TAIL_US  100000
+
+typedef struct {
+    int idx;            /// HIDD_LE_IDX_*
+    const char *name;
+    int count;
+    int64_t latency;    /// sum, from the last fed byte to the notification (us)
+} replay_report_t;
+
+static replay_report_t reports[] = {
+    { HIDD_LE_IDX_REPORT_KEY_IN_VAL, "keyboard" },
+    { HIDD_LE_IDX_REPORT_MOUSE_IN_VAL, "mouse" },
+#if CONFIG_MODULE_USEJOYSTICK
+    { HIDD_LE_IDX_REPORT_JOY_IN_VAL, "joystick" },
+#endif
+    { HIDD_LE_IDX_REPORT_CC_IN_VAL, "consumer" },
+    { HIDD_LE_IDX_REPORT_CC_EXT_IN_VAL, "consumer16" },
+    { HIDD_LE_IDX_BOOT_KB_IN_REPORT_VAL, "boot keyboard" },
+    { HIDD_LE_IDX_BOOT_MOUSE_IN_REPORT_VAL, "boot mouse" },
+};
+
+static int64_t start_us;
+static int64_t last_notify_us;
+
+/** @brief Load a dump ("CP:<count>,<size>\r\n", entries, "\r\nEND\r\n")
+ * @return Entries (to be freed) or NULL, *count is set to the number of entries */
+static uart_capture_entry_t *load_dump(const char *path, unsigned *count)
+{
+    FILE *f = fopen(path, "rb");
+    char header[32];
+    unsigned size;
+    uart_capture_entry_t *entries;
+
+    if (f == NULL) {
+        perror(path);
+        return NULL;
+    }
+    if (fgets(header, sizeof(header), f) == NULL || sscanf(header, "CP:%u,%u", count, &size) != 2 ||
+        size != sizeof(uart_capture_entry_t)) {
+        fprintf(stderr, "%s: no capture header (CP:<count>,%u)\n", path, (unsigned)sizeof(uart_capture_entry_t));
+        fclose(f);
+        return NULL;
+    }
+    entries = malloc(*count ? *count * size : 1);
+    if (entries == NULL || fread(entries, size, *count, f) != *count) {
+        fprintf(stderr, "%s: dump truncated\n", path);
+        free(entries);
+        entries = NULL;
+    }
+    fclose(f);
+    return entries;
+}
+
+static replay_report_t *find_report(uint16_t handle)
+{
+    for (unsigned i = 0; i < sizeof(reports) / sizeof(reports[0]); i++) {
+        if (hidd_le_env.hidd_inst.att_tbl[reports[i].idx] == handle) return &reports[i];
+    }
+    return NULL;
+}
+
+/** @brief Print & clear the notifications and UART replies since the last call */
+static void print_output(int64_t fed_us)
+{
+    size_t len;
+    const char *out = host_uart_output(&len);
+
+    for (int i = 0; i < host_notify_count(); i++) {
+        const host_notify_t *n = host_notify_get(i);
+        replay_report_t *r = find_report(n->handle);
+
+        printf("%12.3f ms  +%8lld us  conn %u %-14s", (n->time - start_us) / 1000.0,
+               (long long)(n->time - last_notify_us), n->conn_id, r ? r->name : "other");
+        for (int j = 0; j < n->len && j < HOST_NOTIFY_MAX_LEN; j++) printf(" %02x", n->data[j]);
+        printf("\n");
+        last_notify_us = n->time;
+        if (r != NULL) {
+            r->count++;
+            r->latency += n->time - fed_us;
+        }
+    }
+    host_notify_clear();
+
+    if (len) {
+        printf("%12.3f ms  uart: ", (esp_timer_get_time() - start_us) / 1000.0);
+        for (size_t i = 0; i < len; i++) {
+            if (out[i] == '\n') printf(i + 1 < len ? "\n%12s  uart: " : "\n", "");
+            else if (out[i] != '\r') putchar(out[i] >= ' ' && out[i] < 0x7f ? out[i] : '.');
+        }
+        if (out[len - 1] != '\n') printf("\n");
+        host_uart_clear();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uart_capture_entry_t *entries;
+    unsigned count;
+    long speed = argc > 2 ? atol(argv[2]) : 1;
+    int64_t offset = 0, fed_us;
+    int total = 0;
+
+    if (argc < 2 || speed < 0) {
+        fprintf(stderr, "usage: %s <dump file> [speed]\n", argv[0]);
+        return 2;
+    }
+    if ((entries = load_dump(argv[1], &count)) == NULL) return 1;
+
+    host_app_init();
+    host_app_connect(0);
+    host_time_advance(REPLAY_TAIL_US);
+    host_notify_clear();
+    host_uart_clear();
+
+    start_us = last_notify_us = fed_us = esp_timer_get_time();
+    for (unsigned i = 0; i < count; i++) {
+        //timestamps are the lower 32bit of the us timer
+        if (i > 0) offset += (uint32_t)(entries[i].timestamp - entries[i - 1].timestamp);
+        if (speed != UART_CAPTURE_SPEED_MAX) {
+            int64_t due = start_us + offset / speed;
+            if (due > esp_timer_get_time()) host_time_advance(due - esp_timer_get_time());
+            print_output(fed_us);
+        }
+        fed_us = esp_timer_get_time();
+        host_app_feed(&entries[i].data, 1);
+        print_output(fed_us);
+    }
+    host_time_advance(REPLAY_TAIL_US);
+    print_output(fed_us);
+
+    printf("replayed %u bytes in %.3f ms (original %.3f ms, speed %ld)\n", count,
+           (fed_us - start_us) / 1000.0, offset / 1000.0, speed);
+    for (unsigned i = 0; i < sizeof(reports) / sizeof(reports[0]); i++) {
+        if (reports[i].count == 0) continue;
+        printf("%-14s %6d report(s), avg. latency %lld us\n", reports[i].name, reports[i].count,
+               (long long)(reports[i].latency / reports[i].count));
+        total += reports[i].count;
+    }
+    printf("notifications: %d\n", total);
+    free(entries);
+    return 0;
+}
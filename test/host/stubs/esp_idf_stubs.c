@@ -0,0 +1,1124 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ *
+ * Stubbed ESP-IDF for the host build: FreeRTOS, esp_timer, NVS, UART and the
+ * Bluedroid GATTS/GAP API, just enough to run main/ without the BT stack.
+ * Single threaded: nothing happens unless the test calls into the firmware or
+ * one of the host_* functions (see host_stubs.h).
+ */
+
+#include "host_stubs.h"
+
+#include <string.h>
+#include <time.h>
+
+/* ---- esp_err.h ---- */
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+        case ESP_ERR_NVS_NOT_INITIALIZED: return "ESP_ERR_NVS_NOT_INITIALIZED";
+        case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_NVS_TYPE_MISMATCH: return "ESP_ERR_NVS_TYPE_MISMATCH";
+        case ESP_ERR_NVS_READ_ONLY: return "ESP_ERR_NVS_READ_ONLY";
+        case ESP_ERR_NVS_NOT_ENOUGH_SPACE: return "ESP_ERR_NVS_NOT_ENOUGH_SPACE";
+        case ESP_ERR_NVS_INVALID_NAME: return "ESP_ERR_NVS_INVALID_NAME";
+        case ESP_ERR_NVS_INVALID_HANDLE: return "ESP_ERR_NVS_INVALID_HANDLE";
+        case ESP_ERR_NVS_INVALID_LENGTH: return "ESP_ERR_NVS_INVALID_LENGTH";
+        case ESP_ERR_NVS_NO_FREE_PAGES: return "ESP_ERR_NVS_NO_FREE_PAGES";
+        case ESP_ERR_NVS_NEW_VERSION_FOUND: return "ESP_ERR_NVS_NEW_VERSION_FOUND";
+        default: return "UNKNOWN ERROR";
+    }
+}
+
+/* ---- esp_log.h ---- */
+
+static int log_level = -1;
+
+void host_log_level(esp_log_level_t level)
+{
+    log_level = level;
+}
+
+void host_log(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    static const char letter[] = "NEWIDV";
+    va_list args;
+
+    if (log_level < 0) {
+        const char *env = getenv("HOST_LOG");
+        log_level = env != NULL ? atoi(env) : ESP_LOG_WARN;
+    }
+    if ((int)level > log_level) return;
+    printf("%c (%s) ", letter[level], tag);
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    printf("\n");
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    //the firmware changes the level with $LGx, the host keeps its own
+    (void)tag;
+    (void)level;
+}
+
+void esp_log_buffer_hex(const char *tag, const void *buffer, uint16_t buff_len)
+{
+    char line[3 * 16 + 1];
+    const uint8_t *p = buffer;
+
+    for (uint16_t i = 0; i < buff_len; i += 16) {
+        int len = 0;
+        for (uint16_t n = i; n < buff_len && n < i + 16; n++) len += sprintf(&line[len], "%02x ", p[n]);
+        host_log(ESP_LOG_INFO, tag, "%s", line);
+    }
+}
+
+void esp_log_buffer_char(const char *tag, const void *buffer, uint16_t buff_len)
+{
+    host_log(ESP_LOG_INFO, tag, "%.*s", buff_len, (const char *)buffer);
+}
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func)
+{
+    static vprintf_like_t current = vprintf;
+    vprintf_like_t previous = current;
+    current = func;
+    return previous;
+}
+
+/* ---- time & esp_timer.h ---- */
+
+#define HOST_TIMERS_MAX 32
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    const char *name;
+    uint64_t period;
+    int64_t expiry;
+    bool active;
+};
+
+//simulated time since boot, starts at 1s
+static int64_t now_us = 1000000;
+static struct esp_timer *timers[HOST_TIMERS_MAX];
+
+int64_t esp_timer_get_time(void)
+{
+    return now_us;
+}
+
+uint32_t esp_log_timestamp(void)
+{
+    return now_us / 1000;
+}
+
+void host_time_advance(uint64_t us)
+{
+    int64_t target = now_us + us;
+
+    while (1) {
+        struct esp_timer *next = NULL;
+        for (int i = 0; i < HOST_TIMERS_MAX; i++) {
+            if (timers[i] == NULL || !timers[i]->active || timers[i]->expiry > target) continue;
+            if (next == NULL || timers[i]->expiry < next->expiry) next = timers[i];
+        }
+        if (next == NULL) break;
+        if (next->expiry > now_us) now_us = next->expiry;
+        if (next->period != 0) next->expiry += next->period;
+        else next->active = false;
+        //the callback may stop, restart or delete the timer
+        next->callback(next->arg);
+    }
+    now_us = target;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle)
+{
+    if (args == NULL || args->callback == NULL || out_handle == NULL) return ESP_ERR_INVALID_ARG;
+    for (int i = 0; i < HOST_TIMERS_MAX; i++) {
+        if (timers[i] != NULL) continue;
+        timers[i] = calloc(1, sizeof(struct esp_timer));
+        if (timers[i] == NULL) return ESP_ERR_NO_MEM;
+        timers[i]->callback = args->callback;
+        timers[i]->arg = args->arg;
+        timers[i]->name = args->name;
+        *out_handle = timers[i];
+        return ESP_OK;
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (timer == NULL) return ESP_ERR_INVALID_ARG;
+    if (timer->active) return ESP_ERR_INVALID_STATE;
+    timer->period = 0;
+    timer->expiry = now_us + timeout_us;
+    timer->active = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    if (timer == NULL || period == 0) return ESP_ERR_INVALID_ARG;
+    if (timer->active) return ESP_ERR_INVALID_STATE;
+    timer->period = period;
+    timer->expiry = now_us + period;
+    timer->active = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (timer == NULL) return ESP_ERR_INVALID_ARG;
+    if (!timer->active) return ESP_ERR_INVALID_STATE;
+    timer->active = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (timer == NULL) return ESP_ERR_INVALID_ARG;
+    if (timer->active) return ESP_ERR_INVALID_STATE;
+    for (int i = 0; i < HOST_TIMERS_MAX; i++) {
+        if (timers[i] == timer) timers[i] = NULL;
+    }
+    free(timer);
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return timer != NULL && timer->active;
+}
+
+uint32_t esp_cpu_get_cycle_count(void)
+{
+    //a 240MHz cycle counter from the monotonic clock
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec) * 240 / 1000);
+}
+
+/* ---- FreeRTOS ---- */
+
+#define HOST_TASKS_MAX 16
+
+typedef struct {
+    TaskFunction_t fn;
+    const char *name;
+    void *arg;
+} host_task_t;
+
+static host_task_t tasks[HOST_TASKS_MAX];
+static int task_cnt;
+static int restarts;
+
+//tasks are registered only, nothing runs concurrently on the host
+static TaskHandle_t task_add(TaskFunction_t fn, const char *name, void *arg)
+{
+    if (task_cnt == HOST_TASKS_MAX) return NULL;
+    tasks[task_cnt].fn = fn;
+    tasks[task_cnt].name = name;
+    tasks[task_cnt].arg = arg;
+    return &tasks[task_cnt++];
+}
+
+TaskFunction_t host_task_find(const char *name, void **arg)
+{
+    //the latest task with this name (tasks may be created again)
+    for (int i = task_cnt - 1; i >= 0; i--) {
+        if (strcmp(tasks[i].name, name) != 0) continue;
+        if (arg != NULL) *arg = tasks[i].arg;
+        return tasks[i].fn;
+    }
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t prio, TaskHandle_t *handle)
+{
+    TaskHandle_t task = task_add(fn, name, arg);
+    if (handle != NULL) *handle = task;
+    return task != NULL ? pdPASS : pdFAIL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t prio,
+                                   TaskHandle_t *handle, BaseType_t core)
+{
+    return xTaskCreate(fn, name, stack, arg, prio, handle);
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t prio,
+                               StackType_t *stack_buf, StaticTask_t *tcb)
+{
+    return task_add(fn, name, arg);
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t prio,
+                                           StackType_t *stack_buf, StaticTask_t *tcb, BaseType_t core)
+{
+    return task_add(fn, name, arg);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    (void)task;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    host_time_advance((uint64_t)ticks * 1000000 / CONFIG_FREERTOS_HZ);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(now_us * CONFIG_FREERTOS_HZ / 1000000);
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) { return 1; }
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) { return 1024; }
+UBaseType_t uxTaskGetNumberOfTasks(void) { return task_cnt; }
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *status, UBaseType_t size, uint32_t *total_runtime)
+{
+    UBaseType_t cnt = 0;
+    for (; cnt < size && cnt < (UBaseType_t)task_cnt; cnt++) {
+        memset(&status[cnt], 0, sizeof(TaskStatus_t));
+        status[cnt].xHandle = &tasks[cnt];
+        status[cnt].pcTaskName = tasks[cnt].name;
+        status[cnt].usStackHighWaterMark = 1024;
+    }
+    if (total_runtime != NULL) *total_runtime = 0;
+    return cnt;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return NULL; }
+char *pcTaskGetName(TaskHandle_t task) { return task != NULL ? (char *)((host_task_t *)task)->name : "main"; }
+BaseType_t xPortGetCoreID(void) { return 1; }
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) { return 0; }
+BaseType_t xTaskNotifyGive(TaskHandle_t task) { return pdPASS; }
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken) { }
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    return calloc(1, sizeof(EventBits_t));
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    return *(EventBits_t *)group |= bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    EventBits_t previous = *(EventBits_t *)group;
+    *(EventBits_t *)group &= ~bits;
+    return previous;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group)
+{
+    return *(EventBits_t *)group;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear, BaseType_t all, TickType_t ticks)
+{
+    //nobody else could set the bits, return immediately
+    EventBits_t current = *(EventBits_t *)group;
+    if (clear) *(EventBits_t *)group &= ~bits;
+    return current;
+}
+
+//single threaded: a mutex is always available
+static int semaphore_dummy;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) { return &semaphore_dummy; }
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buf) { return buf; }
+SemaphoreHandle_t xSemaphoreCreateBinary(void) { return &semaphore_dummy; }
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) { return pdTRUE; }
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) { return pdTRUE; }
+void vSemaphoreDelete(SemaphoreHandle_t sem) { }
+
+typedef struct {
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+    uint8_t data[];
+} host_queue_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    host_queue_t *q = calloc(1, sizeof(host_queue_t) + length * item_size);
+    if (q == NULL) return NULL;
+    q->length = length;
+    q->item_size = item_size;
+    return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+    host_queue_t *q = queue;
+    if (q->count == q->length) return pdFAIL;
+    memcpy(&q->data[((q->head + q->count) % q->length) * q->item_size], item, q->item_size);
+    q->count++;
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+    host_queue_t *q = queue;
+    if (q->count == 0) return pdFAIL;
+    memcpy(item, &q->data[q->head * q->item_size], q->item_size);
+    q->head = (q->head + 1) % q->length;
+    q->count--;
+    return pdPASS;
+}
+
+/* ---- esp_system.h, esp_heap_caps.h ---- */
+
+void esp_restart(void)
+{
+    //the firmware does not expect to return here, the tests check the counter
+    host_log(ESP_LOG_INFO, "host", "esp_restart");
+    restarts++;
+}
+
+int host_restart_count(void)
+{
+    return restarts;
+}
+
+uint32_t esp_random(void) { return (uint32_t)rand(); }
+uint32_t esp_get_free_heap_size(void) { return 200000; }
+uint32_t esp_get_minimum_free_heap_size(void) { return 150000; }
+size_t heap_caps_get_free_size(uint32_t caps) { return 200000; }
+size_t heap_caps_get_minimum_free_size(uint32_t caps) { return 150000; }
+size_t heap_caps_get_largest_free_block(uint32_t caps) { return 110000; }
+
+/* ---- nvs.h ---- */
+
+#define HOST_NVS_ENTRIES_MAX    512
+#define HOST_NVS_NAMESPACES_MAX 8
+//5 pages of 126 entries (minus one spare page), values take 32 byte entries
+#define HOST_NVS_TOTAL_ENTRIES  504
+
+typedef enum { NVS_TYPE_U8, NVS_TYPE_STR, NVS_TYPE_BLOB } host_nvs_type_t;
+
+typedef struct {
+    uint8_t ns;         /// namespace index + 1, 0: unused
+    host_nvs_type_t type;
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    size_t len;
+    uint8_t *data;
+} host_nvs_entry_t;
+
+static char nvs_namespaces[HOST_NVS_NAMESPACES_MAX][NVS_KEY_NAME_MAX_SIZE];
+static host_nvs_entry_t nvs_entries[HOST_NVS_ENTRIES_MAX];
+static esp_err_t nvs_fail_ret;
+static int nvs_commit_cnt;
+
+void host_nvs_fail(esp_err_t ret)
+{
+    nvs_fail_ret = ret;
+}
+
+int host_nvs_count(void)
+{
+    int cnt = 0;
+    for (int i = 0; i < HOST_NVS_ENTRIES_MAX; i++) {
+        if (nvs_entries[i].ns != 0) cnt++;
+    }
+    return cnt;
+}
+
+int host_nvs_commits(void)
+{
+    return nvs_commit_cnt;
+}
+
+esp_err_t nvs_flash_init(void) { return ESP_OK; }
+
+esp_err_t nvs_flash_erase(void)
+{
+    for (int i = 0; i < HOST_NVS_ENTRIES_MAX; i++) {
+        free(nvs_entries[i].data);
+        memset(&nvs_entries[i], 0, sizeof(host_nvs_entry_t));
+    }
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    if (name == NULL || strlen(name) >= NVS_KEY_NAME_MAX_SIZE) return ESP_ERR_NVS_INVALID_NAME;
+    for (int i = 0; i < HOST_NVS_NAMESPACES_MAX; i++) {
+        if (nvs_namespaces[i][0] == 0) strcpy(nvs_namespaces[i], name);
+        if (strcmp(nvs_namespaces[i], name) == 0) {
+            *out_handle = i + 1;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+}
+
+void nvs_close(nvs_handle_t handle) { }
+
+static host_nvs_entry_t *nvs_find(nvs_handle_t handle, const char *key)
+{
+    for (int i = 0; i < HOST_NVS_ENTRIES_MAX; i++) {
+        if (nvs_entries[i].ns == handle && strcmp(nvs_entries[i].key, key) == 0) return &nvs_entries[i];
+    }
+    return NULL;
+}
+
+static size_t nvs_span(const host_nvs_entry_t *e)
+{
+    return e->type == NVS_TYPE_U8 ? 1 : 1 + (e->len + 31) / 32;
+}
+
+static esp_err_t nvs_set(nvs_handle_t handle, const char *key, host_nvs_type_t type, const void *value, size_t len)
+{
+    host_nvs_entry_t *e;
+    size_t used = 0;
+
+    if (handle == 0 || handle > HOST_NVS_NAMESPACES_MAX) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (key == NULL || key[0] == 0 || strlen(key) >= NVS_KEY_NAME_MAX_SIZE) return ESP_ERR_NVS_INVALID_NAME;
+    if (nvs_fail_ret != ESP_OK) return nvs_fail_ret;
+
+    e = nvs_find(handle, key);
+    for (int i = 0; i < HOST_NVS_ENTRIES_MAX; i++) {
+        if (nvs_entries[i].ns != 0 && &nvs_entries[i] != e) used += nvs_span(&nvs_entries[i]);
+    }
+    if (used + 1 + (len + 31) / 32 > HOST_NVS_TOTAL_ENTRIES) return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+
+    if (e == NULL) {
+        for (int i = 0; i < HOST_NVS_ENTRIES_MAX && e == NULL; i++) {
+            if (nvs_entries[i].ns == 0) e = &nvs_entries[i];
+        }
+        if (e == NULL) return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        e->ns = handle;
+        strcpy(e->key, key);
+    }
+    free(e->data);
+    e->data = malloc(len ? len : 1);
+    memcpy(e->data, value, len);
+    e->len = len;
+    e->type = type;
+    return ESP_OK;
+}
+
+static esp_err_t nvs_get(nvs_handle_t handle, const char *key, host_nvs_type_t type, void *out, size_t *len)
+{
+    host_nvs_entry_t *e;
+
+    if (handle == 0 || handle > HOST_NVS_NAMESPACES_MAX) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (key == NULL || strlen(key) >= NVS_KEY_NAME_MAX_SIZE) return ESP_ERR_NVS_INVALID_NAME;
+    e = nvs_find(handle, key);
+    if (e == NULL || e->type != type) return ESP_ERR_NVS_NOT_FOUND;
+    if (out == NULL) {
+        *len = e->len;
+        return ESP_OK;
+    }
+    if (*len < e->len) {
+        *len = e->len;
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out, e->data, e->len);
+    *len = e->len;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value)
+{
+    return nvs_set(handle, key, NVS_TYPE_STR, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length)
+{
+    return nvs_get(handle, key, NVS_TYPE_STR, out_value, length);
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value)
+{
+    return nvs_set(handle, key, NVS_TYPE_U8, &value, 1);
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *out_value)
+{
+    size_t len = 1;
+    return nvs_get(handle, key, NVS_TYPE_U8, out_value, &len);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    return nvs_set(handle, key, NVS_TYPE_BLOB, value, length);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    return nvs_get(handle, key, NVS_TYPE_BLOB, out_value, length);
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    host_nvs_entry_t *e = nvs_find(handle, key);
+    if (nvs_fail_ret != ESP_OK) return nvs_fail_ret;
+    if (e == NULL) return ESP_ERR_NVS_NOT_FOUND;
+    free(e->data);
+    memset(e, 0, sizeof(host_nvs_entry_t));
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle)
+{
+    if (nvs_fail_ret != ESP_OK) return nvs_fail_ret;
+    for (int i = 0; i < HOST_NVS_ENTRIES_MAX; i++) {
+        if (nvs_entries[i].ns != handle) continue;
+        free(nvs_entries[i].data);
+        memset(&nvs_entries[i], 0, sizeof(host_nvs_entry_t));
+    }
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    nvs_commit_cnt++;
+    return nvs_fail_ret;
+}
+
+esp_err_t nvs_get_stats(const char *part_name, nvs_stats_t *nvs_stats)
+{
+    memset(nvs_stats, 0, sizeof(nvs_stats_t));
+    for (int i = 0; i < HOST_NVS_ENTRIES_MAX; i++) {
+        if (nvs_entries[i].ns != 0) nvs_stats->used_entries += nvs_span(&nvs_entries[i]);
+    }
+    for (int i = 0; i < HOST_NVS_NAMESPACES_MAX; i++) {
+        if (nvs_namespaces[i][0] != 0) nvs_stats->namespace_count++;
+    }
+    nvs_stats->total_entries = HOST_NVS_TOTAL_ENTRIES;
+    nvs_stats->free_entries = HOST_NVS_TOTAL_ENTRIES - nvs_stats->used_entries;
+    return ESP_OK;
+}
+
+/* ---- esp_rom_crc.h ---- */
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len)
+{
+    //same as zlib's crc32()
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int i = 0; i < 8; i++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+/* ---- partitions ---- */
+
+esp_partition_iterator_t esp_partition_find(int type, int subtype, const char *label) { return NULL; }
+const esp_partition_t *esp_partition_get(esp_partition_iterator_t iterator) { return NULL; }
+void esp_partition_iterator_release(esp_partition_iterator_t iterator) { }
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition) { return ESP_ERR_NOT_FOUND; }
+
+/* ---- GPIO, LEDC ---- */
+
+esp_err_t gpio_config(const gpio_config_t *config) { return ESP_OK; }
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level) { return ESP_OK; }
+int gpio_get_level(gpio_num_t gpio_num) { return 1; }
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode) { return ESP_OK; }
+esp_err_t ledc_timer_config(const ledc_timer_config_t *timer_conf) { return ESP_OK; }
+esp_err_t ledc_channel_config(const ledc_channel_config_t *ledc_conf) { return ESP_OK; }
+esp_err_t ledc_timer_set(ledc_mode_t speed_mode, ledc_timer_t timer_sel, uint32_t clock_divider, uint32_t duty_resolution,
+                         ledc_clk_src_t clk_src) { return ESP_OK; }
+esp_err_t ledc_set_freq(ledc_mode_t speed_mode, ledc_timer_t timer_num, uint32_t freq_hz) { return ESP_OK; }
+esp_err_t ledc_set_duty(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty) { return ESP_OK; }
+esp_err_t ledc_update_duty(ledc_mode_t speed_mode, ledc_channel_t channel) { return ESP_OK; }
+esp_err_t ledc_stop(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t idle_level) { return ESP_OK; }
+
+/* ---- UART ---- */
+
+static char *uart_out;
+static size_t uart_out_len;
+static size_t uart_out_size;
+
+const char *host_uart_output(size_t *len)
+{
+    if (len != NULL) *len = uart_out_len;
+    return uart_out != NULL ? uart_out : "";
+}
+
+void host_uart_clear(void)
+{
+    uart_out_len = 0;
+    if (uart_out != NULL) uart_out[0] = 0;
+}
+
+int uart_write_bytes(int uart_num, const void *src, size_t size)
+{
+    if (uart_out_len + size + 1 > uart_out_size) {
+        size_t newsize = (uart_out_len + size + 1) * 2;
+        char *p = realloc(uart_out, newsize);
+        if (p == NULL) return -1;
+        uart_out = p;
+        uart_out_size = newsize;
+    }
+    memcpy(&uart_out[uart_out_len], src, size);
+    uart_out_len += size;
+    uart_out[uart_out_len] = 0;
+    return size;
+}
+
+int uart_read_bytes(int uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait)
+{
+    //the tests feed the parser directly
+    return 0;
+}
+
+esp_err_t uart_param_config(int uart_num, const uart_config_t *uart_config) { return ESP_OK; }
+esp_err_t uart_set_pin(int uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num) { return ESP_OK; }
+esp_err_t uart_driver_install(int uart_num, int rx_buffer_size, int tx_buffer_size, int queue_size,
+                              QueueHandle_t *uart_queue, int intr_alloc_flags) { return ESP_OK; }
+
+esp_err_t uart_get_buffered_data_len(int uart_num, size_t *size)
+{
+    *size = 0;
+    return ESP_OK;
+}
+
+/* ---- BT controller ---- */
+
+esp_err_t esp_bt_controller_mem_release(esp_bt_mode_t mode) { return ESP_OK; }
+esp_err_t esp_bt_controller_init(esp_bt_controller_config_t *cfg) { return ESP_OK; }
+esp_err_t esp_bt_controller_enable(esp_bt_mode_t mode) { return ESP_OK; }
+esp_err_t esp_bluedroid_init(void) { return ESP_OK; }
+esp_err_t esp_bluedroid_enable(void) { return ESP_OK; }
+
+/* ---- GATTS & GAP: events ---- */
+
+#define HOST_EVENTS_MAX 32
+
+typedef struct {
+    bool gap;
+    int event;
+    esp_gatt_if_t gatts_if;
+    union {
+        esp_ble_gatts_cb_param_t gatts;
+        esp_ble_gap_cb_param_t gap;
+    } param;
+} host_event_t;
+
+static esp_gatts_cb_t gatts_cb;
+static esp_gap_ble_cb_t gap_cb;
+static host_event_t events[HOST_EVENTS_MAX];
+static int event_head, event_cnt;
+static esp_gatt_if_t last_gatts_if = 2;
+
+static host_event_t *event_add(bool gap, int event, esp_gatt_if_t gatts_if)
+{
+    host_event_t *e;
+    if (event_cnt == HOST_EVENTS_MAX) {
+        host_log(ESP_LOG_ERROR, "host", "BT event queue full, event %d dropped", event);
+        return NULL;
+    }
+    e = &events[(event_head + event_cnt++) % HOST_EVENTS_MAX];
+    memset(e, 0, sizeof(host_event_t));
+    e->gap = gap;
+    e->event = event;
+    e->gatts_if = gatts_if;
+    return e;
+}
+
+int host_bt_run(void)
+{
+    int cnt = 0;
+    //events queued by the callbacks are delivered as well
+    while (event_cnt > 0) {
+        host_event_t e = events[event_head];
+        event_head = (event_head + 1) % HOST_EVENTS_MAX;
+        event_cnt--;
+        if (e.gap) host_bt_gap_event(e.event, &e.param.gap);
+        else host_bt_gatts_event(e.event, e.gatts_if, &e.param.gatts);
+        cnt++;
+    }
+    return cnt;
+}
+
+void host_bt_gatts_event(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param)
+{
+    if (gatts_cb != NULL) gatts_cb(event, gatts_if, param);
+}
+
+void host_bt_gap_event(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
+{
+    if (gap_cb != NULL) gap_cb(event, param);
+}
+
+esp_gatt_if_t host_bt_gatts_if(void)
+{
+    return last_gatts_if;
+}
+
+void host_bt_connect(uint16_t conn_id, const esp_bd_addr_t bda, uint16_t interval)
+{
+    esp_ble_gatts_cb_param_t param = {0};
+    param.connect.conn_id = conn_id;
+    memcpy(param.connect.remote_bda, bda, ESP_BD_ADDR_LEN);
+    param.connect.conn_params.interval = interval;
+    param.connect.conn_params.timeout = 400;
+    host_bt_gatts_event(ESP_GATTS_CONNECT_EVT, last_gatts_if, &param);
+    host_bt_run();
+}
+
+void host_bt_disconnect(uint16_t conn_id, const esp_bd_addr_t bda)
+{
+    esp_ble_gatts_cb_param_t param = {0};
+    param.disconnect.conn_id = conn_id;
+    memcpy(param.disconnect.remote_bda, bda, ESP_BD_ADDR_LEN);
+    param.disconnect.reason = 0x13;
+    host_bt_gatts_event(ESP_GATTS_DISCONNECT_EVT, last_gatts_if, &param);
+    host_bt_run();
+}
+
+/* ---- GATTS: attribute tables & notifications ---- */
+
+#define HOST_ATTRS_MAX 128
+
+typedef struct {
+    uint16_t handle;
+    uint16_t perm;
+    uint8_t auto_rsp;
+    uint16_t max_len;
+    uint16_t len;
+    uint8_t *value;
+} host_attr_t;
+
+static host_attr_t attrs[HOST_ATTRS_MAX];
+static int attr_cnt;
+static uint16_t attr_handles[HOST_ATTRS_MAX];
+
+static host_notify_t notifications[256];
+static int notify_cnt;
+static esp_err_t notify_ret;
+
+static host_attr_t *attr_find(uint16_t handle)
+{
+    for (int i = 0; i < attr_cnt; i++) {
+        if (attrs[i].handle == handle) return &attrs[i];
+    }
+    return NULL;
+}
+
+int host_attr_perm(uint16_t handle)
+{
+    host_attr_t *a = attr_find(handle);
+    return a != NULL ? a->perm : -1;
+}
+
+const uint8_t *host_attr_value(uint16_t handle, uint16_t *len)
+{
+    host_attr_t *a = attr_find(handle);
+    if (a == NULL) return NULL;
+    if (len != NULL) *len = a->len;
+    return a->value;
+}
+
+static struct {
+    bool sent;
+    uint32_t trans_id;
+    esp_gatt_status_t status;
+    esp_gatt_value_t value;
+} gatt_rsp;
+static uint32_t last_trans_id;
+
+int host_bt_write(uint16_t conn_id, uint16_t handle, const uint8_t *value, uint16_t len)
+{
+    esp_ble_gatts_cb_param_t param = {0};
+    host_attr_t *a = attr_find(handle);
+    uint8_t data[64];
+
+    if (len > sizeof(data)) len = sizeof(data);
+    memcpy(data, value, len);
+    memset(&gatt_rsp, 0, sizeof(gatt_rsp));
+    param.write.conn_id = conn_id;
+    param.write.trans_id = ++last_trans_id;
+    param.write.handle = handle;
+    param.write.len = len;
+    param.write.value = data;
+    //write requests to auto_rsp attributes are answered by the stack
+    param.write.need_rsp = a == NULL || !a->auto_rsp;
+    if (!param.write.need_rsp) {
+        gatt_rsp.sent = true;
+        gatt_rsp.trans_id = param.write.trans_id;
+        gatt_rsp.status = ESP_GATT_OK;
+    }
+    host_bt_gatts_event(ESP_GATTS_WRITE_EVT, last_gatts_if, &param);
+    host_bt_run();
+
+    if (!gatt_rsp.sent || gatt_rsp.trans_id != param.write.trans_id) return -1;
+    return gatt_rsp.status;
+}
+
+int host_bt_read(uint16_t conn_id, uint16_t handle, uint8_t *value, uint16_t *len)
+{
+    esp_ble_gatts_cb_param_t param = {0};
+    host_attr_t *a = attr_find(handle);
+    uint16_t n;
+
+    memset(&gatt_rsp, 0, sizeof(gatt_rsp));
+    param.read.conn_id = conn_id;
+    param.read.trans_id = ++last_trans_id;
+    param.read.handle = handle;
+    //the stack answers auto_rsp attributes from the stored value, the event is delivered anyway
+    param.read.need_rsp = a == NULL || !a->auto_rsp;
+    if (!param.read.need_rsp) {
+        gatt_rsp.sent = true;
+        gatt_rsp.trans_id = param.read.trans_id;
+        gatt_rsp.status = ESP_GATT_OK;
+        gatt_rsp.value.len = a->len;
+        memcpy(gatt_rsp.value.value, a->value, a->len);
+    }
+    host_bt_gatts_event(ESP_GATTS_READ_EVT, last_gatts_if, &param);
+    host_bt_run();
+
+    if (!gatt_rsp.sent || gatt_rsp.trans_id != param.read.trans_id) return -1;
+    n = gatt_rsp.value.len < *len ? gatt_rsp.value.len : *len;
+    memcpy(value, gatt_rsp.value.value, n);
+    *len = n;
+    return gatt_rsp.status;
+}
+
+esp_err_t esp_ble_gatts_send_response(esp_gatt_if_t gatts_if, uint16_t conn_id, uint32_t trans_id,
+                                      esp_gatt_status_t status, esp_gatt_rsp_t *rsp)
+{
+    //only the response to the pending host_bt_read / host_bt_write is recorded
+    if (trans_id != last_trans_id) return ESP_OK;
+    gatt_rsp.sent = true;
+    gatt_rsp.trans_id = trans_id;
+    gatt_rsp.status = status;
+    if (rsp != NULL) gatt_rsp.value = rsp->attr_value;
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_register_callback(esp_gatts_cb_t callback)
+{
+    gatts_cb = callback;
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_app_register(uint16_t app_id)
+{
+    host_event_t *e = event_add(false, ESP_GATTS_REG_EVT, ++last_gatts_if);
+    if (e == NULL) return ESP_FAIL;
+    e->param.gatts.reg.status = ESP_GATT_OK;
+    e->param.gatts.reg.app_id = app_id;
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_app_unregister(esp_gatt_if_t gatts_if) { return ESP_OK; }
+
+esp_err_t esp_ble_gatts_create_attr_tab(const esp_gatts_attr_db_t *gatts_attr_db, esp_gatt_if_t gatts_if,
+                                        uint16_t max_nb_attr, uint8_t srvc_inst_id)
+{
+    host_event_t *e;
+    uint16_t *handles = &attr_handles[attr_cnt];
+
+    if (attr_cnt + max_nb_attr > HOST_ATTRS_MAX) return ESP_ERR_NO_MEM;
+    //the stack copies the table, handles are assigned in order
+    for (uint16_t i = 0; i < max_nb_attr; i++) {
+        const esp_attr_desc_t *d = &gatts_attr_db[i].att_desc;
+        host_attr_t *a = &attrs[attr_cnt++];
+        uint16_t size = d->max_length > d->length ? d->max_length : d->length;
+        a->handle = attr_cnt;
+        a->perm = d->perm;
+        a->auto_rsp = gatts_attr_db[i].attr_control.auto_rsp;
+        a->max_len = size;
+        a->len = d->length;
+        a->value = calloc(1, size ? size : 1);
+        if (d->value != NULL) memcpy(a->value, d->value, d->length);
+        handles[i] = a->handle;
+    }
+
+    e = event_add(false, ESP_GATTS_CREAT_ATTR_TAB_EVT, gatts_if);
+    if (e == NULL) return ESP_FAIL;
+    e->param.gatts.add_attr_tab.status = ESP_GATT_OK;
+    e->param.gatts.add_attr_tab.svc_inst_id = srvc_inst_id;
+    e->param.gatts.add_attr_tab.num_handle = max_nb_attr;
+    e->param.gatts.add_attr_tab.handles = handles;
+    //service UUID: value of the primary service declaration
+    e->param.gatts.add_attr_tab.svc_uuid.len = gatts_attr_db[0].att_desc.length;
+    if (gatts_attr_db[0].att_desc.length == ESP_UUID_LEN_16) {
+        e->param.gatts.add_attr_tab.svc_uuid.uuid.uuid16 =
+            gatts_attr_db[0].att_desc.value[0] | (gatts_attr_db[0].att_desc.value[1] << 8);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_start_service(uint16_t service_handle) { return ESP_OK; }
+esp_err_t esp_ble_gatts_stop_service(uint16_t service_handle) { return ESP_OK; }
+esp_err_t esp_ble_gatts_delete_service(uint16_t service_handle) { return ESP_OK; }
+esp_err_t esp_ble_gatt_set_local_mtu(uint16_t mtu) { return ESP_OK; }
+
+esp_err_t esp_ble_gatts_set_attr_value(uint16_t attr_handle, uint16_t length, const uint8_t *value)
+{
+    host_attr_t *a = attr_find(attr_handle);
+    if (a == NULL) return ESP_ERR_INVALID_ARG;
+    if (length > a->max_len) return ESP_ERR_INVALID_SIZE;
+    memcpy(a->value, value, length);
+    a->len = length;
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_get_attr_value(uint16_t attr_handle, uint16_t *length, const uint8_t **value)
+{
+    host_attr_t *a = attr_find(attr_handle);
+    if (a == NULL) return ESP_ERR_INVALID_ARG;
+    *length = a->len;
+    *value = a->value;
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_send_indicate(esp_gatt_if_t gatts_if, uint16_t conn_id, uint16_t attr_handle,
+                                      uint16_t value_len, uint8_t *value, bool need_confirm)
+{
+    host_notify_t *n;
+
+    if (notify_ret != ESP_OK) return notify_ret;
+    if (notify_cnt == sizeof(notifications) / sizeof(notifications[0])) return ESP_ERR_NO_MEM;
+    n = &notifications[notify_cnt++];
+    n->gatts_if = gatts_if;
+    n->conn_id = conn_id;
+    n->handle = attr_handle;
+    n->len = value_len;
+    n->time = now_us;
+    memcpy(n->data, value, value_len < HOST_NOTIFY_MAX_LEN ? value_len : HOST_NOTIFY_MAX_LEN);
+    return ESP_OK;
+}
+
+int host_notify_count(void)
+{
+    return notify_cnt;
+}
+
+const host_notify_t *host_notify_get(int idx)
+{
+    return idx >= 0 && idx < notify_cnt ? &notifications[idx] : NULL;
+}
+
+const host_notify_t *host_notify_last(void)
+{
+    return host_notify_get(notify_cnt - 1);
+}
+
+void host_notify_clear(void)
+{
+    notify_cnt = 0;
+}
+
+void host_notify_result(esp_err_t ret)
+{
+    notify_ret = ret;
+}
+
+/* ---- GAP ---- */
+
+esp_err_t esp_ble_gap_register_callback(esp_gap_ble_cb_t callback)
+{
+    gap_cb = callback;
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_config_adv_data(esp_ble_adv_data_t *adv_data)
+{
+    host_event_t *e = event_add(true, ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT, 0);
+    return e != NULL ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_ble_gap_start_advertising(esp_ble_adv_params_t *adv_params)
+{
+    host_event_t *e = event_add(true, ESP_GAP_BLE_ADV_START_COMPLETE_EVT, 0);
+    return e != NULL ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_ble_remove_bond_device(esp_bd_addr_t bd_addr)
+{
+    host_event_t *e = event_add(true, ESP_GAP_BLE_REMOVE_BOND_DEV_COMPLETE_EVT, 0);
+    if (e == NULL) return ESP_FAIL;
+    memcpy(e->param.gap.remove_bond_dev_cmpl.bd_addr, bd_addr, ESP_BD_ADDR_LEN);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_set_device_name(const char *name) { return ESP_OK; }
+esp_err_t esp_ble_gap_config_local_icon(uint16_t icon) { return ESP_OK; }
+esp_err_t esp_ble_gap_set_scan_params(esp_ble_scan_params_t *scan_params) { return ESP_OK; }
+esp_err_t esp_ble_gap_start_scanning(uint32_t duration) { return ESP_OK; }
+esp_err_t esp_ble_gap_security_rsp(esp_bd_addr_t bd_addr, bool accept) { return ESP_OK; }
+esp_err_t esp_ble_gap_update_conn_params(esp_ble_conn_update_params_t *params) { return ESP_OK; }
+esp_err_t esp_ble_gap_update_whitelist(bool add_remove, esp_bd_addr_t remote_bda, esp_ble_wl_addr_type_t wl_addr_type) { return ESP_OK; }
+esp_err_t esp_ble_gap_set_security_param(esp_ble_sm_param_t param_type, void *value, uint8_t len) { return ESP_OK; }
+esp_err_t esp_ble_set_encryption(esp_bd_addr_t bd_addr, esp_ble_sec_act_t sec_act) { return ESP_OK; }
+int esp_ble_get_bond_device_num(void) { return 0; }
+
+esp_err_t esp_ble_get_current_conn_params(esp_bd_addr_t bd_addr, esp_gap_conn_params_t *conn_params)
+{
+    memset(conn_params, 0, sizeof(esp_gap_conn_params_t));
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_get_bond_device_list(int *dev_num, esp_ble_bond_dev_t *dev_list)
+{
+    *dev_num = 0;
+    return ESP_OK;
+}
+
+uint8_t *esp_ble_resolve_adv_data(uint8_t *adv_data, uint8_t type, uint8_t *length)
+{
+    //AD structures: length, type, data
+    for (int i = 0; i + 1 < ESP_BLE_ADV_DATA_LEN_MAX + ESP_BLE_SCAN_RSP_DATA_LEN_MAX && adv_data[i] != 0; i += adv_data[i] + 1) {
+        if (adv_data[i + 1] == type) {
+            *length = adv_data[i] - 1;
+            return &adv_data[i + 2];
+        }
+    }
+    *length = 0;
+    return NULL;
+}
+
+/* ---- reset ---- */
+
+void host_stubs_reset(void)
+{
+    host_notify_clear();
+    host_notify_result(ESP_OK);
+    host_uart_clear();
+    host_nvs_fail(ESP_OK);
+}
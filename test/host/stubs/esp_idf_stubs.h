@@ -0,0 +1,651 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ */
+
+#ifndef _ESP_IDF_STUBS_H_
+#define _ESP_IDF_STUBS_H_
+
+/** @brief ESP-IDF declarations used by main/, for the host build
+ *
+ * All IDF headers included by the firmware (esp_log.h, freertos/task.h,...) include
+ * this file. Only the parts used by the firmware are declared, types & values
+ * follow ESP-IDF v5.0 where the firmware depends on them. The implementation
+ * (in-memory NVS, recorded notifications & UART output, simulated time) is in
+ * esp_idf_stubs.c, host_stubs.h is the interface for the tests. */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "sdkconfig.h"
+
+/* ---- esp_err.h ---- */
+typedef int esp_err_t;
+#define ESP_OK                          0
+#define ESP_FAIL                        -1
+#define ESP_ERR_NO_MEM                  0x101
+#define ESP_ERR_INVALID_ARG             0x102
+#define ESP_ERR_INVALID_STATE           0x103
+#define ESP_ERR_INVALID_SIZE            0x104
+#define ESP_ERR_NOT_FOUND               0x105
+#define ESP_ERR_NOT_SUPPORTED           0x106
+#define ESP_ERR_TIMEOUT                 0x107
+#define ESP_ERR_INVALID_CRC             0x109
+#define ESP_ERR_NVS_BASE                0x1100
+#define ESP_ERR_NVS_NOT_INITIALIZED     (ESP_ERR_NVS_BASE + 0x01)
+#define ESP_ERR_NVS_NOT_FOUND           (ESP_ERR_NVS_BASE + 0x02)
+#define ESP_ERR_NVS_TYPE_MISMATCH       (ESP_ERR_NVS_BASE + 0x03)
+#define ESP_ERR_NVS_READ_ONLY           (ESP_ERR_NVS_BASE + 0x04)
+#define ESP_ERR_NVS_NOT_ENOUGH_SPACE    (ESP_ERR_NVS_BASE + 0x05)
+#define ESP_ERR_NVS_INVALID_NAME        (ESP_ERR_NVS_BASE + 0x06)
+#define ESP_ERR_NVS_INVALID_HANDLE      (ESP_ERR_NVS_BASE + 0x07)
+#define ESP_ERR_NVS_INVALID_LENGTH      (ESP_ERR_NVS_BASE + 0x0c)
+#define ESP_ERR_NVS_NO_FREE_PAGES       (ESP_ERR_NVS_BASE + 0x0d)
+#define ESP_ERR_NVS_NEW_VERSION_FOUND   (ESP_ERR_NVS_BASE + 0x10)
+#define ESP_ERROR_CHECK(x) do { esp_err_t err_rc_ = (x); if (err_rc_ != ESP_OK) abort(); } while(0)
+const char *esp_err_to_name(esp_err_t code);
+
+/* ---- esp_log.h ---- */
+typedef enum {
+    ESP_LOG_NONE, ESP_LOG_ERROR, ESP_LOG_WARN, ESP_LOG_INFO, ESP_LOG_DEBUG, ESP_LOG_VERBOSE
+} esp_log_level_t;
+typedef int (*vprintf_like_t)(const char *, va_list);
+void host_log(esp_log_level_t level, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+#define ESP_LOGE(tag, format, ...) host_log(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) host_log(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) host_log(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) host_log(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) host_log(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+void esp_log_buffer_hex(const char *tag, const void *buffer, uint16_t buff_len);
+void esp_log_buffer_char(const char *tag, const void *buffer, uint16_t buff_len);
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func);
+uint32_t esp_log_timestamp(void);
+
+/* ---- FreeRTOS ---- */
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t StackType_t;
+typedef uint32_t EventBits_t;
+typedef void *TaskHandle_t;
+typedef void *EventGroupHandle_t;
+typedef void *QueueHandle_t;
+typedef void *SemaphoreHandle_t;
+typedef void (*TaskFunction_t)(void *);
+typedef struct { void *dummy[32]; } StaticTask_t;
+typedef struct { void *dummy[16]; } StaticSemaphore_t;
+typedef struct { int owner; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    { 0 }
+#define portMAX_DELAY                   ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS              (1000 / CONFIG_FREERTOS_HZ)
+#define pdMS_TO_TICKS(ms)               ((TickType_t)(((TickType_t)(ms) * CONFIG_FREERTOS_HZ) / 1000))
+#define pdTRUE                          1
+#define pdFALSE                         0
+#define pdPASS                          pdTRUE
+#define pdFAIL                          pdFALSE
+#define configMAX_PRIORITIES            25
+#define tskIDLE_PRIORITY                0
+#define tskNO_AFFINITY                  0x7fffffff
+#define PRO_CPU_NUM                     0
+#define APP_CPU_NUM                     1
+#define portNUM_PROCESSORS              2
+//single threaded on the host, critical sections are not needed
+#define portENTER_CRITICAL(mux)         (void)(mux)
+#define portEXIT_CRITICAL(mux)          (void)(mux)
+#define portENTER_CRITICAL_ISR(mux)     (void)(mux)
+#define portEXIT_CRITICAL_ISR(mux)      (void)(mux)
+#define taskENTER_CRITICAL(mux)         (void)(mux)
+#define taskEXIT_CRITICAL(mux)          (void)(mux)
+#define portYIELD_FROM_ISR(x)           (void)(x)
+
+typedef enum { eRunning, eReady, eBlocked, eSuspended, eDeleted, eInvalid } eTaskState;
+typedef struct {
+    TaskHandle_t xHandle;
+    const char *pcTaskName;
+    UBaseType_t xTaskNumber;
+    eTaskState eCurrentState;
+    UBaseType_t uxCurrentPriority;
+    UBaseType_t uxBasePriority;
+    uint32_t ulRunTimeCounter;
+    StackType_t *pxStackBase;
+    uint32_t usStackHighWaterMark;
+    BaseType_t xCoreID;
+} TaskStatus_t;
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t prio, TaskHandle_t *handle);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t prio,
+                                   TaskHandle_t *handle, BaseType_t core);
+TaskHandle_t xTaskCreateStatic(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t prio,
+                               StackType_t *stack_buf, StaticTask_t *tcb);
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t prio,
+                                           StackType_t *stack_buf, StaticTask_t *tcb, BaseType_t core);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+UBaseType_t uxTaskGetNumberOfTasks(void);
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *status, UBaseType_t size, uint32_t *total_runtime);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+char *pcTaskGetName(TaskHandle_t task);
+BaseType_t xPortGetCoreID(void);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken);
+
+EventGroupHandle_t xEventGroupCreate(void);
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear, BaseType_t all, TickType_t ticks);
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buf);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+void vSemaphoreDelete(SemaphoreHandle_t sem);
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks);
+
+/* ---- esp_system.h, esp_heap_caps.h, esp_cpu.h ---- */
+void esp_restart(void);
+uint32_t esp_random(void);
+uint32_t esp_get_free_heap_size(void);
+uint32_t esp_get_minimum_free_heap_size(void);
+#define MALLOC_CAP_8BIT         (1 << 2)
+#define MALLOC_CAP_INTERNAL     (1 << 11)
+#define MALLOC_CAP_DEFAULT      (1 << 12)
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+uint32_t esp_cpu_get_cycle_count(void);
+
+/* ---- esp_timer.h ---- */
+typedef struct esp_timer *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *arg);
+typedef enum { ESP_TIMER_TASK } esp_timer_dispatch_t;
+typedef struct {
+    esp_timer_cb_t callback;
+    void *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char *name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+bool esp_timer_is_active(esp_timer_handle_t timer);
+int64_t esp_timer_get_time(void);
+
+/* ---- nvs.h, nvs_flash.h ---- */
+typedef uint32_t nvs_handle_t;
+typedef nvs_handle_t nvs_handle;
+typedef enum { NVS_READONLY, NVS_READWRITE } nvs_open_mode_t;
+typedef nvs_open_mode_t nvs_open_mode;
+typedef struct {
+    size_t used_entries;
+    size_t free_entries;
+    size_t total_entries;
+    size_t namespace_count;
+} nvs_stats_t;
+#define NVS_KEY_NAME_MAX_SIZE 16
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle);
+void nvs_close(nvs_handle_t handle);
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value);
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length);
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value);
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *out_value);
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length);
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length);
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key);
+esp_err_t nvs_erase_all(nvs_handle_t handle);
+esp_err_t nvs_commit(nvs_handle_t handle);
+esp_err_t nvs_get_stats(const char *part_name, nvs_stats_t *nvs_stats);
+
+/* ---- esp_rom_crc.h ---- */
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len);
+
+/* ---- esp_partition.h, esp_ota_ops.h ---- */
+typedef struct { uint32_t address; } esp_partition_t;
+typedef void *esp_partition_iterator_t;
+#define ESP_PARTITION_TYPE_APP              0
+#define ESP_PARTITION_SUBTYPE_APP_FACTORY   0
+esp_partition_iterator_t esp_partition_find(int type, int subtype, const char *label);
+const esp_partition_t *esp_partition_get(esp_partition_iterator_t iterator);
+void esp_partition_iterator_release(esp_partition_iterator_t iterator);
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition);
+
+/* ---- driver/gpio.h ---- */
+typedef int gpio_num_t;
+#define GPIO_NUM_5  5
+#define GPIO_NUM_16 16
+#define GPIO_NUM_17 17
+#define GPIO_NUM_26 26
+typedef enum { GPIO_MODE_INPUT, GPIO_MODE_OUTPUT } gpio_mode_t;
+typedef enum { GPIO_INTR_DISABLE } gpio_int_type_t;
+typedef struct {
+    uint64_t pin_bit_mask;
+    gpio_mode_t mode;
+    int pull_up_en;
+    int pull_down_en;
+    gpio_int_type_t intr_type;
+} gpio_config_t;
+esp_err_t gpio_config(const gpio_config_t *config);
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level);
+int gpio_get_level(gpio_num_t gpio_num);
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode);
+
+/* ---- driver/uart.h ---- */
+#define UART_NUM_0          0
+#define UART_NUM_1          1
+#define UART_NUM_2          2
+#define UART_FIFO_LEN       128
+#define UART_PIN_NO_CHANGE  (-1)
+typedef enum { UART_DATA_8_BITS = 3 } uart_word_length_t;
+typedef enum { UART_PARITY_DISABLE } uart_parity_t;
+typedef enum { UART_STOP_BITS_1 = 1 } uart_stop_bits_t;
+typedef enum { UART_HW_FLOWCTRL_DISABLE } uart_hw_flowcontrol_t;
+typedef enum { UART_SCLK_DEFAULT } uart_sclk_t;
+typedef struct {
+    int baud_rate;
+    uart_word_length_t data_bits;
+    uart_parity_t parity;
+    uart_stop_bits_t stop_bits;
+    uart_hw_flowcontrol_t flow_ctrl;
+    uint8_t rx_flow_ctrl_thresh;
+    uart_sclk_t source_clk;
+} uart_config_t;
+esp_err_t uart_param_config(int uart_num, const uart_config_t *uart_config);
+esp_err_t uart_set_pin(int uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num);
+esp_err_t uart_driver_install(int uart_num, int rx_buffer_size, int tx_buffer_size, int queue_size,
+                              QueueHandle_t *uart_queue, int intr_alloc_flags);
+int uart_read_bytes(int uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait);
+int uart_write_bytes(int uart_num, const void *src, size_t size);
+esp_err_t uart_get_buffered_data_len(int uart_num, size_t *size);
+
+/* ---- driver/ledc.h ---- */
+typedef enum { LEDC_LOW_SPEED_MODE } ledc_mode_t;
+typedef enum { LEDC_TIMER_0 } ledc_timer_t;
+typedef enum { LEDC_CHANNEL_0 } ledc_channel_t;
+typedef enum { LEDC_TIMER_12_BIT = 12, LEDC_TIMER_13_BIT = 13 } ledc_timer_bit_t;
+typedef enum { LEDC_AUTO_CLK, LEDC_USE_REF_TICK } ledc_clk_cfg_t;
+typedef enum { LEDC_REF_TICK, LEDC_APB_CLK } ledc_clk_src_t;
+typedef enum { LEDC_INTR_DISABLE } ledc_intr_type_t;
+#define SOC_LEDC_SUPPORT_REF_TICK 1
+typedef struct {
+    ledc_mode_t speed_mode;
+    ledc_timer_bit_t duty_resolution;
+    ledc_timer_t timer_num;
+    uint32_t freq_hz;
+    ledc_clk_cfg_t clk_cfg;
+} ledc_timer_config_t;
+typedef struct {
+    int gpio_num;
+    ledc_mode_t speed_mode;
+    ledc_channel_t channel;
+    ledc_intr_type_t intr_type;
+    ledc_timer_t timer_sel;
+    uint32_t duty;
+    int hpoint;
+    struct { unsigned int output_invert: 1; } flags;
+} ledc_channel_config_t;
+esp_err_t ledc_timer_config(const ledc_timer_config_t *timer_conf);
+esp_err_t ledc_channel_config(const ledc_channel_config_t *ledc_conf);
+esp_err_t ledc_timer_set(ledc_mode_t speed_mode, ledc_timer_t timer_sel, uint32_t clock_divider, uint32_t duty_resolution,
+                         ledc_clk_src_t clk_src);
+esp_err_t ledc_set_freq(ledc_mode_t speed_mode, ledc_timer_t timer_num, uint32_t freq_hz);
+esp_err_t ledc_set_duty(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty);
+esp_err_t ledc_update_duty(ledc_mode_t speed_mode, ledc_channel_t channel);
+esp_err_t ledc_stop(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t idle_level);
+
+/* ---- esp_bt.h, esp_bt_main.h ---- */
+typedef struct { int dummy; } esp_bt_controller_config_t;
+#define BT_CONTROLLER_INIT_CONFIG_DEFAULT() { 0 }
+typedef enum { ESP_BT_MODE_IDLE, ESP_BT_MODE_BLE, ESP_BT_MODE_CLASSIC_BT, ESP_BT_MODE_BTDM } esp_bt_mode_t;
+esp_err_t esp_bt_controller_mem_release(esp_bt_mode_t mode);
+esp_err_t esp_bt_controller_init(esp_bt_controller_config_t *cfg);
+esp_err_t esp_bt_controller_enable(esp_bt_mode_t mode);
+esp_err_t esp_bluedroid_init(void);
+esp_err_t esp_bluedroid_enable(void);
+
+/* ---- esp_bt_defs.h ---- */
+#define ESP_BD_ADDR_LEN 6
+typedef uint8_t esp_bd_addr_t[ESP_BD_ADDR_LEN];
+typedef int esp_bt_status_t;
+#define ESP_BT_STATUS_SUCCESS 0
+#define ESP_UUID_LEN_16     2
+#define ESP_UUID_LEN_32     4
+#define ESP_UUID_LEN_128    16
+typedef struct {
+    uint16_t len;
+    union {
+        uint16_t uuid16;
+        uint32_t uuid32;
+        uint8_t uuid128[ESP_UUID_LEN_128];
+    } uuid;
+} __attribute__((packed)) esp_bt_uuid_t;
+
+/* ---- esp_gatt_defs.h ---- */
+typedef uint8_t esp_gatt_if_t;
+#define ESP_GATT_IF_NONE 0xff
+typedef enum { ESP_GATT_OK = 0, ESP_GATT_INVALID_ATTR_LEN = 0x0d, ESP_GATT_ERROR = 0x85, ESP_GATT_CONGESTED = 0x8f } esp_gatt_status_t;
+#define ESP_GATT_PERM_READ                  (1 << 0)
+#define ESP_GATT_PERM_READ_ENCRYPTED        (1 << 1)
+#define ESP_GATT_PERM_READ_ENC_MITM         (1 << 2)
+#define ESP_GATT_PERM_WRITE                 (1 << 4)
+#define ESP_GATT_PERM_WRITE_ENCRYPTED       (1 << 5)
+#define ESP_GATT_PERM_WRITE_ENC_MITM        (1 << 6)
+#define ESP_GATT_CHAR_PROP_BIT_BROADCAST    (1 << 0)
+#define ESP_GATT_CHAR_PROP_BIT_READ         (1 << 1)
+#define ESP_GATT_CHAR_PROP_BIT_WRITE_NR     (1 << 2)
+#define ESP_GATT_CHAR_PROP_BIT_WRITE        (1 << 3)
+#define ESP_GATT_CHAR_PROP_BIT_NOTIFY       (1 << 4)
+#define ESP_GATT_CHAR_PROP_BIT_INDICATE     (1 << 5)
+#define ESP_GATT_UUID_PRI_SERVICE           0x2800
+#define ESP_GATT_UUID_SEC_SERVICE           0x2801
+#define ESP_GATT_UUID_INCLUDE_SERVICE       0x2802
+#define ESP_GATT_UUID_CHAR_DECLARE          0x2803
+#define ESP_GATT_UUID_CHAR_CLIENT_CONFIG    0x2902
+#define ESP_GATT_UUID_CHAR_PRESENT_FORMAT   0x2904
+#define ESP_GATT_UUID_EXT_RPT_REF_DESCR     0x2907
+#define ESP_GATT_UUID_RPT_REF_DESCR         0x2908
+#define ESP_GATT_UUID_BATTERY_SERVICE_SVC   0x180F
+#define ESP_GATT_UUID_BATTERY_LEVEL         0x2A19
+#define ESP_GATT_UUID_HID_BT_KB_INPUT       0x2A22
+#define ESP_GATT_UUID_HID_BT_KB_OUTPUT      0x2A32
+#define ESP_GATT_UUID_HID_BT_MOUSE_INPUT    0x2A33
+#define ESP_GATT_UUID_HID_INFORMATION       0x2A4A
+#define ESP_GATT_UUID_HID_REPORT_MAP        0x2A4B
+#define ESP_GATT_UUID_HID_CONTROL_POINT     0x2A4C
+#define ESP_GATT_UUID_HID_REPORT            0x2A4D
+#define ESP_GATT_UUID_HID_PROTO_MODE        0x2A4E
+#define ESP_GATT_RSP_BY_APP                 0
+#define ESP_GATT_AUTO_RSP                   1
+#define ESP_GATT_MAX_ATTR_LEN               600
+typedef struct { uint8_t auto_rsp; } esp_attr_control_t;
+typedef struct {
+    uint8_t value[ESP_GATT_MAX_ATTR_LEN];
+    uint16_t handle;
+    uint16_t offset;
+    uint16_t len;
+    uint8_t auth_req;
+} esp_gatt_value_t;
+typedef union {
+    esp_gatt_value_t attr_value;
+    uint16_t handle;
+} esp_gatt_rsp_t;
+typedef struct {
+    uint16_t uuid_length;
+    uint8_t *uuid_p;
+    uint16_t perm;
+    uint16_t max_length;
+    uint16_t length;
+    uint8_t *value;
+} esp_attr_desc_t;
+typedef struct {
+    esp_attr_control_t attr_control;
+    esp_attr_desc_t att_desc;
+} esp_gatts_attr_db_t;
+typedef struct {
+    uint16_t start_hdl;
+    uint16_t end_hdl;
+    uint16_t uuid;
+} esp_gatts_incl_svc_desc_t;
+typedef struct {
+    uint16_t interval;
+    uint16_t latency;
+    uint16_t timeout;
+} esp_gatt_conn_params_t;
+
+/* ---- esp_gatts_api.h ---- */
+typedef enum {
+    ESP_GATTS_REG_EVT = 0,
+    ESP_GATTS_READ_EVT = 1,
+    ESP_GATTS_WRITE_EVT = 2,
+    ESP_GATTS_EXEC_WRITE_EVT = 3,
+    ESP_GATTS_MTU_EVT = 4,
+    ESP_GATTS_CONF_EVT = 5,
+    ESP_GATTS_UNREG_EVT = 6,
+    ESP_GATTS_CREATE_EVT = 7,
+    ESP_GATTS_ADD_INCL_SRVC_EVT = 8,
+    ESP_GATTS_ADD_CHAR_EVT = 9,
+    ESP_GATTS_ADD_CHAR_DESCR_EVT = 10,
+    ESP_GATTS_DELETE_EVT = 11,
+    ESP_GATTS_START_EVT = 12,
+    ESP_GATTS_STOP_EVT = 13,
+    ESP_GATTS_CONNECT_EVT = 14,
+    ESP_GATTS_DISCONNECT_EVT = 15,
+    ESP_GATTS_OPEN_EVT = 16,
+    ESP_GATTS_CANCEL_OPEN_EVT = 17,
+    ESP_GATTS_CLOSE_EVT = 18,
+    ESP_GATTS_LISTEN_EVT = 19,
+    ESP_GATTS_CONGEST_EVT = 20,
+    ESP_GATTS_RESPONSE_EVT = 21,
+    ESP_GATTS_CREAT_ATTR_TAB_EVT = 22,
+} esp_gatts_cb_event_t;
+typedef union {
+    struct gatts_reg_evt_param { esp_gatt_status_t status; uint16_t app_id; } reg;
+    struct gatts_read_evt_param {
+        uint16_t conn_id; uint32_t trans_id; esp_bd_addr_t bda; uint16_t handle; uint16_t offset;
+        bool is_long; bool need_rsp;
+    } read;
+    struct gatts_write_evt_param {
+        uint16_t conn_id; uint32_t trans_id; esp_bd_addr_t bda; uint16_t handle; uint16_t offset;
+        bool need_rsp; bool is_prep; uint16_t len; uint8_t *value;
+    } write;
+    struct gatts_exec_write_evt_param { uint16_t conn_id; uint32_t trans_id; esp_bd_addr_t bda; uint8_t exec_write_flag; } exec_write;
+    struct gatts_mtu_evt_param { uint16_t conn_id; uint16_t mtu; } mtu;
+    struct gatts_conf_evt_param {
+        esp_gatt_status_t status; uint16_t conn_id; uint16_t handle; uint16_t len; uint8_t *value;
+    } conf;
+    struct gatts_connect_evt_param {
+        uint16_t conn_id; uint8_t link_role; esp_bd_addr_t remote_bda; esp_gatt_conn_params_t conn_params;
+    } connect;
+    struct gatts_disconnect_evt_param { uint16_t conn_id; esp_bd_addr_t remote_bda; int reason; } disconnect;
+    struct gatts_congest_evt_param { uint16_t conn_id; bool congested; } congest;
+    struct gatts_add_attr_tab_evt_param {
+        esp_gatt_status_t status; esp_bt_uuid_t svc_uuid; uint8_t svc_inst_id; uint16_t num_handle; uint16_t *handles;
+    } add_attr_tab;
+} esp_ble_gatts_cb_param_t;
+typedef void (*esp_gatts_cb_t)(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param);
+esp_err_t esp_ble_gatts_register_callback(esp_gatts_cb_t callback);
+esp_err_t esp_ble_gatts_app_register(uint16_t app_id);
+esp_err_t esp_ble_gatts_app_unregister(esp_gatt_if_t gatts_if);
+esp_err_t esp_ble_gatts_create_attr_tab(const esp_gatts_attr_db_t *gatts_attr_db, esp_gatt_if_t gatts_if,
+                                        uint16_t max_nb_attr, uint8_t srvc_inst_id);
+esp_err_t esp_ble_gatts_start_service(uint16_t service_handle);
+esp_err_t esp_ble_gatts_stop_service(uint16_t service_handle);
+esp_err_t esp_ble_gatts_delete_service(uint16_t service_handle);
+esp_err_t esp_ble_gatts_send_indicate(esp_gatt_if_t gatts_if, uint16_t conn_id, uint16_t attr_handle,
+                                      uint16_t value_len, uint8_t *value, bool need_confirm);
+esp_err_t esp_ble_gatts_send_response(esp_gatt_if_t gatts_if, uint16_t conn_id, uint32_t trans_id,
+                                      esp_gatt_status_t status, esp_gatt_rsp_t *rsp);
+esp_err_t esp_ble_gatts_set_attr_value(uint16_t attr_handle, uint16_t length, const uint8_t *value);
+esp_err_t esp_ble_gatts_get_attr_value(uint16_t attr_handle, uint16_t *length, const uint8_t **value);
+esp_err_t esp_ble_gatt_set_local_mtu(uint16_t mtu);
+
+/* ---- esp_gap_ble_api.h, esp_bt_device.h ---- */
+typedef uint8_t esp_ble_addr_type_t;
+#define BLE_ADDR_TYPE_PUBLIC 0
+#define BLE_ADDR_TYPE_RANDOM 1
+typedef enum { BLE_WL_ADDR_TYPE_PUBLIC = 0, BLE_WL_ADDR_TYPE_RANDOM = 1 } esp_ble_wl_addr_type_t;
+typedef enum { ADV_TYPE_IND = 0 } esp_ble_adv_type_t;
+typedef enum { ADV_CHNL_ALL = 0x07 } esp_ble_adv_channel_t;
+typedef enum {
+    ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY,
+    ADV_FILTER_ALLOW_SCAN_WLST_CON_ANY,
+    ADV_FILTER_ALLOW_SCAN_ANY_CON_WLST,
+    ADV_FILTER_ALLOW_SCAN_WLST_CON_WLST,
+} esp_ble_adv_filter_t;
+typedef struct {
+    uint16_t adv_int_min;
+    uint16_t adv_int_max;
+    esp_ble_adv_type_t adv_type;
+    esp_ble_addr_type_t own_addr_type;
+    esp_bd_addr_t peer_addr;
+    esp_ble_addr_type_t peer_addr_type;
+    esp_ble_adv_channel_t channel_map;
+    esp_ble_adv_filter_t adv_filter_policy;
+} esp_ble_adv_params_t;
+typedef struct {
+    bool set_scan_rsp;
+    bool include_name;
+    bool include_txpower;
+    int min_interval;
+    int max_interval;
+    int appearance;
+    uint16_t manufacturer_len;
+    uint8_t *p_manufacturer_data;
+    uint16_t service_data_len;
+    uint8_t *p_service_data;
+    uint16_t service_uuid_len;
+    uint8_t *p_service_uuid;
+    uint8_t flag;
+} esp_ble_adv_data_t;
+typedef enum { BLE_SCAN_TYPE_PASSIVE, BLE_SCAN_TYPE_ACTIVE } esp_ble_scan_type_t;
+typedef enum { BLE_SCAN_FILTER_ALLOW_ALL } esp_ble_scan_filter_t;
+typedef enum { BLE_SCAN_DUPLICATE_DISABLE, BLE_SCAN_DUPLICATE_ENABLE } esp_ble_scan_duplicate_t;
+typedef struct {
+    esp_ble_scan_type_t scan_type;
+    esp_ble_addr_type_t own_addr_type;
+    esp_ble_scan_filter_t scan_filter_policy;
+    uint16_t scan_interval;
+    uint16_t scan_window;
+    esp_ble_scan_duplicate_t scan_duplicate;
+} esp_ble_scan_params_t;
+typedef struct {
+    esp_bd_addr_t bda;
+    uint16_t min_int;
+    uint16_t max_int;
+    uint16_t latency;
+    uint16_t timeout;
+} esp_ble_conn_update_params_t;
+typedef struct {
+    uint16_t interval;
+    uint16_t latency;
+    uint16_t timeout;
+} esp_gap_conn_params_t;
+typedef struct {
+    esp_bd_addr_t bd_addr;
+    esp_ble_addr_type_t bd_addr_type;
+    struct { uint8_t key_mask; } bond_key;
+} esp_ble_bond_dev_t;
+typedef uint8_t esp_ble_auth_req_t;
+typedef uint8_t esp_ble_io_cap_t;
+#define ESP_LE_AUTH_BOND        (1 << 0)
+#define ESP_IO_CAP_NONE         3
+#define ESP_BLE_ENC_KEY_MASK    (1 << 0)
+#define ESP_BLE_ID_KEY_MASK     (1 << 1)
+typedef enum {
+    ESP_BLE_SM_PASSKEY = 0,
+    ESP_BLE_SM_AUTHEN_REQ_MODE,
+    ESP_BLE_SM_IOCAP_MODE,
+    ESP_BLE_SM_SET_INIT_KEY,
+    ESP_BLE_SM_SET_RSP_KEY,
+    ESP_BLE_SM_MAX_KEY_SIZE,
+} esp_ble_sm_param_t;
+typedef enum { ESP_BLE_SEC_ENCRYPT = 1, ESP_BLE_SEC_ENCRYPT_NO_MITM, ESP_BLE_SEC_ENCRYPT_MITM } esp_ble_sec_act_t;
+#define ESP_BLE_APPEARANCE_GENERIC_HID  0x03C0
+#define ESP_BLE_AD_TYPE_NAME_SHORT      0x08
+#define ESP_BLE_AD_TYPE_NAME_CMPL       0x09
+#define ESP_BLE_ADV_DATA_LEN_MAX        31
+#define ESP_BLE_SCAN_RSP_DATA_LEN_MAX   31
+typedef enum {
+    ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT = 0,
+    ESP_GAP_BLE_SCAN_RSP_DATA_SET_COMPLETE_EVT = 1,
+    ESP_GAP_BLE_SCAN_PARAM_SET_COMPLETE_EVT = 2,
+    ESP_GAP_BLE_SCAN_RESULT_EVT = 3,
+    ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT = 4,
+    ESP_GAP_BLE_SCAN_RSP_DATA_RAW_SET_COMPLETE_EVT = 5,
+    ESP_GAP_BLE_ADV_START_COMPLETE_EVT = 6,
+    ESP_GAP_BLE_SCAN_START_COMPLETE_EVT = 7,
+    ESP_GAP_BLE_AUTH_CMPL_EVT = 8,
+    ESP_GAP_BLE_KEY_EVT = 9,
+    ESP_GAP_BLE_SEC_REQ_EVT = 10,
+    ESP_GAP_BLE_PASSKEY_NOTIF_EVT = 11,
+    ESP_GAP_BLE_PASSKEY_REQ_EVT = 12,
+    ESP_GAP_BLE_OOB_REQ_EVT = 13,
+    ESP_GAP_BLE_LOCAL_IR_EVT = 14,
+    ESP_GAP_BLE_LOCAL_ER_EVT = 15,
+    ESP_GAP_BLE_NC_REQ_EVT = 16,
+    ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT = 17,
+    ESP_GAP_BLE_SCAN_STOP_COMPLETE_EVT = 18,
+    ESP_GAP_BLE_SET_STATIC_RAND_ADDR_EVT = 19,
+    ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT = 20,
+    ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT = 21,
+    ESP_GAP_BLE_SET_LOCAL_PRIVACY_COMPLETE_EVT = 22,
+    ESP_GAP_BLE_REMOVE_BOND_DEV_COMPLETE_EVT = 23,
+    ESP_GAP_BLE_CLEAR_BOND_DEV_COMPLETE_EVT = 24,
+} esp_gap_ble_cb_event_t;
+typedef enum { ESP_GAP_SEARCH_INQ_RES_EVT = 0, ESP_GAP_SEARCH_INQ_CMPL_EVT = 1 } esp_gap_search_evt_t;
+typedef union {
+    struct ble_adv_data_cmpl_evt_param { esp_bt_status_t status; } adv_data_cmpl;
+    struct ble_scan_start_cmpl_evt_param { esp_bt_status_t status; } scan_start_cmpl;
+    struct ble_adv_start_cmpl_evt_param { esp_bt_status_t status; } adv_start_cmpl;
+    struct ble_scan_result_evt_param {
+        esp_gap_search_evt_t search_evt; esp_bd_addr_t bda; int dev_type; esp_ble_addr_type_t ble_addr_type;
+        int ble_evt_type; int rssi; uint8_t ble_adv[ESP_BLE_ADV_DATA_LEN_MAX + ESP_BLE_SCAN_RSP_DATA_LEN_MAX];
+        int flag; int num_resps; uint8_t adv_data_len; uint8_t scan_rsp_len;
+    } scan_rst;
+    struct ble_sec_evt_param {
+        union {
+            struct { esp_bd_addr_t bd_addr; } ble_req;
+            struct {
+                esp_bd_addr_t bd_addr; bool key_present; uint8_t key_type; int dev_type; bool success;
+                uint8_t fail_reason; esp_ble_addr_type_t addr_type; uint8_t auth_mode;
+            } auth_cmpl;
+        };
+    } ble_security;
+    struct ble_remove_bond_dev_cmpl_evt_param { esp_bt_status_t status; esp_bd_addr_t bd_addr; } remove_bond_dev_cmpl;
+    struct ble_clear_bond_dev_cmpl_evt_param { esp_bt_status_t status; } clear_bond_dev_cmpl;
+    struct ble_update_conn_params_evt_param {
+        esp_bt_status_t status; esp_bd_addr_t bda; uint16_t min_int; uint16_t max_int; uint16_t latency;
+        uint16_t conn_int; uint16_t timeout;
+    } update_conn_params;
+} esp_ble_gap_cb_param_t;
+typedef void (*esp_gap_ble_cb_t)(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
+esp_err_t esp_ble_gap_register_callback(esp_gap_ble_cb_t callback);
+esp_err_t esp_ble_gap_config_adv_data(esp_ble_adv_data_t *adv_data);
+esp_err_t esp_ble_gap_start_advertising(esp_ble_adv_params_t *adv_params);
+esp_err_t esp_ble_gap_set_device_name(const char *name);
+esp_err_t esp_ble_gap_config_local_icon(uint16_t icon);
+esp_err_t esp_ble_gap_set_scan_params(esp_ble_scan_params_t *scan_params);
+esp_err_t esp_ble_gap_start_scanning(uint32_t duration);
+esp_err_t esp_ble_gap_security_rsp(esp_bd_addr_t bd_addr, bool accept);
+esp_err_t esp_ble_gap_update_conn_params(esp_ble_conn_update_params_t *params);
+esp_err_t esp_ble_get_current_conn_params(esp_bd_addr_t bd_addr, esp_gap_conn_params_t *conn_params);
+esp_err_t esp_ble_gap_update_whitelist(bool add_remove, esp_bd_addr_t remote_bda, esp_ble_wl_addr_type_t wl_addr_type);
+esp_err_t esp_ble_gap_set_security_param(esp_ble_sm_param_t param_type, void *value, uint8_t len);
+esp_err_t esp_ble_set_encryption(esp_bd_addr_t bd_addr, esp_ble_sec_act_t sec_act);
+int esp_ble_get_bond_device_num(void);
+esp_err_t esp_ble_get_bond_device_list(int *dev_num, esp_ble_bond_dev_t *dev_list);
+esp_err_t esp_ble_remove_bond_device(esp_bd_addr_t bd_addr);
+uint8_t *esp_ble_resolve_adv_data(uint8_t *adv_data, uint8_t type, uint8_t *length);
+
+#endif
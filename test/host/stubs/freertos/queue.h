@@ -0,0 +1,2 @@
+/* host build: see esp_idf_stubs.h */
+#include "esp_idf_stubs.h"
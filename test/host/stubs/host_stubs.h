@@ -0,0 +1,113 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ */
+
+#ifndef _HOST_STUBS_H_
+#define _HOST_STUBS_H_
+
+#include "esp_idf_stubs.h"
+
+/** @brief Test interface of the stubbed ESP-IDF (esp_idf_stubs.c)
+ *
+ * Nothing runs in the background on the host: tasks are registered but not started,
+ * timers fire in host_time_advance and BT stack events (register, attribute table
+ * created, advertising started) are queued until host_bt_run. */
+
+/** @brief Maximum length of a recorded notification */
+#define HOST_NOTIFY_MAX_LEN 32
+
+/** @brief One notification sent with esp_ble_gatts_send_indicate */
+typedef struct {
+    esp_gatt_if_t gatts_if;
+    uint16_t conn_id;
+    uint16_t handle;
+    uint16_t len;
+    uint8_t data[HOST_NOTIFY_MAX_LEN];
+    int64_t time;   /// esp_timer_get_time() when sent
+} host_notify_t;
+
+/** @brief Clear recorded notifications, UART output and the NVS failure setting */
+void host_stubs_reset(void);
+
+/** @brief Log level of host_log (ESP_LOG_WARN by default, HOST_LOG=0..5 in the environment) */
+void host_log_level(esp_log_level_t level);
+
+/* ---- time & timers ---- */
+/** @brief Advance the simulated time, due esp_timer callbacks are called in order */
+void host_time_advance(uint64_t us);
+
+/* ---- tasks ---- */
+/** @brief Find a task created by the firmware (not started on the host)
+ * @return Task function or NULL, *arg is set to the task parameter */
+TaskFunction_t host_task_find(const char *name, void **arg);
+/** @brief Number of esp_restart calls (esp_restart returns on the host) */
+int host_restart_count(void);
+
+/* ---- BT stack ---- */
+/** @brief Deliver the queued GATTS & GAP events to the registered callbacks
+ * @return Number of delivered events */
+int host_bt_run(void);
+/** @brief Call the registered GATTS callback directly */
+void host_bt_gatts_event(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param);
+/** @brief Call the registered GAP callback directly */
+void host_bt_gap_event(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
+/** @brief gatts_if of the last registered app (the HID app of the firmware) */
+esp_gatt_if_t host_bt_gatts_if(void);
+/** @brief A host connects (ESP_GATTS_CONNECT_EVT, interval in 1.25ms units) */
+void host_bt_connect(uint16_t conn_id, const esp_bd_addr_t bda, uint16_t interval);
+/** @brief A host disconnects (ESP_GATTS_DISCONNECT_EVT) */
+void host_bt_disconnect(uint16_t conn_id, const esp_bd_addr_t bda);
+/** @brief A host writes an attribute (ESP_GATTS_WRITE_EVT, write request)
+ * @return GATT status of the response, -1 if the firmware did not answer */
+int host_bt_write(uint16_t conn_id, uint16_t handle, const uint8_t *value, uint16_t len);
+/** @brief A host reads an attribute (ESP_GATTS_READ_EVT), answered by the stack (auto_rsp)
+ * or by the firmware with esp_ble_gatts_send_response
+ * @param value Buffer of *len bytes for the response value, *len is set to the value length
+ * @return GATT status of the response, -1 if the firmware did not answer */
+int host_bt_read(uint16_t conn_id, uint16_t handle, uint8_t *value, uint16_t *len);
+
+/** @brief Permissions of an attribute created with esp_ble_gatts_create_attr_tab, -1 if unknown */
+int host_attr_perm(uint16_t handle);
+/** @brief Value of an attribute, NULL if unknown */
+const uint8_t *host_attr_value(uint16_t handle, uint16_t *len);
+
+/** @brief Number of recorded notifications */
+int host_notify_count(void);
+/** @brief Recorded notification, NULL if idx is out of range */
+const host_notify_t *host_notify_get(int idx);
+/** @brief Last recorded notification, NULL if there is none */
+const host_notify_t *host_notify_last(void);
+void host_notify_clear(void);
+/** @brief Return value of the following esp_ble_gatts_send_indicate calls (ESP_OK: recorded) */
+void host_notify_result(esp_err_t ret);
+
+/* ---- UART ---- */
+/** @brief Output written with uart_write_bytes (all UARTs), 0-terminated */
+const char *host_uart_output(size_t *len);
+void host_uart_clear(void);
+
+/* ---- NVS ---- */
+/** @brief Return value of the following nvs_set_* & nvs_commit calls (ESP_OK: normal operation) */
+void host_nvs_fail(esp_err_t ret);
+/** @brief Number of stored NVS entries (all namespaces) */
+int host_nvs_count(void);
+/** @brief Number of nvs_commit calls */
+int host_nvs_commits(void);
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ */
+
+#ifndef _HOST_SDKCONFIG_H_
+#define _HOST_SDKCONFIG_H_
+
+/** @brief Configuration of the host build (replaces the sdkconfig.h generated by ESP-IDF)
+ *
+ * Defaults are the menuconfig defaults for the esp32miniBT module, except that the
+ * optional modules (trace, capture, profiling) are enabled to compile & test them.
+ * Each value can be overridden with -D (see test/host/CMakeLists.txt). */
+
+#ifndef CONFIG_BT_ACL_CONNECTIONS
+#define CONFIG_BT_ACL_CONNECTIONS 4
+#endif
+#ifndef CONFIG_BT_SMP_MAX_BONDS
+#define CONFIG_BT_SMP_MAX_BONDS 15
+#endif
+#ifndef CONFIG_FREERTOS_HZ
+#define CONFIG_FREERTOS_HZ 100
+#endif
+
+#ifndef CONFIG_USE_AS_FLIPMOUSE_FABI
+#define CONFIG_USE_AS_FLIPMOUSE_FABI 1
+#endif
+#ifndef CONFIG_MODULE_NANO
+#define CONFIG_MODULE_NANO 0
+#endif
+#ifndef CONFIG_MODULE_MINIBT
+#define CONFIG_MODULE_MINIBT (!CONFIG_MODULE_NANO)
+#endif
+
+#ifndef CONFIG_MODULE_USEKEYBOARD
+#define CONFIG_MODULE_USEKEYBOARD 1
+#endif
+#ifndef CONFIG_MODULE_USEMOUSE
+#define CONFIG_MODULE_USEMOUSE 1
+#endif
+#ifndef CONFIG_MODULE_USEJOYSTICK
+#define CONFIG_MODULE_USEJOYSTICK 1
+#endif
+#ifndef CONFIG_MODULE_JOYSTICK_HIRES
+#define CONFIG_MODULE_JOYSTICK_HIRES 0
+#endif
+#ifndef CONFIG_MODULE_JOYSTICK_DEADZONE
+#define CONFIG_MODULE_JOYSTICK_DEADZONE 0
+#endif
+#ifndef CONFIG_MODULE_JOYSTICK_HYSTERESIS
+#define CONFIG_MODULE_JOYSTICK_HYSTERESIS 1
+#endif
+#ifndef CONFIG_MODULE_JOYSTICK_MAX_RATE
+#define CONFIG_MODULE_JOYSTICK_MAX_RATE 100
+#endif
+
+#ifndef CONFIG_MODULE_TRACE
+#define CONFIG_MODULE_TRACE 1
+#endif
+#ifndef CONFIG_MODULE_TRACE_ENTRIES
+#define CONFIG_MODULE_TRACE_ENTRIES 256
+#endif
+#ifndef CONFIG_MODULE_CAPTURE
+#define CONFIG_MODULE_CAPTURE 1
+#endif
+#ifndef CONFIG_MODULE_CAPTURE_ENTRIES
+#define CONFIG_MODULE_CAPTURE_ENTRIES 2048
+#endif
+#ifndef CONFIG_MODULE_PROFILING
+#define CONFIG_MODULE_PROFILING 1
+#endif
+#ifndef CONFIG_MODULE_BT_PAIRING
+#define CONFIG_MODULE_BT_PAIRING 0
+#endif
+
+#endif
@@ -0,0 +1,373 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ *
+ * Host tests of the UART interface: ASCII commands (processCommand) and raw
+ * frames of the external UART, from the parser to the BLE notifications.
+ */
+
+#include "host_app.h"
+#include "hidd_le_prf_int.h"
+#include "esp_hidd_prf_api.h"
+#include "esp_rom_crc.h"
+#include "config.h"
+#include "config_store.h"
+#include "kv_cache.h"
+#include "uart_capture.h"
+#include "host_test.h"
+
+static uint16_t handle(int idx)
+{
+    return hidd_le_env.hidd_inst.att_tbl[idx];
+}
+
+static void test_id(void)
+{
+    size_t len;
+    host_app_cmd("ID");
+    //exactly the ID & CR LF, no terminating 0
+    CHECK_STR(host_uart_output(&len), MODULE_ID "\r\n");
+    CHECK_EQ(len, strlen(MODULE_ID "\r\n"));
+    //unknown commands are ignored
+    CHECK_STR(host_app_cmd("XY"), "");
+}
+
+static void test_key_value(void)
+{
+    int commits = host_nvs_commits();
+    int count = host_nvs_count();
+
+    CHECK_STR(host_app_cmd("GV hosttest"), "NVS:ESP_ERR_NVS_NOT_FOUND");
+    CHECK_STR(host_app_cmd("SV hosttest some value"), "NVS:OK");
+    //cached, not written yet
+    CHECK_EQ(host_nvs_commits(), commits);
+    CHECK_STR(host_app_cmd("GV hosttest"), "NVS:some value\r\n");
+    CHECK_STR(host_app_cmd("CM"), "NVS:OK");
+    CHECK_EQ(host_nvs_commits(), commits + 1);
+    CHECK_EQ(host_nvs_count(), count + 1);
+    CHECK_STR(host_app_cmd("GV hosttest"), "NVS:some value\r\n");
+
+    CHECK_STR(host_app_cmd("SV thiskeyistoolong x"), "NVS:ESP_ERR_NVS_INVALID_NAME");
+    CHECK_STR(host_app_cmd("SV novalue"), "NVS:ESP_ERR_NVS_NO_VALUE");
+}
+
+static void test_key_value_errors(void)
+{
+    char cmd[32];
+    int accepted = 0;
+
+    //a failed commit keeps the value, it is written by the next one
+    CHECK_STR(host_app_cmd("SV failkey 1"), "NVS:OK");
+    host_nvs_fail(ESP_ERR_NVS_NOT_ENOUGH_SPACE);
+    CHECK_STR(host_app_cmd("CM"), "NVS:ESP_ERR_NVS_NOT_ENOUGH_SPACE");
+    host_nvs_fail(ESP_OK);
+    CHECK_STR(host_app_cmd("CM"), "NVS:OK");
+    CHECK_STR(host_app_cmd("GV failkey"), "NVS:1\r\n");
+
+    //NVS full & every cache entry dirty: further values are refused
+    CHECK_STR(host_app_cmd("TB"), "NVS:OK");
+    host_nvs_fail(ESP_ERR_NVS_NOT_ENOUGH_SPACE);
+    for (int i = 0; i < KV_CACHE_ENTRIES + 1; i++) {
+        snprintf(cmd, sizeof(cmd), "SV full%d %d", i, i);
+        if (strncmp(host_app_cmd(cmd), "NVS:OK", 6) == 0) accepted++;
+        else CHECK_STR(host_uart_output(NULL), "NVS:ESP_ERR_NVS_NOT_ENOUGH_SPACE");
+    }
+    CHECK_EQ(accepted, KV_CACHE_ENTRIES);
+    host_nvs_fail(ESP_OK);
+    CHECK_STR(host_app_cmd("CM"), "NVS:OK");
+    CHECK_STR(host_app_cmd("GV full0"), "NVS:0\r\n");
+}
+
+static void test_blob(void)
+{
+    uint8_t blob[1500];
+    char cmd[64];
+    const char *out;
+    size_t len;
+    uint32_t crc;
+
+    for (unsigned i = 0; i < sizeof(blob); i++) blob[i] = i * 7;
+    crc = esp_rom_crc32_le(0, blob, sizeof(blob));
+    snprintf(cmd, sizeof(cmd), "BW hostblob %u %08x", (unsigned)sizeof(blob), crc);
+    CHECK_STR(host_app_cmd(cmd), "BW:OK 0\r\n");
+
+    //two chunks, the payload follows the header
+    host_uart_clear();
+    len = snprintf(cmd, sizeof(cmd), "$BD 0 1024 %08x\n", esp_rom_crc32_le(0, blob, 1024));
+    host_app_feed((const uint8_t *)cmd, len);
+    CHECK_EQ(host_app_uart()->state, CMDSTATE_GET_BINARY);
+    host_app_feed(blob, 1024);
+    CHECK_STR(host_uart_output(NULL), "BD:OK 1024\r\n");
+
+    //a corrupted chunk is rejected, the transfer continues at the last offset
+    host_uart_clear();
+    len = snprintf(cmd, sizeof(cmd), "$BD 1024 476 %08x\n", esp_rom_crc32_le(0, &blob[1024], 476) ^ 1);
+    host_app_feed((const uint8_t *)cmd, len);
+    host_app_feed(&blob[1024], 476);
+    CHECK_STR(host_uart_output(NULL), "BD:ESP_ERR_INVALID_CRC 1024\r\n");
+
+    host_uart_clear();
+    len = snprintf(cmd, sizeof(cmd), "$BD 1024 476 %08x\n", esp_rom_crc32_le(0, &blob[1024], 476));
+    host_app_feed((const uint8_t *)cmd, len);
+    host_app_feed(&blob[1024], 476);
+    CHECK_STR(host_uart_output(NULL), "BD:DONE 1500\r\n");
+
+    //read back: header, raw data, END
+    snprintf(cmd, sizeof(cmd), "BR:1500,0,1500,%08X\r\n", crc);
+    out = host_app_cmd("BR hostblob");
+    host_uart_output(&len);
+    CHECK_STR(out, cmd);
+    CHECK_EQ(len, strlen(cmd) + sizeof(blob) + 7);
+    if (len == strlen(cmd) + sizeof(blob) + 7) {
+        CHECK_MEM(&out[strlen(cmd)], blob, sizeof(blob));
+        CHECK_MEM(&out[strlen(cmd) + sizeof(blob)], "\r\nEND\r\n", 7);
+    }
+}
+
+static void test_blob_bad_header(void)
+{
+    //payload with a command & a raw frame, must not be parsed
+    const uint8_t payload[] = { '$', 'G', 'C', '\n', 0xfd, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00 };
+    uint8_t big[1100];
+    char cmd[64];
+    size_t len;
+
+    //invalid CRC field: len bytes are consumed, the error follows
+    host_uart_clear();
+    host_notify_clear();
+    len = snprintf(cmd, sizeof(cmd), "$BD 0 %u xyz\n", (unsigned)sizeof(payload));
+    host_app_feed((const uint8_t *)cmd, len);
+    host_app_feed(payload, sizeof(payload));
+    CHECK_STR(host_uart_output(NULL), "BD:ESP_ERR_INVALID_ARG 0\r\n");
+    CHECK_EQ(host_app_uart()->state, CMDSTATE_IDLE);
+    CHECK_EQ(host_notify_count(), 0);
+
+    //too long chunk: consumed as well
+    memset(big, '$', sizeof(big));
+    memcpy(big, payload, sizeof(payload));
+    host_uart_clear();
+    len = snprintf(cmd, sizeof(cmd), "$BD 0 %u 0\n", (unsigned)sizeof(big));
+    host_app_feed((const uint8_t *)cmd, len);
+    host_app_feed(big, sizeof(big));
+    CHECK_STR(host_uart_output(NULL), "BD:ESP_ERR_INVALID_ARG 0\r\n");
+    CHECK_EQ(host_app_uart()->state, CMDSTATE_IDLE);
+    CHECK_EQ(host_notify_count(), 0);
+
+    //no length: nothing is consumed
+    CHECK_STR(host_app_cmd("BD x"), "BD:ESP_ERR_INVALID_ARG\r\n");
+    CHECK_EQ(host_app_uart()->state, CMDSTATE_IDLE);
+}
+
+#if CONFIG_MODULE_CAPTURE
+static void test_replay_blob(void)
+{
+    const char *header = "$BD 0 9 0\n";
+    //the payload looks like a mouse frame, the frame after it is replayed
+    const uint8_t frames[] = { 0xfd, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00,
+                               0xfd, 0x00, 0x00, 0x02, 0x02, 0x00, 0x00, 0x00, 0x00 };
+    TaskFunction_t task;
+    void *arg;
+
+    CHECK_STR(host_app_cmd("CP S"), "CP:OK\r\n");
+    for (size_t i = 0; i < strlen(header); i++) uart_capture_add(header[i]);
+    for (size_t i = 0; i < sizeof(frames); i++) uart_capture_add(frames[i]);
+    CHECK_STR(host_app_cmd("CP R 0"), "CP:OK\r\n");
+    task = host_task_find("replay", &arg);
+    CHECK(task != NULL);
+    if (task == NULL) return;
+    host_notify_clear();
+    task(arg);
+    CHECK_EQ(host_notify_count(), 1);
+    if (host_notify_count() == 1) CHECK_EQ(host_notify_last()->data[1], 2);
+    uart_capture_stop();
+}
+#endif
+
+static void test_bench_restart(void)
+{
+    TaskFunction_t task;
+    void *arg;
+
+    CHECK_STR(host_app_cmd("BENCH 100 1 1"), "");
+    CHECK_STR(host_app_cmd("BENCH 0"), "");
+    //the stopped task has not finished yet (tasks don't run on the host)
+    CHECK_STR(host_app_cmd("BENCH 100 1 1"), "BENCH:error\r\n");
+    task = host_task_find("bench", &arg);
+    CHECK(task != NULL);
+    if (task == NULL) return;
+    host_uart_clear();
+    task(arg);
+    CHECK_STR(host_uart_output(NULL), "BENCH:0,");
+    //now it can be started again
+    CHECK_STR(host_app_cmd("BENCH 100 1 1"), "");
+    CHECK_STR(host_app_cmd("BENCH 0"), "");
+    host_task_find("bench", &arg)(arg);
+}
+
+static void test_raw_frames(void)
+{
+    //mouse: buttons, X, Y, wheel
+    const uint8_t mouse[] = { 0xfd, 0x00, 0x03, 0x01, 0x10, 0xf0, 0x00, 0x00, 0x00 };
+    //keyboard: modifier, type, 6 keys
+    const uint8_t keyboard[] = { 0xfd, 0x02, 0x00, 0x04, 0x05, 0x00, 0x00, 0x00, 0x00 };
+    //consumer: mode, type, usage (0x0400 is out of range)
+    const uint8_t consumer[] = { 0xfd, 0x00, 0x02, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00 };
+    const host_notify_t *n;
+
+    host_notify_clear();
+    host_app_feed(mouse, sizeof(mouse));
+    CHECK_EQ(host_notify_count(), 1);
+    n = host_notify_last();
+    if (n) {
+        CHECK_EQ(n->handle, handle(HIDD_LE_IDX_REPORT_MOUSE_IN_VAL));
+        CHECK_EQ(n->data[0], 0x01);
+        CHECK_EQ(n->data[1], 0x10);
+        CHECK_EQ(n->data[2], 0xf0);
+    }
+
+    host_notify_clear();
+    host_app_feed(keyboard, sizeof(keyboard));
+    CHECK_EQ(host_notify_count(), 1);
+    n = host_notify_last();
+    if (n) {
+        CHECK_EQ(n->handle, handle(HIDD_LE_IDX_REPORT_KEY_IN_VAL));
+        CHECK_EQ(n->data[0], 0x02);
+        CHECK_EQ(n->data[1], 0x04);
+        CHECK_EQ(n->data[2], 0x05);
+    }
+
+    host_notify_clear();
+    host_app_feed(consumer, sizeof(consumer));
+    CHECK_EQ(host_notify_count(), 0);
+}
+
+#if CONFIG_MODULE_USEJOYSTICK
+static void test_joystick_frame(void)
+{
+    //axes, hat, buttons (2 bytes padding)
+    uint8_t joy[1 + UART_PARSER_JOY_LEN] = { 0xfd, 0x00, 0x01, 10, 20, 30, 40, 50, 60, 0, 1, 0x01 };
+    const host_notify_t *n;
+
+    host_time_advance(100000);
+    host_notify_clear();
+    host_app_feed(joy, sizeof(joy));
+    host_time_advance(100000);
+    CHECK(host_notify_count() >= 1);
+    n = host_notify_last();
+    if (n) CHECK_EQ(n->handle, handle(HIDD_LE_IDX_REPORT_JOY_IN_VAL));
+}
+#endif
+
+static void test_select_host(void)
+{
+    const uint8_t mouse[] = { 0xfd, 0x00, 0x03, 0x00, 0x01, 0x01, 0x00, 0x00, 0x00 };
+
+    host_app_connect(1);
+    CHECK_STR(host_app_cmd("GC"), "CONNECTED:11 22 33 44 55 00 ");
+    CHECK(strstr(host_uart_output(NULL), "CONNECTED:11 22 33 44 55 01 ") != NULL);
+
+    //to all hosts
+    host_notify_clear();
+    host_app_feed(mouse, sizeof(mouse));
+    CHECK_EQ(host_notify_count(), 2);
+
+    //to the selected host only
+    host_app_cmd("SW 112233445501");
+    host_notify_clear();
+    host_app_feed(mouse, sizeof(mouse));
+    CHECK_EQ(host_notify_count(), 1);
+    if (host_notify_last()) CHECK_EQ(host_notify_last()->conn_id, 1);
+
+    //unknown address: selection unchanged
+    host_app_cmd("SW 665544332211");
+    host_notify_clear();
+    host_app_feed(mouse, sizeof(mouse));
+    CHECK_EQ(host_notify_count(), 1);
+    if (host_notify_last()) CHECK_EQ(host_notify_last()->conn_id, 1);
+
+    host_app_disconnect(1);
+    CHECK(strstr(host_app_cmd("GC"), "55 01") == NULL);
+}
+
+static void test_not_connected(void)
+{
+    const uint8_t mouse[] = { 0xfd, 0x00, 0x03, 0x00, 0x01, 0x01, 0x00, 0x00, 0x00 };
+
+    host_app_disconnect(0);
+    host_notify_clear();
+    host_app_feed(mouse, sizeof(mouse));
+    CHECK_EQ(host_notify_count(), 0);
+    CHECK_STR(host_app_cmd("GC"), "");
+}
+
+static void test_config_migrate(void)
+{
+    config_data_t cfg;
+    nvs_handle_t h;
+    char name[MAX_BT_DEVICENAME_LENGTH];
+    size_t len = sizeof(name);
+
+    //a device with the pre-blob keys only
+    CHECK_EQ(nvs_open("config_c", NVS_READWRITE, &h), ESP_OK);
+    nvs_erase_key(h, "cfg");
+    CHECK_EQ(nvs_set_str(h, "btname", "legacy"), ESP_OK);
+    nvs_commit(h);
+
+    //the blob cannot be stored: the legacy keys are kept
+    host_nvs_fail(ESP_ERR_NVS_NOT_ENOUGH_SPACE);
+    CHECK_EQ(config_store_load(&cfg), ESP_OK);
+    CHECK_STR(cfg.bt_device_name, "legacy");
+    host_nvs_fail(ESP_OK);
+    CHECK_EQ(nvs_get_str(h, "btname", name, &len), ESP_OK);
+
+    //stored: erased
+    CHECK_EQ(config_store_load(&cfg), ESP_OK);
+    CHECK_STR(cfg.bt_device_name, "legacy");
+    len = sizeof(name);
+    CHECK_EQ(nvs_get_str(h, "btname", name, &len), ESP_ERR_NVS_NOT_FOUND);
+    CHECK_EQ(config_store_load(&cfg), ESP_OK);
+    CHECK_STR(cfg.bt_device_name, "legacy");
+
+    //no blob again, like after host_app_init
+    nvs_erase_key(h, "cfg");
+    nvs_commit(h);
+}
+
+int main(void)
+{
+    host_app_init();
+    host_app_connect(0);
+
+    RUN(test_id);
+    RUN(test_key_value);
+    RUN(test_key_value_errors);
+    RUN(test_blob);
+    RUN(test_blob_bad_header);
+#if CONFIG_MODULE_CAPTURE
+    RUN(test_replay_blob);
+#endif
+    RUN(test_raw_frames);
+    RUN(test_bench_restart);
+#if CONFIG_MODULE_USEJOYSTICK
+    RUN(test_joystick_frame);
+#endif
+    RUN(test_select_host);
+    RUN(test_not_connected);
+    RUN(test_config_migrate);
+    return TEST_RESULT;
+}
@@ -0,0 +1,78 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ *
+ * Host tests of the HID report map: the report sizes declared by the
+ * descriptors must match the lengths sent by esp_hidd_prf_api.c.
+ * Includes hid_device_le_prf.c to reach its static descriptor tables.
+ * Also run after linking, a mismatch fails the host build.
+ */
+
+#include "../../main/hid_device_le_prf.c"
+
+#include "uart_parser.h"
+#include "host_test.h"
+
+static void test_fragments(void)
+{
+    //each fragment on its own
+    for (unsigned i = 0; i < sizeof(hidReportFragments) / sizeof(hidReportFragments[0]); i++) {
+        const hidd_rpt_fragment_t *f = &hidReportFragments[i];
+        CHECK_EQ(hid_rpt_check_map(f->desc, f->len, f->reports, f->report_cnt, hidd_report_mismatch), 0);
+    }
+}
+
+static void test_composed(void)
+{
+    //the report map as composed on the device, with & without gamepad ($JP)
+    gamepadenabled = 0;
+    CHECK_EQ(hidd_compose_report_map(), 0);
+    CHECK(hidReportMapLen > 0);
+    gamepadenabled = 1;
+    CHECK_EQ(hidd_compose_report_map(), 0);
+    CHECK_EQ(hidReportMapLen, HIDD_REPORT_MAP_FULL_LEN);
+}
+
+#if CONFIG_MODULE_USEJOYSTICK
+static void test_joystick_len(void)
+{
+    //the compiled in descriptor (8 or 16bit axes) must declare the length sent for it
+    const hid_rpt_check_t joystick[] = {
+#if CONFIG_MODULE_JOYSTICK_HIRES
+        { HID_RPT_ID_JOY_IN, HID_RPT_CHECK_INPUT, HID_JOYSTICK_HIRES_IN_RPT_LEN, "joystick (16bit)" },
+#else
+        { HID_RPT_ID_JOY_IN, HID_RPT_CHECK_INPUT, HID_JOYSTICK_IN_RPT_LEN, "joystick (8bit)" },
+#endif
+    };
+    CHECK_EQ(hid_rpt_check_map(hidReportMapJoystick, sizeof(hidReportMapJoystick), joystick, 1, hidd_report_mismatch), 0);
+
+    //raw UART frames carry the report + 2 bytes (type & padding)
+    CHECK_EQ(UART_PARSER_JOY_LEN, HID_JOYSTICK_IN_RPT_LEN + 2);
+    CHECK_EQ(UART_PARSER_JOY_HIRES_LEN, HID_JOYSTICK_HIRES_IN_RPT_LEN + 2);
+}
+#endif
+
+int main(void)
+{
+    RUN(test_fragments);
+    RUN(test_composed);
+#if CONFIG_MODULE_USEJOYSTICK
+    RUN(test_joystick_len);
+#endif
+    return TEST_RESULT;
+}
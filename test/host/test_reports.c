@@ -0,0 +1,401 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ *
+ * Host tests of the report builders (esp_hidd_prf_api.c, hid_dev.c): sent
+ * reports are checked against the attribute handles of the HID service.
+ */
+
+#include "host_app.h"
+#include "hidd_le_prf_int.h"
+#include "esp_hidd_prf_api.h"
+#include "hid_stats.h"
+#include "hid_trace.h"
+#include "host_test.h"
+
+#define CONN 0
+
+static uint16_t handle(int idx)
+{
+    return hidd_le_env.hidd_inst.att_tbl[idx];
+}
+
+/** @brief Check that exactly one notification was sent since the last call */
+static const host_notify_t *sent_one(uint16_t conn_id, int idx, int len)
+{
+    const host_notify_t *n = host_notify_last();
+    CHECK_EQ(host_notify_count(), 1);
+    host_notify_clear();
+    if (n == NULL) return NULL;
+    CHECK_EQ(n->gatts_if, hidd_le_env.gatt_if);
+    CHECK_EQ(n->conn_id, conn_id);
+    CHECK_EQ(n->handle, handle(idx));
+    CHECK_EQ(n->len, len);
+    return n;
+}
+
+static void test_service(void)
+{
+    //handles are assigned for every attribute, the report map is readable
+    for (int i = 0; i < HIDD_LE_IDX_NB; i++) CHECK(handle(i) != 0);
+    CHECK(host_attr_perm(handle(HIDD_LE_IDX_REPORT_MAP_VAL)) >= 0);
+    //the resolution multiplier is only written by a paired host
+    CHECK_EQ(host_attr_perm(handle(HIDD_LE_IDX_REPORT_VAL)), ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE_ENCRYPTED);
+}
+
+static void test_keyboard(void)
+{
+    uint8_t keys[6] = { HID_KEY_A, HID_KEY_B, 0, 0, 0, 0 };
+    const uint8_t expected[HID_KEYBOARD_IN_RPT_LEN] = { 0x02, HID_KEY_A, HID_KEY_B, 0, 0, 0, 0 };
+    const host_notify_t *n;
+
+    host_notify_clear();
+    esp_hidd_send_keyboard_value(CONN, 0x02, keys, 6);
+    n = sent_one(CONN, HIDD_LE_IDX_REPORT_KEY_IN_VAL, HID_KEYBOARD_IN_RPT_LEN);
+    if (n) CHECK_MEM(n->data, expected, HID_KEYBOARD_IN_RPT_LEN);
+
+    //more keys than the report can hold are rejected
+    esp_hidd_send_keyboard_value(CONN, 0, keys, HID_KEYBOARD_IN_RPT_LEN);
+    CHECK_EQ(host_notify_count(), 0);
+}
+
+static void test_consumer(void)
+{
+    const host_notify_t *n;
+
+    host_notify_clear();
+    esp_hidd_send_consumer_value(CONN, HID_CONSUMER_VOLUME_UP, true);
+    n = sent_one(CONN, HIDD_LE_IDX_REPORT_CC_IN_VAL, HID_CC_IN_RPT_LEN);
+    if (n) CHECK(n->data[0] != 0);
+    esp_hidd_send_consumer_value(CONN, HID_CONSUMER_VOLUME_UP, false);
+    n = sent_one(CONN, HIDD_LE_IDX_REPORT_CC_IN_VAL, HID_CC_IN_RPT_LEN);
+    if (n) CHECK_EQ(n->data[0], 0);
+
+    esp_hidd_send_consumer_usage(CONN, HID_CONSUMER_AC_HOME);
+    n = sent_one(CONN, HIDD_LE_IDX_REPORT_CC_EXT_IN_VAL, HID_CC_EXT_IN_RPT_LEN);
+    if (n) CHECK_EQ(n->data[0] | (n->data[1] << 8), HID_CONSUMER_AC_HOME);
+    esp_hidd_send_consumer_usage(CONN, 0);
+    sent_one(CONN, HIDD_LE_IDX_REPORT_CC_EXT_IN_VAL, HID_CC_EXT_IN_RPT_LEN);
+
+    //usages above the logical maximum of the report map are not sent
+    esp_hidd_send_consumer_usage(CONN, HID_CONSUMER_USAGE_MAX + 1);
+    esp_hidd_send_consumer_tap(CONN, 0xFFFF);
+    host_time_advance(100000);
+    CHECK_EQ(host_notify_count(), 0);
+}
+
+static void test_consumer_tap(void)
+{
+    const host_notify_t *n;
+
+    host_notify_clear();
+    esp_hidd_send_consumer_tap(CONN, HID_CONSUMER_AC_BACK);
+    n = sent_one(CONN, HIDD_LE_IDX_REPORT_CC_EXT_IN_VAL, HID_CC_EXT_IN_RPT_LEN);
+    if (n) CHECK_EQ(n->data[0] | (n->data[1] << 8), HID_CONSUMER_AC_BACK);
+
+    //released one connection interval (6 * 1.25ms) later
+    host_time_advance(7000);
+    CHECK_EQ(host_notify_count(), 0);
+    host_time_advance(500);
+    n = sent_one(CONN, HIDD_LE_IDX_REPORT_CC_EXT_IN_VAL, HID_CC_EXT_IN_RPT_LEN);
+    if (n) CHECK_EQ(n->data[0] | (n->data[1] << 8), 0);
+    host_time_advance(100000);
+    CHECK_EQ(host_notify_count(), 0);
+
+    //unknown connection: nothing is sent
+    esp_hidd_send_consumer_tap(7, HID_CONSUMER_AC_BACK);
+    CHECK_EQ(host_notify_count(), 0);
+
+    //the host disconnects before the release, another one gets its slot: no release to the new host
+    host_app_connect(2);
+    esp_hidd_send_consumer_tap(2, HID_CONSUMER_AC_BACK);
+    host_app_disconnect(2);
+    host_app_connect(3);
+    host_notify_clear();
+    host_time_advance(100000);
+    CHECK_EQ(host_notify_count(), 0);
+    host_app_disconnect(3);
+
+    //same for a reconnect with the same conn_id
+    host_app_connect(2);
+    esp_hidd_send_consumer_tap(2, HID_CONSUMER_AC_BACK);
+    host_app_disconnect(2);
+    host_app_connect(2);
+    host_notify_clear();
+    host_time_advance(100000);
+    CHECK_EQ(host_notify_count(), 0);
+    host_app_disconnect(2);
+}
+
+static void test_mouse(void)
+{
+    const uint8_t expected[HID_MOUSE_IN_RPT_LEN] = { 0x01, 5, (uint8_t)-5, 1, 0 };
+    const host_notify_t *n;
+
+    host_notify_clear();
+    esp_hidd_send_mouse_value(CONN, 0x01, 5, -5, 1);
+    n = sent_one(CONN, HIDD_LE_IDX_REPORT_MOUSE_IN_VAL, HID_MOUSE_IN_RPT_LEN);
+    if (n) CHECK_MEM(n->data, expected, HID_MOUSE_IN_RPT_LEN);
+
+    //fractions of a detent are collected until a full detent can be sent
+    esp_hidd_send_mouse_hires_value(CONN, 0, 0, 0, HID_MOUSE_WHEEL_MULTIPLIER / 2, -HID_MOUSE_WHEEL_MULTIPLIER / 2);
+    n = sent_one(CONN, HIDD_LE_IDX_REPORT_MOUSE_IN_VAL, HID_MOUSE_IN_RPT_LEN);
+    if (n) CHECK_EQ(n->data[3], 0);
+    if (n) CHECK_EQ(n->data[4], 0);
+    esp_hidd_send_mouse_hires_value(CONN, 0, 0, 0, HID_MOUSE_WHEEL_MULTIPLIER / 2, -HID_MOUSE_WHEEL_MULTIPLIER / 2);
+    n = sent_one(CONN, HIDD_LE_IDX_REPORT_MOUSE_IN_VAL, HID_MOUSE_IN_RPT_LEN);
+    if (n) CHECK_EQ((int8_t)n->data[3], 1);
+    if (n) CHECK_EQ((int8_t)n->data[4], -1);
+}
+
+/** @brief One byte value a connection reads, -1 if the read was not answered */
+static int read_byte(uint16_t conn_id, int idx)
+{
+    uint8_t value = 0xFF;
+    uint16_t len = sizeof(value);
+    if (host_bt_read(conn_id, handle(idx), &value, &len) != ESP_GATT_OK) return -1;
+    CHECK_EQ(len, 1);
+    return value;
+}
+
+static void test_mouse_res_multiplier(void)
+{
+    uint8_t feature = HIDD_LE_RES_MULT_WHEEL;
+    const host_notify_t *n;
+
+    //the host enables the high-resolution wheel (not pan), the report has one byte
+    CHECK_EQ(host_bt_write(CONN, handle(HIDD_LE_IDX_REPORT_VAL), &feature, 2), ESP_GATT_INVALID_ATTR_LEN);
+    CHECK_EQ(host_bt_write(CONN, handle(HIDD_LE_IDX_REPORT_VAL), &feature, 1), ESP_GATT_OK);
+    host_notify_clear();
+    esp_hidd_send_mouse_hires_value(CONN, 0, 0, 0, 3, 3);
+    n = sent_one(CONN, HIDD_LE_IDX_REPORT_MOUSE_IN_VAL, HID_MOUSE_IN_RPT_LEN);
+    if (n) CHECK_EQ(n->data[3], 3);
+    if (n) CHECK_EQ(n->data[4], 0);
+    //a second host starts without multiplier & does not change the first one
+    CHECK_EQ(read_byte(CONN, HIDD_LE_IDX_REPORT_VAL), HIDD_LE_RES_MULT_WHEEL);
+    host_app_connect(1);
+    CHECK_EQ(read_byte(1, HIDD_LE_IDX_REPORT_VAL), 0);
+    CHECK_EQ(read_byte(CONN, HIDD_LE_IDX_REPORT_VAL), HIDD_LE_RES_MULT_WHEEL);
+    host_app_disconnect(1);
+    host_notify_clear();
+    //full detents are scaled up
+    esp_hidd_send_mouse_value(CONN, 0, 0, 0, -2);
+    n = sent_one(CONN, HIDD_LE_IDX_REPORT_MOUSE_IN_VAL, HID_MOUSE_IN_RPT_LEN);
+    if (n) CHECK_EQ((int8_t)n->data[3], -2 * HID_MOUSE_WHEEL_MULTIPLIER);
+
+    //more than 127 units are split, the movement is sent once
+    esp_hidd_send_mouse_value(CONN, 0x01, 4, 0, 40);
+    CHECK_EQ(host_notify_count(), 3);
+    n = host_notify_get(0);
+    if (n) CHECK_EQ(n->data[1], 4);
+    if (n) CHECK_EQ(n->data[3], 127);
+    n = host_notify_get(2);
+    if (n) CHECK_EQ(n->data[0], 0x01);
+    if (n) CHECK_EQ(n->data[1], 0);
+    if (n) CHECK_EQ(n->data[3], 40 * HID_MOUSE_WHEEL_MULTIPLIER - 2 * 127);
+
+    feature = 0;
+    host_bt_write(CONN, handle(HIDD_LE_IDX_REPORT_VAL), &feature, 1);
+    host_notify_clear();
+}
+
+#if CONFIG_MODULE_USEJOYSTICK
+static void test_joystick(void)
+{
+    const host_notify_t *n;
+#if CONFIG_MODULE_JOYSTICK_HIRES
+    uint8_t raw[HID_JOYSTICK_IN_RPT_LEN] = { 0x80, 0x7f };
+#endif
+
+    host_notify_clear();
+    esp_hidd_send_joy_value(CONN, 1, -1, 127, -127, 0, 2, 3, 0x80000001);
+#if CONFIG_MODULE_JOYSTICK_HIRES
+    n = sent_one(CONN, HIDD_LE_IDX_REPORT_JOY_IN_VAL, HID_JOYSTICK_HIRES_IN_RPT_LEN);
+    if (n) {
+        //8bit axes are scaled to 16bit
+        CHECK_EQ((int16_t)(n->data[0] | (n->data[1] << 8)), 258);
+        CHECK_EQ((int16_t)(n->data[2] | (n->data[3] << 8)), -258);
+        CHECK_EQ((int16_t)(n->data[4] | (n->data[5] << 8)), 32766);
+        CHECK_EQ((int16_t)(n->data[6] | (n->data[7] << 8)), -32766);
+        CHECK_EQ(n->data[16], 3);
+        CHECK_EQ(n->data[17], 0x01);
+        CHECK_EQ(n->data[20], 0x80);
+    }
+    //-128 (raw frames) is clamped to full deflection instead of wrapping around
+    esp_hidd_send_joy_report(CONN, raw);
+    n = sent_one(CONN, HIDD_LE_IDX_REPORT_JOY_IN_VAL, HID_JOYSTICK_HIRES_IN_RPT_LEN);
+    if (n) {
+        CHECK_EQ((int16_t)(n->data[0] | (n->data[1] << 8)), -32766);
+        CHECK_EQ((int16_t)(n->data[2] | (n->data[3] << 8)), 32766);
+    }
+#else
+    n = sent_one(CONN, HIDD_LE_IDX_REPORT_JOY_IN_VAL, HID_JOYSTICK_IN_RPT_LEN);
+    if (n) {
+        const uint8_t expected[HID_JOYSTICK_IN_RPT_LEN] = { 1, 0xff, 127, 0x81, 0, 2, 3, 0x01, 0, 0, 0x80 };
+        CHECK_MEM(n->data, expected, HID_JOYSTICK_IN_RPT_LEN);
+    }
+
+    //16bit axes are scaled down to 8bit
+    esp_hidd_send_joy_hires_value(CONN, 32766, -32766, 258, 0, 0, 0, 0xffff, 0, 5, 2);
+    n = sent_one(CONN, HIDD_LE_IDX_REPORT_JOY_IN_VAL, HID_JOYSTICK_IN_RPT_LEN);
+    if (n) {
+        CHECK_EQ((int8_t)n->data[0], 127);
+        CHECK_EQ((int8_t)n->data[1], -127);
+        CHECK_EQ((int8_t)n->data[2], 1);
+        CHECK_EQ(n->data[6], 5);
+        CHECK_EQ(n->data[7], 2);
+    }
+#endif
+}
+#endif
+
+static void test_confirm_failed(void)
+{
+    esp_ble_gatts_cb_param_t param = { 0 };
+    hid_stats_conn_t before, after;
+
+    CHECK_EQ(hid_stats_get_conn(CONN, &before), ESP_OK);
+    //a notification which was accepted, but not sent
+    param.conf.conn_id = CONN;
+    param.conf.status = ESP_GATT_OK;
+    host_bt_gatts_event(ESP_GATTS_CONF_EVT, host_bt_gatts_if(), &param);
+    param.conf.status = ESP_GATT_CONGESTED;
+    host_bt_gatts_event(ESP_GATTS_CONF_EVT, host_bt_gatts_if(), &param);
+    CHECK_EQ(hid_stats_get_conn(CONN, &after), ESP_OK);
+    CHECK_EQ(after.rejected, before.rejected + 1);
+    CHECK_EQ(after.submitted, before.submitted);
+}
+
+#if CONFIG_MODULE_TRACE
+static void test_trace_events(void)
+{
+    esp_ble_gap_cb_param_t gap = { 0 };
+    esp_ble_gatts_cb_param_t gatts = { 0 };
+    hid_trace_entry_t e;
+    const char *out;
+    int count = -1, size = 0, scans = 0, conf = 0;
+
+    CHECK_STR(host_app_cmd("TR C"), "");
+    //scan results are sampled
+    for (int i = 0; i < 2 * HID_TRACE_SCAN_SAMPLE + 1; i++) host_bt_gap_event(ESP_GAP_BLE_SCAN_RESULT_EVT, &gap);
+    gatts.conf.conn_id = CONN;
+    host_bt_gatts_event(ESP_GATTS_CONF_EVT, host_bt_gatts_if(), &gatts);
+
+    out = host_app_cmd("TR");
+    CHECK(sscanf(out, "TR:%d,%d", &count, &size) == 2);
+    CHECK_EQ(size, (int)sizeof(hid_trace_entry_t));
+    out = strchr(out, '\n');
+    if (out == NULL || size != (int)sizeof(hid_trace_entry_t)) return;
+    for (int i = 0; i < count; i++) {
+        memcpy(&e, out + 1 + i * size, size);
+        if (e.type == HID_TRACE_GAP && e.a8 == ESP_GAP_BLE_SCAN_RESULT_EVT) {
+            CHECK_EQ(e.a16, HID_TRACE_SCAN_SAMPLE);
+            scans++;
+        }
+        //the GATTS trace has the conn_id
+        if (e.type == HID_TRACE_GATTS && e.a8 == ESP_GATTS_CONF_EVT) {
+            CHECK_EQ(e.a16, CONN);
+            conf++;
+        }
+    }
+    CHECK_EQ(scans, 2);
+    CHECK_EQ(conf, 1);
+}
+#endif
+
+
+static void test_boot_mode(void)
+{
+    uint8_t mode = HID_PROTOCOL_MODE_BOOT;
+    uint8_t keys[6] = { HID_KEY_C, 0, 0, 0, 0, 0 };
+    const uint8_t boot_kb[HIDD_LE_BOOT_KB_IN_RPT_LEN] = { 0x01, 0, HID_KEY_C, 0, 0, 0, 0, 0 };
+    const host_notify_t *n;
+
+    host_bt_write(CONN, handle(HIDD_LE_IDX_PROTO_MODE_VAL), &mode, 1);
+    CHECK_EQ(hidd_le_env.boot_mode_cnt, 1);
+    host_notify_clear();
+
+    //keyboard & mouse are translated to the boot reports
+    esp_hidd_send_keyboard_value(CONN, 0x01, keys, 6);
+    n = sent_one(CONN, HIDD_LE_IDX_BOOT_KB_IN_REPORT_VAL, HIDD_LE_BOOT_KB_IN_RPT_LEN);
+    if (n) CHECK_MEM(n->data, boot_kb, HIDD_LE_BOOT_KB_IN_RPT_LEN);
+    esp_hidd_send_mouse_value(CONN, 0x02, 3, 4, 1);
+    n = sent_one(CONN, HIDD_LE_IDX_BOOT_MOUSE_IN_REPORT_VAL, HIDD_LE_BOOT_MOUSE_IN_RPT_LEN);
+    if (n) CHECK_EQ(n->data[0], 0x02);
+    //everything else is not available in boot mode
+    esp_hidd_send_consumer_usage(CONN, HID_CONSUMER_AC_HOME);
+#if CONFIG_MODULE_USEJOYSTICK
+    esp_hidd_send_joy_value(CONN, 0, 0, 0, 0, 0, 0, 0, 0);
+#endif
+    CHECK_EQ(host_notify_count(), 0);
+
+    mode = HID_PROTOCOL_MODE_REPORT;
+    host_bt_write(CONN, handle(HIDD_LE_IDX_PROTO_MODE_VAL), &mode, 1);
+    CHECK_EQ(hidd_le_env.boot_mode_cnt, 0);
+    esp_hidd_send_mouse_value(CONN, 0, 1, 1, 0);
+    sent_one(CONN, HIDD_LE_IDX_REPORT_MOUSE_IN_VAL, HID_MOUSE_IN_RPT_LEN);
+}
+
+static void test_second_connection(void)
+{
+    //a boot mode host does not change the reports of the other one
+    uint8_t mode = HID_PROTOCOL_MODE_BOOT;
+
+    host_app_connect(1);
+    host_bt_write(1, handle(HIDD_LE_IDX_PROTO_MODE_VAL), &mode, 1);
+    host_notify_clear();
+    esp_hidd_send_mouse_value(CONN, 0, 1, 1, 0);
+    sent_one(CONN, HIDD_LE_IDX_REPORT_MOUSE_IN_VAL, HID_MOUSE_IN_RPT_LEN);
+    esp_hidd_send_mouse_value(1, 0, 1, 1, 0);
+    sent_one(1, HIDD_LE_IDX_BOOT_MOUSE_IN_REPORT_VAL, HIDD_LE_BOOT_MOUSE_IN_RPT_LEN);
+
+    //each connection reads its own protocol mode, a new one starts in report mode
+    CHECK_EQ(read_byte(1, HIDD_LE_IDX_PROTO_MODE_VAL), HID_PROTOCOL_MODE_BOOT);
+    CHECK_EQ(read_byte(CONN, HIDD_LE_IDX_PROTO_MODE_VAL), HID_PROTOCOL_MODE_REPORT);
+    host_app_connect(2);
+    CHECK_EQ(read_byte(2, HIDD_LE_IDX_PROTO_MODE_VAL), HID_PROTOCOL_MODE_REPORT);
+    CHECK_EQ(read_byte(1, HIDD_LE_IDX_PROTO_MODE_VAL), HID_PROTOCOL_MODE_BOOT);
+    host_app_disconnect(2);
+
+    //the boot mode counter is released on disconnect
+    host_app_disconnect(1);
+    CHECK_EQ(hidd_le_env.boot_mode_cnt, 0);
+}
+
+int main(void)
+{
+    host_app_init();
+    host_app_connect(CONN);
+
+    RUN(test_service);
+    RUN(test_keyboard);
+    RUN(test_consumer);
+    RUN(test_consumer_tap);
+    RUN(test_mouse);
+    RUN(test_mouse_res_multiplier);
+#if CONFIG_MODULE_USEJOYSTICK
+    RUN(test_joystick);
+#endif
+    RUN(test_confirm_failed);
+#if CONFIG_MODULE_TRACE
+    RUN(test_trace_events);
+#endif
+    RUN(test_boot_mode);
+    RUN(test_second_connection);
+    return TEST_RESULT;
+}
@@ -0,0 +1,215 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * Copyright 2023:
+ * Benjamin Aigner <beni@asterics-foundation.org>,<aignerb@technikum-wien.at>
+ *
+ * Host tests of the UART parser (uart_parser.c, no other firmware code).
+ */
+
+#include <stdint.h>
+#include "uart_parser.h"
+#include "host_test.h"
+
+/* what the handlers have seen */
+static int starts, raws, cmds, binaries, binary_bytes;
+static int last_len;
+static uint8_t last[MAX_CMDLEN];
+/* if > 0, the next ASCII command requests a payload of this size */
+static int request_binary;
+
+static void on_start(struct cmdBuf *b) { starts++; }
+
+static void on_raw(struct cmdBuf *b)
+{
+    raws++;
+    last_len = b->bufferLength;
+    memcpy(last, b->buf, b->bufferLength);
+}
+
+static void on_cmd(struct cmdBuf *b)
+{
+    cmds++;
+    last_len = b->bufferLength;
+    strcpy((char *)last, (char *)b->buf);
+    if (request_binary) uart_parser_expect_binary(b, request_binary);
+    request_binary = 0;
+}
+
+static void on_binary(struct cmdBuf *b)
+{
+    binaries++;
+    binary_bytes += b->bufferLength;
+    CHECK(b->bufferLength > 0 && b->bufferLength <= MAX_CMDLEN);
+}
+
+static const uart_parser_handler_t handler = {
+    .frame_start = on_start,
+    .raw_frame = on_raw,
+    .ascii_cmd = on_cmd,
+    .binary_data = on_binary,
+};
+
+static struct cmdBuf buf;
+
+static void reset(void)
+{
+    uart_parser_init(&buf, 0);
+    starts = raws = cmds = binaries = binary_bytes = last_len = 0;
+    request_binary = 0;
+}
+
+static void feed(const void *data, int len)
+{
+    for (int i = 0; i < len; i++) uart_parser_feed(((const uint8_t *)data)[i], &buf, &handler);
+}
+
+static void test_raw_lengths(void)
+{
+    //keyboard, joystick, wide joystick: the type (byte 1) selects the length
+    static const struct { uint8_t type; int len; } frames[] = {
+        { 0x00, UART_PARSER_RAW_LEN }, { 0x03, UART_PARSER_RAW_LEN }, { 0x05, UART_PARSER_RAW_LEN },
+        { 0x01, UART_PARSER_JOY_LEN }, { 0x04, UART_PARSER_JOY_HIRES_LEN },
+    };
+    for (unsigned i = 0; i < sizeof(frames) / sizeof(frames[0]); i++) {
+        uint8_t frame[1 + UART_PARSER_JOY_HIRES_LEN] = { 0xfd, 0x00, frames[i].type };
+        reset();
+        for (int n = 2; n < frames[i].len; n++) frame[1 + n] = n;
+        feed(frame, frames[i].len);
+        CHECK_EQ(raws, 0);
+        feed(&frame[frames[i].len], 1);
+        CHECK_EQ(starts, 1);
+        CHECK_EQ(raws, 1);
+        CHECK_EQ(last_len, frames[i].len);
+        CHECK_MEM(last, &frame[1], frames[i].len);
+        CHECK_EQ(buf.state, CMDSTATE_IDLE);
+    }
+}
+
+static void test_raw_payload_not_parsed(void)
+{
+    //0xFD, '$' and line ends inside a frame are data
+    const uint8_t frame[] = { 0xfd, 0x0d, 0x03, 0xfd, '$', 0x0a, 0x0d, 0x00, 0x24 };
+    reset();
+    feed(frame, sizeof(frame));
+    CHECK_EQ(raws, 1);
+    CHECK_EQ(cmds, 0);
+    CHECK_MEM(last, &frame[1], UART_PARSER_RAW_LEN);
+    CHECK_EQ(starts, 1);
+}
+
+static void test_garbage_ignored(void)
+{
+    reset();
+    feed("abc\r\n\x00\xff", 7);
+    CHECK_EQ(raws + cmds + starts, 0);
+    CHECK_EQ(buf.state, CMDSTATE_IDLE);
+}
+
+static void test_ascii(void)
+{
+    reset();
+    feed("$ID\r\n", 5);
+    //CR ends the command, LF is ignored in idle state
+    CHECK_EQ(cmds, 1);
+    CHECK_STR((char *)last, "ID");
+    CHECK_EQ(last_len, 2);
+    feed("$SW 2\n$GC\r", 10);
+    CHECK_EQ(cmds, 3);
+    CHECK_STR((char *)last, "GC");
+    //an empty command is passed on too
+    feed("$\n", 2);
+    CHECK_EQ(cmds, 4);
+    CHECK_EQ(last_len, 0);
+}
+
+static void test_ascii_truncated(void)
+{
+    char cmd[3 * MAX_CMDLEN];
+    reset();
+    cmd[0] = '$';
+    memset(&cmd[1], 'A', sizeof(cmd) - 2);
+    cmd[sizeof(cmd) - 1] = '\n';
+    feed(cmd, sizeof(cmd));
+    CHECK_EQ(cmds, 1);
+    CHECK_EQ(last_len, MAX_CMDLEN - 1);
+    CHECK_EQ(strlen((char *)last), MAX_CMDLEN - 1);
+}
+
+static void test_frame_after_command(void)
+{
+    const uint8_t data[] = { '$', 'I', 'D', '\n', 0xfd, 0, 3, 1, 2, 3, 0, 0, 0 };
+    reset();
+    feed(data, sizeof(data));
+    CHECK_EQ(cmds, 1);
+    CHECK_EQ(raws, 1);
+    CHECK_EQ(last[2], 1);
+}
+
+static void test_binary(void)
+{
+    uint8_t payload[2 * MAX_CMDLEN + 17];
+    reset();
+    //the payload can contain anything, it is not parsed
+    for (unsigned i = 0; i < sizeof(payload); i++) payload[i] = i % 3 == 0 ? 0xfd : '$';
+    request_binary = sizeof(payload);
+    feed("$BD 0 217 0\n", 12);
+    CHECK_EQ(cmds, 1);
+    CHECK_EQ(buf.state, CMDSTATE_GET_BINARY);
+    feed(payload, sizeof(payload));
+    CHECK_EQ(binaries, 3);
+    CHECK_EQ(binary_bytes, sizeof(payload));
+    CHECK_EQ(buf.expectedBytes, 0);
+    CHECK_EQ(buf.state, CMDSTATE_IDLE);
+    CHECK_EQ(raws, 0);
+    CHECK_EQ(cmds, 1);
+    //back to normal parsing
+    feed("$ID\n", 4);
+    CHECK_EQ(cmds, 2);
+}
+
+static void test_binary_zero(void)
+{
+    reset();
+    uart_parser_expect_binary(&buf, 0);
+    CHECK_EQ(buf.state, CMDSTATE_IDLE);
+    uart_parser_expect_binary(&buf, -5);
+    CHECK_EQ(buf.state, CMDSTATE_IDLE);
+}
+
+static void test_invalid_state(void)
+{
+    reset();
+    buf.state = 42;
+    feed("$ID\n", 4);
+    //the first byte resets the state, the rest is a command without '$'
+    CHECK_EQ(buf.state, CMDSTATE_IDLE);
+    CHECK_EQ(cmds, 0);
+}
+
+int main(void)
+{
+    RUN(test_raw_lengths);
+    RUN(test_raw_payload_not_parsed);
+    RUN(test_garbage_ignored);
+    RUN(test_ascii);
+    RUN(test_ascii_truncated);
+    RUN(test_frame_after_command);
+    RUN(test_binary);
+    RUN(test_binary_zero);
+    RUN(test_invalid_state);
+    return TEST_RESULT;
+}
@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""Decode or replay a UART capture of esp32_mouse_keyboard ($CP command).
+
+Usage:
+    capture_replay.py <dump file>                       print the captured frames & commands
+    capture_replay.py -p /dev/ttyUSB0 [-b 9600] -o <dump file>   send $CP and save the reply (needs pyserial)
+    capture_replay.py <dump file> -r /dev/ttyUSB0 [-s 2]         send the capture to a device (needs pyserial)
+
+The dump is "CP:<count>,<entry size>\\r\\n", <count> binary entries,
+"\\r\\nEND\\r\\n". Each entry: uint32 timestamp (us), uint8 data (little endian).
+Replaying from the PC reproduces the gaps between frames with the original
+timing divided by --speed (0: as fast as possible). Unlike "$CP R" on the
+device, ASCII commands are sent as well; use --raw-only to skip them.
+Without a device, the host build replays a dump with simulated timing:
+test/host/replay_host <dump file> [speed].
+"""
+
+import argparse
+import re
+import struct
+import sys
+import time
+
+ENTRY = struct.Struct("<IB")
+
+# raw frame sizes after 0xFD, keep in sync with main/uart_parser.h
+RAW_LEN = 8
+RAW_LEN_BY_TYPE = {0x01: 13, 0x04: 23}
+FRAME_TYPES = {0x00: "keyboard", 0x01: "joystick", 0x02: "consumer", 0x03: "mouse",
+               0x04: "joystick16", 0x05: "mouse-hires"}
+
+
+def parse(data):
+    m = re.search(rb"CP:(\d+),(\d+)\r\n", data)
+    if not m:
+        raise ValueError("no capture header (CP:<count>,<size>) found")
+    count, size = int(m.group(1)), int(m.group(2))
+    if size != ENTRY.size:
+        raise ValueError("unsupported entry size %d" % size)
+    start = m.end()
+    payload = data[start:start + count * size]
+    if len(payload) < count * size:
+        raise ValueError("dump truncated: %d of %d bytes" % (len(payload), count * size))
+    entries = []
+    last = None
+    for i in range(count):
+        ts, byte = ENTRY.unpack_from(payload, i * size)
+        # timestamps are the lower 32 bit of the us timer, unwrap them
+        ts_full = ts if last is None else last[1] + ((ts - last[0]) & 0xFFFFFFFF)
+        last = (ts, ts_full)
+        entries.append((ts_full, byte))
+    return entries
+
+
+def split(entries):
+    """Split the byte stream like the device parser: yields (timestamp, kind, bytes)."""
+    i = 0
+    while i < len(entries):
+        ts, byte = entries[i]
+        if byte == 0xFD:
+            frame = [b for _, b in entries[i + 1:i + 1 + RAW_LEN]]
+            length = RAW_LEN_BY_TYPE.get(frame[1], RAW_LEN) if len(frame) > 1 else RAW_LEN
+            frame = [b for _, b in entries[i + 1:i + 1 + length]]
+            yield ts, "raw", bytes([0xFD] + frame)
+            i += 1 + length
+        elif byte == ord("$"):
+            j = i + 1
+            while j < len(entries) and entries[j][1] not in (0x0D, 0x0A):
+                j += 1
+            cmd = bytes(b for _, b in entries[i:j + 1])
+            yield ts, "cmd", cmd
+            i = j + 1
+            # $BD <offset> <len> <crc> is followed by <len> binary bytes
+            m = re.match(rb"\$BD \d+ (\d+) ", cmd)
+            if m and i < len(entries):
+                length = int(m.group(1))
+                yield entries[i][0], "bin", bytes(b for _, b in entries[i:i + length])
+                i += length
+        else:
+            yield ts, "skip", bytes([byte])
+            i += 1
+
+
+def print_frames(entries, out=sys.stdout):
+    base = prev = None
+    for ts, kind, data in split(entries):
+        if base is None:
+            base = prev = ts
+        if kind == "raw":
+            ftype = FRAME_TYPES.get(data[2], "type 0x%02X" % data[2]) if len(data) > 2 else "truncated"
+            text = "%s: %s" % (ftype, data[1:].hex(" "))
+        elif kind == "cmd":
+            text = "command %s" % data.decode("ascii", "replace").strip()
+        elif kind == "bin":
+            text = "binary data, %d bytes" % len(data)
+        else:
+            text = "ignored 0x%02X" % data[0]
+        out.write("%12.3f ms  +%8d us  %s\n" % ((ts - base) / 1000.0, ts - prev, text))
+        prev = ts
+
+
+def read_serial(port, baud):
+    import serial  # pyserial
+    with serial.Serial(port, baud, timeout=2) as ser:
+        ser.reset_input_buffer()
+        ser.write(b"$CP\n")
+        data = b""
+        while not data.endswith(b"\r\nEND\r\n"):
+            chunk = ser.read(1024)
+            if not chunk:
+                break
+            data += chunk
+    return data
+
+
+def replay(entries, port, baud, speed, raw_only):
+    import serial  # pyserial
+    frames = [f for f in split(entries) if f[1] == "raw" or (f[1] in ("cmd", "bin") and not raw_only)]
+    if not frames:
+        return
+    with serial.Serial(port, baud, timeout=2) as ser:
+        first = frames[0][0]
+        begin = time.monotonic()
+        max_lag = 0.0
+        for ts, _, data in frames:
+            if speed:
+                due = begin + (ts - first) / 1e6 / speed
+                wait = due - time.monotonic()
+                if wait > 0:
+                    time.sleep(wait)
+                max_lag = max(max_lag, time.monotonic() - due)
+            ser.write(data)
+        ser.flush()
+        duration = time.monotonic() - begin
+    print("sent %d frames in %.3f s (original %.3f s), max. lag %.1f ms" %
+          (len(frames), duration, (frames[-1][0] - first) / 1e6, max_lag * 1000))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("file", nargs="?", help="binary dump file")
+    parser.add_argument("-p", "--port", help="serial port, sends $CP and reads the dump")
+    parser.add_argument("-b", "--baud", type=int, default=9600, help="baudrate (default 9600, Nano: 115200)")
+    parser.add_argument("-o", "--output", help="save the dump read via --port to this file")
+    parser.add_argument("-r", "--replay", metavar="PORT", help="send the capture to this serial port")
+    parser.add_argument("-s", "--speed", type=float, default=1, help="replay speed (1: original, 0: max.)")
+    parser.add_argument("--raw-only", action="store_true", help="do not replay ASCII commands")
+    args = parser.parse_args()
+
+    if args.port:
+        data = read_serial(args.port, args.baud)
+        if args.output:
+            with open(args.output, "wb") as f:
+                f.write(data)
+    elif args.file:
+        with open(args.file, "rb") as f:
+            data = f.read()
+    else:
+        parser.error("either a dump file or --port is required")
+
+    try:
+        entries = parse(data)
+    except ValueError as e:
+        sys.exit("error: %s" % e)
+    if args.replay:
+        replay(entries, args.replay, args.baud, args.speed, args.raw_only)
+    else:
+        print_frames(entries)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+"""Write or read a binary key/value blob of esp32_mouse_keyboard ($BW/$BD/$BR).
+
+Usage:
+    kv_bulk.py -p /dev/ttyUSB0 [-b 9600] write <key> <file>   store the file as blob <key>
+    kv_bulk.py -p /dev/ttyUSB0 [-b 9600] read <key> <file>    save blob <key> to the file
+
+Writing: "$BW <key> <size> <crc32>" returns "BW:OK <offset>" (non-zero if an
+interrupted transfer of the same data is resumed). Each chunk is
+"$BD <offset> <len> <crc32>\\n" followed by <len> raw bytes and answered with
+"BD:OK <received>", "BD:DONE <size>" or "BD:<error> <received>"; on errors
+the transfer continues at <received>. CRCs are zlib.crc32, in hex.
+Reading: "$BR <key>" returns "BR:<size>,<offset>,<len>,<crc32>\\r\\n", the raw
+bytes and "\\r\\nEND\\r\\n". Requires pyserial.
+"""
+
+import argparse
+import re
+import sys
+import zlib
+
+# keep in sync with main/kv_bulk.h
+MAX_SIZE = 8192
+CHUNK = 1024
+RETRIES = 5
+
+
+def reply_line(ser, prefix):
+    """Read lines until one starts with prefix (log output may be interleaved)."""
+    while True:
+        line = ser.readline()
+        if not line:
+            raise IOError("timeout waiting for %s" % prefix)
+        line = line.decode("ascii", "replace").strip()
+        if line.startswith(prefix):
+            return line[len(prefix):]
+
+
+def write(ser, key, data):
+    if len(data) > MAX_SIZE:
+        raise ValueError("%d bytes, maximum is %d" % (len(data), MAX_SIZE))
+    ser.write(b"$BW %s %d %08x\n" % (key.encode(), len(data), zlib.crc32(data)))
+    answer = reply_line(ser, "BW:")
+    if not answer.startswith("OK"):
+        raise IOError("BW: %s" % answer)
+    offset = int(answer.split()[1])
+    errors = 0
+    while True:
+        chunk = data[offset:offset + CHUNK]
+        ser.write(b"$BD %d %d %08x\n" % (offset, len(chunk), zlib.crc32(chunk)) + chunk)
+        status, received = reply_line(ser, "BD:").split()
+        if status == "DONE":
+            return
+        if status != "OK":
+            errors += 1
+            if errors > RETRIES:
+                raise IOError("BD: %s at %s" % (status, received))
+        offset = int(received)
+
+
+def read(ser, key):
+    ser.write(b"$BR %s\n" % key.encode())
+    m = re.fullmatch(r"(\d+),(\d+),(\d+),([0-9A-Fa-f]{8})", reply_line(ser, "BR:"))
+    if not m:
+        raise IOError("BR: error or unexpected reply")
+    length, crc = int(m.group(3)), int(m.group(4), 16)
+    data = ser.read(length)
+    if len(data) != length or zlib.crc32(data) != crc:
+        raise IOError("BR: data incomplete or CRC mismatch")
+    ser.read(7)  # \r\nEND\r\n
+    return data
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-p", "--port", required=True, help="serial port")
+    parser.add_argument("-b", "--baud", type=int, default=9600, help="baudrate (default 9600, Nano: 115200)")
+    parser.add_argument("action", choices=("write", "read"))
+    parser.add_argument("key", help="NVS key, max. 15 characters")
+    parser.add_argument("file")
+    args = parser.parse_args()
+
+    import serial  # pyserial
+    with serial.Serial(args.port, args.baud, timeout=2) as ser:
+        ser.reset_input_buffer()
+        try:
+            if args.action == "write":
+                with open(args.file, "rb") as f:
+                    write(ser, args.key, f.read())
+            else:
+                data = read(ser, args.key)
+                with open(args.file, "wb") as f:
+                    f.write(data)
+        except (IOError, ValueError) as e:
+            sys.exit("error: %s" % e)
+
+
+if __name__ == "__main__":
+    main()
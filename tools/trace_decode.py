@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""Decode a binary event trace of esp32_mouse_keyboard ($TR command).
+
+Usage:
+    trace_decode.py <dump file>            decode a captured dump
+    trace_decode.py -p /dev/ttyUSB0 [-b 9600]   send $TR and decode the reply (needs pyserial)
+
+The dump is "TR:<count>,<entry size>\\r\\n", <count> binary entries,
+"\\r\\nEND\\r\\n". Each entry: uint32 timestamp (us), uint8 type, uint8 a8,
+uint16 a16 (little endian). Keep the event types in sync with main/hid_trace.h.
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+ENTRY = struct.Struct("<IBBH")
+
+FRAME_TYPES = {0x00: "keyboard", 0x01: "joystick", 0x02: "consumer", 0x03: "mouse",
+               0x04: "joystick16", 0x05: "mouse-hires"}
+REPORT_IDS = {1: "keyboard", 2: "consumer", 3: "mouse", 4: "joystick", 5: "consumer16", 6: "feature"}
+TASKS = {1: "console", 2: "timer"}
+GAP_EVENTS = {0: "ADV_DATA_SET_COMPLETE", 1: "SCAN_RSP_DATA_SET_COMPLETE", 6: "ADV_START_COMPLETE",
+              8: "AUTH_CMPL", 9: "KEY", 10: "SEC_REQ", 11: "PASSKEY_NOTIF", 12: "PASSKEY_REQ",
+              13: "OOB_REQ", 16: "NC_REQ", 17: "ADV_STOP_COMPLETE", 20: "UPDATE_CONN_PARAMS",
+              21: "SET_PKT_LENGTH_COMPLETE", 23: "REMOVE_BOND_DEV_COMPLETE",
+              24: "CLEAR_BOND_DEV_COMPLETE", 25: "GET_BOND_DEV_COMPLETE", 27: "UPDATE_WHITELIST_COMPLETE"}
+GATTS_EVENTS = {0: "REG", 1: "READ", 2: "WRITE", 3: "EXEC_WRITE", 4: "MTU", 5: "CONF", 7: "CREATE",
+                12: "START", 14: "CONNECT", 15: "DISCONNECT", 18: "CLOSE", 20: "CONGEST",
+                21: "RESPONSE", 22: "CREAT_ATTR_TAB", 23: "SET_ATTR_VAL"}
+
+
+def describe(evt, a8, a16):
+    if evt == 1:
+        return "frame start"
+    if evt == 2:
+        return "frame done: %s" % FRAME_TYPES.get(a8, "type 0x%02X" % a8)
+    if evt == 3:
+        cmd = bytes([a16 & 0xFF, a16 >> 8]).decode("ascii", "replace")
+        return "command $%s" % cmd
+    if evt == 4:
+        state = "REJECTED" if a16 & 0x8000 else "ok"
+        return "report %s -> conn %d (%s)" % (REPORT_IDS.get(a8, a8), a16 & 0x7FFF, state)
+    if evt == 5:
+        return "conn %d %s" % (a16, "congested" if a8 else "uncongested")
+    if evt == 6:
+        if a8 == 3:
+            return "GAP SCAN_RESULT (%d since the last one)" % a16
+        return "GAP %s" % GAP_EVENTS.get(a8, a8)
+    if evt == 7:
+        if a16 != 0xFFFF:
+            return "GATTS %s conn %d" % (GATTS_EVENTS.get(a8, a8), a16)
+        return "GATTS %s" % GATTS_EVENTS.get(a8, a8)
+    if evt == 8:
+        return "task wake: %s" % TASKS.get(a8, a8)
+    return "unknown event %d (%d, %d)" % (evt, a8, a16)
+
+
+def parse(data):
+    m = re.search(rb"TR:(\d+),(\d+)\r\n", data)
+    if not m:
+        raise ValueError("no trace header (TR:<count>,<size>) found")
+    count, size = int(m.group(1)), int(m.group(2))
+    if size != ENTRY.size:
+        raise ValueError("unsupported entry size %d" % size)
+    start = m.end()
+    payload = data[start:start + count * size]
+    if len(payload) < count * size:
+        raise ValueError("dump truncated: %d of %d bytes" % (len(payload), count * size))
+    return [ENTRY.unpack_from(payload, i * size) for i in range(count)]
+
+
+def print_timeline(entries, out=sys.stdout):
+    base = None
+    last = None
+    for ts, evt, a8, a16 in entries:
+        # timestamps are the lower 32 bit of the us timer, unwrap them
+        ts_full = ts if last is None else last[1] + ((ts - last[0]) & 0xFFFFFFFF)
+        last = (ts, ts_full)
+        if base is None:
+            base = ts_full
+            prev = ts_full
+        out.write("%12.3f ms  +%8d us  %s\n" % ((ts_full - base) / 1000.0, ts_full - prev, describe(evt, a8, a16)))
+        prev = ts_full
+
+
+def read_serial(port, baud):
+    import serial  # pyserial
+    with serial.Serial(port, baud, timeout=2) as ser:
+        ser.reset_input_buffer()
+        ser.write(b"$TR\n")
+        data = b""
+        while not data.endswith(b"\r\nEND\r\n"):
+            chunk = ser.read(256)
+            if not chunk:
+                break
+            data += chunk
+    return data
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("file", nargs="?", help="binary dump file")
+    parser.add_argument("-p", "--port", help="serial port, sends $TR and reads the dump")
+    parser.add_argument("-b", "--baud", type=int, default=9600, help="baudrate (default 9600, Nano: 115200)")
+    args = parser.parse_args()
+
+    if args.port:
+        data = read_serial(args.port, args.baud)
+    elif args.file:
+        with open(args.file, "rb") as f:
+            data = f.read()
+    else:
+        parser.error("either a dump file or --port is required")
+
+    try:
+        print_timeline(parse(data))
+    except ValueError as e:
+        sys.exit("error: %s" % e)
+
+
+if __name__ == "__main__":
+    main()